@@ -550,6 +550,16 @@ int _OS::get_dynamic_memory_usage() const {
 	return OS::get_singleton()->get_dynamic_memory_usage();
 }
 
+float _OS::get_dynamic_memory_fragmentation() const {
+
+	return Memory::get_dynamic_mem_fragmentation();
+}
+
+void _OS::defragment_dynamic_memory() {
+
+	Memory::defragment_dynamic_mem();
+}
+
 void _OS::set_icon(const Image &p_icon) {
 
 	OS::get_singleton()->set_icon(p_icon);
@@ -1148,6 +1158,8 @@ void _OS::_bind_methods() {
 	ObjectTypeDB::bind_method(_MD("get_static_memory_usage"), &_OS::get_static_memory_usage);
 	ObjectTypeDB::bind_method(_MD("get_static_memory_peak_usage"), &_OS::get_static_memory_peak_usage);
 	ObjectTypeDB::bind_method(_MD("get_dynamic_memory_usage"), &_OS::get_dynamic_memory_usage);
+	ObjectTypeDB::bind_method(_MD("get_dynamic_memory_fragmentation"), &_OS::get_dynamic_memory_fragmentation);
+	ObjectTypeDB::bind_method(_MD("defragment_dynamic_memory"), &_OS::defragment_dynamic_memory);
 
 	ObjectTypeDB::bind_method(_MD("get_data_dir"), &_OS::get_data_dir);
 	ObjectTypeDB::bind_method(_MD("get_system_dir", "dir"), &_OS::get_system_dir);
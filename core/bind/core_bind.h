@@ -258,6 +258,8 @@ public:
 	int get_static_memory_usage() const;
 	int get_static_memory_peak_usage() const;
 	int get_dynamic_memory_usage() const;
+	float get_dynamic_memory_fragmentation() const;
+	void defragment_dynamic_memory();
 
 	void delay_usec(uint32_t p_usec) const;
 	void delay_msec(uint32_t p_msec) const;
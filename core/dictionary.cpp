@@ -33,21 +33,216 @@
 #include "safe_refcount.h"
 #include "variant.h"
 
-struct _DictionaryVariantHash {
+struct DictionaryPrivate {
 
-	static _FORCE_INLINE_ uint32_t hash(const Variant &p_variant) { return p_variant.hash(); }
-};
+	struct Entry {
 
-struct DictionaryPrivate {
+		uint32_t hash; // 0 for a hole left by erase
+		Variant key;
+		Variant value;
+	};
 
 	SafeRefCount refcount;
-	HashMap<Variant, Variant, _DictionaryVariantHash> variant_map;
+	// Entries are kept in insertion order, the first 'used' of 'capacity'
+	// are constructed. Erasing leaves a hole which the next rebuild squeezes
+	// out, unless it was the last entry. The index table maps hash slots to
+	// entry + 1 and only ever holds live entries.
+	Entry *entries;
+	uint32_t *index;
+	int capacity;
+	int used;
+	int holes;
+	uint8_t index_power;
 	bool shared;
+
+	enum {
+		MIN_INDEX_POWER = 3
+	};
+
+	static _FORCE_INLINE_ uint32_t hash_key(const Variant &p_key) {
+
+		uint32_t hash = p_key.hash();
+		return hash ? hash : 1;
+	}
+
+	_FORCE_INLINE_ uint32_t slot(uint32_t p_hash) const {
+
+		return (p_hash * 2654435769U) >> (32 - index_power);
+	}
+
+	int find(const Variant &p_key, uint32_t p_hash) const {
+
+		if (!index)
+			return -1;
+
+		uint32_t mask = (1 << index_power) - 1;
+		for (uint32_t pos = slot(p_hash);; pos = (pos + 1) & mask) {
+
+			uint32_t e = index[pos];
+			if (!e)
+				return -1;
+			const Entry &entry = entries[e - 1];
+			if (entry.hash == p_hash && entry.key == p_key)
+				return e - 1;
+		}
+	}
+
+	void index_entry(int p_entry) {
+
+		uint32_t mask = (1 << index_power) - 1;
+		uint32_t pos = slot(entries[p_entry].hash);
+		while (index[pos])
+			pos = (pos + 1) & mask;
+		index[pos] = p_entry + 1;
+	}
+
+	int size() const {
+
+		return used - holes;
+	}
+
+	void rebuild(uint8_t p_power) {
+
+		if (holes) {
+			int to = 0;
+			for (int i = 0; i < used; i++) {
+
+				if (!entries[i].hash)
+					continue;
+				if (to != i)
+					entries[to] = entries[i];
+				to++;
+			}
+			for (int i = to; i < used; i++)
+				entries[i].~Entry();
+			used = to;
+			holes = 0;
+		}
+
+		if (index)
+			memfree(index);
+		index_power = p_power;
+		index = (uint32_t *)memalloc(sizeof(uint32_t) << index_power);
+		memset(index, 0, sizeof(uint32_t) << index_power);
+		for (int i = 0; i < used; i++)
+			index_entry(i);
+	}
+
+	int insert(const Variant &p_key, uint32_t p_hash) {
+
+		// Keep the index at most 3/4 full, holes go away on the way
+		if (!index) {
+			rebuild(MIN_INDEX_POWER);
+		} else if ((size() + 1) * 4 > (3 << index_power)) {
+			rebuild(index_power + 1);
+		}
+
+		if (used == capacity) {
+			// Variants can be moved around in memory, like Vector does
+			capacity = MAX(capacity * 2, 1 << MIN_INDEX_POWER);
+			entries = (Entry *)(entries ? memrealloc(entries, sizeof(Entry) * capacity) : memalloc(sizeof(Entry) * capacity));
+		}
+
+		int e = used++;
+		memnew_placement(&entries[e], Entry);
+		entries[e].hash = p_hash;
+		entries[e].key = p_key;
+		index_entry(e);
+		return e;
+	}
+
+	void erase(int p_entry) {
+
+		// Linear probing: close the gap by moving back any entry further
+		// along the run that could live in it
+		uint32_t mask = (1 << index_power) - 1;
+		uint32_t gap = slot(entries[p_entry].hash);
+		while (index[gap] != uint32_t(p_entry + 1))
+			gap = (gap + 1) & mask;
+		for (uint32_t pos = (gap + 1) & mask; index[pos]; pos = (pos + 1) & mask) {
+
+			uint32_t home = slot(entries[index[pos] - 1].hash);
+			if (((pos - home) & mask) >= ((pos - gap) & mask)) {
+				index[gap] = index[pos];
+				gap = pos;
+			}
+		}
+		index[gap] = 0;
+
+		if (p_entry == used - 1) {
+			entries[p_entry].~Entry();
+			used--;
+		} else {
+			entries[p_entry].hash = 0;
+			entries[p_entry].key = Variant();
+			entries[p_entry].value = Variant();
+			holes++;
+		}
+
+		if (size() == 0) {
+			clear();
+		} else if (holes > 8 && holes > size()) {
+			rebuild(index_power);
+		}
+	}
+
+	void copy_from(const DictionaryPrivate *p_from) {
+
+		if (!p_from->index)
+			return;
+
+		capacity = p_from->capacity;
+		used = p_from->used;
+		holes = p_from->holes;
+		index_power = p_from->index_power;
+		entries = (Entry *)memalloc(sizeof(Entry) * capacity);
+		for (int i = 0; i < used; i++)
+			memnew_placement(&entries[i], Entry(p_from->entries[i]));
+		index = (uint32_t *)memalloc(sizeof(uint32_t) << index_power);
+		memcpy(index, p_from->index, sizeof(uint32_t) << index_power);
+	}
+
+	void clear() {
+
+		for (int i = 0; i < used; i++)
+			entries[i].~Entry();
+		if (entries)
+			memfree(entries);
+		if (index)
+			memfree(index);
+
+		entries = NULL;
+		index = NULL;
+		capacity = 0;
+		used = 0;
+		holes = 0;
+		index_power = 0;
+	}
+
+	DictionaryPrivate() {
+
+		entries = NULL;
+		index = NULL;
+		capacity = 0;
+		used = 0;
+		holes = 0;
+		index_power = 0;
+		shared = false;
+	}
+
+	~DictionaryPrivate() {
+
+		clear();
+	}
 };
 
 void Dictionary::get_key_list(List<Variant> *p_keys) const {
 
-	_p->variant_map.get_key_list(p_keys);
+	for (int i = 0; i < _p->used; i++) {
+
+		if (_p->entries[i].hash)
+			p_keys->push_back(_p->entries[i].key);
+	}
 }
 
 void Dictionary::_copy_on_write() const {
@@ -56,9 +251,13 @@ void Dictionary::_copy_on_write() const {
 	if (_p->shared)
 		return;
 
+	// Nobody else sees it, no need to copy
+	if (_p->refcount.get() == 1)
+		return;
+
 	DictionaryPrivate *p = memnew(DictionaryPrivate);
 	p->shared = _p->shared;
-	p->variant_map = _p->variant_map;
+	p->copy_from(_p);
 	p->refcount.init();
 	_unref();
 	_p = p;
@@ -68,21 +267,34 @@ Variant &Dictionary::operator[](const Variant &p_key) {
 
 	_copy_on_write();
 
-	return _p->variant_map[p_key];
+	uint32_t hash = DictionaryPrivate::hash_key(p_key);
+	int e = _p->find(p_key, hash);
+	if (e < 0)
+		e = _p->insert(p_key, hash);
+
+	return _p->entries[e].value;
 }
 
 const Variant &Dictionary::operator[](const Variant &p_key) const {
 
-	return _p->variant_map[p_key];
+	const Variant *v = getptr(p_key);
+	ERR_FAIL_COND_V(!v, *v);
+	return *v;
 }
 const Variant *Dictionary::getptr(const Variant &p_key) const {
 
-	return _p->variant_map.getptr(p_key);
+	int e = _p->find(p_key, DictionaryPrivate::hash_key(p_key));
+	if (e < 0)
+		return NULL;
+	return &_p->entries[e].value;
 }
 Variant *Dictionary::getptr(const Variant &p_key) {
 
 	_copy_on_write();
-	return _p->variant_map.getptr(p_key);
+	int e = _p->find(p_key, DictionaryPrivate::hash_key(p_key));
+	if (e < 0)
+		return NULL;
+	return &_p->entries[e].value;
 }
 
 Variant Dictionary::get_valid(const Variant &p_key) const {
@@ -95,16 +307,16 @@ Variant Dictionary::get_valid(const Variant &p_key) const {
 
 int Dictionary::size() const {
 
-	return _p->variant_map.size();
+	return _p->size();
 }
 bool Dictionary::empty() const {
 
-	return !_p->variant_map.size();
+	return !_p->size();
 }
 
 bool Dictionary::has(const Variant &p_key) const {
 
-	return _p->variant_map.has(p_key);
+	return _p->find(p_key, DictionaryPrivate::hash_key(p_key)) >= 0;
 }
 
 bool Dictionary::has_all(const Array &p_keys) const {
@@ -118,7 +330,9 @@ bool Dictionary::has_all(const Array &p_keys) const {
 
 void Dictionary::erase(const Variant &p_key) {
 	_copy_on_write();
-	_p->variant_map.erase(p_key);
+	int e = _p->find(p_key, DictionaryPrivate::hash_key(p_key));
+	if (e >= 0)
+		_p->erase(e);
 }
 
 bool Dictionary::operator==(const Dictionary &p_dictionary) const {
@@ -145,7 +359,7 @@ void Dictionary::_ref(const Dictionary &p_from) const {
 void Dictionary::clear() {
 
 	_copy_on_write();
-	_p->variant_map.clear();
+	_p->clear();
 }
 
 bool Dictionary::is_shared() const {
@@ -165,13 +379,13 @@ uint32_t Dictionary::hash() const {
 
 	uint32_t h = hash_djb2_one_32(Variant::DICTIONARY);
 
-	List<Variant> keys;
-	get_key_list(&keys);
-
-	for (List<Variant>::Element *E = keys.front(); E; E = E->next()) {
+	for (int i = 0; i < _p->used; i++) {
 
-		h = hash_djb2_one_32(E->get().hash(), h);
-		h = hash_djb2_one_32(operator[](E->get()).hash(), h);
+		const DictionaryPrivate::Entry &e = _p->entries[i];
+		if (!e.hash)
+			continue;
+		h = hash_djb2_one_32(e.hash, h);
+		h = hash_djb2_one_32(e.value.hash(), h);
 	}
 
 	return h;
@@ -181,10 +395,11 @@ Array Dictionary::keys() const {
 
 	Array karr;
 	karr.resize(size());
-	const Variant *K = NULL;
 	int idx = 0;
-	while ((K = next(K))) {
-		karr[idx++] = (*K);
+	for (int i = 0; i < _p->used; i++) {
+
+		if (_p->entries[i].hash)
+			karr[idx++] = _p->entries[i].key;
 	}
 	return karr;
 }
@@ -193,17 +408,41 @@ Array Dictionary::values() const {
 
 	Array varr;
 	varr.resize(size());
-	const Variant *key = NULL;
-	int i = 0;
-	while ((key = next(key))) {
-		varr[i++] = _p->variant_map[*key];
+	int idx = 0;
+	for (int i = 0; i < _p->used; i++) {
+
+		if (_p->entries[i].hash)
+			varr[idx++] = _p->entries[i].value;
 	}
 	return varr;
 }
 
 const Variant *Dictionary::next(const Variant *p_key) const {
 
-	return _p->variant_map.next(p_key);
+	int from = 0;
+	if (p_key) {
+		// Keys handed out by this function sit in the entry array, the
+		// iterators of Variant pass a copy which has to be looked up
+		int e = -1;
+		if (_p->entries) {
+			size_t offset = (const char *)p_key - (const char *)&_p->entries[0].key;
+			if (offset < sizeof(DictionaryPrivate::Entry) * _p->used && offset % sizeof(DictionaryPrivate::Entry) == 0)
+				e = offset / sizeof(DictionaryPrivate::Entry);
+		}
+		if (e < 0) {
+			e = _p->find(*p_key, DictionaryPrivate::hash_key(*p_key));
+			ERR_FAIL_COND_V(e < 0, NULL);
+		}
+		from = e + 1;
+	}
+
+	for (int i = from; i < _p->used; i++) {
+
+		if (_p->entries[i].hash)
+			return &_p->entries[i].key;
+	}
+
+	return NULL;
 }
 
 Error Dictionary::parse_json(const String &p_json) {
@@ -92,6 +92,45 @@ void CameraMatrix::set_perspective(float p_fovy_degrees, float p_aspect, float p
 	matrix[3][3] = 0;
 }
 
+void CameraMatrix::set_perspective(float p_fovy_degrees, float p_aspect, float p_z_near, float p_z_far, bool p_flip_fov, int p_eye, float p_intraocular_dist, float p_convergence_dist) {
+
+	if (p_flip_fov) {
+		p_fovy_degrees = get_fovy(p_fovy_degrees, 1.0 / p_aspect);
+	}
+
+	float left, right, modeltranslation, ymax, xmax, frustumshift;
+
+	ymax = p_z_near * Math::tan(Math::deg2rad(p_fovy_degrees / 2.0));
+	xmax = ymax * p_aspect;
+	frustumshift = (p_intraocular_dist / 2.0) * p_z_near / p_convergence_dist;
+
+	switch (p_eye) {
+		case 1: { // left eye
+			left = -xmax + frustumshift;
+			right = xmax + frustumshift;
+			modeltranslation = p_intraocular_dist / 2.0;
+		} break;
+		case 2: { // right eye
+			left = -xmax - frustumshift;
+			right = xmax - frustumshift;
+			modeltranslation = -p_intraocular_dist / 2.0;
+		} break;
+		default: { // mono, same result as the regular perspective
+			left = -xmax;
+			right = xmax;
+			modeltranslation = 0.0;
+		} break;
+	}
+
+	set_frustum(left, right, -ymax, ymax, p_z_near, p_z_far);
+
+	// translate matrix by (modeltranslation, 0.0, 0.0)
+	CameraMatrix cm;
+	cm.set_identity();
+	cm.matrix[3][0] = modeltranslation;
+	*this = *this * cm;
+}
+
 void CameraMatrix::set_orthogonal(float p_left, float p_right, float p_bottom, float p_top, float p_znear, float p_zfar) {
 
 	set_identity();
@@ -348,6 +387,21 @@ Vector<Plane> CameraMatrix::get_projection_planes(const Transform &p_transform)
 	return planes;
 }
 
+Vector<Plane> CameraMatrix::get_stereo_projection_planes(const Transform &p_transform, float p_intraocular_dist, float p_convergence_dist) const {
+
+	Vector<Plane> planes = get_projection_planes(p_transform);
+
+	// Side planes start at each eye and open as wide as the most divergent
+	// eye frustum, which contains both.
+	float spread = 1.0 / matrix[0][0] + p_intraocular_dist * 0.5 / p_convergence_dist;
+	Vector3 left_normal = Vector3(-1, 0, spread).normalized();
+	Vector3 right_normal = Vector3(1, 0, spread).normalized();
+	planes[PLANE_LEFT] = p_transform.xform(Plane(left_normal, left_normal.x * -p_intraocular_dist * 0.5));
+	planes[PLANE_RIGHT] = p_transform.xform(Plane(right_normal, right_normal.x * p_intraocular_dist * 0.5));
+
+	return planes;
+}
+
 CameraMatrix CameraMatrix::inverse() const {
 
 	CameraMatrix cm = *this;
@@ -53,6 +53,7 @@ struct CameraMatrix {
 	void set_zero();
 	void set_light_bias();
 	void set_perspective(float p_fovy_degrees, float p_aspect, float p_z_near, float p_z_far, bool p_flip_fov = false);
+	void set_perspective(float p_fovy_degrees, float p_aspect, float p_z_near, float p_z_far, bool p_flip_fov, int p_eye, float p_intraocular_dist, float p_convergence_dist);
 	void set_orthogonal(float p_left, float p_right, float p_bottom, float p_top, float p_znear, float p_zfar);
 	void set_orthogonal(float p_size, float p_aspect, float p_znear, float p_zfar, bool p_flip_fov = false);
 	void set_frustum(float p_left, float p_right, float p_bottom, float p_top, float p_near, float p_far);
@@ -68,6 +69,8 @@ struct CameraMatrix {
 	float get_fov() const;
 
 	Vector<Plane> get_projection_planes(const Transform &p_transform) const;
+	// Frustum containing both eyes of a stereo pair built from this mono perspective
+	Vector<Plane> get_stereo_projection_planes(const Transform &p_transform, float p_intraocular_dist, float p_convergence_dist) const;
 
 	bool get_endpoints(const Transform &p_transform, Vector3 *p_8points) const;
 	void get_viewport_size(float &r_width, float &r_height) const;
@@ -285,6 +285,16 @@ int MessageQueue::get_max_buffer_usage() const {
 	return buffer_max_used;
 }
 
+int MessageQueue::get_frame_max_buffer_usage() const {
+
+	return buffer_frame_max_used;
+}
+
+void MessageQueue::reset_frame_max_buffer_usage() {
+
+	buffer_frame_max_used = 0;
+}
+
 void MessageQueue::_call_function(Object *p_target, const StringName &p_func, const Variant *p_args, int p_argcount, bool p_show_error) {
 
 	const Variant **argptrs = NULL;
@@ -309,6 +319,8 @@ void MessageQueue::flush() {
 		buffer_max_used = buffer_end;
 		//statistics();
 	}
+	if (buffer_end > buffer_frame_max_used)
+		buffer_frame_max_used = buffer_end;
 
 	uint32_t read_pos = 0;
 
@@ -381,6 +393,7 @@ MessageQueue::MessageQueue() {
 
 	buffer_end = 0;
 	buffer_max_used = 0;
+	buffer_frame_max_used = 0;
 	buffer_size = GLOBAL_DEF("core/message_queue_size_kb", DEFAULT_QUEUE_SIZE_KB);
 	buffer_size *= 1024;
 	buffer = memnew_arr(uint8_t, buffer_size);
@@ -68,6 +68,7 @@ class MessageQueue {
 	uint8_t *buffer;
 	uint32_t buffer_end;
 	uint32_t buffer_max_used;
+	uint32_t buffer_frame_max_used;
 	uint32_t buffer_size;
 
 	void _call_function(Object *p_target, const StringName &p_func, const Variant *p_args, int p_argcount, bool p_show_error);
@@ -91,6 +92,9 @@ public:
 	void flush();
 
 	int get_max_buffer_usage() const;
+	// peak since the last reset, Performance resets it once per frame
+	int get_frame_max_buffer_usage() const;
+	void reset_frame_max_buffer_usage();
 
 	MessageQueue();
 	~MessageQueue();
@@ -0,0 +1,467 @@
+/*************************************************************************/
+/*  oa_hash_map.h                                                        */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+#ifndef OA_HASH_MAP_H
+#define OA_HASH_MAP_H
+
+#include "hash_map.h"
+
+/**
+ * @class OAHashMap
+ *
+ * Open addressing variant of HashMap, with the same interface. Hashes, keys
+ * and values live in three flat arrays, so there is no allocation per
+ * element and a lookup mostly walks the hash array. Collisions are resolved
+ * by linear probing with Robin Hood displacement, which keeps probe lengths
+ * short even at high load, and erasing shifts the following entries back
+ * instead of leaving tombstones.
+ *
+ * Unlike HashMap, inserting or erasing moves entries around: pointers
+ * returned by getptr(), operator[] or next() are only valid until the map
+ * is modified.
+ *
+ * @param TKey  Key, search is based on it, needs to be hasheable. It is unique in this container.
+ * @param TData Data, data associated with the key
+ * @param Hasher Hasher object, needs to provide a valid static hash function for TKey
+ * @param Comparator comparator object, needs to be able to safely compare two TKey values.
+ * @param MIN_CAPACITY_POWER Minimum size of the table, as a power of two.
+ */
+
+template <class TKey, class TData, class Hasher = HashMapHasherDefault, class Comparator = HashMapComparatorDefault<TKey>, uint8_t MIN_CAPACITY_POWER = 3>
+class OAHashMap {
+
+	enum {
+		EMPTY_HASH = 0,
+		// Grow once more than 3/4 of the slots are used
+		MAX_LOAD_NUM = 3,
+		MAX_LOAD_DEN = 4
+	};
+
+	uint32_t *hashes;
+	TKey *keys;
+	TData *values;
+	uint8_t capacity_power;
+	uint32_t elements;
+
+	_FORCE_INLINE_ uint32_t _get_capacity() const { return hashes ? 1 << capacity_power : 0; }
+
+	static _FORCE_INLINE_ uint32_t _fix_hash(uint32_t p_hash) {
+
+		// Zero marks an empty slot
+		return p_hash == EMPTY_HASH ? 1 : p_hash;
+	}
+
+	_FORCE_INLINE_ uint32_t _home(uint32_t p_hash) const {
+
+		// Fibonacci hashing spreads sequential ids and aligned pointers,
+		// which would otherwise pile up in neighbouring slots
+		return (p_hash * 2654435769U) >> (32 - capacity_power);
+	}
+
+	_FORCE_INLINE_ uint32_t _distance(uint32_t p_hash, uint32_t p_pos) const {
+
+		return (p_pos - _home(p_hash)) & ((1 << capacity_power) - 1);
+	}
+
+	template <class C>
+	_FORCE_INLINE_ bool _lookup_pos(const C &p_key, uint32_t p_hash, uint32_t &r_pos) const {
+
+		if (!hashes)
+			return false;
+
+		uint32_t mask = (1 << capacity_power) - 1;
+		uint32_t pos = _home(p_hash);
+		uint32_t distance = 0;
+
+		while (true) {
+
+			uint32_t h = hashes[pos];
+			if (h == EMPTY_HASH)
+				return false;
+			// Anything further along would have displaced this entry
+			if (distance > _distance(h, pos))
+				return false;
+			if (h == p_hash && Comparator::compare(keys[pos], p_key)) {
+				r_pos = pos;
+				return true;
+			}
+
+			pos = (pos + 1) & mask;
+			distance++;
+		}
+	}
+
+	uint32_t _insert(uint32_t p_hash, const TKey &p_key, const TData &p_data) {
+
+		uint32_t mask = (1 << capacity_power) - 1;
+		uint32_t hash = p_hash;
+		TKey key = p_key;
+		TData data = p_data;
+
+		uint32_t pos = _home(hash);
+		uint32_t distance = 0;
+		uint32_t result = mask + 1;
+
+		while (true) {
+
+			if (hashes[pos] == EMPTY_HASH) {
+
+				hashes[pos] = hash;
+				memnew_placement(&keys[pos], TKey(key));
+				memnew_placement(&values[pos], TData(data));
+				elements++;
+				return result > mask ? pos : result;
+			}
+
+			// Take the place of entries closer to home than the one carried,
+			// then carry on with what was there
+			uint32_t existing = _distance(hashes[pos], pos);
+			if (existing < distance) {
+
+				SWAP(hash, hashes[pos]);
+				SWAP(key, keys[pos]);
+				SWAP(data, values[pos]);
+				if (result > mask)
+					result = pos;
+				distance = existing;
+			}
+
+			pos = (pos + 1) & mask;
+			distance++;
+		}
+	}
+
+	void _resize(uint8_t p_power) {
+
+		uint32_t old_capacity = _get_capacity();
+		uint32_t *old_hashes = hashes;
+		TKey *old_keys = keys;
+		TData *old_values = values;
+
+		capacity_power = p_power;
+		uint32_t capacity = 1 << capacity_power;
+		hashes = (uint32_t *)memalloc(sizeof(uint32_t) * capacity);
+		keys = (TKey *)memalloc(sizeof(TKey) * capacity);
+		values = (TData *)memalloc(sizeof(TData) * capacity);
+		for (uint32_t i = 0; i < capacity; i++)
+			hashes[i] = EMPTY_HASH;
+
+		elements = 0;
+		for (uint32_t i = 0; i < old_capacity; i++) {
+
+			if (old_hashes[i] == EMPTY_HASH)
+				continue;
+
+			_insert(old_hashes[i], old_keys[i], old_values[i]);
+			old_keys[i].~TKey();
+			old_values[i].~TData();
+		}
+
+		if (old_hashes) {
+			memfree(old_hashes);
+			memfree(old_keys);
+			memfree(old_values);
+		}
+	}
+
+	void _reserve_one() {
+
+		if (!hashes) {
+			_resize(MIN_CAPACITY_POWER);
+		} else if ((elements + 1) * MAX_LOAD_DEN > _get_capacity() * MAX_LOAD_NUM) {
+			_resize(capacity_power + 1);
+		}
+	}
+
+	void _erase_pos(uint32_t p_pos) {
+
+		uint32_t mask = (1 << capacity_power) - 1;
+		uint32_t pos = p_pos;
+		keys[pos].~TKey();
+		values[pos].~TData();
+
+		// Shift the following run back one slot, until an entry that is
+		// already home or an empty slot ends it
+		uint32_t next = (pos + 1) & mask;
+		while (hashes[next] != EMPTY_HASH && _distance(hashes[next], next) != 0) {
+
+			hashes[pos] = hashes[next];
+			memnew_placement(&keys[pos], TKey(keys[next]));
+			memnew_placement(&values[pos], TData(values[next]));
+			keys[next].~TKey();
+			values[next].~TData();
+
+			pos = next;
+			next = (next + 1) & mask;
+		}
+
+		hashes[pos] = EMPTY_HASH;
+		elements--;
+	}
+
+	void copy_from(const OAHashMap &p_map) {
+
+		if (&p_map == this)
+			return;
+
+		clear();
+
+		if (!p_map.hashes)
+			return;
+
+		_resize(p_map.capacity_power);
+		for (uint32_t i = 0; i < p_map._get_capacity(); i++) {
+
+			if (p_map.hashes[i] != EMPTY_HASH)
+				_insert(p_map.hashes[i], p_map.keys[i], p_map.values[i]);
+		}
+	}
+
+public:
+	void set(const TKey &p_key, const TData &p_data) {
+
+		uint32_t hash = _fix_hash(Hasher::hash(p_key));
+		uint32_t pos;
+		if (_lookup_pos(p_key, hash, pos)) {
+			values[pos] = p_data;
+			return;
+		}
+
+		_reserve_one();
+		_insert(hash, p_key, p_data);
+	}
+
+	bool has(const TKey &p_key) const {
+
+		return getptr(p_key) != NULL;
+	}
+
+	/**
+	 * Get a key from data, return a const reference.
+	 * WARNING: this doesn't check errors, use either getptr and check NULL, or check
+	 * first with has(key)
+	 */
+
+	const TData &get(const TKey &p_key) const {
+
+		const TData *res = getptr(p_key);
+		ERR_FAIL_COND_V(!res, *res);
+		return *res;
+	}
+
+	TData &get(const TKey &p_key) {
+
+		TData *res = getptr(p_key);
+		ERR_FAIL_COND_V(!res, *res);
+		return *res;
+	}
+
+	_FORCE_INLINE_ TData *getptr(const TKey &p_key) {
+
+		uint32_t pos;
+		if (_lookup_pos(p_key, _fix_hash(Hasher::hash(p_key)), pos))
+			return &values[pos];
+		return NULL;
+	}
+
+	_FORCE_INLINE_ const TData *getptr(const TKey &p_key) const {
+
+		uint32_t pos;
+		if (_lookup_pos(p_key, _fix_hash(Hasher::hash(p_key)), pos))
+			return &values[pos];
+		return NULL;
+	}
+
+	/**
+	 * Same as getptr, with a custom key (that should support operator==()) and its hash.
+	 */
+
+	template <class C>
+	_FORCE_INLINE_ TData *custom_getptr(C p_custom_key, uint32_t p_custom_hash) {
+
+		uint32_t pos;
+		if (_lookup_pos(p_custom_key, _fix_hash(p_custom_hash), pos))
+			return &values[pos];
+		return NULL;
+	}
+
+	template <class C>
+	_FORCE_INLINE_ const TData *custom_getptr(C p_custom_key, uint32_t p_custom_hash) const {
+
+		uint32_t pos;
+		if (_lookup_pos(p_custom_key, _fix_hash(p_custom_hash), pos))
+			return &values[pos];
+		return NULL;
+	}
+
+	/**
+	 * Erase an item, return true if erasing was succesful
+	 */
+
+	bool erase(const TKey &p_key) {
+
+		uint32_t pos;
+		if (!_lookup_pos(p_key, _fix_hash(Hasher::hash(p_key)), pos))
+			return false;
+
+		_erase_pos(pos);
+		if (elements == 0)
+			clear();
+		return true;
+	}
+
+	inline const TData &operator[](const TKey &p_key) const { //constref
+
+		return get(p_key);
+	}
+
+	inline TData &operator[](const TKey &p_key) { //assignment
+
+		uint32_t hash = _fix_hash(Hasher::hash(p_key));
+		uint32_t pos;
+		if (!_lookup_pos(p_key, hash, pos)) {
+			_reserve_one();
+			pos = _insert(hash, p_key, TData());
+		}
+
+		return values[pos];
+	}
+
+	/**
+	 * Get the next key to p_key, and the first key if p_key is null.
+	 * Returns a pointer to the next key if found, NULL otherwise.
+	 * Adding/Removing elements while iterating will, of course, have unexpected results, don't do it.
+	 */
+	const TKey *next(const TKey *p_key) const {
+
+		if (!hashes)
+			return NULL;
+
+		uint32_t capacity = _get_capacity();
+		uint32_t pos = 0;
+		if (p_key >= keys && p_key < keys + capacity) {
+			// One of ours, the slot follows from the pointer
+			pos = (p_key - keys) + 1;
+		} else if (p_key) {
+			// A copy of a key, find where it is
+			ERR_FAIL_COND_V(!_lookup_pos(*p_key, _fix_hash(Hasher::hash(*p_key)), pos), NULL);
+			pos++;
+		}
+
+		for (; pos < capacity; pos++) {
+
+			if (hashes[pos] != EMPTY_HASH)
+				return &keys[pos];
+		}
+
+		return NULL;
+	}
+
+	inline unsigned int size() const {
+
+		return elements;
+	}
+
+	inline bool empty() const {
+
+		return elements == 0;
+	}
+
+	// Table slots, for diagnostics
+	inline unsigned int get_capacity() const {
+
+		return _get_capacity();
+	}
+
+	void clear() {
+
+		if (hashes) {
+			uint32_t capacity = _get_capacity();
+			for (uint32_t i = 0; i < capacity; i++) {
+
+				if (hashes[i] == EMPTY_HASH)
+					continue;
+				keys[i].~TKey();
+				values[i].~TData();
+			}
+
+			memfree(hashes);
+			memfree(keys);
+			memfree(values);
+		}
+
+		hashes = NULL;
+		keys = NULL;
+		values = NULL;
+		capacity_power = 0;
+		elements = 0;
+	}
+
+	void get_key_list(List<TKey> *p_keys) const {
+
+		uint32_t capacity = _get_capacity();
+		for (uint32_t i = 0; i < capacity; i++) {
+
+			if (hashes[i] != EMPTY_HASH)
+				p_keys->push_back(keys[i]);
+		}
+	}
+
+	void operator=(const OAHashMap &p_map) {
+
+		copy_from(p_map);
+	}
+
+	OAHashMap() {
+
+		hashes = NULL;
+		keys = NULL;
+		values = NULL;
+		capacity_power = 0;
+		elements = 0;
+	}
+
+	OAHashMap(const OAHashMap &p_map) {
+
+		hashes = NULL;
+		keys = NULL;
+		values = NULL;
+		capacity_power = 0;
+		elements = 0;
+
+		copy_from(p_map);
+	}
+
+	~OAHashMap() {
+
+		clear();
+	}
+};
+
+#endif
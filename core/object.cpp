@@ -1787,9 +1787,9 @@ void postinitialize_handler(Object *p_object) {
 	p_object->_postinitialize();
 }
 
-HashMap<uint32_t, Object *> ObjectDB::instances;
+OAHashMap<uint32_t, Object *> ObjectDB::instances;
 uint32_t ObjectDB::instance_counter = 1;
-HashMap<Object *, ObjectID, ObjectDB::ObjectPtrHash> ObjectDB::instance_checks;
+OAHashMap<Object *, ObjectID, ObjectDB::ObjectPtrHash> ObjectDB::instance_checks;
 uint32_t ObjectDB::add_instance(Object *p_object) {
 
 	GLOBAL_LOCK_FUNCTION;
@@ -33,6 +33,7 @@
 
 #include "list.h"
 #include "map.h"
+#include "oa_hash_map.h"
 #include "set.h"
 #include "variant.h"
 #include "vmap.h"
@@ -395,7 +396,7 @@ private:
 		Signal() { lock = 0; }
 	};
 
-	HashMap<StringName, Signal, StringNameHasher> signal_map;
+	OAHashMap<StringName, Signal, StringNameHasher> signal_map;
 	List<Connection> connections;
 #ifdef DEBUG_ENABLED
 	SafeRefCount _lock_index;
@@ -681,8 +682,8 @@ class ObjectDB {
 		}
 	};
 
-	static HashMap<uint32_t, Object *> instances;
-	static HashMap<Object *, ObjectID, ObjectPtrHash> instance_checks;
+	static OAHashMap<uint32_t, Object *> instances;
+	static OAHashMap<Object *, ObjectID, ObjectPtrHash> instance_checks;
 
 	static uint32_t instance_counter;
 	friend class Object;
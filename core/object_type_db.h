@@ -122,7 +122,7 @@ class ObjectTypeDB {
 	struct TypeInfo {
 
 		TypeInfo *inherits_ptr;
-		HashMap<StringName, MethodBind *, StringNameHasher> method_map;
+		OAHashMap<StringName, MethodBind *, StringNameHasher> method_map;
 		HashMap<StringName, int, StringNameHasher> constant_map;
 		HashMap<StringName, MethodInfo, StringNameHasher> signal_map;
 		List<PropertyInfo> property_list;
@@ -267,6 +267,7 @@ struct InputEvent {
 	uint32_t ID;
 	int type;
 	int device;
+	int screen; // pointer events: the screen they happened on, 0 is the main one
 
 	union {
 		InputEventMouseMotion mouse_motion;
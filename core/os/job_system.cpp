@@ -0,0 +1,279 @@
+/*************************************************************************/
+/*  job_system.cpp                                                       */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "job_system.h"
+#include "os/os.h"
+#include "os/zone_profiler.h"
+#include "safe_refcount.h"
+
+JobSystem *JobSystem::singleton = NULL;
+
+JobSystem *JobSystem::get_singleton() {
+
+	return singleton;
+}
+
+void JobSystem::_worker_func(void *p_userdata) {
+
+	Worker *w = (Worker *)p_userdata;
+	JobSystem *js = w->owner;
+	w->id = Thread::get_caller_ID();
+	ZONE_THREAD_NAME("Job worker " + itos(w->index));
+
+	while (!js->exit_threads) {
+
+		Job job;
+		if (js->_take(w->index, job)) {
+			js->_run(job);
+			continue;
+		}
+
+		js->semaphore->wait();
+	}
+}
+
+int JobSystem::_get_queue_index() const {
+
+	Thread::ID caller = Thread::get_caller_ID();
+	for (int i = 0; i < worker_count; i++) {
+		if (workers[i].id == caller)
+			return i;
+	}
+	return worker_count;
+}
+
+bool JobSystem::_push(int p_queue, const Job &p_job) {
+
+	Queue &q = queues[p_queue];
+	q.mutex->lock();
+	if (q.bottom - q.top >= QUEUE_SIZE) {
+		q.mutex->unlock();
+		return false;
+	}
+	q.jobs[q.bottom % QUEUE_SIZE] = p_job;
+	q.bottom++;
+	q.mutex->unlock();
+	return true;
+}
+
+bool JobSystem::_pop(int p_queue, Job &r_job) {
+
+	Queue &q = queues[p_queue];
+	q.mutex->lock();
+	if (q.bottom == q.top) {
+		q.mutex->unlock();
+		return false;
+	}
+	q.bottom--;
+	r_job = q.jobs[q.bottom % QUEUE_SIZE];
+	q.mutex->unlock();
+	return true;
+}
+
+bool JobSystem::_steal(int p_queue, Job &r_job) {
+
+	Queue &q = queues[p_queue];
+	if (q.bottom == q.top)
+		return false; // racy peek, saves the lock on empty queues
+
+	q.mutex->lock();
+	if (q.bottom == q.top) {
+		q.mutex->unlock();
+		return false;
+	}
+	r_job = q.jobs[q.top % QUEUE_SIZE];
+	q.top++;
+	q.mutex->unlock();
+	return true;
+}
+
+bool JobSystem::_take(int p_queue, Job &r_job) {
+
+	if (_pop(p_queue, r_job))
+		return true;
+
+	int queue_count = worker_count + 1;
+	for (int i = 1; i < queue_count; i++) {
+
+		if (_steal((p_queue + i) % queue_count, r_job)) {
+			atomic_increment(&steal_count);
+			return true;
+		}
+	}
+	return false;
+}
+
+void JobSystem::_run(const Job &p_job) {
+
+	ZONE_SCOPE("JobSystem::job");
+	for (int i = p_job.begin; i < p_job.end; i++) {
+		p_job.func(p_job.userdata, i);
+	}
+	atomic_decrement(&p_job.group->pending);
+}
+
+void JobSystem::init(int p_threads) {
+
+	ERR_FAIL_COND(worker_count > 0);
+
+#ifdef NO_THREADS
+	int threads = 0;
+#else
+	int threads = CLAMP(p_threads, 0, int(MAX_WORKERS));
+#endif
+	int cores = OS::get_singleton()->get_processor_count();
+
+	for (int i = 0; i < threads; i++) {
+
+		Worker &w = workers[worker_count];
+		w.owner = this;
+		w.index = worker_count;
+		w.id = 0;
+
+		// the main thread keeps core 0
+		Thread::Settings settings;
+		settings.core = i + 1 < cores ? i + 1 : -1;
+		w.thread = Thread::create(_worker_func, &w, settings);
+		if (!w.thread)
+			break; // wait() runs whatever the workers can't
+
+		worker_count++;
+	}
+
+	// wait for the workers to know who they are, so their dispatches use their own queues
+	for (int i = 0; i < worker_count; i++) {
+		while (!workers[i].id)
+			OS::get_singleton()->yield();
+	}
+}
+
+void JobSystem::finish() {
+
+	exit_threads = true;
+	for (int i = 0; i < worker_count; i++) {
+		semaphore->post();
+	}
+	for (int i = 0; i < worker_count; i++) {
+		Thread::wait_to_finish(workers[i].thread);
+		memdelete(workers[i].thread);
+	}
+	worker_count = 0;
+	exit_threads = false;
+}
+
+void JobSystem::dispatch(JobFunc p_func, void *p_userdata, int p_count, Group *p_group, int p_batch) {
+
+	ERR_FAIL_COND(!p_group);
+	if (p_count <= 0)
+		return;
+
+	int batch = MAX(p_batch, 1);
+	int jobs = (p_count + batch - 1) / batch;
+	atomic_add(&p_group->pending, jobs);
+
+	int home = _get_queue_index();
+
+	for (int i = 0; i < jobs; i++) {
+
+		Job job;
+		job.func = p_func;
+		job.userdata = p_userdata;
+		job.begin = i * batch;
+		job.end = MIN(job.begin + batch, p_count);
+		job.group = p_group;
+
+		// workers keep their jobs close, anyone else deals them out
+		int queue = home;
+		if (home == worker_count && worker_count) {
+			queue = next_queue;
+			next_queue = (next_queue + 1) % worker_count;
+		}
+
+		if (!_push(queue, job))
+			_run(job); // queue full, don't wait for room
+	}
+
+	int wake = MIN(jobs, worker_count);
+	for (int i = 0; i < wake; i++) {
+		semaphore->post();
+	}
+}
+
+void JobSystem::wait(Group *p_group) {
+
+	ERR_FAIL_COND(!p_group);
+
+	int home = _get_queue_index();
+	// a locked read, so the jobs' results are visible once it says they're done
+	while (atomic_add(&p_group->pending, 0)) {
+
+		Job job;
+		if (_take(home, job))
+			_run(job);
+		else
+			OS::get_singleton()->yield(); // the last jobs are running elsewhere
+	}
+}
+
+void JobSystem::run(JobFunc p_func, void *p_userdata, int p_count, int p_batch) {
+
+	Group group;
+	dispatch(p_func, p_userdata, p_count, &group, p_batch);
+	wait(&group);
+}
+
+JobSystem::JobSystem() {
+
+	singleton = this;
+	worker_count = 0;
+	next_queue = 0;
+	exit_threads = false;
+	steal_count = 0;
+
+	for (int i = 0; i < MAX_WORKERS + 1; i++) {
+		queues[i].mutex = Mutex::create();
+		queues[i].top = 0;
+		queues[i].bottom = 0;
+	}
+	semaphore = Semaphore::create();
+}
+
+JobSystem::~JobSystem() {
+
+	finish();
+
+	for (int i = 0; i < MAX_WORKERS + 1; i++) {
+		memdelete(queues[i].mutex);
+	}
+	memdelete(semaphore);
+
+	if (singleton == this)
+		singleton = NULL;
+}
@@ -0,0 +1,129 @@
+/*************************************************************************/
+/*  job_system.h                                                         */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include "os/mutex.h"
+#include "os/semaphore.h"
+#include "os/thread.h"
+#include "typedefs.h"
+
+/**
+	Runs batches of small jobs on a set of worker threads, one per spare
+	core. Every worker owns a queue: it takes its newest job first and,
+	when its queue runs dry, steals the oldest job from another queue.
+	Jobs dispatched from outside the workers are spread over their queues.
+
+	A thread waiting on a group doesn't block, it runs queued jobs until
+	the group is done, so nesting dispatches inside jobs is fine and a
+	system with no workers simply runs everything in wait().
+*/
+
+class JobSystem {
+public:
+	typedef void (*JobFunc)(void *p_userdata, int p_index);
+
+	// Counts the jobs of a dispatch still to run, wait() on it before using their results
+	struct Group {
+		uint32_t pending;
+		Group() { pending = 0; }
+	};
+
+	enum {
+		MAX_WORKERS = 8,
+		QUEUE_SIZE = 256,
+	};
+
+private:
+	struct Job {
+		JobFunc func;
+		void *userdata;
+		int begin;
+		int end;
+		Group *group;
+	};
+
+	struct Queue {
+		Mutex *mutex;
+		Job jobs[QUEUE_SIZE];
+		int top; // oldest, where thieves take from
+		int bottom; // newest, where the owner pushes and pops
+	};
+
+	struct Worker {
+		JobSystem *owner;
+		Thread *thread;
+		volatile Thread::ID id;
+		int index;
+	};
+
+	static JobSystem *singleton;
+
+	Worker workers[MAX_WORKERS];
+	int worker_count;
+	// one per worker, plus one shared by every other thread
+	Queue queues[MAX_WORKERS + 1];
+	int next_queue;
+
+	Semaphore *semaphore;
+	volatile bool exit_threads;
+	uint32_t steal_count;
+
+	static void _worker_func(void *p_userdata);
+
+	int _get_queue_index() const;
+	bool _push(int p_queue, const Job &p_job);
+	bool _pop(int p_queue, Job &r_job);
+	bool _steal(int p_queue, Job &r_job);
+	bool _take(int p_queue, Job &r_job);
+	void _run(const Job &p_job);
+
+public:
+	static JobSystem *get_singleton();
+
+	// Starts p_threads workers, worker i pinned to core i + 1 when the platform has it
+	void init(int p_threads);
+	void finish();
+
+	// Calls p_func for every index in [0, p_count), p_batch indices per job
+	void dispatch(JobFunc p_func, void *p_userdata, int p_count, Group *p_group, int p_batch = 1);
+	void wait(Group *p_group);
+	// dispatch() then wait()
+	void run(JobFunc p_func, void *p_userdata, int p_count, int p_batch = 1);
+
+	int get_worker_count() const { return worker_count; }
+	uint32_t get_steal_count() const { return steal_count; }
+
+	JobSystem();
+	~JobSystem();
+};
+
+#endif // JOB_SYSTEM_H
@@ -79,11 +79,23 @@ size_t Memory::get_static_mem_usage() {
 	return MemoryPoolStatic::get_singleton()->get_total_usage();
 }
 
+float Memory::get_static_mem_fragmentation() {
+
+	ERR_FAIL_COND_V(!MemoryPoolStatic::get_singleton(), 0);
+	return MemoryPoolStatic::get_singleton()->get_fragmentation();
+}
+
 void Memory::dump_static_mem_to_file(const char *p_file) {
 
 	MemoryPoolStatic::get_singleton()->dump_mem_to_file(p_file);
 }
 
+void Memory::release_thread_cache() {
+
+	if (MemoryPoolStatic::get_singleton())
+		MemoryPoolStatic::get_singleton()->release_thread_cache();
+}
+
 MID Memory::alloc_dynamic(size_t p_bytes, const char *p_descr) {
 
 	MemoryPoolDynamic::ID id = MemoryPoolDynamic::get_singleton()->alloc(p_bytes, p_descr);
@@ -110,6 +122,16 @@ size_t Memory::get_dynamic_mem_usage() {
 	return MemoryPoolDynamic::get_singleton()->get_total_usage();
 }
 
+float Memory::get_dynamic_mem_fragmentation() {
+
+	return MemoryPoolDynamic::get_singleton()->get_fragmentation();
+}
+
+void Memory::defragment_dynamic_mem() {
+
+	MemoryPoolDynamic::get_singleton()->defragment();
+}
+
 _GlobalNil::_GlobalNil() {
 
 	color = 1;
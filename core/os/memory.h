@@ -189,13 +189,17 @@ public:
 	static size_t get_static_mem_available();
 	static size_t get_static_mem_usage();
 	static size_t get_static_mem_max_usage();
+	static float get_static_mem_fragmentation();
 	static void dump_static_mem_to_file(const char *p_file);
+	static void release_thread_cache();
 
 	static MID alloc_dynamic(size_t p_bytes, const char *p_descr = "");
 	static Error realloc_dynamic(MID p_mid, size_t p_bytes);
 
 	static size_t get_dynamic_mem_available();
 	static size_t get_dynamic_mem_usage();
+	static float get_dynamic_mem_fragmentation();
+	static void defragment_dynamic_mem();
 };
 
 template <class T>
@@ -37,7 +37,10 @@ MemoryPoolDynamic *MemoryPoolDynamic::get_singleton() {
 	return singleton;
 }
 
-MemoryPoolDynamic::MemoryPoolDynamic() {
+MemoryPoolDynamic::MemoryPoolDynamic(bool p_make_default) {
+
+	if (!p_make_default)
+		return;
 
 	ERR_FAIL_COND(singleton != NULL);
 	singleton = this;
@@ -45,5 +48,6 @@ MemoryPoolDynamic::MemoryPoolDynamic() {
 
 MemoryPoolDynamic::~MemoryPoolDynamic() {
 
-	singleton = NULL;
+	if (singleton == this)
+		singleton = NULL;
 }
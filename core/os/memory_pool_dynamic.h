@@ -64,8 +64,12 @@ protected:
 
 	virtual size_t get_available_mem() const = 0;
 	virtual size_t get_total_usage() const = 0;
+	// 0 when all free memory is one block, towards 1 as it splits into holes
+	virtual float get_fragmentation() const { return 0; }
+	// move unlocked blocks together so free memory becomes contiguous again
+	virtual void defragment() {}
 
-	MemoryPoolDynamic();
+	MemoryPoolDynamic(bool p_make_default = true);
 
 public:
 	virtual ~MemoryPoolDynamic();
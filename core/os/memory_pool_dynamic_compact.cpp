@@ -0,0 +1,435 @@
+/*************************************************************************/
+/*  memory_pool_dynamic_compact.cpp                                      */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "memory_pool_dynamic_compact.h"
+#include "os/copymem.h"
+#include "os/memory.h"
+#include "os/os.h"
+#include "print_string.h"
+#include "ustring.h"
+
+MemoryPoolDynamicCompact::Handle *MemoryPoolDynamicCompact::_get_handle(ID p_id) {
+
+	uint64_t idx = p_id >> CHECK_BITS;
+	uint32_t check = p_id & ((1 << CHECK_BITS) - 1);
+
+	if (idx >= (uint64_t)handle_max || check == 0 || handles[idx].check != check)
+		return NULL;
+
+	return &handles[idx];
+}
+
+const MemoryPoolDynamicCompact::Handle *MemoryPoolDynamicCompact::_get_handle(ID p_id) const {
+
+	uint64_t idx = p_id >> CHECK_BITS;
+	uint32_t check = p_id & ((1 << CHECK_BITS) - 1);
+
+	if (idx >= (uint64_t)handle_max || check == 0 || handles[idx].check != check)
+		return NULL;
+
+	return &handles[idx];
+}
+
+int MemoryPoolDynamicCompact::_alloc_handle() {
+
+	if (handle_first_free == -1) {
+
+		int new_max = handle_max * 2;
+		Handle *new_handles = (Handle *)Memory::realloc_static(handles, sizeof(Handle) * new_max);
+		ERR_FAIL_COND_V(!new_handles, -1);
+		handles = new_handles;
+
+		for (int i = handle_max; i < new_max; i++) {
+			handles[i].check = 0;
+			handles[i].next_free = (i + 1 < new_max) ? i + 1 : -1;
+		}
+
+		handle_first_free = handle_max;
+		handle_max = new_max;
+	}
+
+	int idx = handle_first_free;
+	Handle &h = handles[idx];
+	handle_first_free = h.next_free;
+
+	if (++last_check > CHECK_MAX)
+		last_check = 1;
+
+	h.check = last_check;
+	h.pool_id = POOL_ALLOCATOR_INVALID_ID;
+	h.heap_mem = NULL;
+	h.size = 0;
+	h.lock = 0;
+	h.descr = "";
+	h.next_free = -1;
+
+	return idx;
+}
+
+void MemoryPoolDynamicCompact::_free_handle(int p_index) {
+
+	handles[p_index].check = 0;
+	handles[p_index].next_free = handle_first_free;
+	handle_first_free = p_index;
+}
+
+PoolAllocator::ID MemoryPoolDynamicCompact::_pool_alloc(size_t p_amount) {
+
+	if (p_amount == 0 || p_amount > (size_t)pool->get_free_mem())
+		return POOL_ALLOCATOR_INVALID_ID;
+
+	if (pool->get_entry_count() >= pool->get_max_entries())
+		return POOL_ALLOCATOR_INVALID_ID;
+
+	// PoolAllocator compacts on its own when no hole fits, which would stall
+	// this frame for an unbounded time. Leave that to defragment().
+	size_t aligned = (p_amount + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+	if ((size_t)pool->get_largest_free_block() < aligned)
+		return POOL_ALLOCATOR_INVALID_ID;
+
+	return pool->alloc(p_amount);
+}
+
+MemoryPoolDynamic::ID MemoryPoolDynamicCompact::alloc(size_t p_amount, const char *p_description) {
+
+	_THREAD_SAFE_METHOD_
+
+	int idx = _alloc_handle();
+	ERR_FAIL_COND_V(idx == -1, INVALID_ID);
+
+	Handle &h = handles[idx];
+	h.pool_id = _pool_alloc(p_amount);
+
+	if (h.pool_id == POOL_ALLOCATOR_INVALID_ID) {
+
+		h.heap_mem = memalloc(p_amount);
+		if (!h.heap_mem) {
+			_free_handle(idx);
+			return INVALID_ID;
+		}
+
+		heap_usage += p_amount;
+		heap_blocks++;
+	}
+
+	h.size = p_amount;
+	h.descr = p_description;
+
+	return ((ID)idx << CHECK_BITS) | h.check;
+}
+
+void MemoryPoolDynamicCompact::free(ID p_id) {
+
+	_THREAD_SAFE_METHOD_
+
+	Handle *h = _get_handle(p_id);
+	ERR_FAIL_COND(!h);
+
+	if (h->lock > 0) {
+
+		ERR_PRINT("Freed ID Still locked");
+	}
+
+	if (h->pool_id != POOL_ALLOCATOR_INVALID_ID) {
+
+		for (uint32_t i = 0; i < h->lock; i++)
+			pool->unlock(h->pool_id);
+		pool->free(h->pool_id);
+	} else {
+
+		memfree(h->heap_mem);
+		heap_usage -= h->size;
+		heap_blocks--;
+	}
+
+	_free_handle(p_id >> CHECK_BITS);
+}
+
+Error MemoryPoolDynamicCompact::realloc(ID p_id, size_t p_amount) {
+
+	_THREAD_SAFE_METHOD_
+
+	Handle *h = _get_handle(p_id);
+	ERR_FAIL_COND_V(!h, ERR_INVALID_PARAMETER);
+	ERR_FAIL_COND_V(h->lock > 0, ERR_LOCKED);
+
+	if (h->pool_id == POOL_ALLOCATOR_INVALID_ID) {
+
+		void *new_mem = memrealloc(h->heap_mem, p_amount);
+		ERR_FAIL_COND_V(!new_mem, ERR_OUT_OF_MEMORY);
+
+		heap_usage -= h->size;
+		heap_usage += p_amount;
+		h->heap_mem = new_mem;
+		h->size = p_amount;
+		return OK;
+	}
+
+	if (p_amount > 0 && p_amount <= (size_t)pool->get_free_mem() + h->size && pool->resize_in_place(h->pool_id, p_amount)) {
+
+		h->size = p_amount;
+		return OK;
+	}
+
+	// no room behind it, move it to another hole or out to the heap
+	PoolAllocator::ID new_id = _pool_alloc(p_amount);
+	void *new_mem = NULL;
+
+	if (new_id == POOL_ALLOCATOR_INVALID_ID) {
+
+		new_mem = memalloc(p_amount);
+		ERR_FAIL_COND_V(!new_mem, ERR_OUT_OF_MEMORY);
+	}
+
+	pool->lock(h->pool_id);
+	if (new_id != POOL_ALLOCATOR_INVALID_ID) {
+		pool->lock(new_id);
+		copymem(pool->get(new_id), pool->get(h->pool_id), MIN(h->size, p_amount));
+		pool->unlock(new_id);
+	} else {
+		copymem(new_mem, pool->get(h->pool_id), MIN(h->size, p_amount));
+	}
+	pool->unlock(h->pool_id);
+	pool->free(h->pool_id);
+
+	h->pool_id = new_id;
+	h->heap_mem = new_mem;
+	h->size = p_amount;
+
+	if (new_mem) {
+		heap_usage += p_amount;
+		heap_blocks++;
+	}
+
+	return OK;
+}
+
+bool MemoryPoolDynamicCompact::is_valid(ID p_id) {
+
+	_THREAD_SAFE_METHOD_
+
+	return _get_handle(p_id) != NULL;
+}
+
+size_t MemoryPoolDynamicCompact::get_size(ID p_id) const {
+
+	_THREAD_SAFE_METHOD_
+
+	const Handle *h = _get_handle(p_id);
+	ERR_FAIL_COND_V(!h, 0);
+
+	return h->size;
+}
+
+const char *MemoryPoolDynamicCompact::get_description(ID p_id) const {
+
+	_THREAD_SAFE_METHOD_
+
+	const Handle *h = _get_handle(p_id);
+	ERR_FAIL_COND_V(!h, "");
+
+	return h->descr;
+}
+
+bool MemoryPoolDynamicCompact::is_locked(ID p_id) const {
+
+	_THREAD_SAFE_METHOD_
+
+	const Handle *h = _get_handle(p_id);
+	ERR_FAIL_COND_V(!h, false);
+
+	return h->lock > 0;
+}
+
+Error MemoryPoolDynamicCompact::lock(ID p_id) {
+
+	_THREAD_SAFE_METHOD_
+
+	Handle *h = _get_handle(p_id);
+	ERR_FAIL_COND_V(!h, ERR_INVALID_PARAMETER);
+
+	// the arena keeps its own count so compaction skips the block
+	if (h->pool_id != POOL_ALLOCATOR_INVALID_ID)
+		pool->lock(h->pool_id);
+	h->lock++;
+
+	return OK;
+}
+
+void *MemoryPoolDynamicCompact::get(ID p_id) {
+
+	_THREAD_SAFE_METHOD_
+
+	Handle *h = _get_handle(p_id);
+	ERR_FAIL_COND_V(!h, NULL);
+	ERR_FAIL_COND_V(h->lock == 0, NULL);
+
+	if (h->pool_id != POOL_ALLOCATOR_INVALID_ID)
+		return pool->get(h->pool_id);
+
+	return h->heap_mem;
+}
+
+Error MemoryPoolDynamicCompact::unlock(ID p_id) {
+
+	_THREAD_SAFE_METHOD_
+
+	Handle *h = _get_handle(p_id);
+	ERR_FAIL_COND_V(!h, ERR_INVALID_PARAMETER);
+	ERR_FAIL_COND_V(h->lock == 0, ERR_INVALID_PARAMETER);
+
+	if (h->pool_id != POOL_ALLOCATOR_INVALID_ID)
+		pool->unlock(h->pool_id);
+	h->lock--;
+
+	return OK;
+}
+
+size_t MemoryPoolDynamicCompact::get_available_mem() const {
+
+	return pool->get_free_mem();
+}
+
+size_t MemoryPoolDynamicCompact::get_total_usage() const {
+
+	_THREAD_SAFE_METHOD_
+
+	return pool->get_used_mem() + heap_usage;
+}
+
+float MemoryPoolDynamicCompact::get_fragmentation() const {
+
+	_THREAD_SAFE_METHOD_
+
+	int free_mem = pool->get_free_mem();
+	if (free_mem == 0)
+		return 0;
+
+	return 1.0 - (float)pool->get_largest_free_block() / free_mem;
+}
+
+void MemoryPoolDynamicCompact::defragment() {
+
+	_THREAD_SAFE_METHOD_
+
+	pool->defragment();
+
+	// now that the free space is in one piece, bring overflow blocks home
+	for (int i = 0; i < handle_max && heap_blocks > 0; i++) {
+
+		Handle &h = handles[i];
+		if (h.check == 0 || h.pool_id != POOL_ALLOCATOR_INVALID_ID || h.lock > 0)
+			continue;
+
+		PoolAllocator::ID id = _pool_alloc(h.size);
+		if (id == POOL_ALLOCATOR_INVALID_ID)
+			continue;
+
+		pool->lock(id);
+		copymem(pool->get(id), h.heap_mem, h.size);
+		pool->unlock(id);
+
+		memfree(h.heap_mem);
+		heap_usage -= h.size;
+		heap_blocks--;
+
+		h.pool_id = id;
+		h.heap_mem = NULL;
+	}
+}
+
+int MemoryPoolDynamicCompact::get_arena_size() const {
+
+	return pool->get_free_mem() + pool->get_used_mem();
+}
+
+int MemoryPoolDynamicCompact::get_heap_block_count() const {
+
+	_THREAD_SAFE_METHOD_
+
+	return heap_blocks;
+}
+
+size_t MemoryPoolDynamicCompact::get_heap_usage() const {
+
+	_THREAD_SAFE_METHOD_
+
+	return heap_usage;
+}
+
+size_t MemoryPoolDynamicCompact::get_largest_free_block() const {
+
+	_THREAD_SAFE_METHOD_
+
+	return pool->get_largest_free_block();
+}
+
+MemoryPoolDynamicCompact::MemoryPoolDynamicCompact(int p_arena_size, int p_max_blocks, bool p_make_default)
+	: MemoryPoolDynamic(p_make_default) {
+
+	pool = memnew(PoolAllocator(ARENA_ALIGN, p_arena_size, true, p_max_blocks));
+
+	handle_max = MIN_HANDLES;
+	handles = (Handle *)Memory::alloc_static(sizeof(Handle) * handle_max, "MemoryPoolDynamicCompact");
+	for (int i = 0; i < handle_max; i++) {
+		handles[i].check = 0;
+		handles[i].next_free = (i + 1 < handle_max) ? i + 1 : -1;
+	}
+	handle_first_free = 0;
+	last_check = 0;
+
+	heap_usage = 0;
+	heap_blocks = 0;
+}
+
+MemoryPoolDynamicCompact::~MemoryPoolDynamicCompact() {
+
+	int leaked = 0;
+	for (int i = 0; i < handle_max; i++) {
+
+		Handle &h = handles[i];
+		if (h.check == 0)
+			continue;
+
+#ifdef DEBUG_MEMORY_ENABLED
+		if (OS::get_singleton() && OS::get_singleton()->is_stdout_verbose())
+			ERR_PRINT(String("\t" + String::num(h.size) + " bytes - " + String(h.descr)).ascii().get_data());
+#endif
+		if (h.pool_id == POOL_ALLOCATOR_INVALID_ID)
+			memfree(h.heap_mem);
+		leaked++;
+	}
+
+	if (leaked > 0 && OS::get_singleton() && OS::get_singleton()->is_stdout_verbose())
+		print_line("INFO: dynmem - " + itos(leaked) + " blocks leaked.");
+
+	memdelete(pool);
+	Memory::free_static(handles);
+}
@@ -0,0 +1,118 @@
+/*************************************************************************/
+/*  memory_pool_dynamic_compact.h                                        */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#ifndef MEMORY_POOL_DYNAMIC_COMPACT_H
+#define MEMORY_POOL_DYNAMIC_COMPACT_H
+
+#include "os/memory_pool_dynamic.h"
+#include "os/thread_safe.h"
+#include "pool_allocator.h"
+
+/**
+	Dynamic pool that keeps its blocks inside one PoolAllocator arena so
+	they can be moved. Users only see blocks through lock()/get(), so any
+	block that is not locked may be slid down by defragment(), merging the
+	holes left by freed DVector and Image buffers back into one free block.
+
+	Allocation never compacts implicitly, to keep frame times flat: when no
+	hole is big enough (or the arena is out of entries) the block is taken
+	from the static heap instead. defragment() compacts the arena and then
+	pulls unlocked heap blocks back in while they fit. IDs index a handle
+	table, so they stay valid while blocks move between arena and heap.
+*/
+
+class MemoryPoolDynamicCompact : public MemoryPoolDynamic {
+
+	_THREAD_SAFE_CLASS_
+
+	enum {
+		CHECK_BITS = 16,
+		CHECK_MAX = (1 << CHECK_BITS) - 2, // keeps IDs clear of INVALID_ID
+		ARENA_ALIGN = 16,
+		MIN_HANDLES = 256
+	};
+
+	struct Handle {
+
+		PoolAllocator::ID pool_id; // POOL_ALLOCATOR_INVALID_ID while the block lives on the heap
+		void *heap_mem;
+		size_t size;
+		uint32_t lock;
+		uint32_t check; // 0 when the handle is free
+		const char *descr;
+		int next_free;
+	};
+
+	PoolAllocator *pool;
+
+	Handle *handles;
+	int handle_max;
+	int handle_first_free;
+	uint32_t last_check;
+
+	size_t heap_usage;
+	int heap_blocks;
+
+	Handle *_get_handle(ID p_id);
+	const Handle *_get_handle(ID p_id) const;
+	int _alloc_handle();
+	void _free_handle(int p_index);
+	PoolAllocator::ID _pool_alloc(size_t p_amount);
+
+public:
+	typedef MemoryPoolDynamic::ID ID;
+
+	virtual ID alloc(size_t p_amount, const char *p_description);
+	virtual void free(ID p_id);
+	virtual Error realloc(ID p_id, size_t p_amount);
+	virtual bool is_valid(ID p_id);
+	virtual size_t get_size(ID p_id) const;
+	virtual const char *get_description(ID p_id) const;
+
+	virtual bool is_locked(ID p_id) const;
+	virtual Error lock(ID p_id);
+	virtual void *get(ID p_ID);
+	virtual Error unlock(ID p_id);
+
+	virtual size_t get_available_mem() const;
+	virtual size_t get_total_usage() const;
+	virtual float get_fragmentation() const;
+	virtual void defragment();
+
+	int get_arena_size() const;
+	int get_heap_block_count() const;
+	size_t get_heap_usage() const;
+	size_t get_largest_free_block() const;
+
+	MemoryPoolDynamicCompact(int p_arena_size, int p_max_blocks = 8192, bool p_make_default = true);
+	virtual ~MemoryPoolDynamicCompact();
+};
+
+#endif
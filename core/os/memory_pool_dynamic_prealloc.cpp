@@ -99,6 +99,15 @@ size_t MemoryPoolDynamicPrealloc::get_total_usage() const {
 	return pool_alloc->get_used_mem();
 }
 
+float MemoryPoolDynamicPrealloc::get_fragmentation() const {
+
+	int free_mem = pool_alloc->get_free_mem();
+	if (free_mem <= 0)
+		return 0;
+
+	return 1.0 - float(pool_alloc->get_largest_free_block()) / free_mem;
+}
+
 MemoryPoolDynamicPrealloc::MemoryPoolDynamicPrealloc(void *p_mem, int p_size, int p_align, int p_max_entries) {
 
 	pool_alloc = memnew(PoolAllocator(p_mem, p_size, p_align, true, p_max_entries));
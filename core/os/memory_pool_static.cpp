@@ -37,11 +37,13 @@ MemoryPoolStatic *MemoryPoolStatic::get_singleton() {
 	return singleton;
 }
 
-MemoryPoolStatic::MemoryPoolStatic() {
+MemoryPoolStatic::MemoryPoolStatic(bool p_make_default) {
 
-	singleton = this;
+	if (p_make_default)
+		singleton = this;
 }
 
 MemoryPoolStatic::~MemoryPoolStatic() {
-	singleton = NULL;
+	if (singleton == this)
+		singleton = NULL;
 }
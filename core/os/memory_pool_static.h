@@ -52,6 +52,11 @@ public:
 	virtual size_t get_available_mem() const = 0;
 	virtual size_t get_total_usage() = 0;
 	virtual size_t get_max_usage() = 0;
+	// 0 when free memory is fully reusable, towards 1 as it gets stranded
+	virtual float get_fragmentation() { return 0; }
+
+	// Threads call this right before exiting, for pools that keep per-thread state
+	virtual void release_thread_cache() {}
 
 	/* Most likely available only if memory debugger was compiled in */
 	virtual int get_alloc_count() = 0;
@@ -61,7 +66,7 @@ public:
 
 	virtual void dump_mem_to_file(const char *p_file) = 0;
 
-	MemoryPoolStatic();
+	MemoryPoolStatic(bool p_make_default = true);
 	virtual ~MemoryPoolStatic();
 };
 
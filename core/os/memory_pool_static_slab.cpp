@@ -0,0 +1,580 @@
+/*************************************************************************/
+/*  memory_pool_static_slab.cpp                                          */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "memory_pool_static_slab.h"
+#include "error_macros.h"
+#include "os/copymem.h"
+#include "os/memory.h"
+#include "safe_refcount.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#if defined(_MSC_VER)
+#define SLAB_THREAD_LOCAL __declspec(thread)
+#else
+#define SLAB_THREAD_LOCAL __thread
+#endif
+
+// multiples of 8, so blocks stay aligned for doubles and 64 bit atomics
+const uint32_t MemoryPoolStaticSlab::class_sizes[CLASS_COUNT] = { 8, 16, 24, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024 };
+uint32_t MemoryPoolStaticSlab::generation_counter = 0;
+
+// A thread can use a few pools at once (a test pool next to the default one),
+// any further ones share a cache under the lock
+struct SlabThreadSlot {
+	uint32_t generation;
+	void *cache;
+};
+
+enum {
+	SLAB_THREAD_SLOTS = 4
+};
+
+static SLAB_THREAD_LOCAL SlabThreadSlot slab_thread_slots[SLAB_THREAD_SLOTS];
+
+void MemoryPoolStaticSlab::_lock() const {
+
+	if (mutex)
+		mutex->lock();
+}
+
+void MemoryPoolStaticSlab::_unlock() const {
+
+	if (mutex)
+		mutex->unlock();
+}
+
+MemoryPoolStaticSlab::ThreadCache *MemoryPoolStaticSlab::_get_thread_cache() {
+
+	SlabThreadSlot *free_slot = NULL;
+	for (int i = 0; i < SLAB_THREAD_SLOTS; i++) {
+		if (slab_thread_slots[i].generation == generation)
+			return (ThreadCache *)slab_thread_slots[i].cache;
+		if (!free_slot && slab_thread_slots[i].generation == 0)
+			free_slot = &slab_thread_slots[i];
+	}
+
+	// taking a slot over would strand the blocks cached for its pool,
+	// past SLAB_THREAD_SLOTS pools this thread goes through the lock
+	if (!free_slot)
+		return &shared_cache;
+
+	// first block on this thread
+	ThreadCache *cache = &shared_cache;
+	_lock();
+	for (int i = 0; i < MAX_THREAD_CACHES; i++) {
+		if (!caches[i].in_use) {
+			cache = &caches[i];
+			cache->in_use = true;
+			break;
+		}
+	}
+	_unlock();
+
+	free_slot->generation = generation;
+	free_slot->cache = cache;
+	return cache;
+}
+
+int MemoryPoolStaticSlab::_refill(ThreadCache *p_cache, int p_class) {
+
+	SizeClass &sc = classes[p_class];
+	uint32_t wanted = MAX(sc.cache_limit / 2, 1u);
+	uint32_t moved = 0;
+
+	_lock();
+
+	while (moved < wanted) {
+
+		Page *page = sc.partial;
+		if (!page) {
+			if (!free_pages)
+				break;
+
+			page = free_pages;
+			free_pages = page->next;
+			free_page_count--;
+
+			page->size_class = p_class;
+			page->used = 0;
+			page->carved = 0;
+			page->free_list = NULL;
+			page->prev = NULL;
+			page->next = NULL;
+			sc.partial = page;
+			slab_free_bytes += size_t(sc.blocks_per_page) * sc.size;
+		}
+
+		void *block;
+		if (page->free_list) {
+			block = page->free_list;
+			page->free_list = *(void **)block;
+		} else {
+			block = arena + size_t(page - pages) * PAGE_SIZE + size_t(page->carved) * sc.size;
+			page->carved++;
+		}
+		page->used++;
+		slab_free_bytes -= sc.size;
+
+		if (page->used == sc.blocks_per_page) {
+			// full, drop it from the partial list
+			sc.partial = page->next;
+			if (page->next)
+				page->next->prev = NULL;
+			page->next = NULL;
+		}
+
+		*(void **)block = p_cache->free_list[p_class];
+		p_cache->free_list[p_class] = block;
+		p_cache->count[p_class]++;
+		moved++;
+	}
+
+	_unlock();
+
+	return moved;
+}
+
+void MemoryPoolStaticSlab::_drain(ThreadCache *p_cache, int p_class, uint32_t p_keep) {
+
+	SizeClass &sc = classes[p_class];
+
+	_lock();
+
+	while (p_cache->count[p_class] > p_keep) {
+
+		void *block = p_cache->free_list[p_class];
+		p_cache->free_list[p_class] = *(void **)block;
+		p_cache->count[p_class]--;
+
+		Page *page = _get_page(block);
+		*(void **)block = page->free_list;
+		page->free_list = block;
+		slab_free_bytes += sc.size;
+
+		if (page->used == sc.blocks_per_page) {
+			// was full, it can hand out blocks again
+			page->prev = NULL;
+			page->next = sc.partial;
+			if (sc.partial)
+				sc.partial->prev = page;
+			sc.partial = page;
+		}
+
+		page->used--;
+
+		if (page->used == 0) {
+			// empty, give it back so any size class can use it
+			if (page->prev)
+				page->prev->next = page->next;
+			else
+				sc.partial = page->next;
+			if (page->next)
+				page->next->prev = page->prev;
+
+			page->size_class = CLASS_COUNT;
+			page->next = free_pages;
+			free_pages = page;
+			free_page_count++;
+			slab_free_bytes -= size_t(sc.blocks_per_page) * sc.size;
+		}
+	}
+
+	_unlock();
+}
+
+void *MemoryPoolStaticSlab::_alloc_large(size_t p_bytes) {
+
+	LargeHeader *header = (LargeHeader *)::malloc(p_bytes + sizeof(LargeHeader));
+	ERR_FAIL_COND_V(!header, NULL);
+	header->size = p_bytes;
+
+	_lock();
+	large_usage += p_bytes;
+	large_allocations++;
+	_update_max_usage();
+	_unlock();
+
+	return header + 1;
+}
+
+void MemoryPoolStaticSlab::_free_large(void *p_ptr) {
+
+	LargeHeader *header = (LargeHeader *)p_ptr - 1;
+
+	_lock();
+	large_usage -= header->size;
+	large_allocations--;
+	_unlock();
+
+	::free(header);
+}
+
+void MemoryPoolStaticSlab::_update_max_usage() {
+
+	// called under the lock, thread usage is read without syncing, close enough for a peak
+	int64_t usage = int64_t(large_usage) + central_usage + shared_cache.usage;
+	for (int i = 0; i < MAX_THREAD_CACHES; i++) {
+		usage += caches[i].usage;
+	}
+	if (usage > int64_t(max_usage))
+		max_usage = usage;
+}
+
+void *MemoryPoolStaticSlab::alloc(size_t p_bytes, const char *p_description) {
+
+	ERR_FAIL_COND_V(p_bytes == 0, NULL);
+
+	if (p_bytes > MAX_SMALL_SIZE)
+		return _alloc_large(p_bytes);
+
+	int c = size_to_class[(p_bytes + 7) >> 3];
+	ThreadCache *cache = _get_thread_cache();
+	bool shared = cache == &shared_cache;
+	if (shared)
+		_lock();
+
+	void *block = cache->free_list[c];
+	if (!block) {
+		if (_refill(cache, c) == 0) {
+			// arena is full
+			if (shared)
+				_unlock();
+			return _alloc_large(p_bytes);
+		}
+		block = cache->free_list[c];
+
+		_lock();
+		_update_max_usage();
+		_unlock();
+	}
+
+	cache->free_list[c] = *(void **)block;
+	cache->count[c]--;
+	cache->usage += classes[c].size;
+	cache->allocations++;
+
+	if (shared)
+		_unlock();
+
+	return block;
+}
+
+void MemoryPoolStaticSlab::free(void *p_ptr) {
+
+	ERR_FAIL_COND(!p_ptr);
+
+	if (!_owns_page(p_ptr)) {
+		_free_large(p_ptr);
+		return;
+	}
+
+	// the page can't change class while this block is in use
+	int c = _get_page(p_ptr)->size_class;
+	ThreadCache *cache = _get_thread_cache();
+	bool shared = cache == &shared_cache;
+	if (shared)
+		_lock();
+
+	*(void **)p_ptr = cache->free_list[c];
+	cache->free_list[c] = p_ptr;
+	cache->count[c]++;
+	cache->usage -= classes[c].size;
+	cache->allocations--;
+
+	if (cache->count[c] > classes[c].cache_limit)
+		_drain(cache, c, classes[c].cache_limit / 2);
+
+	if (shared)
+		_unlock();
+}
+
+void *MemoryPoolStaticSlab::realloc(void *p_memory, size_t p_bytes) {
+
+	if (!p_memory)
+		return alloc(p_bytes);
+
+	if (p_bytes == 0) {
+		free(p_memory);
+		return NULL;
+	}
+
+	size_t old_size;
+	if (_owns_page(p_memory)) {
+
+		int c = _get_page(p_memory)->size_class;
+		old_size = classes[c].size;
+		if (p_bytes <= old_size && (c == 0 || p_bytes > classes[c - 1].size))
+			return p_memory; // same class
+	} else {
+
+		LargeHeader *header = (LargeHeader *)p_memory - 1;
+		old_size = header->size;
+
+		if (p_bytes > MAX_SMALL_SIZE) {
+
+			LargeHeader *new_header = (LargeHeader *)::realloc(header, p_bytes + sizeof(LargeHeader));
+			ERR_FAIL_COND_V(!new_header, NULL);
+			new_header->size = p_bytes;
+
+			_lock();
+			large_usage += p_bytes;
+			large_usage -= old_size;
+			_update_max_usage();
+			_unlock();
+
+			return new_header + 1;
+		}
+	}
+
+	void *new_memory = alloc(p_bytes);
+	ERR_FAIL_COND_V(!new_memory, NULL);
+	copymem(new_memory, p_memory, MIN(old_size, p_bytes));
+	free(p_memory);
+
+	return new_memory;
+}
+
+void MemoryPoolStaticSlab::release_thread_cache() {
+
+	// without a slot this thread used the shared cache
+	ThreadCache *cache = &shared_cache;
+	for (int i = 0; i < SLAB_THREAD_SLOTS; i++) {
+
+		SlabThreadSlot &slot = slab_thread_slots[i];
+		if (slot.generation != generation)
+			continue;
+
+		cache = (ThreadCache *)slot.cache;
+		slot.generation = 0;
+		slot.cache = NULL;
+		break;
+	}
+
+	_lock();
+	for (int c = 0; c < CLASS_COUNT; c++) {
+		_drain(cache, c, 0);
+	}
+	if (cache != &shared_cache) {
+		// the blocks it handed out may still be freed elsewhere, keep the counts
+		central_usage += cache->usage;
+		central_allocations += cache->allocations;
+		cache->usage = 0;
+		cache->allocations = 0;
+		cache->in_use = false;
+	}
+	_unlock();
+}
+
+size_t MemoryPoolStaticSlab::_get_cached_bytes() const {
+
+	// owners change their counts without the lock, this is only a snapshot
+	size_t bytes = 0;
+	for (int i = 0; i < CLASS_COUNT; i++) {
+		uint32_t count = shared_cache.count[i];
+		for (int j = 0; j < MAX_THREAD_CACHES; j++) {
+			count += caches[j].count[i];
+		}
+		bytes += size_t(count) * classes[i].size;
+	}
+	return bytes;
+}
+
+size_t MemoryPoolStaticSlab::get_available_mem() const {
+
+	_lock();
+	size_t available = size_t(free_page_count) * PAGE_SIZE + slab_free_bytes + _get_cached_bytes();
+	_unlock();
+
+	return available;
+}
+
+size_t MemoryPoolStaticSlab::get_total_usage() {
+
+	_lock();
+	int64_t usage = int64_t(large_usage) + central_usage + shared_cache.usage;
+	for (int i = 0; i < MAX_THREAD_CACHES; i++) {
+		usage += caches[i].usage;
+	}
+	_unlock();
+
+	return MAX(usage, 0);
+}
+
+size_t MemoryPoolStaticSlab::get_max_usage() {
+
+	return max_usage;
+}
+
+float MemoryPoolStaticSlab::get_fragmentation() {
+
+	_lock();
+	size_t stranded = slab_free_bytes + _get_cached_bytes();
+	size_t free_mem = stranded + size_t(free_page_count) * PAGE_SIZE;
+	_unlock();
+
+	if (free_mem == 0)
+		return 0;
+
+	return float(stranded) / free_mem;
+}
+
+int MemoryPoolStaticSlab::get_alloc_count() {
+
+	_lock();
+	int64_t count = int64_t(large_allocations) + central_allocations + shared_cache.allocations;
+	for (int i = 0; i < MAX_THREAD_CACHES; i++) {
+		count += caches[i].allocations;
+	}
+	_unlock();
+
+	return MAX(count, 0);
+}
+
+void *MemoryPoolStaticSlab::get_alloc_ptr(int p_alloc_idx) {
+
+	return NULL;
+}
+
+const char *MemoryPoolStaticSlab::get_alloc_description(int p_alloc_idx) {
+
+	return "";
+}
+
+size_t MemoryPoolStaticSlab::get_alloc_size(int p_alloc_idx) {
+
+	return 0;
+}
+
+void MemoryPoolStaticSlab::dump_mem_to_file(const char *p_file) {
+
+	FILE *f = fopen(p_file, "wb");
+	ERR_FAIL_COND(!f);
+
+	_lock();
+
+	uint32_t class_pages[CLASS_COUNT] = {};
+	uint32_t class_used[CLASS_COUNT] = {};
+	for (uint32_t i = 0; i < page_count; i++) {
+		if (pages[i].size_class < CLASS_COUNT) {
+			class_pages[pages[i].size_class]++;
+			class_used[pages[i].size_class] += pages[i].used;
+		}
+	}
+
+	fprintf(f, "arena: %u pages of %i bytes, %u free\n", page_count, int(PAGE_SIZE), free_page_count);
+	for (int i = 0; i < CLASS_COUNT; i++) {
+		fprintf(f, "class %u: %u pages, %u of %u blocks taken\n", classes[i].size, class_pages[i], class_used[i], class_pages[i] * classes[i].blocks_per_page);
+	}
+	fprintf(f, "large: %i blocks, %lu bytes\n", large_allocations, (unsigned long)large_usage);
+
+	_unlock();
+
+	fclose(f);
+}
+
+MemoryPoolStaticSlab::MemoryPoolStaticSlab(size_t p_arena_size, bool p_make_default) :
+		MemoryPoolStatic(p_make_default) {
+
+	page_count = p_arena_size / PAGE_SIZE;
+	arena_alloc = page_count ? (uint8_t *)::malloc(size_t(page_count) * PAGE_SIZE + PAGE_SIZE) : NULL;
+	pages = arena_alloc ? (Page *)::malloc(sizeof(Page) * page_count) : NULL;
+	if (!pages) {
+		if (page_count)
+			printf("**ERROR: SLAB ALLOC: could not reserve %lu bytes, using malloc for everything\n", (unsigned long)p_arena_size);
+		::free(arena_alloc);
+		arena_alloc = NULL;
+		page_count = 0;
+	}
+
+	arena = arena_alloc ? (uint8_t *)((uintptr_t(arena_alloc) + PAGE_SIZE - 1) & ~uintptr_t(PAGE_SIZE - 1)) : NULL;
+	free_pages = NULL;
+	for (int i = int(page_count) - 1; i >= 0; i--) {
+		pages[i].size_class = CLASS_COUNT;
+		pages[i].used = 0;
+		pages[i].carved = 0;
+		pages[i].free_list = NULL;
+		pages[i].prev = NULL;
+		pages[i].next = free_pages;
+		free_pages = &pages[i];
+	}
+	free_page_count = page_count;
+
+	int c = 0;
+	for (int i = 0; i <= (MAX_SMALL_SIZE >> 3); i++) {
+		while ((uint32_t(i) << 3) > class_sizes[c])
+			c++;
+		size_to_class[i] = c;
+	}
+
+	for (int i = 0; i < CLASS_COUNT; i++) {
+		classes[i].size = class_sizes[i];
+		classes[i].blocks_per_page = PAGE_SIZE / class_sizes[i];
+		// a few KB per class and thread
+		classes[i].cache_limit = CLAMP(4096 / class_sizes[i], 4u, 64u);
+		classes[i].partial = NULL;
+	}
+
+	zeromem(caches, sizeof(caches));
+	zeromem(&shared_cache, sizeof(shared_cache));
+	shared_cache.in_use = true;
+	generation = atomic_increment(&generation_counter);
+
+	slab_free_bytes = 0;
+	central_usage = 0;
+	central_allocations = 0;
+	large_usage = 0;
+	large_allocations = 0;
+	max_usage = 0;
+
+	// last, Mutex::create() may already allocate from this pool
+	mutex = NULL;
+#ifndef NO_THREADS
+	mutex = Mutex::create();
+#endif
+}
+
+MemoryPoolStaticSlab::~MemoryPoolStaticSlab() {
+
+	Mutex *old_mutex = mutex;
+	mutex = NULL;
+	if (old_mutex)
+		memdelete(old_mutex);
+
+	release_thread_cache();
+
+	if (get_alloc_count() > 0) {
+		// static destructors may still touch these blocks, leave the arena mapped
+		return;
+	}
+
+	::free(pages);
+	::free(arena_alloc);
+}
@@ -0,0 +1,167 @@
+/*************************************************************************/
+/*  memory_pool_static_slab.h                                            */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#ifndef MEMORY_POOL_STATIC_SLAB_H
+#define MEMORY_POOL_STATIC_SLAB_H
+
+#include "os/memory_pool_static.h"
+#include "os/mutex.h"
+
+/**
+	Size-class allocator for constrained targets. Small blocks (up to
+	MAX_SMALL_SIZE) are carved out of fixed-size pages in one arena reserved
+	up front, each page holding blocks of a single size class, so churn
+	can't split the heap into unusable holes. Bigger blocks, and small ones
+	once the arena is full, fall through to malloc.
+
+	Every thread keeps a short free list per size class and only takes the
+	lock to refill or drain it in batches. Blocks may be freed from any
+	thread. Threads should call release_thread_cache() before exiting
+	(the Thread implementations do), or their cached blocks stay out of
+	circulation.
+
+	Usage counts size-class bytes, not requested bytes. Fragmentation is
+	the part of the free arena memory that sits in half used pages and can
+	only serve its own size class.
+*/
+
+class MemoryPoolStaticSlab : public MemoryPoolStatic {
+public:
+	enum {
+		PAGE_SIZE = 8192,
+		MAX_SMALL_SIZE = 1024,
+		CLASS_COUNT = 14,
+		MAX_THREAD_CACHES = 32,
+	};
+
+private:
+	struct Page {
+		void *free_list;
+		Page *next;
+		Page *prev;
+		uint16_t size_class; // CLASS_COUNT if the page is free
+		uint16_t used; // blocks out of the page, including ones sitting in thread caches
+		uint16_t carved; // blocks below this were handed out at least once
+	};
+
+	struct SizeClass {
+		uint32_t size;
+		uint32_t blocks_per_page;
+		uint32_t cache_limit;
+		Page *partial; // pages with at least one free block
+	};
+
+	struct ThreadCache {
+		void *free_list[CLASS_COUNT];
+		uint32_t count[CLASS_COUNT];
+		// changed only by the owner thread, may go negative when freeing other threads' blocks
+		int64_t usage;
+		int64_t allocations;
+		bool in_use;
+	};
+
+	struct LargeHeader {
+		uint64_t size;
+	};
+
+	static const uint32_t class_sizes[CLASS_COUNT];
+	static uint32_t generation_counter;
+
+	uint8_t *arena_alloc;
+	uint8_t *arena;
+	uint32_t page_count;
+	Page *pages;
+	Page *free_pages;
+	uint32_t free_page_count;
+	size_t slab_free_bytes; // free blocks in pages of some size class
+
+	uint8_t size_to_class[(MAX_SMALL_SIZE >> 3) + 1];
+	SizeClass classes[CLASS_COUNT];
+
+	ThreadCache caches[MAX_THREAD_CACHES];
+	ThreadCache shared_cache; // threads past MAX_THREAD_CACHES, used under the lock
+	uint32_t generation;
+
+	// central counts, for blocks moved by the lock holder
+	int64_t central_usage;
+	int64_t central_allocations;
+	size_t large_usage;
+	int large_allocations;
+	size_t max_usage;
+
+	Mutex *mutex;
+
+	_FORCE_INLINE_ bool _owns_page(const void *p_ptr) const {
+		return p_ptr >= arena && p_ptr < arena + size_t(page_count) * PAGE_SIZE;
+	}
+	_FORCE_INLINE_ Page *_get_page(const void *p_ptr) const {
+		return &pages[((const uint8_t *)p_ptr - arena) / PAGE_SIZE];
+	}
+
+	ThreadCache *_get_thread_cache();
+	void _lock() const;
+	void _unlock() const;
+
+	int _refill(ThreadCache *p_cache, int p_class);
+	void _drain(ThreadCache *p_cache, int p_class, uint32_t p_keep);
+	void _update_max_usage();
+	size_t _get_cached_bytes() const;
+
+	void *_alloc_large(size_t p_bytes);
+	void _free_large(void *p_ptr);
+
+public:
+	virtual void *alloc(size_t p_bytes, const char *p_description = "");
+	virtual void *realloc(void *p_memory, size_t p_bytes);
+	virtual void free(void *p_ptr);
+
+	virtual size_t get_available_mem() const;
+	virtual size_t get_total_usage();
+	virtual size_t get_max_usage();
+	virtual float get_fragmentation();
+
+	virtual int get_alloc_count();
+	virtual void *get_alloc_ptr(int p_alloc_idx);
+	virtual const char *get_alloc_description(int p_alloc_idx);
+	virtual size_t get_alloc_size(int p_alloc_idx);
+
+	virtual void dump_mem_to_file(const char *p_file);
+
+	virtual void release_thread_cache();
+
+	size_t get_arena_size() const { return size_t(page_count) * PAGE_SIZE; }
+	size_t get_large_usage() const { return large_usage; }
+
+	// p_make_default false leaves Memory on the current pool, for tests and benchmarks
+	MemoryPoolStaticSlab(size_t p_arena_size, bool p_make_default = true);
+	~MemoryPoolStaticSlab();
+};
+
+#endif // MEMORY_POOL_STATIC_SLAB_H
@@ -52,7 +52,11 @@ public:
 	struct Settings {
 
 		Priority priority;
-		Settings() { priority = PRIORITY_NORMAL; }
+		int core; ///< processor to run on, -1 lets the OS choose
+		Settings() {
+			priority = PRIORITY_NORMAL;
+			core = -1;
+		}
 	};
 
 	typedef uint64_t ID;
@@ -0,0 +1,181 @@
+/*************************************************************************/
+/*  zone_profiler.cpp                                                    */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "zone_profiler.h"
+#include "os/file_access.h"
+#include "safe_refcount.h"
+
+bool ZoneProfiler::enabled = false;
+ZoneProfiler::ThreadBuffer *ZoneProfiler::buffers[MAX_THREADS] = {};
+uint32_t ZoneProfiler::buffer_count = 0;
+Mutex *ZoneProfiler::mutex = NULL;
+
+ZoneProfiler::ThreadBuffer *ZoneProfiler::_get_buffer() {
+
+	Thread::ID id = Thread::get_caller_ID();
+	uint32_t count = buffer_count;
+	for (uint32_t i = 0; i < count; i++) {
+		if (buffers[i]->thread == id)
+			return buffers[i];
+	}
+
+	if (!mutex)
+		return NULL;
+
+	// first zone on this thread
+	mutex->lock();
+	ThreadBuffer *buffer = NULL;
+	if (buffer_count < MAX_THREADS) {
+		buffer = memnew(ThreadBuffer);
+		buffer->thread = id;
+		buffer->name = Thread::get_main_ID() == id ? "Main" : "Thread " + itos(buffer_count);
+		buffer->written = 0;
+		buffer->depth = 0;
+		buffers[buffer_count] = buffer;
+		atomic_increment(&buffer_count); // publishes the slot after it's filled
+	}
+	mutex->unlock();
+
+	return buffer;
+}
+
+void ZoneProfiler::_record(ThreadBuffer *p_buffer, const char *p_name, uint64_t p_begin, uint64_t p_end) {
+
+	p_buffer->depth--;
+
+	Zone &z = p_buffer->zones[p_buffer->written % RING_SIZE];
+	z.name = p_name;
+	z.begin = p_begin;
+	z.duration = p_end - p_begin;
+	z.depth = p_buffer->depth;
+	p_buffer->written++;
+}
+
+void ZoneProfiler::set_enabled(bool p_enabled) {
+
+	enabled = p_enabled;
+}
+
+void ZoneProfiler::set_thread_name(const String &p_name) {
+
+	ThreadBuffer *buffer = _get_buffer();
+	if (buffer)
+		buffer->name = p_name;
+}
+
+int ZoneProfiler::get_zones(Thread::ID p_thread, Zone *r_zones, int p_max) {
+
+	for (uint32_t i = 0; i < buffer_count; i++) {
+
+		const ThreadBuffer *b = buffers[i];
+		if (b->thread != p_thread)
+			continue;
+
+		uint32_t count = MIN(b->written, uint32_t(RING_SIZE));
+		uint32_t first = b->written - count;
+		int copied = 0;
+		for (uint32_t j = 0; j < count && copied < p_max; j++) {
+			r_zones[copied++] = b->zones[(first + j) % RING_SIZE];
+		}
+		return copied;
+	}
+
+	return 0;
+}
+
+String ZoneProfiler::get_chrome_trace() {
+
+	String json = "{\"traceEvents\":[\n";
+	bool first_event = true;
+
+	for (uint32_t i = 0; i < buffer_count; i++) {
+
+		const ThreadBuffer *b = buffers[i];
+		String tid = itos(i);
+
+		if (!first_event)
+			json += ",\n";
+		first_event = false;
+		json += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" + tid + ",\"args\":{\"name\":\"" + b->name.json_escape() + "\"}}";
+
+		uint32_t count = MIN(b->written, uint32_t(RING_SIZE));
+		uint32_t first = b->written - count;
+		for (uint32_t j = 0; j < count; j++) {
+
+			const Zone &z = b->zones[(first + j) % RING_SIZE];
+			json += ",\n{\"name\":\"" + String(z.name).json_escape() + "\",\"ph\":\"X\",\"pid\":0,\"tid\":" + tid;
+			json += ",\"ts\":" + itos(z.begin) + ",\"dur\":" + itos(z.duration) + "}";
+		}
+	}
+
+	json += "\n],\"displayTimeUnit\":\"ms\"}\n";
+	return json;
+}
+
+Error ZoneProfiler::dump_chrome_trace(const String &p_path) {
+
+	Error err;
+	FileAccess *f = FileAccess::open(p_path, FileAccess::WRITE, &err);
+	ERR_FAIL_COND_V(!f, err);
+
+	CharString utf8 = get_chrome_trace().utf8();
+	f->store_buffer((const uint8_t *)utf8.get_data(), utf8.length());
+	memdelete(f);
+
+	return OK;
+}
+
+void ZoneProfiler::clear() {
+
+	for (uint32_t i = 0; i < buffer_count; i++) {
+		buffers[i]->written = 0;
+	}
+}
+
+void ZoneProfiler::init() {
+
+	if (!mutex)
+		mutex = Mutex::create();
+}
+
+void ZoneProfiler::finish() {
+
+	enabled = false;
+	for (uint32_t i = 0; i < buffer_count; i++) {
+		memdelete(buffers[i]);
+		buffers[i] = NULL;
+	}
+	buffer_count = 0;
+
+	if (mutex) {
+		memdelete(mutex);
+		mutex = NULL;
+	}
+}
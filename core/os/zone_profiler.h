@@ -0,0 +1,138 @@
+/*************************************************************************/
+/*  zone_profiler.h                                                      */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#ifndef ZONE_PROFILER_H
+#define ZONE_PROFILER_H
+
+#include "os/mutex.h"
+#include "os/os.h"
+#include "os/thread.h"
+#include "ustring.h"
+
+/**
+	Times named, nested spans of code ("zones") on every thread. Each
+	thread writes finished zones into its own ring buffer, keeping the last
+	RING_SIZE of them, and dump_chrome_trace() writes all rings as a trace
+	that chrome://tracing and similar viewers open.
+
+	The ZONE_SCOPE() macros only exist in builds with ZONE_PROFILER_ENABLED
+	(scons zone_profiler=yes), other builds don't pay anything for them.
+	Recording also has to be switched on with set_enabled().
+*/
+
+class ZoneProfiler {
+public:
+	enum {
+		RING_SIZE = 4096,
+		MAX_THREADS = 16,
+	};
+
+	struct Zone {
+		const char *name;
+		uint64_t begin; // usec
+		uint32_t duration;
+		uint32_t depth;
+	};
+
+	struct ThreadBuffer {
+		Thread::ID thread;
+		String name;
+		Zone zones[RING_SIZE];
+		uint32_t written;
+		uint32_t depth;
+	};
+
+	class Scope {
+		ThreadBuffer *buffer;
+		const char *name;
+		uint64_t begin;
+
+	public:
+		_FORCE_INLINE_ Scope(const char *p_name) {
+			buffer = enabled ? _get_buffer() : NULL;
+			if (buffer) {
+				name = p_name;
+				begin = OS::get_singleton()->get_ticks_usec();
+				buffer->depth++;
+			}
+		}
+		_FORCE_INLINE_ ~Scope() {
+			if (buffer)
+				_record(buffer, name, begin, OS::get_singleton()->get_ticks_usec());
+		}
+	};
+
+private:
+	static bool enabled;
+	static ThreadBuffer *buffers[MAX_THREADS];
+	static uint32_t buffer_count;
+	static Mutex *mutex;
+
+	static ThreadBuffer *_get_buffer();
+	static void _record(ThreadBuffer *p_buffer, const char *p_name, uint64_t p_begin, uint64_t p_end);
+
+public:
+	static void set_enabled(bool p_enabled);
+	static bool is_enabled() { return enabled; }
+
+	// Labels the calling thread in traces
+	static void set_thread_name(const String &p_name);
+
+	// Oldest first, returns how many zones were copied
+	static int get_zones(Thread::ID p_thread, Zone *r_zones, int p_max);
+
+	// Meant for when the recorded threads are idle, zones still being written may come out torn
+	static Error dump_chrome_trace(const String &p_path);
+	static String get_chrome_trace();
+
+	static void clear();
+
+	static void init();
+	static void finish();
+};
+
+#ifdef ZONE_PROFILER_ENABLED
+
+#define _ZONE_CONCAT_IMPL(m_a, m_b) m_a##m_b
+#define _ZONE_CONCAT(m_a, m_b) _ZONE_CONCAT_IMPL(m_a, m_b)
+
+#define ZONE_SCOPE(m_name) ZoneProfiler::Scope _ZONE_CONCAT(_zone_scope_, __LINE__)(m_name)
+#define ZONE_SCOPE_FUNCTION() ZONE_SCOPE(__FUNCTION__)
+#define ZONE_THREAD_NAME(m_name) ZoneProfiler::set_thread_name(m_name)
+
+#else
+
+#define ZONE_SCOPE(m_name)
+#define ZONE_SCOPE_FUNCTION()
+#define ZONE_THREAD_NAME(m_name)
+
+#endif
+
+#endif // ZONE_PROFILER_H
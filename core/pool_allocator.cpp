@@ -420,6 +420,53 @@ Error PoolAllocator::resize(ID p_mem, int p_new_size) {
 	ERR_FAIL_V(ERR_OUT_OF_MEMORY);
 }
 
+bool PoolAllocator::resize_in_place(ID p_mem, int p_new_size) {
+
+	ERR_FAIL_COND_V(p_new_size < 1, false);
+
+	mt_lock();
+	Entry *e = get_entry(p_mem);
+
+	if (!e) {
+		mt_unlock();
+		ERR_FAIL_COND_V(!e, false);
+	}
+
+	int alloc_size = aligned(p_new_size);
+	int old_size = aligned(e->len);
+
+	if (alloc_size > old_size) {
+
+		if (alloc_size - old_size > free_mem) {
+			mt_unlock();
+			return false;
+		}
+
+		EntryIndicesPos entry_indices_pos;
+
+		if (!find_entry_index(&entry_indices_pos, e)) {
+			mt_unlock();
+			ERR_FAIL_V(false);
+		}
+
+		int next_pos = (entry_indices_pos + 1 == entry_count) ? pool_size : entry_array[entry_indices[entry_indices_pos + 1]].pos;
+
+		if (next_pos - (int)e->pos < alloc_size) {
+			mt_unlock();
+			return false;
+		}
+	}
+
+	free_mem += old_size;
+	free_mem -= alloc_size;
+	e->len = p_new_size;
+	if (free_mem < free_mem_peak)
+		free_mem_peak = free_mem;
+
+	mt_unlock();
+	return true;
+}
+
 Error PoolAllocator::lock(ID p_mem) {
 
 	if (!needs_locking)
@@ -551,16 +598,53 @@ int PoolAllocator::get_used_mem() const {
 	return pool_size - free_mem;
 }
 
-int PoolAllocator::get_free_peak() {
+int PoolAllocator::get_free_peak() const {
 
 	return free_mem_peak;
 }
 
-int PoolAllocator::get_free_mem() {
+int PoolAllocator::get_free_mem() const {
 
 	return free_mem;
 }
 
+int PoolAllocator::get_entry_count() const {
+
+	return entry_count;
+}
+
+int PoolAllocator::get_max_entries() const {
+
+	return entry_max;
+}
+
+void PoolAllocator::defragment() {
+
+	mt_lock();
+	compact();
+	mt_unlock();
+}
+
+int PoolAllocator::get_largest_free_block() const {
+
+	mt_lock();
+
+	int largest = 0;
+	int prev_entry_end_pos = 0;
+
+	for (int i = 0; i < entry_count; i++) {
+
+		const Entry &entry = entry_array[entry_indices[i]];
+		largest = MAX(largest, int(entry.pos) - prev_entry_end_pos);
+		prev_entry_end_pos = entry_end(entry);
+	}
+	largest = MAX(largest, pool_size - prev_entry_end_pos);
+
+	mt_unlock();
+
+	return largest;
+}
+
 void PoolAllocator::create_pool(void *p_mem, int p_size, int p_max_entries) {
 
 	pool = (uint8_t *)p_mem;
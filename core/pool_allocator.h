@@ -129,11 +129,16 @@ public:
 	ID alloc(int p_size); ///< Alloc memory, get an ID on success, POOL_ALOCATOR_INVALID_ID on failure
 	void free(ID p_mem); ///< Free allocated memory
 	Error resize(ID p_mem, int p_new_size); ///< resize a memory chunk
+	bool resize_in_place(ID p_mem, int p_new_size); ///< resize without moving any chunk, false if there is no room behind it
 	int get_size(ID p_mem) const;
 
-	int get_free_mem(); ///< get free memory
+	int get_free_mem() const; ///< get free memory
 	int get_used_mem() const;
-	int get_free_peak(); ///< get free memory
+	int get_free_peak() const; ///< get free memory
+	int get_largest_free_block() const; ///< biggest allocation that fits without compacting
+	int get_entry_count() const;
+	int get_max_entries() const;
+	void defragment(); ///< compact all unlocked chunks towards the start of the pool
 
 	Error lock(ID p_mem); //@todo move this out
 	void *get(ID p_mem);
@@ -0,0 +1,119 @@
+/*************************************************************************/
+/*  string_builder.cpp                                                   */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+#include "string_builder.h"
+
+#include "os/copymem.h"
+#include "os/memory.h"
+
+void StringBuilder::_grow(int p_min_capacity) {
+
+	int new_capacity = MAX(capacity * 2, p_min_capacity);
+	if (buffer == inline_buffer) {
+		buffer = (CharType *)memalloc(sizeof(CharType) * new_capacity);
+		copymem(buffer, inline_buffer, sizeof(CharType) * length);
+	} else {
+		buffer = (CharType *)memrealloc(buffer, sizeof(CharType) * new_capacity);
+	}
+	capacity = new_capacity;
+}
+
+StringBuilder &StringBuilder::append(const CharType *p_str, int p_length) {
+
+	if (p_length <= 0)
+		return *this;
+
+	copymem(_reserve(p_length), p_str, sizeof(CharType) * p_length);
+	return *this;
+}
+
+StringBuilder &StringBuilder::append(const String &p_string) {
+
+	return append(p_string.c_str(), p_string.length());
+}
+
+StringBuilder &StringBuilder::append(const char *p_cstring) {
+
+	if (!p_cstring)
+		return *this;
+
+	int len = strlen(p_cstring);
+	CharType *dst = _reserve(len);
+	for (int i = 0; i < len; i++)
+		dst[i] = (uint8_t)p_cstring[i];
+	return *this;
+}
+
+StringBuilder &StringBuilder::append_repeat(CharType p_char, int p_count) {
+
+	if (p_count <= 0)
+		return *this;
+
+	CharType *dst = _reserve(p_count);
+	for (int i = 0; i < p_count; i++)
+		dst[i] = p_char;
+	return *this;
+}
+
+void StringBuilder::reserve(int p_chars) {
+
+	if (p_chars > capacity)
+		_grow(p_chars);
+}
+
+void StringBuilder::clear() {
+
+	length = 0;
+}
+
+String StringBuilder::as_string() const {
+
+	String string;
+	if (length == 0)
+		return string;
+
+	string.resize(length + 1);
+	CharType *dst = string.ptr();
+	copymem(dst, buffer, sizeof(CharType) * length);
+	dst[length] = 0;
+	return string;
+}
+
+StringBuilder::StringBuilder() {
+
+	buffer = inline_buffer;
+	length = 0;
+	capacity = INLINE_SIZE;
+}
+
+StringBuilder::~StringBuilder() {
+
+	if (buffer != inline_buffer)
+		memfree(buffer);
+}
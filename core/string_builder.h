@@ -0,0 +1,98 @@
+/*************************************************************************/
+/*  string_builder.h                                                     */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+#ifndef STRING_BUILDER_H
+#define STRING_BUILDER_H
+
+#include "ustring.h"
+
+/**
+ * Accumulates text and turns it into a String with a single allocation.
+ * Short results never touch the heap before that: the first INLINE_SIZE
+ * characters are kept in the builder itself, so it is cheap to use on the
+ * stack for formatting small pieces of UI text. Past that, the buffer
+ * grows by doubling instead of reallocating on every append like
+ * String::operator+= does.
+ */
+class StringBuilder {
+
+	enum {
+		INLINE_SIZE = 64
+	};
+
+	CharType inline_buffer[INLINE_SIZE];
+	CharType *buffer;
+	int length;
+	int capacity;
+
+	void _grow(int p_min_capacity);
+
+	_FORCE_INLINE_ CharType *_reserve(int p_chars) {
+
+		if (length + p_chars > capacity)
+			_grow(length + p_chars);
+		CharType *dst = buffer + length;
+		length += p_chars;
+		return dst;
+	}
+
+public:
+	StringBuilder &append(const CharType *p_str, int p_length);
+	StringBuilder &append(const String &p_string);
+	StringBuilder &append(const char *p_cstring);
+	_FORCE_INLINE_ StringBuilder &append(CharType p_char) {
+
+		*_reserve(1) = p_char;
+		return *this;
+	}
+
+	_FORCE_INLINE_ StringBuilder &operator+=(const String &p_string) { return append(p_string); }
+	_FORCE_INLINE_ StringBuilder &operator+=(const char *p_cstring) { return append(p_cstring); }
+	_FORCE_INLINE_ StringBuilder &operator+=(CharType p_char) { return append(p_char); }
+
+	// Append p_count copies of p_char, for padding
+	StringBuilder &append_repeat(CharType p_char, int p_count);
+
+	void reserve(int p_chars);
+	void clear();
+
+	_FORCE_INLINE_ int get_length() const { return length; }
+	_FORCE_INLINE_ bool empty() const { return length == 0; }
+
+	String as_string() const;
+
+	StringBuilder();
+	~StringBuilder();
+
+private:
+	StringBuilder(const StringBuilder &);
+	void operator=(const StringBuilder &);
+};
+
+#endif // STRING_BUILDER_H
@@ -29,8 +29,12 @@
 /*************************************************************************/
 
 #include "string_db.h"
+#include "os/mutex.h"
 #include "os/os.h"
 #include "print_string.h"
+
+#include <string.h>
+
 StaticCString StaticCString::create(const char *p_ptr) {
 	StaticCString scs;
 	scs.ptr = p_ptr;
@@ -38,6 +42,7 @@ StaticCString StaticCString::create(const char *p_ptr) {
 }
 
 StringName::_Data *StringName::_table[STRING_TABLE_LEN];
+Mutex *StringName::_table_lock[STRING_TABLE_SHARDS];
 
 StringName _scs_create(const char *p_chr) {
 
@@ -53,25 +58,32 @@ void StringName::setup() {
 
 		_table[i] = NULL;
 	}
+	for (int i = 0; i < STRING_TABLE_SHARDS; i++) {
+
+		_table_lock[i] = Mutex::create(false);
+	}
 	configured = true;
 }
 
 void StringName::cleanup() {
 
-	_global_lock();
+	// only runs at exit, without the locks since the shard locks aren't
+	// recursive and printing an orphan may intern a name
 	int lost_strings = 0;
 	for (int i = 0; i < STRING_TABLE_LEN; i++) {
 
 		while (_table[i]) {
 
 			_Data *d = _table[i];
-			lost_strings++;
-			if (OS::get_singleton()->is_stdout_verbose()) {
-
-				if (d->cname) {
-					print_line("Orphan StringName: " + String(d->cname));
-				} else {
-					print_line("Orphan StringName: " + String(d->name));
+			if (!d->is_static) {
+				lost_strings++;
+				if (OS::get_singleton()->is_stdout_verbose()) {
+
+					if (d->cname) {
+						print_line("Orphan StringName: " + String(d->cname));
+					} else {
+						print_line("Orphan StringName: " + String(d->name));
+					}
 				}
 			}
 
@@ -82,16 +94,28 @@ void StringName::cleanup() {
 	if (OS::get_singleton()->is_stdout_verbose() && lost_strings) {
 		print_line("StringName: " + itos(lost_strings) + " unclaimed string names at exit.");
 	}
-	_global_unlock();
+
+	for (int i = 0; i < STRING_TABLE_SHARDS; i++) {
+
+		if (_table_lock[i]) {
+			memdelete(_table_lock[i]);
+			_table_lock[i] = NULL;
+		}
+	}
+	configured = false;
 }
 
 void StringName::unref() {
 
-	ERR_FAIL_COND(!configured);
+	if (!configured) {
+		// names cached by SNAME() are destroyed after cleanup() freed them
+		_data = NULL;
+		return;
+	}
 
 	if (_data && _data->refcount.unref()) {
 
-		_global_lock();
+		MutexLock lock(_get_table_lock(_data->idx));
 
 		if (_data->prev) {
 			_data->prev->next = _data->next;
@@ -106,7 +130,6 @@ void StringName::unref() {
 			_data->next->prev = _data->prev;
 		}
 		memdelete(_data);
-		_global_unlock();
 	}
 
 	_data = NULL;
@@ -175,6 +198,67 @@ StringName::StringName(const StringName &p_name) {
 	}
 }
 
+// Comparisons against the interned name that don't build a String from cname
+
+static _FORCE_INLINE_ bool _name_equals(const char *p_cname, const String &p_name, const char *p_other) {
+
+	return p_cname ? strcmp(p_cname, p_other) == 0 : p_name == p_other;
+}
+
+static _FORCE_INLINE_ bool _name_equals(const char *p_cname, const String &p_name, const CharType *p_other) {
+
+	if (!p_cname)
+		return p_name == p_other;
+
+	// same widening as String(const char *)
+	while (*p_cname && *p_other) {
+		if (CharType(*p_cname) != *p_other)
+			return false;
+		p_cname++;
+		p_other++;
+	}
+	return *p_cname == 0 && *p_other == 0;
+}
+
+static _FORCE_INLINE_ bool _name_equals(const char *p_cname, const String &p_name, const String &p_other) {
+
+	return p_cname ? p_other == p_cname : p_name == p_other;
+}
+
+// Must be called with the lock for p_idx held. Returns the entry with a new
+// reference, or NULL if it's missing or being released by another thread.
+template <class T>
+StringName::_Data *StringName::_find(const T &p_name, uint32_t p_hash, uint32_t p_idx) {
+
+	_Data *data = _table[p_idx];
+
+	while (data) {
+
+		// compare hash first
+		if (data->hash == p_hash && _name_equals(data->cname, data->name, p_name))
+			break;
+		data = data->next;
+	}
+
+	if (data && data->refcount.ref())
+		return data;
+
+	return NULL;
+}
+
+// Must be called with the lock for p_idx held
+void StringName::_insert(_Data *p_data, uint32_t p_hash, uint32_t p_idx) {
+
+	p_data->refcount.init();
+	p_data->hash = p_hash;
+	p_data->idx = p_idx;
+	p_data->next = _table[p_idx];
+	p_data->prev = NULL;
+	if (_table[p_idx])
+		_table[p_idx]->prev = p_data;
+	_table[p_idx] = p_data;
+}
+
 StringName::StringName(const char *p_name) {
 
 	_data = NULL;
@@ -183,44 +267,34 @@ StringName::StringName(const char *p_name) {
 
 	ERR_FAIL_COND(!p_name || !p_name[0]);
 
-	_global_lock();
-
 	uint32_t hash = String::hash(p_name);
 
 	uint32_t idx = hash & STRING_TABLE_MASK;
 
-	_data = _table[idx];
+	MutexLock lock(_get_table_lock(idx));
 
-	while (_data) {
+	_data = _find(p_name, hash, idx);
+	if (_data)
+		return; // exists
 
-		// compare hash first
-		if (_data->hash == hash && _data->get_name() == p_name)
-			break;
-		_data = _data->next;
-	}
+	_data = memnew(_Data);
+	_data->name = p_name;
+	_insert(_data, hash, idx);
+}
 
-	if (_data) {
-		if (_data->refcount.ref()) {
-			// exists
-			_global_unlock();
-			return;
-		} else {
-		}
-	}
+void StringName::_init_static(const char *p_name, uint32_t p_hash) {
+
+	uint32_t idx = p_hash & STRING_TABLE_MASK;
+
+	MutexLock lock(_get_table_lock(idx));
+
+	_data = _find(p_name, p_hash, idx);
+	if (_data)
+		return; // exists
 
 	_data = memnew(_Data);
-	_data->name = p_name;
-	_data->refcount.init();
-	_data->hash = hash;
-	_data->idx = idx;
-	_data->cname = NULL;
-	_data->next = _table[idx];
-	_data->prev = NULL;
-	if (_table[idx])
-		_table[idx]->prev = _data;
-	_table[idx] = _data;
-
-	_global_unlock();
+	_data->cname = p_name;
+	_insert(_data, p_hash, idx);
 }
 
 StringName::StringName(const StaticCString &p_static_string) {
@@ -231,44 +305,21 @@ StringName::StringName(const StaticCString &p_static_string) {
 
 	ERR_FAIL_COND(!p_static_string.ptr || !p_static_string.ptr[0]);
 
-	_global_lock();
-
-	uint32_t hash = String::hash(p_static_string.ptr);
-
-	uint32_t idx = hash & STRING_TABLE_MASK;
+	_init_static(p_static_string.ptr, String::hash(p_static_string.ptr));
+}
 
-	_data = _table[idx];
+StringName::StringName(const StaticCString &p_static_string, uint32_t p_hash, bool p_static) {
 
-	while (_data) {
+	_data = NULL;
 
-		// compare hash first
-		if (_data->hash == hash && _data->get_name() == p_static_string.ptr)
-			break;
-		_data = _data->next;
-	}
+	ERR_FAIL_COND(!configured);
 
-	if (_data) {
-		if (_data->refcount.ref()) {
-			// exists
-			_global_unlock();
-			return;
-		} else {
-		}
-	}
+	ERR_FAIL_COND(!p_static_string.ptr || !p_static_string.ptr[0]);
 
-	_data = memnew(_Data);
+	_init_static(p_static_string.ptr, p_hash);
 
-	_data->refcount.init();
-	_data->hash = hash;
-	_data->idx = idx;
-	_data->cname = p_static_string.ptr;
-	_data->next = _table[idx];
-	_data->prev = NULL;
-	if (_table[idx])
-		_table[idx]->prev = _data;
-	_table[idx] = _data;
-
-	_global_unlock();
+	if (p_static)
+		_data->is_static = true;
 }
 
 StringName::StringName(const String &p_name) {
@@ -280,43 +331,19 @@ StringName::StringName(const String &p_name) {
 	if (p_name.empty())
 		return;
 
-	_global_lock();
-
 	uint32_t hash = p_name.hash();
 
 	uint32_t idx = hash & STRING_TABLE_MASK;
 
-	_data = _table[idx];
-
-	while (_data) {
-
-		if (_data->hash == hash && _data->get_name() == p_name)
-			break;
-		_data = _data->next;
-	}
+	MutexLock lock(_get_table_lock(idx));
 
-	if (_data) {
-		if (_data->refcount.ref()) {
-			// exists
-			_global_unlock();
-			return;
-		} else {
-		}
-	}
+	_data = _find(p_name, hash, idx);
+	if (_data)
+		return; // exists
 
 	_data = memnew(_Data);
 	_data->name = p_name;
-	_data->refcount.init();
-	_data->hash = hash;
-	_data->idx = idx;
-	_data->cname = NULL;
-	_data->next = _table[idx];
-	_data->prev = NULL;
-	if (_table[idx])
-		_table[idx]->prev = _data;
-	_table[idx] = _data;
-
-	_global_unlock();
+	_insert(_data, hash, idx);
 }
 
 StringName StringName::search(const char *p_name) {
@@ -327,28 +354,16 @@ StringName StringName::search(const char *p_name) {
 	if (!p_name[0])
 		return StringName();
 
-	_global_lock();
-
 	uint32_t hash = String::hash(p_name);
 
 	uint32_t idx = hash & STRING_TABLE_MASK;
 
-	_Data *_data = _table[idx];
-
-	while (_data) {
-
-		// compare hash first
-		if (_data->hash == hash && _data->get_name() == p_name)
-			break;
-		_data = _data->next;
-	}
+	MutexLock lock(_get_table_lock(idx));
 
-	if (_data && _data->refcount.ref()) {
-		_global_unlock();
+	_Data *_data = _find(p_name, hash, idx);
+	if (_data)
 		return StringName(_data);
-	}
 
-	_global_unlock();
 	return StringName(); //does not exist
 }
 
@@ -360,56 +375,32 @@ StringName StringName::search(const CharType *p_name) {
 	if (!p_name[0])
 		return StringName();
 
-	_global_lock();
-
 	uint32_t hash = String::hash(p_name);
 
 	uint32_t idx = hash & STRING_TABLE_MASK;
 
-	_Data *_data = _table[idx];
-
-	while (_data) {
-
-		// compare hash first
-		if (_data->hash == hash && _data->get_name() == p_name)
-			break;
-		_data = _data->next;
-	}
+	MutexLock lock(_get_table_lock(idx));
 
-	if (_data && _data->refcount.ref()) {
-		_global_unlock();
+	_Data *_data = _find(p_name, hash, idx);
+	if (_data)
 		return StringName(_data);
-	}
 
-	_global_unlock();
 	return StringName(); //does not exist
 }
 StringName StringName::search(const String &p_name) {
 
 	ERR_FAIL_COND_V(p_name == "", StringName());
 
-	_global_lock();
-
 	uint32_t hash = p_name.hash();
 
 	uint32_t idx = hash & STRING_TABLE_MASK;
 
-	_Data *_data = _table[idx];
-
-	while (_data) {
+	MutexLock lock(_get_table_lock(idx));
 
-		// compare hash first
-		if (_data->hash == hash && p_name == _data->get_name())
-			break;
-		_data = _data->next;
-	}
-
-	if (_data && _data->refcount.ref()) {
-		_global_unlock();
+	_Data *_data = _find(p_name, hash, idx);
+	if (_data)
 		return StringName(_data);
-	}
 
-	_global_unlock();
 	return StringName(); //does not exist
 }
 
@@ -35,6 +35,8 @@
 #include "safe_refcount.h"
 #include "ustring.h"
 
+class Mutex;
+
 /**
 	@author Juan Linietsky <reduzio@gmail.com>
 */
@@ -51,7 +53,13 @@ class StringName {
 
 		STRING_TABLE_BITS = 12,
 		STRING_TABLE_LEN = 1 << STRING_TABLE_BITS,
-		STRING_TABLE_MASK = STRING_TABLE_LEN - 1
+		STRING_TABLE_MASK = STRING_TABLE_LEN - 1,
+
+		// buckets are split between this many locks, so threads interning
+		// different names rarely wait on each other
+		STRING_TABLE_SHARD_BITS = 4,
+		STRING_TABLE_SHARDS = 1 << STRING_TABLE_SHARD_BITS,
+		STRING_TABLE_SHARD_MASK = STRING_TABLE_SHARDS - 1
 	};
 
 	struct _Data {
@@ -62,16 +70,26 @@ class StringName {
 		String get_name() const { return cname ? String(cname) : name; }
 		int idx;
 		uint32_t hash;
+		bool is_static;
 		_Data *prev;
 		_Data *next;
 		_Data() {
 			cname = NULL;
 			next = prev = NULL;
 			hash = 0;
+			is_static = false;
 		}
 	};
 
 	static _Data *_table[STRING_TABLE_LEN];
+	static Mutex *_table_lock[STRING_TABLE_SHARDS];
+
+	_FORCE_INLINE_ static Mutex *_get_table_lock(uint32_t p_idx) { return _table_lock[p_idx & STRING_TABLE_SHARD_MASK]; }
+
+	template <class T>
+	static _Data *_find(const T &p_name, uint32_t p_hash, uint32_t p_idx);
+	static void _insert(_Data *p_data, uint32_t p_hash, uint32_t p_idx);
+	void _init_static(const char *p_name, uint32_t p_hash);
 
 	_Data *_data;
 
@@ -127,6 +145,14 @@ public:
 		return String();
 	}
 
+#if __cplusplus >= 201103L
+	// same as String::hash(const char *), usable in constant expressions
+	static constexpr uint32_t hash_static(const char *p_cstr, uint32_t p_hash = 5381) {
+
+		return *p_cstr ? hash_static(p_cstr + 1, ((p_hash << 5) + p_hash) + (uint32_t)*p_cstr) : p_hash;
+	}
+#endif
+
 	static StringName search(const char *p_name);
 	static StringName search(const CharType *p_name);
 	static StringName search(const String &p_name);
@@ -144,6 +170,7 @@ public:
 	StringName(const StringName &p_name);
 	StringName(const String &p_name);
 	StringName(const StaticCString &p_static_string);
+	StringName(const StaticCString &p_static_string, uint32_t p_hash, bool p_static = false);
 	StringName();
 	~StringName();
 };
@@ -158,4 +185,23 @@ StringName _scs_create(const char *p_chr);
 //#define _SCS(m_cstr) (m_cstr[0]?StringName(StaticCString::create(m_cstr)):StringName())
 #define _SCS(m_cstr) _scs_create(m_cstr)
 
+/**
+ * Interns a string literal once per call site and returns a reference to
+ * the cached StringName, so hot paths like emit_signal(SNAME("timeout"))
+ * skip hashing and the table lookup after the first call. The hash is
+ * computed at compile time. Only use it after the core types are set up.
+ *
+ * The cache needs C++11. In C++98 builds SNAME() makes a new StringName
+ * on every call, the same as passing the literal.
+ */
+#if __cplusplus >= 201103L
+#define SNAME(m_cstr) ([]() -> const StringName & {                                 \
+	static constexpr uint32_t sname_hash = StringName::hash_static(m_cstr);         \
+	static const StringName sname(StaticCString::create(m_cstr), sname_hash, true); \
+	return sname;                                                                   \
+})()
+#else
+#define SNAME(m_cstr) StringName(m_cstr)
+#endif
+
 #endif
@@ -32,7 +32,9 @@
 #include "color.h"
 #include "math_funcs.h"
 #include "os/memory.h"
+#include "os/copymem.h"
 #include "print_string.h"
+#include "string_builder.h"
 #include "ucaps.h"
 #include "variant.h"
 
@@ -163,8 +165,20 @@ bool String::operator!=(const String &p_str) const {
 
 String String::operator+(const String &p_str) const {
 
-	String res = *this;
-	res += p_str;
+	if (empty())
+		return p_str;
+	if (p_str.empty())
+		return *this;
+
+	// Size the result once instead of copying this and growing it.
+	int len = length();
+	int other_len = p_str.length();
+
+	String res;
+	res.resize(len + other_len + 1);
+	CharType *dst = res.ptr();
+	copymem(dst, c_str(), len * sizeof(CharType));
+	copymem(dst + len, p_str.c_str(), (other_len + 1) * sizeof(CharType));
 	return res;
 }
 
@@ -2217,9 +2231,10 @@ bool operator==(const char *p_chr, const String &p_str) {
 
 String operator+(const char *p_chr, const String &p_str) {
 
-	String tmp = p_chr;
-	tmp += p_str;
-	return tmp;
+	StringBuilder sb;
+	sb.append(p_chr);
+	sb.append(p_str);
+	return sb.as_string();
 }
 String operator+(CharType p_chr, const String &p_str) {
 
@@ -2477,6 +2492,9 @@ String String::substr(int p_from, int p_chars) const {
 		p_chars = length() - p_from;
 	}
 
+	if (p_from == 0 && p_chars == length())
+		return *this; // shares the buffer
+
 	return String(&c_str()[p_from], p_chars);
 }
 
@@ -2966,39 +2984,38 @@ String String::format(const Variant &values, String placeholder) const {
 
 String String::replace(String p_key, String p_with) const {
 
-	String new_string;
+	int result = find(p_key);
+	if (result < 0)
+		return *this;
+
+	StringBuilder new_string;
 	int search_from = 0;
-	int result = 0;
 
-	while ((result = find(p_key, search_from)) >= 0) {
+	do {
 
-		new_string += substr(search_from, result - search_from);
-		new_string += p_with;
+		new_string.append(&c_str()[search_from], result - search_from);
+		new_string.append(p_with);
 		search_from = result + p_key.length();
-	}
+	} while ((result = find(p_key, search_from)) >= 0);
 
-	new_string += substr(search_from, length() - search_from);
+	new_string.append(&c_str()[search_from], length() - search_from);
 
-	return new_string;
+	return new_string.as_string();
 }
 
 String String::replace_first(String p_key, String p_with) const {
 
-	String new_string;
-	int search_from = 0;
-	int result = 0;
-
-	while ((result = find(p_key, search_from)) >= 0) {
-
-		new_string += substr(search_from, result - search_from);
-		new_string += p_with;
-		search_from = result + p_key.length();
-		break;
-	}
+	int result = find(p_key);
+	if (result < 0)
+		return *this;
 
-	new_string += substr(search_from, length() - search_from);
+	StringBuilder new_string;
+	new_string.append(c_str(), result);
+	new_string.append(p_with);
+	int search_from = result + p_key.length();
+	new_string.append(&c_str()[search_from], length() - search_from);
 
-	return new_string;
+	return new_string.as_string();
 }
 String String::replacen(String p_key, String p_with) const {
 
@@ -3950,7 +3967,7 @@ String String::lpad(int min_length, const String &character) const {
 //   "fish %s %d pie" % ["frog", 12]
 // In case of an error, the string returned is the error description and "error" is true.
 String String::sprintf(const Array &values, bool *error) const {
-	String formatted;
+	StringBuilder formatted;
 	CharType *self = (CharType *)c_str();
 	bool in_format = false;
 	int value_index = 0;
@@ -3969,7 +3986,7 @@ String String::sprintf(const Array &values, bool *error) const {
 		if (in_format) { // We have % - lets see what else we get.
 			switch (c) {
 				case '%': { // Replace %% with %
-					formatted += chr(c);
+					formatted += c;
 					in_format = false;
 					break;
 				}
@@ -4188,7 +4205,7 @@ String String::sprintf(const Array &values, bool *error) const {
 					in_decimals = false;
 					break;
 				default:
-					formatted += chr(c);
+					formatted += c;
 			}
 		}
 	}
@@ -4202,7 +4219,7 @@ String String::sprintf(const Array &values, bool *error) const {
 	}
 
 	*error = false;
-	return formatted;
+	return formatted.as_string();
 }
 
 #include "translation.h"
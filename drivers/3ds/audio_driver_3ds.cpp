@@ -41,22 +41,21 @@ Error AudioDriver3ds::init() {
 		return FAILED;
 
 	active=false;
+	paused=false;
 	thread_exited=false;
 	exit_thread=false;
 	pcm_open = false;
-	samples_in = NULL;
 
 	mix_rate = 44100;
 	output_format = OUTPUT_STEREO;
 	channels = 2;
 
 	int latency = GLOBAL_DEF("audio/output_latency",25);
-	buffer_size = next_power_of_2( latency * mix_rate / 1000 );
+	int buffer_size = next_power_of_2( latency * mix_rate / 1000 );
+	int buffer_count = CLAMP(int(GLOBAL_DEF("audio/3ds/buffer_count",3)), 2, int(AudioPump::MAX_BUFFERS));
 
-	samples_in = memnew_arr(int32_t, buffer_size*channels);
-	
 	ndspWaveBuf* buffer = ndsp_buffers;
-	for (int i = 0; i < NDSP_BUFFER_COUNT; ++i) {
+	for (int i = 0; i < buffer_count; ++i) {
 		memset(buffer, 0, sizeof(ndspWaveBuf));
 		buffer->data_vaddr = linearAlloc(buffer_size * channels * sizeof(int16_t));
 		buffer->nsamples = buffer_size;
@@ -65,56 +64,74 @@ Error AudioDriver3ds::init() {
 		buffer++;
 	}
 	
+	pump.setup(this, buffer_count, buffer_size, channels, AudioDriver3ds::mix_func, this);
+	
 	ndspChnReset(channel_num);
 	ndspChnSetInterp(channel_num, NDSP_INTERP_LINEAR);
 	ndspChnSetRate(channel_num, mix_rate);
 	ndspChnSetFormat(channel_num, (channels == 1) ? NDSP_FORMAT_MONO_PCM16 : NDSP_FORMAT_STEREO_PCM16);
 
+	// sample voices on the channels the output leaves free, 0 mixes everything in software
+	int hardware_voices = CLAMP(int(GLOBAL_DEF("audio/3ds/hardware_voices", 0)), 0, int(AudioMixerHW::MAX_HARDWARE_VOICES) - 1);
+	int cache_kb = GLOBAL_DEF("audio/3ds/hardware_sample_cache_kb", 1024);
+	hw_voices.setup(hardware_voices, channel_num, cache_kb * 1024);
+
+	LightEvent_Init(&buffer_event, RESET_ONESHOT);
+	ndspSetCallback(AudioDriver3ds::ndsp_callback, this);
+
 	mutex = Mutex::create();
 	thread = Thread3ds::create(AudioDriver3ds::thread_func, this);
 
 	return OK;
 };
 
+void AudioDriver3ds::ndsp_callback(void* p_udata) {
+
+	// Runs for every DSP frame, only wake the pump when it has work
+	AudioDriver3ds* ad = (AudioDriver3ds*)p_udata;
+	if (ad->exit_thread || ad->ndsp_buffers[ad->pump.get_next_buffer()].status == NDSP_WBUF_DONE)
+		LightEvent_Signal(&ad->buffer_event);
+}
+
+void AudioDriver3ds::mix_func(void* p_udata, int p_frames, int32_t* r_buffer) {
+
+	AudioDriver3ds* ad = (AudioDriver3ds*)p_udata;
+	ad->lock();
+	ad->audio_server_process(p_frames, r_buffer);
+	ad->unlock();
+}
+
+int16_t* AudioDriver3ds::sink_get_buffer(int p_index) {
+
+	ndspWaveBuf* buffer = &ndsp_buffers[p_index];
+	buffer->status = NDSP_WBUF_FREE;
+	return buffer->data_pcm16;
+}
+
+bool AudioDriver3ds::sink_is_buffer_done(int p_index) const {
+
+	return ndsp_buffers[p_index].status == NDSP_WBUF_DONE;
+}
+
+void AudioDriver3ds::sink_submit_buffer(int p_index, int p_frames) {
+
+	ndspWaveBuf* buffer = &ndsp_buffers[p_index];
+	DSP_FlushDataCache(buffer->data_pcm16, p_frames * channels * sizeof(int16_t));
+	ndspChnWaveBufAdd(channel_num, buffer);
+}
+
 void AudioDriver3ds::thread_func(void* p_udata) {
-	
-	int buffer_index = 0;
-	ndspWaveBuf* buffer;
 
 	AudioDriver3ds* ad = (AudioDriver3ds*)p_udata;
-	
-	int sample_count = ad->buffer_size * ad->channels;
 
 	while (!ad->exit_thread) {
-		
-		buffer = &ad->ndsp_buffers[buffer_index % NDSP_BUFFER_COUNT];
-		
-		while (!ad->exit_thread && (!ad->active || buffer->status != NDSP_WBUF_DONE))
-			OS::get_singleton()->delay_usec(10000);
-		
-		if (ad->exit_thread)
-			break;
-
-		buffer->status = NDSP_WBUF_FREE;
-
-		if (ad->active) {
-			ad->lock();
-			ad->audio_server_process(ad->buffer_size, ad->samples_in);
-			ad->unlock();
-			
-			for(int i = 0; i < sample_count; ++i)
-				buffer->data_pcm16[i] = ad->samples_in[i] >> 16;
-			
-		} else
-			memset(buffer->data_pcm16, 0, sample_count * sizeof(int16_t));
-		
-		DSP_FlushDataCache(buffer->data_pcm16, sample_count * sizeof(int16_t));
-		ndspChnWaveBufAdd(channel_num, buffer);
-
-		buffer_index++;
+
+		ad->pump.pump(ad->active && !ad->paused);
+		LightEvent_Wait(&ad->buffer_event);
 	}
 
 	ndspChnWaveBufClear(channel_num);
+	ad->hw_voices.clear();
 
 	ad->thread_exited=true;
 };
@@ -129,10 +146,23 @@ int AudioDriver3ds::get_mix_rate() const {
 	return mix_rate;
 };
 
+AudioMixerHW::Backend *AudioDriver3ds::get_voice_backend() {
+
+	return hw_voices.backend_get_voice_count() ? &hw_voices : NULL;
+}
+
 AudioDriverSW::OutputFormat AudioDriver3ds::get_output_format() const {
 
 	return output_format;
 };
+void AudioDriver3ds::set_pause(bool p_pause) {
+
+	// Mixing happens under the lock, so this waits for the current buffer
+	lock();
+	paused = p_pause;
+	unlock();
+}
+
 void AudioDriver3ds::lock() {
 
 	if (!thread || !mutex)
@@ -152,14 +182,13 @@ void AudioDriver3ds::finish() {
 		return;
 
 	exit_thread = true;
+	LightEvent_Signal(&buffer_event);
 	Thread3ds::wait_to_finish(thread);
+	ndspSetCallback(NULL, NULL);
 
-	if (samples_in) {
-		memdelete_arr(samples_in);
-	};
-	
-	for (int i = 0; i < NDSP_BUFFER_COUNT; ++i)
+	for (int i = 0; i < pump.get_buffer_count(); ++i)
 		linearFree(ndsp_buffers[i].data_pcm16);
+	pump.clear();
 
 	memdelete(thread);
 	if (mutex)
@@ -173,6 +202,8 @@ AudioDriver3ds::AudioDriver3ds() {
 
 	mutex = NULL;
 	thread = NULL;
+	active = false;
+	paused = false;
 };
 
 AudioDriver3ds::~AudioDriver3ds() {
@@ -30,12 +30,15 @@
 #define AUDIO_DRIVER_3DS_H
 
 #include "servers/audio/audio_server_sw.h"
+#include "audio_pump.h"
+#include "audio_voices_3ds.h"
 
 #include "core/os/thread.h"
 #include "core/os/mutex.h"
 
 extern "C" {
 #include <3ds/types.h>
+#include <3ds/synchronization.h>
 #include <3ds/ndsp/ndsp.h>
 #include <3ds/ndsp/channel.h>
 #include <3ds/allocator/linear.h>
@@ -43,21 +46,19 @@ extern "C" {
 }
 
 
-class AudioDriver3ds : public AudioDriverSW {
+class AudioDriver3ds : public AudioDriverSW, public AudioPump::Sink {
 	
-	enum {
-		NDSP_BUFFER_COUNT = 3,
-	};
-
 	Thread* thread;
 	Mutex* mutex;
 
-	int32_t* samples_in;
-	
-	ndspWaveBuf ndsp_buffers[NDSP_BUFFER_COUNT];
+	AudioPump pump;
+	ndspWaveBuf ndsp_buffers[AudioPump::MAX_BUFFERS];
+	LightEvent buffer_event;
+	AudioVoices3ds hw_voices;
 
 	static void thread_func(void* p_udata);
-	int buffer_size;
+	static void ndsp_callback(void* p_udata);
+	static void mix_func(void* p_udata, int p_frames, int32_t* r_buffer);
 
 	unsigned int mix_rate;
 	OutputFormat output_format;
@@ -65,10 +66,17 @@ class AudioDriver3ds : public AudioDriverSW {
 	int channels;
 
 	bool active;
+	bool paused;
 	bool thread_exited;
 	mutable bool exit_thread;
 	bool pcm_open;
 
+protected:
+
+	virtual int16_t* sink_get_buffer(int p_index);
+	virtual bool sink_is_buffer_done(int p_index) const;
+	virtual void sink_submit_buffer(int p_index, int p_frames);
+
 public:
 
 	const char* get_name() const {
@@ -83,6 +91,13 @@ public:
 	virtual void unlock();
 	virtual void finish();
 
+	// Stops mixing, once it returns the audio server is not in use by the driver thread
+	void set_pause(bool p_pause);
+
+	virtual AudioMixerHW::Backend *get_voice_backend();
+
+	uint32_t get_underrun_count() const { return pump.get_underrun_count(); }
+
 	AudioDriver3ds();
 	~AudioDriver3ds();
 };
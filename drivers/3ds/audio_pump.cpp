@@ -0,0 +1,147 @@
+/*************************************************************************/
+/*  audio_pump.cpp                                                       */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                    http://www.godotengine.org                         */
+/*************************************************************************/
+/* Copyright (c) 2007-2016 Juan Linietsky, Ariel Manzur.                 */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+#include "audio_pump.h"
+#include "error_macros.h"
+#include "os/memory.h"
+#include <string.h>
+
+#if defined(__ARM_FEATURE_DSP)
+#include <arm_acle.h>
+#endif
+
+static _FORCE_INLINE_ int32_t _round_sat(int32_t p_sample)
+{
+#if defined(__ARM_FEATURE_DSP)
+	return __qadd(p_sample, 0x8000);
+#else
+	return p_sample > 0x7FFFFFFF - 0x8000 ? 0x7FFFFFFF : p_sample + 0x8000;
+#endif
+}
+
+void AudioPump::convert_to_int16(const int32_t *p_src, int16_t *p_dst, int p_count)
+{
+	// ARM11 has no NEON, but packing the high halves of two words into one
+	// store maps to QADD + PKHTB and halves the memory traffic
+	if (p_count > 0 && ((size_t)p_dst & 3)) {
+		*p_dst++ = _round_sat(*p_src++) >> 16;
+		p_count--;
+	}
+
+	uint32_t *dst = (uint32_t *)p_dst;
+	int pairs = p_count >> 1;
+	for (int i = 0; i < (pairs & ~1); i += 2) {
+		uint32_t a = _round_sat(p_src[0]);
+		uint32_t b = _round_sat(p_src[1]);
+		uint32_t c = _round_sat(p_src[2]);
+		uint32_t d = _round_sat(p_src[3]);
+		dst[0] = (a >> 16) | (b & 0xFFFF0000);
+		dst[1] = (c >> 16) | (d & 0xFFFF0000);
+		dst += 2;
+		p_src += 4;
+	}
+	if (pairs & 1) {
+		uint32_t a = _round_sat(p_src[0]);
+		uint32_t b = _round_sat(p_src[1]);
+		*dst++ = (a >> 16) | (b & 0xFFFF0000);
+		p_src += 2;
+	}
+	if (p_count & 1)
+		*(int16_t *)dst = _round_sat(*p_src) >> 16;
+}
+
+void AudioPump::setup(Sink *p_sink, int p_buffer_count, int p_buffer_frames, int p_channels, MixFunc p_mix_func, void *p_userdata)
+{
+	ERR_FAIL_COND(!p_sink || !p_mix_func);
+	ERR_FAIL_COND(p_buffer_count < 2 || p_buffer_count > MAX_BUFFERS);
+	ERR_FAIL_COND(p_buffer_frames <= 0 || p_channels <= 0);
+
+	clear();
+
+	sink = p_sink;
+	mix_func = p_mix_func;
+	mix_userdata = p_userdata;
+	buffer_count = p_buffer_count;
+	buffer_frames = p_buffer_frames;
+	channels = p_channels;
+	mix_buffer = memnew_arr(int32_t, buffer_frames * channels);
+}
+
+void AudioPump::clear()
+{
+	if (mix_buffer)
+		memdelete_arr(mix_buffer);
+	mix_buffer = NULL;
+	sink = NULL;
+	buffer_count = 0;
+	next_buffer = 0;
+	primed = false;
+	underruns = 0;
+}
+
+int AudioPump::pump(bool p_active)
+{
+	ERR_FAIL_COND_V(!sink, 0);
+
+	if (primed && sink->sink_is_buffer_done((next_buffer + buffer_count - 1) % buffer_count))
+		underruns++;
+
+	int sample_count = buffer_frames * channels;
+	int queued = 0;
+	while (queued < buffer_count && sink->sink_is_buffer_done(next_buffer)) {
+
+		int16_t *out = sink->sink_get_buffer(next_buffer);
+		if (p_active) {
+			mix_func(mix_userdata, buffer_frames, mix_buffer);
+			convert_to_int16(mix_buffer, out, sample_count);
+		} else {
+			memset(out, 0, sample_count * sizeof(int16_t));
+		}
+		sink->sink_submit_buffer(next_buffer, buffer_frames);
+
+		next_buffer = (next_buffer + 1) % buffer_count;
+		queued++;
+	}
+
+	// Silence doesn't count, the driver is allowed to starve while inactive
+	if (queued)
+		primed = p_active;
+
+	return queued;
+}
+
+AudioPump::AudioPump()
+{
+	mix_buffer = NULL;
+	clear();
+}
+
+AudioPump::~AudioPump()
+{
+	clear();
+}
@@ -0,0 +1,94 @@
+/*************************************************************************/
+/*  audio_pump.h                                                         */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                    http://www.godotengine.org                         */
+/*************************************************************************/
+/* Copyright (c) 2007-2016 Juan Linietsky, Ariel Manzur.                 */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+#ifndef AUDIO_PUMP_H
+#define AUDIO_PUMP_H
+
+#include "typedefs.h"
+
+/**
+	Keeps a ring of output buffers full. Each call to pump() mixes into
+	every buffer the sink reports as done, in ring order, and queues it
+	again. When the most recently queued buffer has already finished, the
+	sink ran dry before we got to it, and that is counted as an underrun.
+
+	The sink owns the buffers and knows how to wait for one to finish, so
+	the driver thread only wakes when there is work, and tests use a fake
+	sink with no hardware behind it.
+*/
+
+class AudioPump {
+public:
+	enum {
+		MAX_BUFFERS = 8,
+	};
+
+	class Sink {
+	public:
+		virtual int16_t *sink_get_buffer(int p_index) = 0;
+		virtual bool sink_is_buffer_done(int p_index) const = 0;
+		virtual void sink_submit_buffer(int p_index, int p_frames) = 0;
+		virtual ~Sink() {}
+	};
+
+	typedef void (*MixFunc)(void *p_userdata, int p_frames, int32_t *r_buffer);
+
+private:
+	Sink *sink;
+	MixFunc mix_func;
+	void *mix_userdata;
+
+	int buffer_count;
+	int buffer_frames;
+	int channels;
+	int32_t *mix_buffer;
+
+	int next_buffer;
+	bool primed;
+	uint32_t underruns;
+
+public:
+	void setup(Sink *p_sink, int p_buffer_count, int p_buffer_frames, int p_channels, MixFunc p_mix_func, void *p_userdata);
+	void clear();
+
+	// Fills every finished buffer, silence when not active. Returns how many were queued.
+	int pump(bool p_active);
+
+	int get_next_buffer() const { return next_buffer; }
+	int get_buffer_count() const { return buffer_count; }
+	int get_buffer_frames() const { return buffer_frames; }
+	uint32_t get_underrun_count() const { return underruns; }
+
+	// Rounds to nearest and saturates, two samples per 32 bit store
+	static void convert_to_int16(const int32_t *p_src, int16_t *p_dst, int p_count);
+
+	AudioPump();
+	~AudioPump();
+};
+
+#endif // AUDIO_PUMP_H
@@ -0,0 +1,255 @@
+/*************************************************************************/
+/*  audio_voices_3ds.cpp                                                 */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                    http://www.godotengine.org                         */
+/*************************************************************************/
+/* Copyright (c) 2007-2016 Juan Linietsky, Ariel Manzur.                 */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+#ifdef _3DS
+#include "audio_voices_3ds.h"
+#include <string.h>
+
+AudioVoices3ds::SampleCopy *AudioVoices3ds::_acquire(const Sample &p_sample) {
+
+	int frame_size = (p_sample.format == AS::SAMPLE_FORMAT_PCM16 ? 2 : 1) * (p_sample.stereo ? 2 : 1);
+	int size = p_sample.length * frame_size;
+
+	Map<RID, SampleCopy>::Element *E = copies.find(p_sample.rid);
+	if (E && E->get().version != p_sample.version) {
+		// the sample data was set again since it was copied
+		if (E->get().users)
+			return NULL;
+		copy_memory -= E->get().size;
+		linearFree(E->get().data);
+		copies.erase(E);
+		E = NULL;
+	}
+
+	if (!E) {
+		_trim(size);
+		void *data = linearAlloc(size);
+		if (!data) {
+			_trim(copy_budget);
+			data = linearAlloc(size);
+			if (!data)
+				return NULL;
+		}
+
+		memcpy(data, p_sample.data, size);
+		DSP_FlushDataCache(data, size);
+
+		SampleCopy copy;
+		copy.data = data;
+		copy.version = p_sample.version;
+		copy.size = size;
+		copy.users = 0;
+		E = copies.insert(p_sample.rid, copy);
+		copy_memory += size;
+	}
+
+	E->get().users++;
+	E->get().last_used = use_count++;
+	return &E->get();
+}
+
+void AudioVoices3ds::_release(RID p_sample) {
+
+	Map<RID, SampleCopy>::Element *E = copies.find(p_sample);
+	ERR_FAIL_COND(!E);
+	E->get().users--;
+}
+
+void AudioVoices3ds::_trim(int p_needed) {
+
+	// drop the least recently used copies nobody plays until p_needed fits
+	while (copy_memory + p_needed > copy_budget) {
+
+		Map<RID, SampleCopy>::Element *oldest = NULL;
+		for (Map<RID, SampleCopy>::Element *E = copies.front(); E; E = E->next()) {
+
+			if (E->get().users)
+				continue;
+			if (!oldest || E->get().last_used < oldest->get().last_used)
+				oldest = E;
+		}
+
+		if (!oldest)
+			return;
+
+		copy_memory -= oldest->get().size;
+		linearFree(oldest->get().data);
+		copies.erase(oldest);
+	}
+}
+
+void AudioVoices3ds::setup(int p_voices, int p_reserved_channel, int p_cache_budget) {
+
+	voice_count = CLAMP(p_voices, 0, int(AudioMixerHW::MAX_HARDWARE_VOICES) - 1);
+	copy_budget = p_cache_budget;
+
+	for (int i = 0; i < voice_count; i++) {
+		voices[i].channel = i < p_reserved_channel ? i : i + 1;
+		voices[i].active = false;
+	}
+}
+
+void AudioVoices3ds::clear() {
+
+	for (int i = 0; i < voice_count; i++) {
+		backend_voice_stop(i);
+	}
+
+	for (Map<RID, SampleCopy>::Element *E = copies.front(); E; E = E->next()) {
+		linearFree(E->get().data);
+	}
+	copies.clear();
+	copy_memory = 0;
+	voice_count = 0;
+}
+
+int AudioVoices3ds::backend_get_voice_count() const {
+
+	return voice_count;
+}
+
+bool AudioVoices3ds::backend_voice_start(int p_voice, const Sample &p_sample, int p_from_frame, int p_mix_rate, float p_left, float p_right) {
+
+	ERR_FAIL_INDEX_V(p_voice, voice_count, false);
+	ERR_FAIL_INDEX_V(p_from_frame, p_sample.length, false);
+
+	backend_voice_stop(p_voice);
+
+	u16 format;
+	switch (p_sample.format) {
+		case AS::SAMPLE_FORMAT_PCM8: format = p_sample.stereo ? NDSP_FORMAT_STEREO_PCM8 : NDSP_FORMAT_MONO_PCM8; break;
+		case AS::SAMPLE_FORMAT_PCM16: format = p_sample.stereo ? NDSP_FORMAT_STEREO_PCM16 : NDSP_FORMAT_MONO_PCM16; break;
+		default: return false;
+	}
+
+	SampleCopy *copy = _acquire(p_sample);
+	if (!copy)
+		return false;
+
+	Voice &v = voices[p_voice];
+	int frame_size = (p_sample.format == AS::SAMPLE_FORMAT_PCM16 ? 2 : 1) * (p_sample.stereo ? 2 : 1);
+	int loop_end = MIN(p_sample.loop_end, p_sample.length);
+
+	v.sample = p_sample.rid;
+	v.looping = p_sample.loop_format == AS::SAMPLE_LOOP_FORWARD && p_sample.loop_begin < loop_end;
+	v.loop_begin = v.looping ? p_sample.loop_begin : 0;
+	v.start_frame = p_from_frame;
+	if (v.looping && v.start_frame >= loop_end)
+		v.start_frame = v.loop_begin;
+	v.active = true;
+
+	ndspChnReset(v.channel);
+	ndspChnSetInterp(v.channel, NDSP_INTERP_LINEAR);
+	ndspChnSetRate(v.channel, p_mix_rate);
+	ndspChnSetFormat(v.channel, format);
+	backend_voice_set_volume(p_voice, p_left, p_right);
+
+	memset(v.buffers, 0, sizeof(v.buffers));
+
+	ndspWaveBuf *intro = &v.buffers[0];
+	intro->data_vaddr = (uint8_t *)copy->data + v.start_frame * frame_size;
+	intro->nsamples = (v.looping ? loop_end : p_sample.length) - v.start_frame;
+	intro->looping = false;
+	ndspChnWaveBufAdd(v.channel, intro);
+
+	if (v.looping) {
+		ndspWaveBuf *loop = &v.buffers[1];
+		loop->data_vaddr = (uint8_t *)copy->data + v.loop_begin * frame_size;
+		loop->nsamples = loop_end - v.loop_begin;
+		loop->looping = true;
+		ndspChnWaveBufAdd(v.channel, loop);
+	}
+
+	return true;
+}
+
+void AudioVoices3ds::backend_voice_stop(int p_voice) {
+
+	ERR_FAIL_INDEX(p_voice, voice_count);
+	Voice &v = voices[p_voice];
+	if (!v.active)
+		return;
+
+	ndspChnWaveBufClear(v.channel);
+	_release(v.sample);
+	v.active = false;
+}
+
+void AudioVoices3ds::backend_voice_set_mix_rate(int p_voice, int p_mix_rate) {
+
+	ERR_FAIL_INDEX(p_voice, voice_count);
+	ndspChnSetRate(voices[p_voice].channel, p_mix_rate);
+}
+
+void AudioVoices3ds::backend_voice_set_volume(int p_voice, float p_left, float p_right) {
+
+	ERR_FAIL_INDEX(p_voice, voice_count);
+
+	float mix[12];
+	memset(mix, 0, sizeof(mix));
+	mix[0] = p_left;
+	mix[1] = p_right;
+	ndspChnSetMix(voices[p_voice].channel, mix);
+}
+
+bool AudioVoices3ds::backend_voice_is_playing(int p_voice) const {
+
+	ERR_FAIL_INDEX_V(p_voice, voice_count, false);
+	const Voice &v = voices[p_voice];
+
+	// the loop buffer never finishes, a one-shot is done with its only buffer
+	return v.active && (v.looping || v.buffers[0].status != NDSP_WBUF_DONE);
+}
+
+int AudioVoices3ds::backend_voice_get_position(int p_voice) const {
+
+	ERR_FAIL_INDEX_V(p_voice, voice_count, 0);
+	const Voice &v = voices[p_voice];
+	if (!v.active)
+		return 0;
+
+	int pos = ndspChnGetSamplePos(v.channel);
+	if (v.looping && v.buffers[0].status == NDSP_WBUF_DONE)
+		return v.loop_begin + pos;
+	return v.start_frame + pos;
+}
+
+AudioVoices3ds::AudioVoices3ds() {
+
+	voice_count = 0;
+	copy_memory = 0;
+	copy_budget = 0;
+	use_count = 0;
+}
+
+AudioVoices3ds::~AudioVoices3ds() {
+
+	clear();
+}
+
+#endif
@@ -0,0 +1,104 @@
+/*************************************************************************/
+/*  audio_voices_3ds.h                                                   */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                    http://www.godotengine.org                         */
+/*************************************************************************/
+/* Copyright (c) 2007-2016 Juan Linietsky, Ariel Manzur.                 */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+#ifndef AUDIO_VOICES_3DS_H
+#define AUDIO_VOICES_3DS_H
+
+#include "servers/audio/audio_mixer_hw.h"
+#include "map.h"
+
+extern "C" {
+#include <3ds/types.h>
+#include <3ds/ndsp/ndsp.h>
+#include <3ds/ndsp/channel.h>
+#include <3ds/allocator/linear.h>
+#include <3ds/services/dsp.h>
+}
+
+/**
+	Plays AudioMixerHW channels on the ndsp channels the output stream
+	leaves free, letting the DSP do the resampling and volume.
+
+	The DSP only reads linear memory, so each sample is copied there the
+	first time it plays. Copies stay while a voice uses them, and unused
+	ones are kept up to the cache budget so repeated effects don't copy
+	again. A copy is only reused while the sample version matches, so data
+	set again in place, or a freed RID handed to a new sample, is copied
+	afresh. A sample with a loop start gets two wave buffers: the part up
+	to the loop end, then the loop itself, repeating.
+*/
+
+class AudioVoices3ds : public AudioMixerHW::Backend {
+
+	struct SampleCopy {
+		void *data;
+		uint32_t version;
+		int size;
+		int users;
+		uint64_t last_used;
+	};
+
+	struct Voice {
+		int channel;
+		RID sample;
+		ndspWaveBuf buffers[2];
+		int start_frame;
+		int loop_begin;
+		bool looping;
+		bool active;
+	};
+
+	Voice voices[AudioMixerHW::MAX_HARDWARE_VOICES];
+	int voice_count;
+
+	Map<RID, SampleCopy> copies;
+	int copy_memory;
+	int copy_budget;
+	uint64_t use_count;
+
+	SampleCopy *_acquire(const Sample &p_sample);
+	void _release(RID p_sample);
+	void _trim(int p_needed);
+
+public:
+	void setup(int p_voices, int p_reserved_channel, int p_cache_budget);
+	void clear();
+
+	virtual int backend_get_voice_count() const;
+	virtual bool backend_voice_start(int p_voice, const Sample &p_sample, int p_from_frame, int p_mix_rate, float p_left, float p_right);
+	virtual void backend_voice_stop(int p_voice);
+	virtual void backend_voice_set_mix_rate(int p_voice, int p_mix_rate);
+	virtual void backend_voice_set_volume(int p_voice, float p_left, float p_right);
+	virtual bool backend_voice_is_playing(int p_voice) const;
+	virtual int backend_voice_get_position(int p_voice) const;
+
+	AudioVoices3ds();
+	~AudioVoices3ds();
+};
+
+#endif // AUDIO_VOICES_3DS_H
@@ -0,0 +1,200 @@
+/*************************************************************************/
+/*  canvas_batcher.cpp                                                   */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                    http://www.godotengine.org                         */
+/*************************************************************************/
+/* Copyright (c) 2007-2016 Juan Linietsky, Ariel Manzur.                 */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+#include "canvas_batcher.h"
+
+void CanvasBatcher::fill_quad_indices(uint16_t *p_indices, int p_quad_count)
+{
+	for (int i = 0; i < p_quad_count; i++) {
+		uint16_t base = i * VERTICES_PER_QUAD;
+		*p_indices++ = base + 0;
+		*p_indices++ = base + 1;
+		*p_indices++ = base + 2;
+		*p_indices++ = base + 0;
+		*p_indices++ = base + 2;
+		*p_indices++ = base + 3;
+	}
+}
+
+void CanvasBatcher::set_clip(bool p_clip, const Rect2 &p_rect)
+{
+	state.clip = p_clip;
+	state.clip_rect = p_clip ? p_rect : Rect2();
+}
+
+void CanvasBatcher::_check_state()
+{
+	if (quad_count == MAX_BATCH_QUADS || (quad_count && pending_state != state))
+		flush();
+
+	if (quad_count == 0)
+		pending_state = state;
+}
+
+void CanvasBatcher::add_quad(const Rect2 &p_rect, const Rect2 &p_src_region, const Size2 &p_tex_size, const Color &p_color, bool p_h_flip, bool p_v_flip, bool p_transpose)
+{
+	_check_state();
+
+	Vector2 pos[4] = {
+		transform.xform(p_rect.pos),
+		transform.xform(Vector2(p_rect.pos.x + p_rect.size.width, p_rect.pos.y)),
+		transform.xform(p_rect.pos + p_rect.size),
+		transform.xform(Vector2(p_rect.pos.x, p_rect.pos.y + p_rect.size.height)),
+	};
+
+	Vector2 uv[4];
+	if (p_tex_size.width > 0 && p_tex_size.height > 0) {
+		float u0 = p_src_region.pos.x / p_tex_size.width;
+		float v0 = p_src_region.pos.y / p_tex_size.height;
+		float u1 = (p_src_region.pos.x + p_src_region.size.width) / p_tex_size.width;
+		float v1 = (p_src_region.pos.y + p_src_region.size.height) / p_tex_size.height;
+		uv[0] = Vector2(u0, v0);
+		uv[1] = Vector2(u1, v0);
+		uv[2] = Vector2(u1, v1);
+		uv[3] = Vector2(u0, v1);
+
+		// Same order as the old per-quad path so flips look identical
+		if (p_transpose) {
+			SWAP(uv[1], uv[3]);
+		}
+		if (p_h_flip) {
+			SWAP(uv[0], uv[1]);
+			SWAP(uv[2], uv[3]);
+		}
+		if (p_v_flip) {
+			SWAP(uv[1], uv[2]);
+			SWAP(uv[0], uv[3]);
+		}
+	}
+
+	Vertex *v = &vertices.ptr()[quad_count * VERTICES_PER_QUAD];
+	for (int i = 0; i < VERTICES_PER_QUAD; i++) {
+		v[i].x = pos[i].x;
+		v[i].y = pos[i].y;
+		v[i].z = depth;
+		v[i].u = uv[i].x;
+		v[i].v = uv[i].y;
+		v[i].r = p_color.r;
+		v[i].g = p_color.g;
+		v[i].b = p_color.b;
+		v[i].a = p_color.a;
+	}
+
+	quad_count++;
+}
+
+void CanvasBatcher::add_nine_patch(const Rect2 &p_rect, const Rect2 &p_src_region, const Size2 &p_tex_size, const float *p_margin, bool p_draw_center, const Color &p_color)
+{
+	const Rect2 &region = p_src_region;
+
+	Rect2 rect_center(p_rect.pos + Point2(p_margin[MARGIN_LEFT], p_margin[MARGIN_TOP]), Size2(p_rect.size.width - p_margin[MARGIN_LEFT] - p_margin[MARGIN_RIGHT], p_rect.size.height - p_margin[MARGIN_TOP] - p_margin[MARGIN_BOTTOM]));
+	Rect2 src_center(Point2(region.pos.x + p_margin[MARGIN_LEFT], region.pos.y + p_margin[MARGIN_TOP]), Size2(region.size.width - p_margin[MARGIN_LEFT] - p_margin[MARGIN_RIGHT], region.size.height - p_margin[MARGIN_TOP] - p_margin[MARGIN_BOTTOM]));
+
+	Rect2 rects[9] = {
+		// corners
+		Rect2(p_rect.pos, Size2(p_margin[MARGIN_LEFT], p_margin[MARGIN_TOP])),
+		Rect2(Point2(p_rect.pos.x + p_rect.size.width - p_margin[MARGIN_RIGHT], p_rect.pos.y), Size2(p_margin[MARGIN_RIGHT], p_margin[MARGIN_TOP])),
+		Rect2(Point2(p_rect.pos.x, p_rect.pos.y + p_rect.size.height - p_margin[MARGIN_BOTTOM]), Size2(p_margin[MARGIN_LEFT], p_margin[MARGIN_BOTTOM])),
+		Rect2(Point2(p_rect.pos.x + p_rect.size.width - p_margin[MARGIN_RIGHT], p_rect.pos.y + p_rect.size.height - p_margin[MARGIN_BOTTOM]), Size2(p_margin[MARGIN_RIGHT], p_margin[MARGIN_BOTTOM])),
+		// edges
+		Rect2(Point2(rect_center.pos.x, p_rect.pos.y), Size2(rect_center.size.width, p_margin[MARGIN_TOP])),
+		Rect2(Point2(rect_center.pos.x, rect_center.pos.y + rect_center.size.height), Size2(rect_center.size.width, p_margin[MARGIN_BOTTOM])),
+		Rect2(Point2(p_rect.pos.x, rect_center.pos.y), Size2(p_margin[MARGIN_LEFT], rect_center.size.height)),
+		Rect2(Point2(rect_center.pos.x + rect_center.size.width, rect_center.pos.y), Size2(p_margin[MARGIN_RIGHT], rect_center.size.height)),
+		// center
+		rect_center,
+	};
+
+	Rect2 srcs[9] = {
+		Rect2(region.pos, Size2(p_margin[MARGIN_LEFT], p_margin[MARGIN_TOP])),
+		Rect2(Point2(region.pos.x + region.size.width - p_margin[MARGIN_RIGHT], region.pos.y), Size2(p_margin[MARGIN_RIGHT], p_margin[MARGIN_TOP])),
+		Rect2(Point2(region.pos.x, region.pos.y + region.size.height - p_margin[MARGIN_BOTTOM]), Size2(p_margin[MARGIN_LEFT], p_margin[MARGIN_BOTTOM])),
+		Rect2(Point2(region.pos.x + region.size.width - p_margin[MARGIN_RIGHT], region.pos.y + region.size.height - p_margin[MARGIN_BOTTOM]), Size2(p_margin[MARGIN_RIGHT], p_margin[MARGIN_BOTTOM])),
+		Rect2(Point2(src_center.pos.x, region.pos.y), Size2(src_center.size.width, p_margin[MARGIN_TOP])),
+		Rect2(Point2(src_center.pos.x, src_center.pos.y + src_center.size.height), Size2(src_center.size.width, p_margin[MARGIN_BOTTOM])),
+		Rect2(Point2(region.pos.x, region.pos.y + p_margin[MARGIN_TOP]), Size2(p_margin[MARGIN_LEFT], src_center.size.height)),
+		Rect2(Point2(src_center.pos.x + src_center.size.width, region.pos.y + p_margin[MARGIN_TOP]), Size2(p_margin[MARGIN_RIGHT], src_center.size.height)),
+		src_center,
+	};
+
+	int count = p_draw_center ? 9 : 8;
+	for (int i = 0; i < count; i++) {
+		// Zero margins are common in themes, don't waste vertices on them
+		if (rects[i].size.width <= 0 || rects[i].size.height <= 0)
+			continue;
+		add_quad(rects[i], srcs[i], p_tex_size, p_color);
+	}
+}
+
+void CanvasBatcher::flush()
+{
+	if (quad_count == 0)
+		return;
+
+	if (backend)
+		backend->canvas_batch_draw(pending_state, vertices.ptr(), quad_count);
+
+	batch_count++;
+	total_quads += quad_count;
+	quad_count = 0;
+}
+
+void CanvasBatcher::reset_stats()
+{
+	batch_count = 0;
+	total_quads = 0;
+}
+
+CanvasBatcher::CanvasBatcher()
+{
+	backend = NULL;
+	depth = 0.5f;
+	quad_count = 0;
+	batch_count = 0;
+	total_quads = 0;
+	vertices.resize(MAX_BATCH_QUADS * VERTICES_PER_QUAD);
+}
+
+void CanvasBatchRecorder::canvas_batch_draw(const CanvasBatcher::State &p_state, const CanvasBatcher::Vertex *p_vertices, int p_quad_count)
+{
+	Batch batch;
+	batch.state = p_state;
+	batch.first_vertex = vertices.size();
+	batch.quad_count = p_quad_count;
+	batches.push_back(batch);
+
+	int count = p_quad_count * CanvasBatcher::VERTICES_PER_QUAD;
+	for (int i = 0; i < count; i++)
+		vertices.push_back(p_vertices[i]);
+}
+
+void CanvasBatchRecorder::clear()
+{
+	batches.clear();
+	vertices.clear();
+}
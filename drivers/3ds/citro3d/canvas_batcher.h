@@ -0,0 +1,146 @@
+/*************************************************************************/
+/*  canvas_batcher.h                                                     */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                    http://www.godotengine.org                         */
+/*************************************************************************/
+/* Copyright (c) 2007-2016 Juan Linietsky, Ariel Manzur.                 */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+#ifndef CANVAS_BATCHER_H
+#define CANVAS_BATCHER_H
+
+#include "color.h"
+#include "math_2d.h"
+#include "vector.h"
+
+/**
+	Gathers consecutive canvas quads that share a texture, blend mode and
+	clip rect into a single vertex stream, handing one batch at a time to
+	a backend. Positions are transformed on the CPU so that items with
+	different transforms can still share a draw call.
+
+	This is pure CPU code on purpose: the citro3d rasterizer provides the
+	real backend, while tests use CanvasBatchRecorder.
+*/
+
+class CanvasBatcher {
+public:
+	enum {
+		MAX_BATCH_QUADS = 1024,
+		VERTICES_PER_QUAD = 4,
+		INDICES_PER_QUAD = 6,
+	};
+
+	struct Vertex {
+		float x, y, z;
+		float u, v;
+		float r, g, b, a;
+	};
+
+	struct State {
+		const void *texture; // opaque to the batcher, compared by identity
+		int blend_mode;
+		bool clip;
+		Rect2 clip_rect;
+
+		bool operator==(const State &p_state) const {
+			return texture == p_state.texture && blend_mode == p_state.blend_mode && clip == p_state.clip && (!clip || clip_rect == p_state.clip_rect);
+		}
+		bool operator!=(const State &p_state) const { return !(*this == p_state); }
+
+		State() {
+			texture = NULL;
+			blend_mode = 0;
+			clip = false;
+		}
+	};
+
+	class Backend {
+	public:
+		// p_vertices holds p_quad_count*VERTICES_PER_QUAD vertices, laid out
+		// so that fill_quad_indices() yields a valid triangle list.
+		virtual void canvas_batch_draw(const State &p_state, const Vertex *p_vertices, int p_quad_count) = 0;
+		virtual ~Backend() {}
+	};
+
+private:
+	Backend *backend;
+
+	State state;
+	State pending_state;
+	Matrix32 transform;
+	float depth;
+
+	Vector<Vertex> vertices;
+	int quad_count;
+
+	int batch_count;
+	int total_quads;
+
+	_FORCE_INLINE_ void _check_state();
+
+public:
+	static void fill_quad_indices(uint16_t *p_indices, int p_quad_count);
+
+	void set_backend(Backend *p_backend) { backend = p_backend; }
+
+	void set_texture(const void *p_texture) { state.texture = p_texture; }
+	void set_blend_mode(int p_blend_mode) { state.blend_mode = p_blend_mode; }
+	void set_clip(bool p_clip, const Rect2 &p_rect = Rect2());
+	void set_transform(const Matrix32 &p_transform) { transform = p_transform; }
+	const Matrix32 &get_transform() const { return transform; }
+
+	void add_quad(const Rect2 &p_rect, const Rect2 &p_src_region, const Size2 &p_tex_size, const Color &p_color, bool p_h_flip = false, bool p_v_flip = false, bool p_transpose = false);
+	void add_nine_patch(const Rect2 &p_rect, const Rect2 &p_src_region, const Size2 &p_tex_size, const float *p_margin, bool p_draw_center, const Color &p_color);
+
+	void flush();
+
+	void reset_stats();
+	int get_batch_count() const { return batch_count; }
+	int get_quad_count() const { return total_quads; }
+	int get_pending_quad_count() const { return quad_count; }
+
+	CanvasBatcher();
+};
+
+/**
+	Backend that just stores what it was asked to draw, for tests and
+	debugging.
+*/
+
+class CanvasBatchRecorder : public CanvasBatcher::Backend {
+public:
+	struct Batch {
+		CanvasBatcher::State state;
+		int first_vertex;
+		int quad_count;
+	};
+
+	Vector<Batch> batches;
+	Vector<CanvasBatcher::Vertex> vertices;
+
+	virtual void canvas_batch_draw(const CanvasBatcher::State &p_state, const CanvasBatcher::Vertex *p_vertices, int p_quad_count);
+	void clear();
+};
+
+#endif
@@ -0,0 +1,215 @@
+/*************************************************************************/
+/*  gpu_memory_budget.cpp                                                */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                    http://www.godotengine.org                         */
+/*************************************************************************/
+/* Copyright (c) 2007-2016 Juan Linietsky, Ariel Manzur.                 */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+#include "gpu_memory_budget.h"
+#include "error_macros.h"
+
+void GPUMemoryBudget::_lru_unlink(Item *p_item)
+{
+	if (p_item->lru_prev)
+		p_item->lru_prev->lru_next = p_item->lru_next;
+	else
+		lru_first = p_item->lru_next;
+
+	if (p_item->lru_next)
+		p_item->lru_next->lru_prev = p_item->lru_prev;
+	else
+		lru_last = p_item->lru_prev;
+
+	p_item->lru_prev = p_item->lru_next = NULL;
+}
+
+void GPUMemoryBudget::_lru_append(Item *p_item)
+{
+	p_item->lru_prev = lru_last;
+	p_item->lru_next = NULL;
+	if (lru_last)
+		lru_last->lru_next = p_item;
+	else
+		lru_first = p_item;
+	lru_last = p_item;
+}
+
+void GPUMemoryBudget::add(Item *p_item, Category p_category, int p_size, bool p_evictable)
+{
+	ERR_FAIL_COND(!p_item || p_item->tracked);
+	ERR_FAIL_INDEX(p_category, CATEGORY_MAX);
+
+	p_item->category = p_category;
+	p_item->size = p_size;
+	p_item->tracked = true;
+	p_item->evictable = p_evictable;
+	p_item->last_used = frame;
+	if (p_item->suspended) {
+		p_item->suspended = false;
+		restore_count++;
+	}
+	if (p_evictable)
+		_lru_append(p_item);
+
+	allocated(p_category, p_size);
+}
+
+void GPUMemoryBudget::remove(Item *p_item)
+{
+	ERR_FAIL_COND(!p_item || !p_item->tracked);
+
+	if (p_item->evictable)
+		_lru_unlink(p_item);
+	p_item->tracked = false;
+	freed(p_item->category, p_item->size);
+}
+
+void GPUMemoryBudget::set_evictable(Item *p_item, bool p_evictable)
+{
+	ERR_FAIL_COND(!p_item || !p_item->tracked);
+
+	if (p_item->evictable == p_evictable)
+		return;
+
+	p_item->evictable = p_evictable;
+	if (p_evictable)
+		_lru_append(p_item);
+	else
+		_lru_unlink(p_item);
+}
+
+void GPUMemoryBudget::touch(Item *p_item)
+{
+	p_item->last_used = frame;
+	if (p_item->tracked && p_item->evictable && p_item != lru_last) {
+		_lru_unlink(p_item);
+		_lru_append(p_item);
+	}
+}
+
+void GPUMemoryBudget::allocated(Category p_category, int p_size)
+{
+	usage[p_category] += p_size;
+	peak_usage = MAX(peak_usage, get_total_usage());
+}
+
+void GPUMemoryBudget::freed(Category p_category, int p_size)
+{
+	usage[p_category] -= p_size;
+	ERR_FAIL_COND(usage[p_category] < 0);
+}
+
+int64_t GPUMemoryBudget::evict(int64_t p_bytes)
+{
+	ERR_FAIL_COND_V(!backend, 0);
+
+	int64_t released = 0;
+	Item *item = lru_first;
+
+	// Everything past the first busy item was used even more recently
+	while (item && released < p_bytes && is_idle(item)) {
+
+		Item *next = item->lru_next;
+		int size = item->size;
+		if (backend->budget_evict(item)) {
+			ERR_FAIL_COND_V(item->tracked, released);
+			released += size;
+			eviction_count++;
+		}
+		item = next;
+	}
+
+	return released;
+}
+
+bool GPUMemoryBudget::enforce(int64_t p_extra)
+{
+	if (budget <= 0)
+		return true;
+
+	int64_t over = get_total_usage() + p_extra - budget;
+	if (over > 0)
+		evict(over);
+
+	return get_total_usage() + p_extra <= budget;
+}
+
+int64_t GPUMemoryBudget::suspend()
+{
+	ERR_FAIL_COND_V(!backend, 0);
+
+	suspending = true;
+	int64_t released = 0;
+	Item *item = lru_first;
+
+	while (item) {
+
+		Item *next = item->lru_next;
+		int size = item->size;
+		if (backend->budget_evict(item)) {
+			ERR_CONTINUE(item->tracked);
+			item->suspended = true;
+			released += size;
+		}
+		item = next;
+	}
+
+	suspending = false;
+	return released;
+}
+
+int64_t GPUMemoryBudget::get_usage(Category p_category) const
+{
+	ERR_FAIL_INDEX_V(p_category, CATEGORY_MAX, 0);
+	return usage[p_category];
+}
+
+int64_t GPUMemoryBudget::get_total_usage() const
+{
+	int64_t total = 0;
+	for (int i = 0; i < CATEGORY_MAX; i++)
+		total += usage[i];
+	return total;
+}
+
+GPUMemoryBudget::GPUMemoryBudget()
+{
+	backend = NULL;
+	budget = 0;
+	for (int i = 0; i < CATEGORY_MAX; i++)
+		usage[i] = 0;
+	peak_usage = 0;
+	frame = 0;
+	eviction_count = 0;
+	suspending = false;
+	restore_count = 0;
+	lru_first = lru_last = NULL;
+}
+
+GPUMemoryBudget::~GPUMemoryBudget()
+{
+	// Owners are expected to remove their items before going away
+	while (lru_first)
+		_lru_unlink(lru_first);
+}
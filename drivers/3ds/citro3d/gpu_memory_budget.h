@@ -0,0 +1,156 @@
+/*************************************************************************/
+/*  gpu_memory_budget.h                                                  */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                    http://www.godotengine.org                         */
+/*************************************************************************/
+/* Copyright (c) 2007-2016 Juan Linietsky, Ariel Manzur.                 */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+#ifndef GPU_MEMORY_BUDGET_H
+#define GPU_MEMORY_BUDGET_H
+
+#include "typedefs.h"
+
+/**
+	Keeps count of the linear memory handed to the GPU, by category, and
+	evicts the least recently used textures once the total goes over the
+	budget.
+
+	Items are embedded in whatever owns the allocation. Evictable items
+	are kept in LRU order, touch() moves them to the back. An item only
+	becomes a candidate after sitting unused for EVICT_FRAME_DELAY frames,
+	so its storage can be released right away without the GPU still
+	reading it. The backend does the actual release and must keep a CPU
+	side copy, or some other way, to restore from.
+
+	Before the app is suspended, suspend() releases every evictable item
+	at once, busy or not, so the GPU must be idle by then. The backend can
+	check is_suspending() to also drop copies it is able to reload. Items
+	are only restored when used again, add() counts those as restores.
+
+	Plain bookkeeping, so the rasterizer owns the memory and tests use a
+	stub backend.
+*/
+
+class GPUMemoryBudget {
+public:
+	enum Category {
+		CATEGORY_TEXTURE,
+		CATEGORY_VERTEX,
+		CATEGORY_INDEX,
+		CATEGORY_MAX
+	};
+
+	enum {
+		EVICT_FRAME_DELAY = 2,
+	};
+
+	struct Item {
+		void *owner;
+		Category category;
+		int size;
+		bool tracked;
+		bool evictable;
+		bool suspended; // released by suspend() and not restored yet
+		uint64_t last_used;
+		Item *lru_prev;
+		Item *lru_next;
+
+		Item(void *p_owner = NULL) {
+			owner = p_owner;
+			category = CATEGORY_TEXTURE;
+			size = 0;
+			tracked = false;
+			evictable = false;
+			suspended = false;
+			last_used = 0;
+			lru_prev = lru_next = NULL;
+		}
+	};
+
+	class Backend {
+	public:
+		// Release the storage behind p_item and remove() it. Returning
+		// false leaves it resident, it is skipped this time around.
+		virtual bool budget_evict(Item *p_item) = 0;
+		virtual ~Backend() {}
+	};
+
+private:
+	Backend *backend;
+	int64_t budget;
+	int64_t usage[CATEGORY_MAX];
+	int64_t peak_usage;
+	uint64_t frame;
+	int eviction_count;
+	bool suspending;
+	int restore_count;
+
+	Item *lru_first; // least recently used
+	Item *lru_last;
+
+	void _lru_unlink(Item *p_item);
+	void _lru_append(Item *p_item);
+
+public:
+	void set_backend(Backend *p_backend) { backend = p_backend; }
+
+	// In bytes, 0 turns eviction off
+	void set_budget(int64_t p_bytes) { budget = p_bytes; }
+	int64_t get_budget() const { return budget; }
+
+	void add(Item *p_item, Category p_category, int p_size, bool p_evictable = true);
+	void remove(Item *p_item);
+	void set_evictable(Item *p_item, bool p_evictable);
+	void touch(Item *p_item);
+
+	// Allocations nobody can evict, like scratch arenas
+	void allocated(Category p_category, int p_size);
+	void freed(Category p_category, int p_size);
+
+	_FORCE_INLINE_ bool is_idle(const Item *p_item) const { return p_item->last_used + EVICT_FRAME_DELAY <= frame; }
+
+	// Evicts idle items, oldest first, until p_bytes were released or
+	// nothing is left to evict. Returns the amount released.
+	int64_t evict(int64_t p_bytes);
+	// Evicts until p_extra more bytes fit in the budget
+	bool enforce(int64_t p_extra = 0);
+
+	// Evicts everything evictable, returns the amount released
+	int64_t suspend();
+	bool is_suspending() const { return suspending; }
+
+	void advance_frame() { frame++; }
+	uint64_t get_frame() const { return frame; }
+
+	int64_t get_usage(Category p_category) const;
+	int64_t get_total_usage() const;
+	int64_t get_peak_usage() const { return peak_usage; }
+	int get_eviction_count() const { return eviction_count; }
+	int get_restore_count() const { return restore_count; }
+
+	GPUMemoryBudget();
+	~GPUMemoryBudget();
+};
+
+#endif
@@ -0,0 +1,162 @@
+/*************************************************************************/
+/*  multimesh_batcher.cpp                                                */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                    http://www.godotengine.org                         */
+/*************************************************************************/
+/* Copyright (c) 2007-2016 Juan Linietsky, Ariel Manzur.                 */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+#include "multimesh_batcher.h"
+#include "servers/visual_server.h"
+
+#define XFORM_AT(m_xforms, m_stride, m_index) (*reinterpret_cast<const Transform *>(reinterpret_cast<const uint8_t *>(m_xforms) + (m_index) * (m_stride)))
+
+void MultiMeshBatcher::build_batches(const Transform *p_xforms, int p_count, int p_xform_stride, const AABB &p_mesh_aabb, Vector<Batch> &r_batches)
+{
+	r_batches.resize((p_count + BATCH_INSTANCES - 1) / BATCH_INSTANCES);
+
+	for (int b = 0; b < r_batches.size(); b++) {
+
+		Batch &batch = r_batches[b];
+		batch.from = b * BATCH_INSTANCES;
+		batch.count = MIN(BATCH_INSTANCES, p_count - batch.from);
+		batch.aabb = XFORM_AT(p_xforms, p_xform_stride, batch.from).xform(p_mesh_aabb);
+
+		for (int i = 1; i < batch.count; i++)
+			batch.aabb.merge_with(XFORM_AT(p_xforms, p_xform_stride, batch.from + i).xform(p_mesh_aabb));
+	}
+}
+
+void MultiMeshBatcher::cull_batches(const Vector<Batch> &p_batches, int p_instance_limit, const Transform &p_xform, const Plane *p_planes, int p_plane_count, Vector<Batch> &r_visible)
+{
+	r_visible.clear();
+
+	for (int b = 0; b < p_batches.size(); b++) {
+
+		const Batch &batch = p_batches[b];
+		if (batch.from >= p_instance_limit)
+			break;
+
+		if (!p_xform.xform(batch.aabb).intersects_convex_shape(p_planes, p_plane_count))
+			continue;
+
+		int count = MIN(batch.count, p_instance_limit - batch.from);
+		if (r_visible.size() && r_visible[r_visible.size() - 1].from + r_visible[r_visible.size() - 1].count == batch.from) {
+			Batch &last = r_visible[r_visible.size() - 1];
+			last.count += count;
+			last.aabb.merge_with(batch.aabb);
+		} else {
+			Batch run = batch;
+			run.count = count;
+			r_visible.push_back(run);
+		}
+	}
+}
+
+void MultiMeshBatcher::make_pretransform_layout(const PicaVertexLayout &p_source, PicaVertexLayout &r_layout)
+{
+	r_layout = p_source;
+
+	for (int i = 0; i < r_layout.attrib_count; i++) {
+		if (r_layout.attribs[i].array == VS::ARRAY_VERTEX)
+			r_layout.attribs[i].type = PICA_ATTRIB_FLOAT;
+	}
+	r_layout.update_offsets();
+
+	r_layout.position_origin = Vector3();
+	r_layout.position_scale = 1.0;
+	r_layout.index_size = p_source.index_count ? 2 : 0;
+}
+
+int MultiMeshBatcher::get_pretransform_max_instances(const PicaVertexLayout &p_source)
+{
+	return MAX(1, MAX_DRAW_VERTICES / MAX(p_source.vertex_count, 1));
+}
+
+void MultiMeshBatcher::pretransform(const PicaVertexLayout &p_source, const uint8_t *p_vertices, const uint8_t *p_indices, const PicaVertexLayout &p_dest, const Transform *p_xforms, int p_count, int p_xform_stride, uint8_t *r_vertices, uint16_t *r_indices)
+{
+	ERR_FAIL_COND(p_source.attrib_count != p_dest.attrib_count);
+	ERR_FAIL_COND(p_count > get_pretransform_max_instances(p_source));
+
+	int vertex_count = p_source.vertex_count;
+	Transform dequant = p_source.get_position_transform();
+
+	for (int n = 0; n < p_count; n++) {
+
+		const Transform &instance = XFORM_AT(p_xforms, p_xform_stride, n);
+		Transform xform = instance * dequant;
+		uint8_t *dst_base = r_vertices + n * vertex_count * p_dest.stride;
+
+		for (int ai = 0; ai < p_source.attrib_count; ai++) {
+
+			const PicaVertexLayout::Attrib &src = p_source.attribs[ai];
+			const PicaVertexLayout::Attrib &dst = p_dest.attribs[ai];
+
+			switch (src.array) {
+
+				case VS::ARRAY_VERTEX: {
+
+					for (int i = 0; i < vertex_count; i++) {
+						const int16_t *p = reinterpret_cast<const int16_t *>(p_vertices + i * p_source.stride + src.offset);
+						Vector3 v = xform.xform(Vector3(p[0], p[1], p[2]));
+						float *d = reinterpret_cast<float *>(dst_base + i * p_dest.stride + dst.offset);
+						d[0] = v.x;
+						d[1] = v.y;
+						d[2] = v.z;
+					}
+				} break;
+				case VS::ARRAY_NORMAL: {
+
+					for (int i = 0; i < vertex_count; i++) {
+						const int8_t *p = reinterpret_cast<const int8_t *>(p_vertices + i * p_source.stride + src.offset);
+						Vector3 v = instance.basis.xform(Vector3(p[0], p[1], p[2])).normalized();
+						int8_t *d = reinterpret_cast<int8_t *>(dst_base + i * p_dest.stride + dst.offset);
+						for (int j = 0; j < 3; j++)
+							d[j] = CLAMP(Math::fast_ftoi(v[j] * 127.0), -127, 127);
+					}
+				} break;
+				default: {
+
+					// Not affected by the transform, same type in both layouts
+					int size = src.get_size();
+					for (int i = 0; i < vertex_count; i++)
+						memcpy(dst_base + i * p_dest.stride + dst.offset, p_vertices + i * p_source.stride + src.offset, size);
+				}
+			}
+		}
+
+		if (!p_source.index_count || !r_indices)
+			continue;
+
+		uint16_t base = n * vertex_count;
+		uint16_t *dst = r_indices + n * p_source.index_count;
+		if (p_source.index_size == 2) {
+			const uint16_t *src = reinterpret_cast<const uint16_t *>(p_indices);
+			for (int i = 0; i < p_source.index_count; i++)
+				dst[i] = base + src[i];
+		} else {
+			for (int i = 0; i < p_source.index_count; i++)
+				dst[i] = base + p_indices[i];
+		}
+	}
+}
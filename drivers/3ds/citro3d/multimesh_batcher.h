@@ -0,0 +1,84 @@
+/*************************************************************************/
+/*  multimesh_batcher.h                                                  */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                    http://www.godotengine.org                         */
+/*************************************************************************/
+/* Copyright (c) 2007-2016 Juan Linietsky, Ariel Manzur.                 */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+#ifndef MULTIMESH_BATCHER_H
+#define MULTIMESH_BATCHER_H
+
+#include "math/aabb.h"
+#include "math/plane.h"
+#include "math/transform.h"
+#include "vector.h"
+#include "vertex_format.h"
+
+/**
+	Splits MultiMesh instances into fixed size batches that are culled
+	against the frustum as a whole, and pre-transforms small meshes on the
+	CPU so a whole run of instances goes out in a single draw.
+
+	Batches keep the instance order and the bounds of the mesh AABB under
+	every instance transform, in multimesh space. They only need
+	rebuilding when transforms or the mesh change.
+
+	Larger meshes are drawn once per instance, streaming the instance
+	matrix through the modelview uniform with the vertex loader set up
+	once per batch run.
+
+	Plain CPU code, tested on the host.
+*/
+
+class MultiMeshBatcher {
+public:
+	enum {
+		BATCH_INSTANCES = 32,
+		MAX_DRAW_VERTICES = 1 << 16, // 16 bit indices
+	};
+
+	struct Batch {
+		int from;
+		int count;
+		AABB aabb;
+	};
+
+	static void build_batches(const Transform *p_xforms, int p_count, int p_xform_stride, const AABB &p_mesh_aabb, Vector<Batch> &r_batches);
+
+	// Visible batches limited to the first p_instance_limit instances, with
+	// adjacent ones merged into runs. p_planes are in the space p_xform
+	// maps the multimesh to.
+	static void cull_batches(const Vector<Batch> &p_batches, int p_instance_limit, const Transform &p_xform, const Plane *p_planes, int p_plane_count, Vector<Batch> &r_visible);
+
+	// Layout of pre-transformed vertices: float positions, everything
+	// else as packed in the source, 16 bit indices.
+	static void make_pretransform_layout(const PicaVertexLayout &p_source, PicaVertexLayout &r_layout);
+	static int get_pretransform_max_instances(const PicaVertexLayout &p_source);
+
+	// Writes p_count instances of the source surface, transformed, one
+	// after the other. r_indices is only written for indexed surfaces.
+	static void pretransform(const PicaVertexLayout &p_source, const uint8_t *p_vertices, const uint8_t *p_indices, const PicaVertexLayout &p_dest, const Transform *p_xforms, int p_count, int p_xform_stride, uint8_t *r_vertices, uint16_t *r_indices);
+};
+
+#endif
@@ -31,7 +31,9 @@
 #include "rasterizer_citro3d.h"
 #include "globals.h"
 #include "os/os.h"
+#include "os/zone_profiler.h"
 #include "util.h"
+#include "texture_ctex.h"
 
 // Built-in shaders generated in byte array headers
 #include "shaders/2d.h"
@@ -42,6 +44,12 @@
 	GX_TRANSFER_IN_FORMAT(GX_TRANSFER_FMT_RGBA8) | GX_TRANSFER_OUT_FORMAT(GX_TRANSFER_FMT_RGB8) | \
 	GX_TRANSFER_SCALING(GX_TRANSFER_SCALE_XY))
 
+// Targets already at the screen resolution, stereo left eye and bottom screen
+#define NATIVE_TRANSFER_FLAGS \
+	(GX_TRANSFER_FLIP_VERT(0) | GX_TRANSFER_OUT_TILED(0) | GX_TRANSFER_RAW_COPY(0) | \
+	GX_TRANSFER_IN_FORMAT(GX_TRANSFER_FMT_RGBA8) | GX_TRANSFER_OUT_FORMAT(GX_TRANSFER_FMT_RGB8) | \
+	GX_TRANSFER_SCALING(GX_TRANSFER_SCALE_NO))
+
 /* TEXTURE API */
 
 // #define print(...) printf(__VA_ARGS__)
@@ -51,7 +59,98 @@ RID RasterizerCitro3d::texture_create()
 {
 	Texture *texture = memnew(Texture);
 	ERR_FAIL_COND_V(!texture,RID());
-	return texture_owner.make_rid( texture );
+	texture->self = texture_owner.make_rid( texture );
+	return texture->self;
+}
+
+bool RasterizerCitro3d::_texture_init(Texture *p_texture, PicaTextureFormat p_format)
+{
+	u32 w = next_pow2(p_texture->width);
+	u32 h = next_pow2(p_texture->height);
+
+	C3D_Tex &tex = p_texture->tex;
+	if (tex.data && p_texture->pica_format == p_format && tex.width == w && tex.height == h)
+		return true;
+
+	_texture_release(p_texture);
+
+	int size = pica_texture_format_get_size(p_format, w, h);
+	memory_budget.enforce(size);
+	if (!C3D_TexInit(&tex, w, h, (GPU_TEXCOLOR)p_format)) {
+		// Out of linear memory, give up idle textures even if under budget
+		memory_budget.evict(size);
+		ERR_FAIL_COND_V(!C3D_TexInit(&tex, w, h, (GPU_TEXCOLOR)p_format), false);
+	}
+
+	p_texture->pica_format = p_format;
+	p_texture->evicted = false;
+	memory_budget.add(&p_texture->budget_item, GPUMemoryBudget::CATEGORY_TEXTURE, size);
+	return true;
+}
+
+void RasterizerCitro3d::_texture_release(Texture *p_texture)
+{
+	C3D_Tex &tex = p_texture->tex;
+	if (!tex.data)
+		return;
+
+	memory_budget.remove(&p_texture->budget_item);
+	texture_free_queue[canvas_vertex_arena_index].push_back(tex);
+	tex.data = NULL;
+}
+
+void RasterizerCitro3d::_texture_upload(Texture *p_texture, const Image &p_image)
+{
+	_rinfo.texture_uploads++;
+
+	if (p_image.get_format() == Image::FORMAT_CUSTOM) {
+		_texture_upload_ctex(p_texture, p_image);
+		return;
+	}
+
+	Image image = p_image;
+	Image alpha;
+	PicaTextureFormat format = pica_texture_prepare(image, alpha, p_texture->flags, texture_format_options);
+	ERR_FAIL_COND(format == PICA_TEXTURE_MAX);
+
+	if (_texture_can_atlas(p_texture, format)) {
+		TextureAtlas::Entry *entry = _texture_atlas_reserve(p_texture, format, 1);
+		if (entry && texture_atlas.set_image(entry, image) == OK)
+			return;
+	}
+
+	_texture_atlas_remove(p_texture);
+	ERR_FAIL_COND(!_texture_init(p_texture, format));
+
+	C3D_Tex &tex = p_texture->tex;
+	ERR_FAIL_COND(pica_texture_convert(tex.data, tex.width, tex.height, image, alpha, format) != OK);
+	C3D_TexFlush(&tex);
+}
+
+bool RasterizerCitro3d::_texture_upload_ctex(Texture *p_texture, const Image &p_image)
+{
+	DVector<uint8_t> data = p_image.get_data();
+	DVector<uint8_t>::Read r = data.read();
+
+	CTexHeader header;
+	ERR_FAIL_COND_V(ctex_decode_header(r.ptr(), data.size(), header) != OK, false);
+	ERR_FAIL_COND_V(header.width != p_texture->width || header.height != p_texture->height, false);
+
+	if (_texture_can_atlas(p_texture, header.format)) {
+		TextureAtlas::Entry *entry = _texture_atlas_reserve(p_texture, header.format, 1);
+		if (entry && texture_atlas.set_tiled(entry, r.ptr() + CTEX_HEADER_SIZE, header.tex_width, header.tex_height) == OK)
+			return true;
+	}
+
+	_texture_atlas_remove(p_texture);
+	ERR_FAIL_COND_V(!_texture_init(p_texture, header.format), false);
+
+	// Already tiled offline, a straight copy is enough
+	C3D_Tex &tex = p_texture->tex;
+	ERR_FAIL_COND_V(tex.width != header.tex_width || tex.height != header.tex_height, false);
+	memcpy(tex.data, r.ptr() + CTEX_HEADER_SIZE, header.data_size);
+	C3D_TexFlush(&tex);
+	return true;
 }
 
 void RasterizerCitro3d::texture_allocate(RID p_texture,int p_width, int p_height,Image::Format p_format,uint32_t p_flags)
@@ -61,12 +160,27 @@ void RasterizerCitro3d::texture_allocate(RID p_texture,int p_width, int p_height
 // 	print("texture_allocate %u %u %u\n", w, h, p_texture.get_id());
 	Texture *texture = texture_owner.get( p_texture );
 	ERR_FAIL_COND(!texture);
-	ERR_FAIL_COND(w > 1024 || h > 1024);
-	ERR_FAIL_COND(!C3D_TexInit(&texture->tex, w, h, GPU_RGBA8));
+	ERR_FAIL_COND(w > PICA_TEXTURE_MAX_SIZE || h > PICA_TEXTURE_MAX_SIZE);
 	texture->width=p_width;
 	texture->height=p_height;
 	texture->format=p_format;
 	texture->flags=p_flags;
+	_texture_atlas_remove(texture);
+
+	// Pre-tiled textures carry their format in the data
+	if (p_format == Image::FORMAT_CUSTOM)
+		return;
+
+	// Content is unknown yet, assume alpha; texture_set_data() may pick a smaller format
+	PicaTextureFormat format = pica_texture_format_select(p_format, p_flags, Image::ALPHA_BLEND, texture_format_options);
+
+	// Atlas cells are only reserved once the real format is known
+	if (_texture_can_atlas(texture, format)) {
+		_texture_release(texture);
+		return;
+	}
+
+	_texture_init(texture, format);
 }
 
 void RasterizerCitro3d::texture_set_data(RID p_texture,const Image& p_image,VS::CubeMapSide p_cube_side)
@@ -75,17 +189,8 @@ void RasterizerCitro3d::texture_set_data(RID p_texture,const Image& p_image,VS::
 	ERR_FAIL_COND(!texture);
 	ERR_FAIL_COND(texture->format != p_image.get_format() );
 
-	Image &image = texture->image[p_cube_side];
-	image = p_image;
-	image.convert(Image::FORMAT_RGBA);
-	ERR_FAIL_COND(image.get_format() != Image::FORMAT_RGBA);
-	
-	DVector<uint8_t> d = image.get_data();
-	const u32* imagedata = reinterpret_cast<const u32*>(d.read().ptr());
-
-	texture_tile_sw(&texture->tex, imagedata, texture->width, texture->height);
-
-// 	texture->image[p_cube_side]=image;
+	texture->image[p_cube_side] = p_image;
+	_texture_upload(texture, p_image);
 }
 
 Image RasterizerCitro3d::texture_get_data(RID p_texture,VS::CubeMapSide p_cube_side) const
@@ -104,6 +209,10 @@ void RasterizerCitro3d::texture_set_flags(RID p_texture,uint32_t p_flags)
 	ERR_FAIL_COND(!texture);
 	uint32_t cube = texture->flags & VS::TEXTURE_FLAG_CUBEMAP;
 	texture->flags=p_flags|cube; // can't remove a cube from being a cube
+
+	// Repeating needs storage of its own
+	if (texture->atlas_entry && !_texture_can_atlas(texture, texture->pica_format))
+		_texture_atlas_evict(texture);
 }
 uint32_t RasterizerCitro3d::texture_get_flags(RID p_texture) const {
 	Texture * texture = texture_owner.get(p_texture);
@@ -151,7 +260,169 @@ void RasterizerCitro3d::texture_set_size_override(RID p_texture,int p_width, int
 
 void RasterizerCitro3d::texture_set_reload_hook(RID p_texture,ObjectID p_owner,const StringName& p_function) const {
 
+	Texture * texture = texture_owner.get(p_texture);
+	ERR_FAIL_COND(!texture);
+
+	// The copy in image[] is kept for budget evictions, it only goes on suspend
+	texture->reloader = p_owner;
+	texture->reloader_func = p_function;
+}
+
+/* MEMORY BUDGET */
+
+bool RasterizerCitro3d::_budget_evict(GPUMemoryBudget::Item *p_item)
+{
+	Texture *texture = reinterpret_cast<Texture*>(p_item->owner);
+	ERR_FAIL_COND_V(!texture || !texture->tex.data, false);
+
+	// The image is the CPU side copy, without it only the reload hook can restore it
+	if (texture->image[0].empty() && !texture->reloader)
+		return false;
+
+	// Idle for a few frames (or suspending after a sync), so the GPU is done with it: no need to queue
+	memory_budget.remove(p_item);
+	C3D_TexDelete(&texture->tex);
+	texture->tex.data = NULL;
+	texture->evicted = true;
+
+	// The reload hook reads it back from disk, no need to hold on to it while in the background
+	if (memory_budget.is_suspending() && texture->reloader) {
+		for (int i = 0; i < 6; i++)
+			texture->image[i] = Image();
+	}
+	return true;
+}
+
+bool RasterizerCitro3d::_texture_use(Texture *p_texture)
+{
+	if (p_texture->evicted) {
+		if (!p_texture->image[0].empty()) {
+			_texture_upload(p_texture, p_texture->image[0]);
+		} else {
+			// Ends up back in texture_set_data()
+			Object *reloader = ObjectDB::get_instance(p_texture->reloader);
+			if (reloader)
+				reloader->call(p_texture->reloader_func, p_texture->self);
+		}
+
+		// A successful upload clears the flag, otherwise try again next time
+		if (!p_texture->tex.data && !p_texture->atlas_entry)
+			return false;
+		p_texture->evicted = false;
+	}
+
+	memory_budget.touch(&p_texture->budget_item);
+	return true;
+}
+
+/* TEXTURE ATLAS */
+
+bool RasterizerCitro3d::_atlas_page_alloc(TextureAtlas::Page *p_page)
+{
+	// Pages are plain textures, so the canvas binds them like any other
+	Texture *texture = memnew(Texture);
+	texture->width = p_page->size;
+	texture->height = p_page->size;
+	texture->atlas_allowed = false;
+	if (!_texture_init(texture, p_page->format)) {
+		memdelete(texture);
+		return false;
+	}
+
+	// Entries would have to be restored one by one, pages stay resident
+	memory_budget.set_evictable(&texture->budget_item, false);
+	memset(texture->tex.data, 0, texture->tex.size);
+	p_page->data = texture->tex.data;
+	p_page->userdata = texture;
+	return true;
+}
+
+void RasterizerCitro3d::_atlas_page_free(TextureAtlas::Page *p_page)
+{
+	Texture *texture = reinterpret_cast<Texture*>(p_page->userdata);
+	ERR_FAIL_COND(!texture);
+	_texture_release(texture);
+	memdelete(texture);
+	p_page->data = NULL;
+	p_page->userdata = NULL;
+}
+
+void RasterizerCitro3d::_atlas_page_changed(TextureAtlas::Page *p_page)
+{
+	Texture *texture = reinterpret_cast<Texture*>(p_page->userdata);
+	ERR_FAIL_COND(!texture);
+	C3D_TexFlush(&texture->tex);
+}
+
+bool RasterizerCitro3d::_texture_can_atlas(const Texture *p_texture, PicaTextureFormat p_format) const
+{
+	if (!texture_atlas_enabled || !p_texture->atlas_allowed)
+		return false;
+
+	// Wrapping needs the texture to span the whole UV range
+	if (p_texture->flags & (VS::TEXTURE_FLAG_REPEAT | VS::TEXTURE_FLAG_MIRRORED_REPEAT | VS::TEXTURE_FLAG_CUBEMAP | VS::TEXTURE_FLAG_VIDEO_SURFACE))
+		return false;
+
+	return TextureAtlas::can_store(p_texture->width, p_texture->height, p_format);
+}
+
+TextureAtlas::Entry *RasterizerCitro3d::_texture_atlas_reserve(Texture *p_texture, PicaTextureFormat p_format, int p_border)
+{
+	TextureAtlas::Entry *entry = p_texture->atlas_entry;
+	if (entry && (entry->page->format != p_format || entry->border != p_border))
+		_texture_atlas_remove(p_texture);
+
+	if (!p_texture->atlas_entry) {
+		// Queued quads hold UVs for the current layout, which may change
+		canvas_batcher.flush();
+		p_texture->atlas_entry = texture_atlas.add(p_texture->width, p_texture->height, p_format, p_border);
+		if (!p_texture->atlas_entry)
+			return NULL;
+	}
+
+	_texture_release(p_texture);
+	p_texture->pica_format = p_format;
+	return p_texture->atlas_entry;
+}
+
+void RasterizerCitro3d::_texture_atlas_remove(Texture *p_texture)
+{
+	if (!p_texture->atlas_entry)
+		return;
+
+	canvas_batcher.flush(); // pending batch may point at the page
+	texture_atlas.remove(p_texture->atlas_entry);
+	p_texture->atlas_entry = NULL;
+}
+
+void RasterizerCitro3d::_texture_atlas_evict(Texture *p_texture)
+{
+	// Used in a way the atlas can't serve, keep it out for good
+	p_texture->atlas_allowed = false;
+	if (!p_texture->atlas_entry)
+		return;
+
+	_texture_atlas_remove(p_texture);
+	_texture_upload(p_texture, p_texture->image[0]);
+}
 
+const RasterizerCitro3d::Texture *RasterizerCitro3d::_canvas_texture_remap(Texture *p_texture, Rect2 &r_region, Size2 &r_tex_size)
+{
+	const TextureAtlas::Entry *entry = p_texture->atlas_entry;
+	if (!entry) {
+		// Still evicted, drawn untextured
+		if (!_texture_use(p_texture))
+			return NULL;
+		r_tex_size = Size2(p_texture->tex.width, p_texture->tex.height);
+		return p_texture;
+	}
+
+	const TextureAtlas::Page *page = entry->page;
+	Texture *page_texture = reinterpret_cast<Texture*>(page->userdata);
+	_texture_use(page_texture);
+	r_region.pos += entry->get_rect().pos;
+	r_tex_size = Size2(page->size, page->size);
+	return page_texture;
 }
 
 /* SHADER API */
@@ -404,306 +675,6 @@ RID RasterizerCitro3d::mesh_create()
 	return mesh_owner.make_rid( memnew( Mesh ) );
 }
 
-Error RasterizerCitro3d::_surface_set_arrays(Surface *p_surface, uint8_t *p_mem,uint8_t *p_index_mem,const Array& p_arrays,bool p_main) {
-
-	uint32_t stride = p_main ? p_surface->stride : p_surface->local_stride;
-
-	for(int ai=0;ai<VS::ARRAY_MAX;ai++)
-	{
-		if (ai>=p_arrays.size())
-			break;
-		if (p_arrays[ai].get_type()==Variant::NIL)
-			continue;
-		Surface::ArrayData &a=p_surface->array[ai];
-
-		switch(ai) {
-
-			case VS::ARRAY_VERTEX: {
-
-				ERR_FAIL_COND_V( p_arrays[ai].get_type() != Variant::VECTOR3_ARRAY, ERR_INVALID_PARAMETER );
-
-				DVector<Vector3> array = p_arrays[ai];
-				ERR_FAIL_COND_V( array.size() != p_surface->array_len, ERR_INVALID_PARAMETER );
-
-
-				DVector<Vector3>::Read read = array.read();
-				const Vector3* src=read.ptr();
-
-				// setting vertices means regenerating the AABB
-				AABB aabb;
-
-				float scale=1;
-
-				for (int i=0;i<p_surface->array_len;i++) {
-					float vector[3]={ src[i].x, src[i].y, src[i].z };
-
-					memcpy(&p_mem[a.ofs+i*stride], vector, a.size);
-
-					if (i==0) {
-						aabb=AABB(src[i],Vector3());
-					} else {
-						aabb.expand_to( src[i] );
-					}
-				}
-
-				if (p_main) {
-					p_surface->aabb=aabb;
-					p_surface->vertex_scale=scale;
-				}
-
-			} break;
-			case VS::ARRAY_NORMAL: {
-
-				ERR_FAIL_COND_V( p_arrays[ai].get_type() != Variant::VECTOR3_ARRAY, ERR_INVALID_PARAMETER );
-
-				DVector<Vector3> array = p_arrays[ai];
-				ERR_FAIL_COND_V( array.size() != p_surface->array_len, ERR_INVALID_PARAMETER );
-
-
-				DVector<Vector3>::Read read = array.read();
-				const Vector3* src=read.ptr();
-
-				// setting vertices means regenerating the AABB
-				for (int i=0;i<p_surface->array_len;i++) {
-					float vector[3]={ src[i].x, src[i].y, src[i].z };
-					memcpy(&p_mem[a.ofs+i*stride], vector, a.size);
-				}
-			} break;
-			case VS::ARRAY_TANGENT: {
-
-				ERR_FAIL_COND_V( p_arrays[ai].get_type() != Variant::REAL_ARRAY, ERR_INVALID_PARAMETER );
-
-				DVector<real_t> array = p_arrays[ai];
-
-				ERR_FAIL_COND_V( array.size() != p_surface->array_len*4, ERR_INVALID_PARAMETER );
-
-				DVector<real_t>::Read read = array.read();
-				const real_t* src = read.ptr();
-
-				for (int i=0;i<p_surface->array_len;i++) {
-
-					float xyzw[4]={
-						src[i*4+0],
-						src[i*4+1],
-						src[i*4+2],
-						src[i*4+3]
-					};
-
-					memcpy(&p_mem[a.ofs+i*stride], xyzw, a.size);
-
-				}
-
-			} break;
-			case VS::ARRAY_COLOR: {
-
-				ERR_FAIL_COND_V( p_arrays[ai].get_type() != Variant::COLOR_ARRAY, ERR_INVALID_PARAMETER );
-
-				DVector<Color> array = p_arrays[ai];
-
-				ERR_FAIL_COND_V( array.size() != p_surface->array_len, ERR_INVALID_PARAMETER );
-
-				DVector<Color>::Read read = array.read();
-				const Color* src = read.ptr();
-				bool alpha=false;
-
-				for (int i=0;i<p_surface->array_len;i++) {
-
-					if (src[i].a<0.98) // tolerate alpha a bit, for crappy exporters
-						alpha=true;
-
-					uint8_t colors[4];
-
-					for(int j=0;j<4;j++) {
-						colors[j]=CLAMP( int((src[i][j])*255.0), 0,255 );
-					}
-
-					memcpy(&p_mem[a.ofs+i*stride], colors, a.size);
-				}
-
-				if (p_main)
-					p_surface->has_alpha=alpha;
-
-			} break;
-			case VS::ARRAY_TEX_UV:
-			case VS::ARRAY_TEX_UV2: {
-
-				ERR_FAIL_COND_V( p_arrays[ai].get_type() != Variant::VECTOR3_ARRAY && p_arrays[ai].get_type() != Variant::VECTOR2_ARRAY, ERR_INVALID_PARAMETER );
-
-				DVector<Vector2> array = p_arrays[ai];
-
-				ERR_FAIL_COND_V( array.size() != p_surface->array_len , ERR_INVALID_PARAMETER);
-
-				DVector<Vector2>::Read read = array.read();
-
-				const Vector2 * src=read.ptr();
-				float scale=1.0;
-
-				for (int i=0;i<p_surface->array_len;i++) {
-
-					float uv[2]={ src[i].x , src[i].y };
-
-					memcpy(&p_mem[a.ofs+i*stride], uv, a.size);
-
-				}
-
-				if (p_main) {
-					if  (ai==VS::ARRAY_TEX_UV) {
-						p_surface->uv_scale=scale;
-					}
-					if  (ai==VS::ARRAY_TEX_UV2) {
-						p_surface->uv2_scale=scale;
-					}
-				}
-
-			} break;
-			case VS::ARRAY_WEIGHTS: {
-				ERR_FAIL_COND_V( p_arrays[ai].get_type() != Variant::REAL_ARRAY, ERR_INVALID_PARAMETER );
-
-				DVector<real_t> array = p_arrays[ai];
-
-				ERR_FAIL_COND_V( array.size() != p_surface->array_len*VS::ARRAY_WEIGHTS_SIZE, ERR_INVALID_PARAMETER );
-
-
-				DVector<real_t>::Read read = array.read();
-
-				const real_t * src = read.ptr();
-
-				for (int i=0;i<p_surface->array_len;i++) {
-
-					float data[VS::ARRAY_WEIGHTS_SIZE];
-					for (int j=0;j<VS::ARRAY_WEIGHTS_SIZE;j++) {
-						data[j]=src[i*VS::ARRAY_WEIGHTS_SIZE+j];
-					}
-
-					memcpy(&p_mem[a.ofs+i*stride], data, a.size);
-				}
-
-			} break;
-			case VS::ARRAY_BONES: {
-
-
-				ERR_FAIL_COND_V( p_arrays[ai].get_type() != Variant::REAL_ARRAY, ERR_INVALID_PARAMETER );
-
-				DVector<int> array = p_arrays[ai];
-
-				ERR_FAIL_COND_V( array.size() != p_surface->array_len*VS::ARRAY_WEIGHTS_SIZE, ERR_INVALID_PARAMETER );
-
-
-				DVector<int>::Read read = array.read();
-
-				const int * src = read.ptr();
-
-				p_surface->max_bone=0;
-
-				for (int i=0;i<p_surface->array_len;i++) {
-
-					u8 data[VS::ARRAY_WEIGHTS_SIZE];
-					for (int j=0;j<VS::ARRAY_WEIGHTS_SIZE;j++) {
-						data[j]=CLAMP(src[i*VS::ARRAY_WEIGHTS_SIZE+j],0,255);
-						p_surface->max_bone=MAX(data[j],p_surface->max_bone);
-
-					}
-
-					memcpy(&p_mem[a.ofs+i*stride], data, a.size);
-				}
-
-			} break;
-			case VS::ARRAY_INDEX: {
-
-// 				ERR_FAIL_COND_V(a.size > 2, ERR_INVALID_DATA);
-				ERR_FAIL_COND_V( p_surface->index_array_len<=0, ERR_INVALID_DATA );
-				ERR_FAIL_COND_V( p_arrays[ai].get_type() != Variant::INT_ARRAY, ERR_INVALID_PARAMETER );
-
-				DVector<int> indices = p_arrays[ai];
-				ERR_FAIL_COND_V( indices.size() == 0, ERR_INVALID_PARAMETER );
-				ERR_FAIL_COND_V( indices.size() != p_surface->index_array_len, ERR_INVALID_PARAMETER );
-
-				/* determine wether using 8 or 16 bits indices */
-
-				DVector<int>::Read read = indices.read();
-				const int *src=read.ptr();
-
-				for (int i=0;i<p_surface->index_array_len;i++) {
-					if (a.size==2) {
-						uint16_t v=src[i];
-						memcpy(&p_index_mem[i*a.size], &v, a.size);
-					} else {
-						uint8_t v=src[i];
-						memcpy(&p_index_mem[i*a.size], &v, a.size);
-					}
-				}
-			} break;
-
-			default: { ERR_FAIL_V(ERR_INVALID_PARAMETER);}
-		}
-
-		p_surface->configured_format|=(1<<ai);
-	}
-
-	if (p_surface->format&VS::ARRAY_FORMAT_BONES) {
-		//create AABBs for each detected bone
-		int total_bones = p_surface->max_bone+1;
-		if (p_main) {
-			p_surface->skeleton_bone_aabb.resize(total_bones);
-			p_surface->skeleton_bone_used.resize(total_bones);
-			for(int i=0;i<total_bones;i++)
-				p_surface->skeleton_bone_used[i]=false;
-		}
-		DVector<Vector3> vertices = p_arrays[VS::ARRAY_VERTEX];
-		DVector<int> bones = p_arrays[VS::ARRAY_BONES];
-		DVector<float> weights = p_arrays[VS::ARRAY_WEIGHTS];
-
-		bool any_valid=false;
-
-		if (vertices.size() && bones.size()==vertices.size()*4 && weights.size()==bones.size()) {
-			//print_line("MAKING SKELETHONG");
-			int vs = vertices.size();
-			DVector<Vector3>::Read rv =vertices.read();
-			DVector<int>::Read rb=bones.read();
-			DVector<float>::Read rw=weights.read();
-
-			Vector<bool> first;
-			first.resize(total_bones);
-			for(int i=0;i<total_bones;i++) {
-				first[i]=p_main;
-			}
-			AABB *bptr = p_surface->skeleton_bone_aabb.ptr();
-			bool *fptr=first.ptr();
-			bool *usedptr=p_surface->skeleton_bone_used.ptr();
-
-			for(int i=0;i<vs;i++) {
-
-				Vector3 v = rv[i];
-				for(int j=0;j<4;j++) {
-
-					int idx = rb[i*4+j];
-					float w = rw[i*4+j];
-					if (w==0)
-						continue;//break;
-					ERR_FAIL_INDEX_V(idx,total_bones,ERR_INVALID_DATA);
-
-					if (fptr[idx]) {
-						bptr[idx].pos=v;
-						fptr[idx]=false;
-						any_valid=true;
-					} else {
-						bptr[idx].expand_to(v);
-					}
-					usedptr[idx]=true;
-				}
-			}
-		}
-
-		if (p_main && !any_valid) {
-
-			p_surface->skeleton_bone_aabb.clear();
-			p_surface->skeleton_bone_used.clear();
-		}
-	}
-
-	return OK;
-}
-
 void RasterizerCitro3d::mesh_add_surface(RID p_mesh,VS::PrimitiveType p_primitive,const Array& p_arrays,const Array& p_blend_shapes,bool p_alpha_sort)
 {
 	print("mesh_add_surface\n");
@@ -717,7 +688,6 @@ void RasterizerCitro3d::mesh_add_surface(RID p_mesh,VS::PrimitiveType p_primitiv
 	uint32_t format=0;
 
 	// validation
-	int index_array_len=0;
 	int array_len=0;
 
 	for(int i=0;i<p_arrays.size();i++) {
@@ -731,9 +701,6 @@ void RasterizerCitro3d::mesh_add_surface(RID p_mesh,VS::PrimitiveType p_primitiv
 
 			array_len=Vector3Array(p_arrays[i]).size();
 			ERR_FAIL_COND(array_len==0);
-		} else if (i==VS::ARRAY_INDEX) {
-
-			index_array_len=IntArray(p_arrays[i]).size();
 		}
 	}
 
@@ -757,172 +724,57 @@ void RasterizerCitro3d::mesh_add_surface(RID p_mesh,VS::PrimitiveType p_primitiv
 		}
 	}
 
+	// Tangents, second UVs, colors and skinning are not read by the 3D shader
+	PicaVertexLayout layout;
+	uint32_t pack_format = VS::ARRAY_FORMAT_VERTEX|VS::ARRAY_FORMAT_NORMAL|VS::ARRAY_FORMAT_TEX_UV|VS::ARRAY_FORMAT_INDEX;
+	Error err = pica_vertex_layout_create(p_arrays,pack_format,layout);
+	ERR_FAIL_COND(err);
+
 	Surface *surface = memnew( Surface );
 	ERR_FAIL_COND( !surface );
 
-	int total_elem_size=0;
-
-	for (int i=0;i<VS::ARRAY_MAX;i++)
-	{
-		Surface::ArrayData&ad=surface->array[i];
-		ad.size=0;
-		ad.ofs=0;
-		int elem_size=0;
-		int elem_count=0;
-		bool valid_local=true;
-		bool normalize=false;
-		bool bind=false;
-
-		if (!(format&(1<<i))) // no array
-			continue;
-
-		switch(i) {
-
-			case VS::ARRAY_VERTEX: {
-				print("ARRAY_VERTEX\n");
-				elem_size=3*sizeof(float);
-				bind=true;
-				elem_count=3;
-			} break;
-			case VS::ARRAY_NORMAL: {
-				print("ARRAY_NORMAL\n");
-				elem_size=3*sizeof(float);
-				bind=true;
-				elem_count=3;
-			} break;
-			case VS::ARRAY_TANGENT: {
-				print("ARRAY_TANGENT\n");
-				continue;
-				elem_size=4*sizeof(float);
-				bind=true;
-				elem_count=4;
-			} break;
-			case VS::ARRAY_COLOR: {
-				print("ARRAY_COLOR\n");
-				continue;
-				elem_size=4*sizeof(uint8_t); /* RGBA */
-				elem_count=4;
-				bind=true;
-				normalize=true;
-			} break;
-			case VS::ARRAY_TEX_UV2:
-				print("ARRAY_TEX_UV2\n");
-				continue;
-			case VS::ARRAY_TEX_UV: {
-				print("ARRAY_TEX_UV\n");
-				elem_size=2*sizeof(float); // vertex
-				bind=true;
-				elem_count=2;
-			} break;
-			case VS::ARRAY_WEIGHTS: {
-				print("ARRAY_WEIGHTS\n");
-				continue;
-				elem_size=VS::ARRAY_WEIGHTS_SIZE*sizeof(float);
-				valid_local=false;
-				bind=true;
-				elem_count=4;
-			} break;
-			case VS::ARRAY_BONES: {
-				print("ARRAY_BONES\n");
-				continue;
-				elem_size=VS::ARRAY_WEIGHTS_SIZE*sizeof(u8);
-				valid_local=false;
-				bind=true;
-				elem_count=4;
-			} break;
-			case VS::ARRAY_INDEX: {
-				print("ARRAY_INDEX\n");
-				if (index_array_len<=0) {
-					ERR_PRINT("index_array_len==NO_INDEX_ARRAY");
-					break;
-				}
-				ERR_FAIL_COND(array_len > (1<<16)); // 32 bit index not supported
-				
-				/* determine wether using 8 or 16 bits indices */
-				if (array_len > (1<<8)) {
-					elem_size=2; // C3D_UNSIGNED_SHORT
-				} else {
-					elem_size=1; // C3D_UNSIGNED_BYTE
-				}
-
-				surface->index_array_len=index_array_len; // only way it can exist
-				ad.ofs=0;
-				ad.size=elem_size;
-				
-				continue;
-			} break;
-			default: {
-				ERR_FAIL( );
-			}
-		}
-
-		ad.ofs=total_elem_size;
-		ad.size=elem_size;
-// 		ad.datatype=datatype;
-		ad.normalize=normalize;
-		ad.bind=bind;
-		ad.count=elem_count;
-		total_elem_size+=elem_size;
-		if (valid_local) {
-			surface->local_stride+=elem_size;
-			surface->morph_format|=(1<<i);
-		}
-	}
-
-	surface->stride=total_elem_size;
+	surface->layout=layout;
+	surface->stride=layout.stride;
 	surface->array_len=array_len;
+	surface->index_array_len=layout.index_count;
+	surface->array[VS::ARRAY_INDEX].size=layout.index_size;
 	surface->format=format;
+	surface->configured_format=layout.format;
+	surface->aabb=layout.aabb;
+	surface->has_alpha=layout.has_alpha;
+	surface->vertex_scale=layout.position_scale;
 	surface->primitive=p_primitive;
 	surface->morph_target_count=mesh->morph_target_count;
-	surface->configured_format=0;
 	surface->mesh=mesh;
-// 	if (keep_copies) {
-// 		surface->data=p_arrays;
-// 		surface->morph_data=p_blend_shapes;
-// 	}
 
-	surface->array_local = (u8*)linearAlloc(surface->array_len*surface->stride);
-// 	u8 *array_ptr= (u8*)linearAlloc(surface->array_len*surface->stride);
-// 	u8 *index_array_ptr=NULL;
-	
-// 	DVector<uint8_t> array_pre_vbo;
-// 	DVector<uint8_t>::Write vaw;
-// 	DVector<uint8_t> index_array_pre_vbo;
-// 	DVector<uint8_t>::Write iaw;
-
-	/* create pointers */
-// 	array_pre_vbo.resize(surface->array_len*surface->stride);
-// 	vaw = array_pre_vbo.write();
-// 	array_ptr=vaw.ptr();
+	// Packed straight into linear memory once, the GPU reads it every frame from there
+	int vertex_size=layout.vertex_count*layout.stride;
+	int index_size=layout.index_count*layout.index_size;
+
+	surface->array_local = (u8*)linearAlloc(vertex_size);
+	if (surface->array_local)
+		memory_budget.allocated(GPUMemoryBudget::CATEGORY_VERTEX, vertex_size);
+	if (index_size) {
+		surface->index_array_local = (u8*)linearAlloc(index_size);
+		if (surface->index_array_local)
+			memory_budget.allocated(GPUMemoryBudget::CATEGORY_INDEX, index_size);
+	}
 
-	if (surface->index_array_len)
-	{
-// 		index_array_pre_vbo.resize(surface->index_array_len*surface->array[VS::ARRAY_INDEX].size);
-// 		iaw = index_array_pre_vbo.write();
-// 		index_array_ptr=iaw.ptr();
-		surface->index_array_local = (u8*) linearAlloc(surface->index_array_len*surface->array[VS::ARRAY_INDEX].size);
-// 		index_array_ptr = (u8*) linearAlloc(surface->index_array_len*surface->array[VS::ARRAY_INDEX].size);
+	if (!surface->array_local || (index_size && !surface->index_array_local)) {
+		_surface_free(surface);
+		ERR_EXPLAIN("Out of linear memory for mesh surface");
+		ERR_FAIL();
 	}
 
-	_surface_set_arrays(surface,surface->array_local,surface->index_array_local,p_arrays,true);
+	err = pica_vertex_pack(p_arrays,layout,surface->array_local,surface->index_array_local);
+	if (err) {
+		_surface_free(surface);
+		ERR_FAIL();
+	}
 
-	/* create buffers!! */
-	
-	
-// 	glGenBuffers(1,&surface->vertex_id);
-// 	ERR_FAIL_COND(surface->vertex_id==0);
-// 	glBindBuffer(GL_ARRAY_BUFFER,surface->vertex_id);
-// 	glBufferData(GL_ARRAY_BUFFER,surface->array_len*surface->stride,array_ptr,GL_STATIC_DRAW);
-// 	glBindBuffer(GL_ARRAY_BUFFER,0); //unbind
-// 	if (surface->index_array_len) {
-// 
-// 		glGenBuffers(1,&surface->index_id);
-// 		ERR_FAIL_COND(surface->index_id==0);
-// 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,surface->index_id);
-// 		glBufferData(GL_ELEMENT_ARRAY_BUFFER,index_array_len*surface->array[VS::ARRAY_INDEX].size,index_array_ptr,GL_STATIC_DRAW);
-// 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,0); //unbind
-// 
-// 	}
+	GSPGPU_FlushDataCache(surface->array_local, vertex_size);
+	if (index_size)
+		GSPGPU_FlushDataCache(surface->index_array_local, index_size);
 
 	mesh->surfaces.push_back(surface);
 }
@@ -1063,6 +915,29 @@ VS::PrimitiveType RasterizerCitro3d::mesh_surface_get_primitive_type(RID p_mesh,
 	return surface->primitive;
 }
 
+void RasterizerCitro3d::_surface_free(Surface *p_surface) {
+
+	if (p_surface->array_local) {
+		linearFree(p_surface->array_local);
+		memory_budget.freed(GPUMemoryBudget::CATEGORY_VERTEX, p_surface->layout.vertex_count*p_surface->layout.stride);
+	}
+	if (p_surface->index_array_local) {
+		linearFree(p_surface->index_array_local);
+		memory_budget.freed(GPUMemoryBudget::CATEGORY_INDEX, p_surface->layout.index_count*p_surface->layout.index_size);
+	}
+
+	if (p_surface->morph_targets_local) {
+
+		for(int i=0;i<p_surface->morph_target_count;i++) {
+
+			memdelete_arr(p_surface->morph_targets_local[i].array);
+		}
+		memdelete_arr(p_surface->morph_targets_local);
+	}
+
+	memdelete(p_surface);
+}
+
 void RasterizerCitro3d::mesh_remove_surface(RID p_mesh,int p_index) {
 
 	Mesh *mesh = mesh_owner.get( p_mesh );
@@ -1071,7 +946,7 @@ void RasterizerCitro3d::mesh_remove_surface(RID p_mesh,int p_index) {
 	Surface *surface = mesh->surfaces[p_index];
 	ERR_FAIL_COND( !surface);
 
-	memdelete( mesh->surfaces[p_index] );
+	_surface_free(surface);
 	mesh->surfaces.remove(p_index);
 
 }
@@ -1132,6 +1007,7 @@ void RasterizerCitro3d::multimesh_set_instance_count(RID p_multimesh,int p_count
 
 	multimesh->elements.clear(); // make sure to delete everything, so it "fails" in all implementations
 	multimesh->elements.resize(p_count);
+	multimesh->batches_dirty=true;
 }
 int RasterizerCitro3d::multimesh_get_instance_count(RID p_multimesh) const {
 
@@ -1161,6 +1037,7 @@ void RasterizerCitro3d::multimesh_instance_set_transform(RID p_multimesh,int p_i
 	ERR_FAIL_COND(!multimesh);
 	ERR_FAIL_INDEX(p_index,multimesh->elements.size());
 	multimesh->elements[p_index].xform=p_transform;
+	multimesh->batches_dirty=true;
 
 }
 void RasterizerCitro3d::multimesh_instance_set_color(RID p_multimesh,int p_index,const Color& p_color) {
@@ -1983,6 +1860,16 @@ void RasterizerCitro3d::begin_frame()
 	print("begin_frame\n");
 	draw_next_frame = false;
 	
+	_rinfo.vertex_count=0;
+	_rinfo.object_count=0;
+	_rinfo.mat_change_count=0;
+	_rinfo.surface_count=0;
+	_rinfo.shader_change_count=0;
+	_rinfo.ci_draw_commands=0;
+	_rinfo.draw_calls=0;
+	_rinfo.texture_uploads=0;
+	canvas_batcher.reset_stats();
+	
 	float time = (OS::get_singleton()->get_ticks_usec()/1000); // get msec
 	time/=1000.0; // make secs
 	if (frame != 0) {
@@ -1993,7 +1880,36 @@ void RasterizerCitro3d::begin_frame()
 	scaled_time += time_delta;
 	last_time=time;
 	frame++;
-	C3D_FrameBegin(0);
+	
+	// Slider at zero shows the left image only, the mono path handles it
+	stereo_depth = stereo_target ? osGet3DSliderState() : 0;
+	stereo_canvas_batches.clear();
+	
+	frame_fence_begin();
+	if (!frame_begun)
+		C3D_FrameBegin(_frame_begin_flags());
+	frame_begun = false;
+	// citro3d keeps one command list in flight and beginning a frame waits
+	// for it to drain, so everything submitted so far is done
+	frame_fence_signal(get_frame_fence_submitted());
+}
+
+int RasterizerCitro3d::_frame_begin_flags() const
+{
+	// Pipelined frames are paced here instead of in swap_buffers, once the
+	// CPU work for the next frame is already done
+	if (get_max_frames_in_flight() > 1 && OS::get_singleton()->is_vsync_enabled())
+		return C3D_FRAME_SYNCDRAW;
+	return 0;
+}
+
+void RasterizerCitro3d::_frame_fence_wait(uint64_t p_serial)
+{
+	// Only reached in lockstep mode. Waiting on the GPU is done by beginning
+	// the next frame, begin_frame skips it afterwards
+	C3D_FrameBegin(_frame_begin_flags());
+	frame_begun = true;
+	frame_fence_signal(p_serial);
 }
 
 void RasterizerCitro3d::capture_viewport(Image* r_capture) {
@@ -2005,6 +1921,7 @@ void RasterizerCitro3d::capture_viewport(Image* r_capture) {
 void RasterizerCitro3d::clear_viewport(const Color& p_color)
 {
 	print("clear_viewport\n");
+	canvas_batcher.flush();
 	RenderTarget* rt = current_rt ? current_rt : base_framebuffer;
 	u32 c = (u8)(p_color.r*255);
 	c <<= 8;
@@ -2014,6 +1931,8 @@ void RasterizerCitro3d::clear_viewport(const Color& p_color)
 	c <<= 8;
 	c |= (u8)(p_color.a*255);
 	C3D_RenderTargetClear(rt->target,C3D_CLEAR_ALL,c,0);
+	if (_stereo_active())
+		C3D_RenderTargetClear(stereo_target,C3D_CLEAR_ALL,c,0);
 };
 
 void RasterizerCitro3d::set_viewport(const VS::ViewportRect& p_viewport)
@@ -2022,6 +1941,37 @@ void RasterizerCitro3d::set_viewport(const VS::ViewportRect& p_viewport)
 	u32 top = p_viewport.height - p_viewport.y;
 	//C3D_SetViewport(top, p_viewport.x, p_viewport.height, p_viewport.width);
 	C3D_SetViewport(0, 0, p_viewport.height, p_viewport.width);
+	current_viewport = p_viewport;
+}
+
+void RasterizerCitro3d::set_screen(int p_screen)
+{
+	ERR_FAIL_INDEX(p_screen, SCREEN_MAX);
+	if (p_screen == current_screen)
+		return;
+
+	_canvas_batch_end();
+	if (current_screen == SCREEN_TOP && _stereo_active())
+		_stereo_canvas_replay();
+
+	if (!screen_framebuffers[p_screen]) {
+		RenderTarget *rt = memnew(RenderTarget);
+		rt->texture_ptr = NULL;
+		rt->target = C3D_RenderTargetCreate(240, 320, GPU_RB_RGBA8, GPU_RB_DEPTH24_STENCIL8);
+		if (!rt->target) {
+			memdelete(rt);
+			ERR_FAIL();
+		}
+		C3D_RenderTargetSetOutput(rt->target, GFX_BOTTOM, GFX_LEFT, NATIVE_TRANSFER_FLAGS);
+		C3D_RenderTargetClear(rt->target,C3D_CLEAR_ALL,CLEAR_COLOR,0);
+		screen_framebuffers[p_screen] = rt;
+	}
+
+	current_screen = p_screen;
+	base_framebuffer = screen_framebuffers[p_screen];
+	canvas_applied_blend_mode = -1;
+	if (!current_rt)
+		C3D_SetFrameBuf(&base_framebuffer->target->frameBuf);
 }
 
 void RasterizerCitro3d::set_time_scale(float p_scale)
@@ -2031,6 +1981,8 @@ void RasterizerCitro3d::set_time_scale(float p_scale)
 void RasterizerCitro3d::set_render_target(RID p_render_target, bool p_transparent_bg, bool p_vflip)
 {
 	print("set_render_target\n");
+	_canvas_batch_end();
+	canvas_applied_blend_mode = -1;
 	current_rt_vflip=p_vflip;
 	
 	if (p_render_target.is_valid())
@@ -2059,6 +2011,10 @@ void RasterizerCitro3d::set_render_target(RID p_render_target, bool p_transparen
 void RasterizerCitro3d::begin_scene(RID p_viewport_data,RID p_env,VS::ScenarioDebugMode p_debug)
 {
 	print("begin_scene\n");
+	_canvas_batch_end();
+	// Canvas drawn so far sits behind the scene, the left eye needs it too
+	if (_stereo_active())
+		_stereo_canvas_replay();
 	opaque_render_list.clear();
 	alpha_render_list.clear();
 	
@@ -2090,6 +2046,7 @@ void RasterizerCitro3d::set_camera(const Transform& p_world, const CameraMatrix&
 	
 	print("set_camera\n");
 	camera_transform=p_world;
+	stereo_scene=false;
 // 	if (current_rt && current_rt_vflip) {
 	if (current_rt_vflip) {
 // 		m[4] = -1;
@@ -2104,6 +2061,7 @@ void RasterizerCitro3d::set_camera(const Transform& p_world, const CameraMatrix&
 // 	camera_projection = camera_projection * m;
 // 	camera_projection.invert();
 	camera_plane = Plane( camera_transform.origin, -camera_transform.basis.get_axis(2) );
+	camera_planes = camera_projection.get_projection_planes(camera_transform);
 	camera_z_near=camera_projection.get_z_near();
 	camera_z_far=camera_projection.get_z_far();
 	camera_projection.get_viewport_size(camera_vp_size.x,camera_vp_size.y);
@@ -2123,6 +2081,60 @@ void RasterizerCitro3d::set_camera(const Transform& p_world, const CameraMatrix&
 // 	C3D_FVUnifMtx4x4(GPU_VERTEX_SHADER, scene_shader->location_projection, &mtx);
 }
 
+float RasterizerCitro3d::get_stereo_eye_separation() const
+{
+	return _stereo_active() ? stereo_depth * stereo_eye_separation : 0;
+}
+
+float RasterizerCitro3d::get_stereo_convergence() const
+{
+	return stereo_convergence;
+}
+
+void RasterizerCitro3d::set_stereo_camera(const CameraMatrix &p_left_projection, const CameraMatrix &p_right_projection)
+{
+	ERR_FAIL_COND(!_stereo_active());
+	stereo_projection[0] = p_left_projection;
+	stereo_projection[1] = p_right_projection;
+	stereo_scene = true;
+	camera_planes = camera_projection.get_stereo_projection_planes(camera_transform, get_stereo_eye_separation(), stereo_convergence);
+}
+
+bool RasterizerCitro3d::_stereo_active() const
+{
+	return stereo_target && stereo_depth > 0 && !current_rt && current_screen == SCREEN_TOP;
+}
+
+void RasterizerCitro3d::_stereo_canvas_replay()
+{
+	if (stereo_canvas_batches.empty())
+		return;
+
+	C3D_SetFrameBuf(&stereo_target->frameBuf);
+	C3D_SetViewport(0, 0, STEREO_TARGET_WIDTH, STEREO_TARGET_HEIGHT);
+
+	_canvas_bind_program();
+	canvas_applied_blend_mode = -1;
+	canvas_applied_clip = false;
+	C3D_SetScissor(GPU_SCISSOR_DISABLE, 0, 0, 0, 0);
+
+	float scale = float(STEREO_TARGET_HEIGHT) / 800.0;
+	for (int i = 0; i < stereo_canvas_batches.size(); i++) {
+		const StereoCanvasBatch &batch = stereo_canvas_batches[i];
+		_canvas_batch_submit(batch.state, batch.vertices, batch.quad_count, scale);
+	}
+	stereo_canvas_batches.clear();
+
+	if (canvas_applied_clip) {
+		C3D_SetScissor(GPU_SCISSOR_DISABLE, 0, 0, 0, 0);
+		canvas_applied_clip = false;
+	}
+	canvas_applied_blend_mode = -1;
+
+	C3D_SetFrameBuf(&base_framebuffer->target->frameBuf);
+	C3D_SetViewport(0, 0, current_viewport.height, current_viewport.width);
+}
+
 void RasterizerCitro3d::add_light( RID p_light_instance )
 {
 
@@ -2155,6 +2167,37 @@ void RasterizerCitro3d::add_mesh( const RID& p_mesh, const InstanceData *p_data)
 void RasterizerCitro3d::add_multimesh( const RID& p_multimesh, const InstanceData *p_data)
 {
 	print("add_multimesh\n");
+	MultiMesh *multimesh = multimesh_owner.get(p_multimesh);
+	ERR_FAIL_COND(!multimesh);
+
+	if (!multimesh->mesh.is_valid())
+		return;
+	if (multimesh->elements.empty())
+		return;
+
+	Mesh *mesh = mesh_owner.get(multimesh->mesh);
+	ERR_FAIL_COND(!mesh);
+
+	int surf_count = mesh->surfaces.size();
+	if (surf_count==0)
+		return;
+
+	AABB mesh_aabb = mesh->surfaces[0]->aabb;
+	multimesh->cache_surfaces.resize(surf_count);
+	for (int i=0;i<surf_count;i++) {
+
+		multimesh->cache_surfaces[i].material=mesh->surfaces[i]->material;
+		multimesh->cache_surfaces[i].has_alpha=mesh->surfaces[i]->has_alpha;
+		multimesh->cache_surfaces[i].surface=mesh->surfaces[i];
+		mesh_aabb.merge_with(mesh->surfaces[i]->aabb);
+	}
+
+	_multimesh_update_batches(multimesh, mesh_aabb);
+
+	for (int i=0;i<surf_count;i++) {
+
+		_add_geometry(&multimesh->cache_surfaces[i],p_data,multimesh->cache_surfaces[i].surface,multimesh);
+	}
 }
 
 void RasterizerCitro3d::add_particles( const RID& p_particle_instance, const InstanceData *p_data)
@@ -2172,9 +2215,27 @@ void RasterizerCitro3d::add_particles( const RID& p_particle_instance, const Ins
 
 void RasterizerCitro3d::end_scene()
 {
+	ZONE_SCOPE("RasterizerCitro3d::end_scene");
 	print("end_scene\n");
 	
 // 	opaque_render_list.sort_mat_light_type_flags();
+	if (stereo_scene) {
+
+		// Same list twice, only the projection changes
+		C3D_SetFrameBuf(&stereo_target->frameBuf);
+		C3D_SetViewport(0, 0, STEREO_TARGET_WIDTH, STEREO_TARGET_HEIGHT);
+		_set_uniform(scene_shader->location_projection, stereo_projection[0]);
+		_render_list_forward(&opaque_render_list, camera_transform, camera_transform_inverse,stereo_projection[0],false,fragment_lighting);
+
+		C3D_SetFrameBuf(&base_framebuffer->target->frameBuf);
+		C3D_SetViewport(0, 0, current_viewport.height, current_viewport.width);
+		_set_uniform(scene_shader->location_projection, stereo_projection[1]);
+		_render_list_forward(&opaque_render_list, camera_transform, camera_transform_inverse,stereo_projection[1],false,fragment_lighting);
+
+		stereo_scene = false;
+		return;
+	}
+
 	_render_list_forward(&opaque_render_list, camera_transform, camera_transform_inverse,camera_projection,false,fragment_lighting);
 	
 // 	alpha_render_list.sort_z();
@@ -2188,16 +2249,44 @@ void RasterizerCitro3d::end_shadow_map() {
 
 void RasterizerCitro3d::end_frame()
 {
+	ZONE_SCOPE("RasterizerCitro3d::end_frame");
+	_canvas_batch_end();
+	
+	if (current_screen != SCREEN_TOP)
+		set_screen(SCREEN_TOP);
+	
+	bool stereo = _stereo_active();
+	if (stereo)
+		_stereo_canvas_replay();
+	
 	C3D_FrameEnd(GX_CMDLIST_UPDATE_GAS_ACC);
 	
-	print("end_frame %d %f\n", vertexArrays.size(), C3D_GetCmdBufUsage());
+	print("end_frame %d %f\n", canvas_batcher.get_batch_count(), C3D_GetCmdBufUsage());
+	
+	// Skipped screens still get their last image, gfx is double buffered
+	RenderTarget *bottom = screen_framebuffers[SCREEN_BOTTOM];
+	if (bottom)
+		C3D_FrameBufTransfer(&bottom->target->frameBuf,GFX_BOTTOM,GFX_LEFT,bottom->target->transferFlags);
 	
 	RenderTarget* rt = current_rt ? current_rt : base_framebuffer;
-	C3D_FrameBufTransfer(&rt->target->frameBuf,rt->target->screen,rt->target->side,rt->target->transferFlags);
-	VertexArray **varray = vertexArrays.ptr();
-	for (int i = 0; i < vertexArrays.size(); ++i)
-		memdelete(*varray++);
-	vertexArrays.clear();
+	if (stereo) {
+		C3D_FrameBufTransfer(&stereo_target->frameBuf,GFX_TOP,GFX_LEFT,stereo_target->transferFlags);
+		C3D_FrameBufTransfer(&rt->target->frameBuf,GFX_TOP,GFX_RIGHT,rt->target->transferFlags);
+	} else {
+		C3D_FrameBufTransfer(&rt->target->frameBuf,rt->target->screen,rt->target->side,rt->target->transferFlags);
+	}
+	
+	frame_fence_submit();
+	
+	// Recycle the arena used two frames ago: no more than two frames are in
+	// flight and the older one completed before this frame began
+	canvas_vertex_arena_index ^= 1;
+	canvas_vertex_arena_used = 0;
+	_free_deferred(canvas_vertex_arena_index);
+
+	// Textures not bound for a while make room if we went over budget
+	memory_budget.advance_frame();
+	memory_budget.enforce();
 	
 	OS::get_singleton()->swap_buffers();
 }
@@ -2206,6 +2295,43 @@ void RasterizerCitro3d::flush_frame()
 {
 }
 
+void RasterizerCitro3d::_free_deferred(int p_index)
+{
+	Vector<void*> &overflow = canvas_vertex_overflow[p_index];
+	for (int i = 0; i < overflow.size(); ++i)
+		linearFree(overflow[i]);
+	overflow.clear();
+	memory_budget.freed(GPUMemoryBudget::CATEGORY_VERTEX, canvas_vertex_overflow_size[p_index]);
+	canvas_vertex_overflow_size[p_index] = 0;
+	Vector<C3D_Tex> &textures = texture_free_queue[p_index];
+	for (int i = 0; i < textures.size(); ++i)
+		C3D_TexDelete(&textures[i]);
+	textures.clear();
+}
+
+void RasterizerCitro3d::suspend(bool p_release_vram)
+{
+	ZONE_SCOPE("RasterizerCitro3d::suspend");
+
+	// An empty frame synced on the last one: once it begins, the GPU is
+	// done with everything queued so far
+	C3D_FrameBegin(C3D_FRAME_SYNCDRAW);
+	C3D_FrameEnd(0);
+	frame_fence_signal(get_frame_fence_submitted());
+
+	// Nothing is in flight anymore, deferred frees don't have to wait
+	_free_deferred(0);
+	_free_deferred(1);
+
+	if (!p_release_vram || !release_textures_on_suspend)
+		return;
+
+	// Restored one by one as they get drawn again after resuming
+	int64_t released = memory_budget.suspend();
+	if (OS::get_singleton()->is_stdout_verbose())
+		print_line("suspend: released " + itos(released / 1024) + " KB of textures");
+}
+
 RID RasterizerCitro3d::canvas_light_occluder_create()
 {
 	CanvasOccluder *co = memnew( CanvasOccluder );
@@ -2433,16 +2559,18 @@ void RasterizerCitro3d::begin_canvas_bg()
 {
 	print("begin_canvas_bg\n");
 }
-void RasterizerCitro3d::canvas_begin()
+void RasterizerCitro3d::_canvas_bind_program()
 {
-	print("canvas_begin");
-	
 	C3D_Mtx projection;
-	Mtx_OrthoTilt(&projection, 0.0, 800.0, 480.0, 0.0, 0.0, 1.0, true);
+	if (current_screen == SCREEN_BOTTOM && !current_rt)
+		Mtx_OrthoTilt(&projection, 0.0, 320.0, 240.0, 0.0, 0.0, 1.0, true);
+	else
+		Mtx_OrthoTilt(&projection, 0.0, 800.0, 480.0, 0.0, 0.0, 1.0, true);
 	
 	C3D_BindProgram(&canvas_shader->program);
 	C3D_FVUnifMtx4x4(GPU_VERTEX_SHADER, canvas_shader->location_projection, &projection);
 	
+	// Batched vertices are already in canvas space, transforms stay identity
 	_set_uniform(canvas_shader->location_modelview, Matrix32());
 	_set_uniform(canvas_shader->location_extra, Matrix32());
 	
@@ -2450,18 +2578,37 @@ void RasterizerCitro3d::canvas_begin()
 	AttrInfo_Init(attrInfo);
 	AttrInfo_AddLoader(attrInfo, 0, GPU_FLOAT, 3); // v0=position
 	AttrInfo_AddLoader(attrInfo, 1, GPU_FLOAT, 2); // v1=texcoord
-	AttrInfo_AddFixed(attrInfo, 2); // v2=color
+	AttrInfo_AddLoader(attrInfo, 2, GPU_FLOAT, 4); // v2=color
+}
+
+void RasterizerCitro3d::canvas_begin()
+{
+	print("canvas_begin");
+	
+	canvas_batcher.flush();
+	
+	_canvas_bind_program();
 	
 	canvas_opacity = 1.0;
+	canvas_transform = Matrix32();
 	
 	canvas_blend_mode = VS::MATERIAL_BLEND_MODE_MIX;
-	C3D_AlphaBlend(GPU_BLEND_ADD, GPU_BLEND_ADD, GPU_SRC_ALPHA, GPU_ONE_MINUS_SRC_ALPHA, GPU_SRC_ALPHA, GPU_ONE_MINUS_SRC_ALPHA);
+	canvas_applied_blend_mode = -1;
+	canvas_applied_clip = false;
+	C3D_SetScissor(GPU_SCISSOR_DISABLE, 0, 0, 0, 0);
+	
+	canvas_batcher.set_transform(Matrix32());
+	canvas_batcher.set_blend_mode(canvas_blend_mode);
+	canvas_batcher.set_clip(false);
+	canvas_batcher.set_texture(NULL);
 
 	print(" %f\n", C3D_GetCmdBufUsage());
 }
 void RasterizerCitro3d::canvas_disable_blending()
 {
 	print("canvas_disable_blending\n");
+	canvas_batcher.flush();
+	canvas_applied_blend_mode = -1;
 	C3D_AlphaBlend(GPU_BLEND_ADD, GPU_BLEND_ADD, GPU_SRC_ALPHA, GPU_ONE_MINUS_SRC_ALPHA, GPU_SRC_ALPHA, GPU_ONE_MINUS_SRC_ALPHA);
 }
 
@@ -2472,7 +2619,14 @@ void RasterizerCitro3d::canvas_set_opacity(float p_opacity)
 
 void RasterizerCitro3d::canvas_set_blend_mode(VS::MaterialBlendMode p_mode)
 {
-	if (p_mode==canvas_blend_mode)
+	// Applied lazily when the batch using it gets drawn
+	canvas_blend_mode=p_mode;
+	canvas_batcher.set_blend_mode(p_mode);
+}
+
+void RasterizerCitro3d::_canvas_apply_blend_mode(int p_mode)
+{
+	if (p_mode==canvas_applied_blend_mode)
 		return;
 
 	switch(p_mode)
@@ -2502,14 +2656,13 @@ void RasterizerCitro3d::canvas_set_blend_mode(VS::MaterialBlendMode p_mode)
 		} break;
 	}
 
-	canvas_blend_mode=p_mode;
+	canvas_applied_blend_mode=p_mode;
 }
 
 void RasterizerCitro3d::canvas_begin_rect(const Matrix32& p_transform)
 {
-	_set_uniform(canvas_shader->location_modelview, p_transform);
-	_set_uniform(canvas_shader->location_extra, Matrix32());
-// 	canvas_transform = p_transform;
+	canvas_transform = p_transform;
+	canvas_batcher.set_transform(p_transform);
 }
 
 void RasterizerCitro3d::canvas_set_clip(bool p_clip, const Rect2& p_rect) {
@@ -2519,161 +2672,242 @@ void RasterizerCitro3d::canvas_set_clip(bool p_clip, const Rect2& p_rect) {
 
 }
 
-void RasterizerCitro3d::canvas_end_rect()
+void RasterizerCitro3d::canvas_end_rect()
+{
+	print("canvas_end_rect\n");
+	_canvas_batch_end();
+}
+
+void RasterizerCitro3d::canvas_draw_line(const Point2& p_from, const Point2& p_to, const Color& p_color, float p_width)
+{
+	print("canvas_draw_line\n");
+}
+
+void RasterizerCitro3d::canvas_draw_rect(const Rect2& p_rect, int p_flags, const Rect2& p_source,RID p_texture,const Color& p_modulate)
+{
+// 	print("canvas_draw_rect %.1f %.1f %.1f %.1f\n", p_rect.pos.x, p_rect.pos.y, p_rect.size.width, p_rect.size.height);
+	
+	Color m = p_modulate;
+	m.a *= canvas_opacity;
+	
+	if (p_texture.is_valid())
+	{
+		Texture* texture = texture_owner.get(p_texture);
+		ERR_FAIL_COND(!texture);
+		
+		if (p_flags & CANVAS_RECT_TILE && !(texture->flags & VS::TEXTURE_FLAG_REPEAT))
+		{
+			
+		}
+
+		// Tiling would sample the neighbours in the atlas page
+		if (p_flags & CANVAS_RECT_TILE && texture->atlas_entry)
+			_texture_atlas_evict(texture);
+
+		// Regions are in texels of the image, storage may be padded or shared
+		Size2 tex_size;
+		Rect2 region = (p_flags&CANVAS_RECT_REGION) ? p_source : Rect2(0,0,texture->width,texture->height);
+		canvas_batcher.set_texture(_canvas_texture_remap(texture,region,tex_size));
+		canvas_batcher.add_quad(p_rect,region,tex_size,m,p_flags&CANVAS_RECT_FLIP_H,p_flags&CANVAS_RECT_FLIP_V,p_flags&CANVAS_RECT_TRANSPOSE);
+	}
+	else
+	{
+		canvas_batcher.set_texture(NULL);
+		canvas_batcher.add_quad(p_rect,Rect2(),Size2(),m);
+	}
+	
+	_rinfo.ci_draw_commands++;
+}
+void RasterizerCitro3d::canvas_draw_style_box(const Rect2& p_rect, const Rect2& p_src_region, RID p_texture,const float *p_margin, bool p_draw_center,const Color& p_modulate)
+{
+	print("canvas_draw_style_box\n");
+	
+	Color m = p_modulate;
+	m.a *= canvas_opacity;
+
+	ERR_FAIL_COND(!p_texture.is_valid());
+	Texture* texture=texture_owner.get(p_texture);
+	ERR_FAIL_COND(!texture);
+
+	Rect2 region = p_src_region;
+	if (region.size.width <= 0 )
+	    region.size.width = texture->width;
+	if (region.size.height <= 0)
+	    region.size.height = texture->height;
+
+	Size2 tex_size;
+	canvas_batcher.set_texture(_canvas_texture_remap(texture,region,tex_size));
+	canvas_batcher.add_nine_patch(p_rect,region,tex_size,p_margin,p_draw_center,m);
+
+	_rinfo.ci_draw_commands++;
+}
+void RasterizerCitro3d::canvas_draw_primitive(const Vector<Point2>& p_points, const Vector<Color>& p_colors,const Vector<Point2>& p_uvs, RID p_texture,float p_width)
+{
+	print("canvas_draw_primitive\n");
+}
+
+
+void RasterizerCitro3d::canvas_draw_polygon(int p_vertex_count, const int* p_indices, const Vector2* p_vertices, const Vector2* p_uvs, const Color* p_colors,const RID& p_texture,bool p_singlecolor)
+{
+	print("canvas_draw_polygon\n");
+}
+
+RasterizerCitro3d::Texture* RasterizerCitro3d::_bind_texture(const RID& p_texture)
+{
+	if (p_texture.is_valid())
+	{
+		Texture*texture=texture_owner.get(p_texture);
+		// Meshes use the full UV range, they need the texture on its own
+		if (texture->atlas_entry)
+			_texture_atlas_evict(texture);
+		if (_texture_use(texture)) {
+			C3D_TexBind(0, &texture->tex);
+			return texture;
+		}
+	}
+	
+	C3D_TexBind(0, NULL);
+	return NULL;
+}
+
+void RasterizerCitro3d::canvas_set_transform(const Matrix32& p_transform)
+{
+	canvas_batcher.set_transform(canvas_transform * p_transform);
+}
+
+// Modulates texture 0 with p_color. Alpha-only textures sample as black,
+// so their color comes from p_color alone
+static void _set_texture_env(C3D_TexEnv *p_env, PicaTextureFormat p_format, GPU_TEVSRC p_color)
+{
+	C3D_TexEnvSrc(p_env, C3D_Both, GPU_TEXTURE0, p_color);
+	C3D_TexEnvOpRgb(p_env, GPU_TEVOP_RGB_SRC_COLOR);
+	C3D_TexEnvOpAlpha(p_env, GPU_TEVOP_A_SRC_ALPHA);
+	C3D_TexEnvFunc(p_env, C3D_Both, GPU_MODULATE);
+	if (pica_texture_format_is_alpha_only(p_format)) {
+		C3D_TexEnvSrc(p_env, C3D_RGB, p_color);
+		C3D_TexEnvFunc(p_env, C3D_RGB, GPU_REPLACE);
+	}
+}
+
+static void _set_scissor(int x, int y, int w, int h, int p_screen_width)
+{
+	print("set_scissor %d %d %d %d\n", x, y, w, h);
+	// Keep in mind the sideway 3ds screen, so it seems screwy
+	int bottom = p_screen_width - x;
+	int top = 240 - y;
+	int left = top - h;
+	int right = bottom - w;
+	if (bottom < 0) bottom = 0;
+	if (top < 0) top = 0;
+	if (left < 0) left = 0;
+	if (right < 0) right = 0;
+	C3D_SetScissor(GPU_SCISSOR_NORMAL, left, right, top, bottom);
+// 	C3D_SetScissor(GPU_SCISSOR_NORMAL, 240 - (y + h), 400 - (x + w), 240 - y, 400 - x);
+}
+
+Rect2 RasterizerCitro3d::_get_canvas_scissor(CanvasItem* p_item) const
+{
+	int x, y, w, h;
+
+	if (current_rt) {
+		x = p_item->final_clip_rect.pos.x;
+		y = p_item->final_clip_rect.pos.y;
+		w = p_item->final_clip_rect.size.x;
+		h = p_item->final_clip_rect.size.y;
+	}
+	else
+	{
+		x = p_item->final_clip_rect.pos.x;
+		y = 240 - (p_item->final_clip_rect.pos.y + p_item->final_clip_rect.size.y);
+		w = p_item->final_clip_rect.size.x;
+		h = p_item->final_clip_rect.size.y;
+	}
+	
+	return Rect2(x, y, w, h);
+}
+
+void *RasterizerCitro3d::_canvas_alloc_vertices(int p_size)
+{
+	if (canvas_vertex_arena_used + p_size <= CANVAS_VERTEX_ARENA_SIZE) {
+		void *ptr = canvas_vertex_arena[canvas_vertex_arena_index] + canvas_vertex_arena_used;
+		canvas_vertex_arena_used += (p_size + 15) & ~15;
+		return ptr;
+	}
+
+	// Arena exhausted, spill into a one-off block released with the arena
+	void *ptr = linearAlloc(p_size);
+	ERR_FAIL_COND_V(!ptr, NULL);
+	canvas_vertex_overflow[canvas_vertex_arena_index].push_back(ptr);
+	canvas_vertex_overflow_size[canvas_vertex_arena_index] += p_size;
+	memory_budget.allocated(GPUMemoryBudget::CATEGORY_VERTEX, p_size);
+	return ptr;
+}
+
+void RasterizerCitro3d::_canvas_batch_draw(const CanvasBatcher::State &p_state, const CanvasBatcher::Vertex *p_vertices, int p_quad_count)
 {
-	print("canvas_end_rect\n");
-}
+	int size = p_quad_count * CanvasBatcher::VERTICES_PER_QUAD * sizeof(CanvasBatcher::Vertex);
+	void *vertices = _canvas_alloc_vertices(size);
+	ERR_FAIL_COND(!vertices);
+	memcpy(vertices, p_vertices, size);
+	GSPGPU_FlushDataCache(vertices, size);
+
+	if (_stereo_active()) {
+		StereoCanvasBatch batch;
+		batch.state = p_state;
+		batch.vertices = vertices;
+		batch.quad_count = p_quad_count;
+		stereo_canvas_batches.push_back(batch);
+	}
 
-void RasterizerCitro3d::canvas_draw_line(const Point2& p_from, const Point2& p_to, const Color& p_color, float p_width)
-{
-	print("canvas_draw_line\n");
+	_canvas_batch_submit(p_state, vertices, p_quad_count);
 }
 
-void RasterizerCitro3d::canvas_draw_rect(const Rect2& p_rect, int p_flags, const Rect2& p_source,RID p_texture,const Color& p_modulate)
+void RasterizerCitro3d::_canvas_batch_submit(const CanvasBatcher::State &p_state, const void *p_vertices, int p_quad_count, float p_scissor_scale)
 {
-// 	print("canvas_draw_rect %.1f %.1f %.1f %.1f\n", p_rect.pos.x, p_rect.pos.y, p_rect.size.width, p_rect.size.height);
-	
-	// Set the fixed attribute (color)
-	C3D_FixedAttribSet(2, p_modulate.r, p_modulate.g, p_modulate.b, p_modulate.a * canvas_opacity);
-// 	C3D_FixedAttribSet(2, 1.f, 1.f, 1.f, 1.f);
 	C3D_TexEnv* env = C3D_GetTexEnv(0);
-	
-	
-	if (p_texture.is_valid())
-	{
-		Texture* texture = texture_owner.get(p_texture);
-// 		ERR_FAIL_COND(!texture);
-		
-		if (p_flags & CANVAS_RECT_TILE && !(texture->flags & VS::TEXTURE_FLAG_REPEAT))
-		{
-			
-		}
-		
-		C3D_TexBind(0, &texture->tex);
-		
-		C3D_TexEnvSrc(env, C3D_Both, GPU_TEXTURE0, GPU_PRIMARY_COLOR);
-        C3D_TexEnvOpRgb(env, GPU_TEVOP_RGB_SRC_COLOR);
-		C3D_TexEnvOpAlpha(env,GPU_TEVOP_A_SRC_ALPHA);
-        C3D_TexEnvFunc(env, C3D_Both, GPU_MODULATE);
-		
-		if (!(p_flags&CANVAS_RECT_REGION)) {
-
-			Rect2 region = Rect2(0,0,texture->tex.width,texture->tex.height);
-			_draw_textured_quad(p_rect,region,region.size,p_flags&CANVAS_RECT_FLIP_H,p_flags&CANVAS_RECT_FLIP_V,p_flags&CANVAS_RECT_TRANSPOSE);
-
-		} else {
-
-			_draw_textured_quad(p_rect, p_source, Size2(texture->tex.width,texture->tex.height),p_flags&CANVAS_RECT_FLIP_H,p_flags&CANVAS_RECT_FLIP_V,p_flags&CANVAS_RECT_TRANSPOSE);
-
-		}
-	}
-	else
-	{
+	if (p_state.texture) {
+		const Texture *texture = reinterpret_cast<const Texture*>(p_state.texture);
+		C3D_TexBind(0, const_cast<C3D_Tex*>(&texture->tex));
+		_set_texture_env(env, texture->pica_format, GPU_PRIMARY_COLOR);
+	} else {
 		C3D_TexBind(0, NULL);
-		
 		C3D_TexEnvSrc(env, C3D_Both, GPU_PRIMARY_COLOR);
 		C3D_TexEnvOpRgb(env, GPU_TEVOP_RGB_SRC_COLOR);
 		C3D_TexEnvOpAlpha(env,GPU_TEVOP_A_SRC_ALPHA);
 		C3D_TexEnvFunc(env, C3D_Both, GPU_REPLACE);
-		
-		_draw_quad(p_rect);
 	}
-}
-void RasterizerCitro3d::canvas_draw_style_box(const Rect2& p_rect, const Rect2& p_src_region, RID p_texture,const float *p_margin, bool p_draw_center,const Color& p_modulate)
-{
-	print("canvas_draw_style_box\n");
-	
-// 	Color m = p_modulate;
-// 	m.a*=canvas_opacity;
-// 	_set_color_attrib(m);
-	C3D_FixedAttribSet(2, p_modulate.r, p_modulate.g, p_modulate.b, p_modulate.a * canvas_opacity);
 
-	Texture* texture=_bind_texture(p_texture);
-	ERR_FAIL_COND(!texture);
+	_canvas_apply_blend_mode(p_state.blend_mode);
 
-	Rect2 region = p_src_region;
-	if (region.size.width <= 0 )
-	    region.size.width = texture->width;
-	if (region.size.height <= 0)
-	    region.size.height = texture->height;
-	/* CORNERS */
-	_draw_textured_quad( // top left
-		Rect2( p_rect.pos, Size2(p_margin[MARGIN_LEFT],p_margin[MARGIN_TOP])),
-		Rect2( region.pos, Size2(p_margin[MARGIN_LEFT],p_margin[MARGIN_TOP])),
-		Size2( texture->width, texture->height ) );
-
-	_draw_textured_quad( // top right
-		Rect2( Point2( p_rect.pos.x + p_rect.size.width - p_margin[MARGIN_RIGHT], p_rect.pos.y), Size2(p_margin[MARGIN_RIGHT],p_margin[MARGIN_TOP])),
-		Rect2( Point2(region.pos.x+region.size.width-p_margin[MARGIN_RIGHT], region.pos.y), Size2(p_margin[MARGIN_RIGHT],p_margin[MARGIN_TOP])),
-		Size2( texture->width, texture->height ) );
-
-
-	_draw_textured_quad( // bottom left
-		Rect2( Point2(p_rect.pos.x,p_rect.pos.y + p_rect.size.height - p_margin[MARGIN_BOTTOM]), Size2(p_margin[MARGIN_LEFT],p_margin[MARGIN_BOTTOM])),
-		Rect2( Point2(region.pos.x, region.pos.y+region.size.height-p_margin[MARGIN_BOTTOM]), Size2(p_margin[MARGIN_LEFT],p_margin[MARGIN_BOTTOM])),
-		Size2( texture->width, texture->height ) );
-
-	_draw_textured_quad( // bottom right
-		Rect2( Point2( p_rect.pos.x + p_rect.size.width - p_margin[MARGIN_RIGHT], p_rect.pos.y + p_rect.size.height - p_margin[MARGIN_BOTTOM]), Size2(p_margin[MARGIN_RIGHT],p_margin[MARGIN_BOTTOM])),
-		Rect2( Point2(region.pos.x+region.size.width-p_margin[MARGIN_RIGHT], region.pos.y+region.size.height-p_margin[MARGIN_BOTTOM]), Size2(p_margin[MARGIN_RIGHT],p_margin[MARGIN_BOTTOM])),
-		Size2( texture->width, texture->height ) );
-
-	Rect2 rect_center( p_rect.pos+Point2( p_margin[MARGIN_LEFT], p_margin[MARGIN_TOP]), Size2( p_rect.size.width - p_margin[MARGIN_LEFT] - p_margin[MARGIN_RIGHT], p_rect.size.height - p_margin[MARGIN_TOP] - p_margin[MARGIN_BOTTOM] ));
-
-	Rect2 src_center( Point2(region.pos.x+p_margin[MARGIN_LEFT], region.pos.y+p_margin[MARGIN_TOP]), Size2(region.size.width - p_margin[MARGIN_LEFT] - p_margin[MARGIN_RIGHT], region.size.height - p_margin[MARGIN_TOP] - p_margin[MARGIN_BOTTOM] ));
-
-
-	_draw_textured_quad( // top
-		Rect2( Point2(rect_center.pos.x,p_rect.pos.y),Size2(rect_center.size.width,p_margin[MARGIN_TOP])),
-		Rect2( Point2(src_center.pos.x,region.pos.y), Size2(src_center.size.width,p_margin[MARGIN_TOP])),
-		Size2( texture->width, texture->height ) );
-
-	_draw_textured_quad( // bottom
-		Rect2( Point2(rect_center.pos.x,rect_center.pos.y+rect_center.size.height),Size2(rect_center.size.width,p_margin[MARGIN_BOTTOM])),
-		Rect2( Point2(src_center.pos.x,src_center.pos.y+src_center.size.height), Size2(src_center.size.width,p_margin[MARGIN_BOTTOM])),
-		Size2( texture->width, texture->height ) );
-
-	_draw_textured_quad( // left
-		Rect2( Point2(p_rect.pos.x,rect_center.pos.y),Size2(p_margin[MARGIN_LEFT],rect_center.size.height)),
-		Rect2( Point2(region.pos.x,region.pos.y+p_margin[MARGIN_TOP]), Size2(p_margin[MARGIN_LEFT],src_center.size.height)),
-		Size2( texture->width, texture->height ) );
-
-	_draw_textured_quad( // right
-		Rect2( Point2(rect_center.pos.x+rect_center.size.width,rect_center.pos.y),Size2(p_margin[MARGIN_RIGHT],rect_center.size.height)),
-		Rect2( Point2(src_center.pos.x+src_center.size.width,region.pos.y+p_margin[MARGIN_TOP]), Size2(p_margin[MARGIN_RIGHT],src_center.size.height)),
-		Size2( texture->width, texture->height ) );
-
-	if (p_draw_center) {
-		_draw_textured_quad(
-			rect_center,
-			src_center,
-			Size2( texture->width, texture->height ));
+	if (p_state.clip) {
+		if (!canvas_applied_clip || canvas_applied_clip_rect != p_state.clip_rect) {
+			Rect2 r = Rect2(p_state.clip_rect.pos * p_scissor_scale, p_state.clip_rect.size * p_scissor_scale);
+			_set_scissor(r.pos.x, r.pos.y, r.size.width, r.size.height, current_screen == SCREEN_BOTTOM && !current_rt ? 320 : 400);
+		}
+	} else if (canvas_applied_clip) {
+		C3D_SetScissor(GPU_SCISSOR_DISABLE, 0, 0, 0, 0);
 	}
+	canvas_applied_clip = p_state.clip;
+	canvas_applied_clip_rect = p_state.clip_rect;
 
-	_rinfo.ci_draw_commands++;
-}
-void RasterizerCitro3d::canvas_draw_primitive(const Vector<Point2>& p_points, const Vector<Color>& p_colors,const Vector<Point2>& p_uvs, RID p_texture,float p_width)
-{
-	print("canvas_draw_primitive\n");
-}
+	C3D_BufInfo* bufInfo = C3D_GetBufInfo();
+	BufInfo_Init(bufInfo);
+	BufInfo_Add(bufInfo, p_vertices, sizeof(CanvasBatcher::Vertex), 3, 0x210);
 
+	C3D_DrawElements(GPU_TRIANGLES, p_quad_count * CanvasBatcher::INDICES_PER_QUAD, C3D_UNSIGNED_SHORT, canvas_batch_indices);
 
-void RasterizerCitro3d::canvas_draw_polygon(int p_vertex_count, const int* p_indices, const Vector2* p_vertices, const Vector2* p_uvs, const Color* p_colors,const RID& p_texture,bool p_singlecolor)
-{
-	print("canvas_draw_polygon\n");
+	_rinfo.draw_calls++;
+	_rinfo.vertex_count += p_quad_count * CanvasBatcher::VERTICES_PER_QUAD;
 }
 
-RasterizerCitro3d::Texture* RasterizerCitro3d::_bind_texture(const RID& p_texture)
+void RasterizerCitro3d::_canvas_batch_end()
 {
-	if (p_texture.is_valid())
-	{
-		Texture*texture=texture_owner.get(p_texture);
-		C3D_TexBind(0, &texture->tex);
-		return texture;
+	canvas_batcher.flush();
+
+	if (canvas_applied_clip) {
+		C3D_SetScissor(GPU_SCISSOR_DISABLE, 0, 0, 0, 0);
+		canvas_applied_clip = false;
 	}
-	
-	C3D_TexBind(0, NULL);
-	return NULL;
 }
 
 void RasterizerCitro3d::_set_uniform(int uniform_location, const Matrix32& p_transform)
@@ -2776,48 +3010,6 @@ void RasterizerCitro3d::_set_uniform(int uniform_location, const CameraMatrix& p
 	C3D_FVUnifMtx4x4(GPU_VERTEX_SHADER, uniform_location, &mtx);
 }
 
-void RasterizerCitro3d::canvas_set_transform(const Matrix32& p_transform)
-{
-	_set_uniform(canvas_shader->location_extra, p_transform);
-}
-
-static void _set_scissor(int x, int y, int w, int h)
-{
-	print("set_scissor %d %d %d %d\n", x, y, w, h);
-	// Keep in mind the sideway 3ds screen, so it seems screwy
-	int bottom = 400 - x;
-	int top = 240 - y;
-	int left = top - h;
-	int right = bottom - w;
-	if (bottom < 0) bottom = 0;
-	if (top < 0) top = 0;
-	if (left < 0) left = 0;
-	if (right < 0) right = 0;
-	C3D_SetScissor(GPU_SCISSOR_NORMAL, left, right, top, bottom);
-// 	C3D_SetScissor(GPU_SCISSOR_NORMAL, 240 - (y + h), 400 - (x + w), 240 - y, 400 - x);
-}
-
-void RasterizerCitro3d::_set_canvas_scissor(CanvasItem* p_item)
-{
-	int x, y, w, h;
-
-	if (current_rt) {
-		x = p_item->final_clip_rect.pos.x;
-		y = p_item->final_clip_rect.pos.y;
-		w = p_item->final_clip_rect.size.x;
-		h = p_item->final_clip_rect.size.y;
-	}
-	else
-	{
-		x = p_item->final_clip_rect.pos.x;
-		y = 240 - (p_item->final_clip_rect.pos.y + p_item->final_clip_rect.size.y);
-		w = p_item->final_clip_rect.size.x;
-		h = p_item->final_clip_rect.size.y;
-	}
-	
-	_set_scissor(x, y, w, h);
-}
-
 template<bool use_normalmap>
 void RasterizerCitro3d::_canvas_item_render_commands(CanvasItem *p_item,CanvasItem *current_clip,bool &reclip)
 {
@@ -2932,10 +3124,10 @@ void RasterizerCitro3d::_canvas_item_render_commands(CanvasItem *p_item,CanvasIt
 
 					if (ci->ignore!=reclip) {
 						if (ci->ignore) {
-							C3D_SetScissor(GPU_SCISSOR_DISABLE, 0, 0, 0, 0);
+							canvas_batcher.set_clip(false);
 							reclip = true;
 						} else {							
-							_set_canvas_scissor(current_clip);
+							canvas_batcher.set_clip(true, _get_canvas_scissor(current_clip));
 							reclip=false;
 						}
 					}
@@ -2948,6 +3140,7 @@ void RasterizerCitro3d::_canvas_item_render_commands(CanvasItem *p_item,CanvasIt
 
 void RasterizerCitro3d::canvas_render_items(CanvasItem *p_item_list,int p_z,const Color& p_modulate,CanvasLight *p_light)
 {
+	ZONE_SCOPE("RasterizerCitro3d::canvas_render_items");
 // 	print("canvas_render_items Z:%d\n", p_z);
 	
 	canvas_opacity=1.0;
@@ -2984,18 +3177,18 @@ void RasterizerCitro3d::canvas_render_items(CanvasItem *p_item_list,int p_z,cons
 // 					h = current_clip->final_clip_rect.size.y;
 // 				}
 // 				_set_scissor(x, y, w, h);
-				_set_canvas_scissor(current_clip);
+				canvas_batcher.set_clip(true, _get_canvas_scissor(current_clip));
 			}
 			else
-				C3D_SetScissor(GPU_SCISSOR_DISABLE, 0, 0, 0, 0);
+				canvas_batcher.set_clip(false);
 		}
 		
 		// Handle material/shader
 		CanvasItem *material_owner = ci->material_owner?ci->material_owner:ci;
 		CanvasItemMaterial *material = material_owner->material;
 		
-		_set_uniform(canvas_shader->location_modelview,ci->final_transform);
-		_set_uniform(canvas_shader->location_extra, Matrix32());
+		canvas_transform = ci->final_transform;
+		canvas_batcher.set_transform(canvas_transform);
 		
 		bool unshaded = (material && material->shading_mode==VS::CANVAS_ITEM_SHADING_UNSHADED) || ci->blend_mode!=VS::MATERIAL_BLEND_MODE_MIX;
 		
@@ -3011,14 +3204,13 @@ void RasterizerCitro3d::canvas_render_items(CanvasItem *p_item_list,int p_z,cons
 		
 		if (reclip)
 		{
-			_set_canvas_scissor(current_clip);
+			canvas_batcher.set_clip(true, _get_canvas_scissor(current_clip));
 		}
 		
 		p_item_list = p_item_list->next;
 	}
 	
-	if (current_clip)
-		C3D_SetScissor(GPU_SCISSOR_DISABLE, 0, 0, 0, 0);
+	_canvas_batch_end();
 }
 
 /* ENVIRONMENT */
@@ -3172,6 +3364,9 @@ void RasterizerCitro3d::free(const RID& p_rid) {
 
 // 		print("delete texture\n");
 		Texture *texture = texture_owner.get(p_rid);
+		canvas_batcher.flush(); // pending batch may still point at it
+		_texture_atlas_remove(texture);
+		_texture_release(texture);
 		texture_owner.free(p_rid);
 		memdelete(texture);
 
@@ -3193,24 +3388,8 @@ void RasterizerCitro3d::free(const RID& p_rid) {
 		Mesh *mesh = mesh_owner.get(p_rid);
 
 		for (int i=0;i<mesh->surfaces.size();i++) {
-			Surface *surface = mesh->surfaces[i];
-			if (surface->array_local)
-				linearFree(surface->array_local);
-			if (surface->index_array_local)
-				linearFree(surface->index_array_local);
-			
-			if (mesh->morph_target_count>0) {
-
-				for(int i=0;i<mesh->morph_target_count;i++) {
-
-					memdelete_arr(surface->morph_targets_local[i].array);
-				}
-				memdelete_arr(surface->morph_targets_local);
-				surface->morph_targets_local=NULL;
-			}
-			
-			memdelete( mesh->surfaces[i] );
-		};
+			_surface_free(mesh->surfaces[i]);
+		}
 
 		mesh->surfaces.clear();
 		mesh_owner.free(p_rid);
@@ -3942,10 +4121,7 @@ bool RasterizerCitro3d::_setup_material(const Geometry *p_geometry,const Materia
 		if (texture)
 		{
 			print("binding material texture\n");
-			C3D_TexEnvSrc(env, C3D_Both, GPU_PREVIOUS, GPU_TEXTURE0);
-			C3D_TexEnvOpRgb(env, GPU_TEVOP_RGB_SRC_COLOR);
-			C3D_TexEnvOpAlpha(env,GPU_TEVOP_A_SRC_ALPHA);
-			C3D_TexEnvFunc(env, C3D_Both, GPU_MODULATE);
+			_set_texture_env(env, texture->pica_format, GPU_PREVIOUS);
 		}
 		else
 		{
@@ -4296,171 +4472,146 @@ static const GPU_Primitive_t gl_primitive[]={
 	GPU_TRIANGLE_FAN
 };
 
-void RasterizerCitro3d::_render(const Geometry *p_geometry,const Material *p_material, const Skeleton* p_skeleton, const GeometryOwner *p_owner,const Transform& p_xform)
+void RasterizerCitro3d::_set_vertex_layout(const PicaVertexLayout &p_layout, const void *p_vertices)
 {
-	_rinfo.object_count++;
-	
 	C3D_AttrInfo* attrInfo = C3D_GetAttrInfo();
 	AttrInfo_Init(attrInfo);
-	
+
+	// Loaders are added in attribute order, v0=vertex v1=normal v2=tex_uv
+	for (int i=0;i<p_layout.attrib_count;i++) {
+		const PicaVertexLayout::Attrib &attrib = p_layout.attribs[i];
+		int reg = attrib.array==VS::ARRAY_VERTEX ? 0 : (attrib.array==VS::ARRAY_NORMAL ? 1 : 2);
+		AttrInfo_AddLoader(attrInfo, reg, (GPU_FORMATS)attrib.type, attrib.count);
+	}
+	if (!p_layout.get_attrib(VS::ARRAY_NORMAL)) {
+		AttrInfo_AddFixed(attrInfo, 1);
+		C3D_FixedAttribSet(1, 0.f, 0.f, 1.f, 0.f);
+	}
+	if (!p_layout.get_attrib(VS::ARRAY_TEX_UV)) {
+		AttrInfo_AddFixed(attrInfo, 2);
+		C3D_FixedAttribSet(2, 0.f, 0.f, 0.f, 0.f);
+	}
+
 	C3D_BufInfo* bufInfo = C3D_GetBufInfo();
 	BufInfo_Init(bufInfo);
+	BufInfo_Add(bufInfo, p_vertices, p_layout.stride, p_layout.attrib_count, p_layout.get_permutation());
+}
 
-	switch(p_geometry->type) {
-
-		case Geometry::GEOMETRY_SURFACE: {
+void RasterizerCitro3d::_draw_surface(const Surface *p_surface, const PicaVertexLayout &p_layout, const void *p_indices, int p_instances)
+{
+	if (p_layout.index_count) {
+		ERR_FAIL_COND(!p_indices);
+		C3D_DrawElements(gl_primitive[p_surface->primitive], p_layout.index_count*p_instances, (p_layout.index_size == 2) ? C3D_UNSIGNED_SHORT : C3D_UNSIGNED_BYTE, p_indices);
+	} else {
+		C3D_DrawArrays(gl_primitive[p_surface->primitive], 0, p_layout.vertex_count*p_instances);
+	}
 
-			Surface *s = (Surface*)p_geometry;
-			
-			bool has_tex = (s->stride > 24);
-// 			bool has_tex = s->array[VS::ARRAY_TEX_UV].bind;
-			
-			print("stride:%d primitive:%d\n", s->stride, (int)gl_primitive[s->primitive]);
+	_rinfo.vertex_count+=p_layout.vertex_count*p_instances;
+	_rinfo.draw_calls++;
+}
 
-			AttrInfo_AddLoader(attrInfo, 0, GPU_FLOAT, 3); // v0=vertex
-			AttrInfo_AddLoader(attrInfo, 1, GPU_FLOAT, 3); // v1=normal
-			if (has_tex)
-				AttrInfo_AddLoader(attrInfo, 2, GPU_FLOAT, 2); // v2=tex_uv
-			else
-			{
-// 				AttrInfo_AddFixed(attrInfo, 2);
-// 				C3D_FixedAttribSet(2, 1.f, 1.f, 1.f, 1.f);
-			}
-			
-			BufInfo_Add(bufInfo, s->array_local, s->stride, has_tex ? 3 : 2, has_tex ? 0x210 : 0x10);
+void RasterizerCitro3d::_multimesh_update_batches(MultiMesh *p_multimesh, const AABB &p_mesh_aabb)
+{
+	if (!p_multimesh->batches_dirty && p_multimesh->batches_mesh_aabb==p_mesh_aabb)
+		return;
 
-			_rinfo.vertex_count+=s->array_len;
+	int count = p_multimesh->elements.size();
+	const Transform *xforms = count ? &p_multimesh->elements[0].xform : NULL;
+	MultiMeshBatcher::build_batches(xforms, count, sizeof(MultiMesh::Element), p_mesh_aabb, p_multimesh->batches);
+	p_multimesh->batches_mesh_aabb=p_mesh_aabb;
+	p_multimesh->batches_dirty=false;
+}
 
-			if (s->index_array_len>0) {
+void RasterizerCitro3d::_render_multimesh(const Surface *p_surface, const MultiMesh *p_multimesh, const Transform &p_xform)
+{
+	int element_count=p_multimesh->elements.size();
+	if (p_multimesh->visible>=0)
+		element_count=MIN(element_count,p_multimesh->visible);
+	if (element_count==0)
+		return;
 
-				if (s->index_array_local)
-				{
-					print("index len: %u\n", s->array[VS::ARRAY_INDEX].size);
+	MultiMeshBatcher::cull_batches(p_multimesh->batches, element_count, p_xform, camera_planes.ptr(), camera_planes.size(), multimesh_visible);
 
-					//print_line("LOCAL F: "+itos(s->format)+" C: "+itos(s->index_array_len)+" VC: "+itos(s->array_len));
-// 					glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,0);
-// 					glDrawElements(gl_primitive[s->primitive], s->index_array_len, (s->array_len>(1<<16))?GL_UNSIGNED_INT:GL_UNSIGNED_SHORT, s->index_array_local);
-					
-					C3D_DrawElements(gl_primitive[s->primitive], s->index_array_len, (s->array[VS::ARRAY_INDEX].size == 2) ? C3D_UNSIGNED_SHORT : C3D_UNSIGNED_BYTE, s->index_array_local);
+	const MultiMesh::Element *elements=&p_multimesh->elements[0];
+	const PicaVertexLayout &layout = p_surface->layout;
 
-				}
+	// Lists can be concatenated, strips and fans can not
+	if (p_surface->primitive==VS::PRIMITIVE_TRIANGLES && layout.vertex_count<=multimesh_pretransform_max_vertices) {
 
-			} else {
+		PicaVertexLayout dest;
+		MultiMeshBatcher::make_pretransform_layout(layout, dest);
+		int max_instances = MultiMeshBatcher::get_pretransform_max_instances(layout);
 
-// 				glDrawArrays(gl_primitive[s->primitive],0,s->array_len);
-				C3D_DrawArrays(gl_primitive[s->primitive], 0, s->array_len);
+		_set_uniform(scene_shader->location_modelview, p_xform);
 
-			};
+		for (int b=0;b<multimesh_visible.size();b++) {
 
-			_rinfo.draw_calls++;
-		} break;
+			const MultiMeshBatcher::Batch &run = multimesh_visible[b];
+			for (int from=run.from;from<run.from+run.count;from+=max_instances) {
 
-		case Geometry::GEOMETRY_MULTISURFACE: {
+				int count = MIN(max_instances, run.from+run.count-from);
+				int vertex_size = count*layout.vertex_count*dest.stride;
+				int index_size = count*dest.index_count*dest.index_size;
 
-// 			material_shader.bind_uniforms();
-			Surface *s = static_cast<const MultiMeshSurface*>(p_geometry)->surface;
-			const MultiMesh *mm = static_cast<const MultiMesh*>(p_owner);
-			int element_count=mm->elements.size();
+				// Same per-frame arena the canvas streams through
+				u8 *vertices = (u8*)_canvas_alloc_vertices(vertex_size);
+				u16 *indices = index_size ? (u16*)_canvas_alloc_vertices(index_size) : NULL;
+				ERR_FAIL_COND(!vertices || (index_size && !indices));
 
-			if (element_count==0)
-				return;
+				MultiMeshBatcher::pretransform(layout, p_surface->array_local, p_surface->index_array_local, dest, &elements[from].xform, count, sizeof(MultiMesh::Element), vertices, indices);
+				GSPGPU_FlushDataCache(vertices, vertex_size);
+				if (indices)
+					GSPGPU_FlushDataCache(indices, index_size);
 
-			if (mm->visible>=0) {
-				element_count=MIN(element_count,mm->visible);
+				_set_vertex_layout(dest, vertices);
+				_draw_surface(p_surface, dest, indices, count);
 			}
+		}
+		return;
+	}
 
-			const MultiMesh::Element *elements=&mm->elements[0];
-
-			_rinfo.vertex_count+=s->array_len*element_count;
-
-			_rinfo.draw_calls+=element_count;
-
-/*
-			if (use_texture_instancing) {
-				//this is probably the fastest all around way if vertex texture fetch is supported
-
-				float twd=(1.0/mm->tw)*4.0;
-				float thd=1.0/mm->th;
-				float parm[3]={0.0,01.0,(1.0f/mm->tw)};
-				glActiveTexture(GL_TEXTURE0+max_texture_units-2);
-				glDisableVertexAttribArray(6);
-				glBindTexture(GL_TEXTURE_2D,mm->tex_id);
-				material_shader.set_uniform(MaterialShaderGLES2::INSTANCE_MATRICES,GL_TEXTURE0+max_texture_units-2);
-
-				if (s->index_array_len>0) {
-
-
-					glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,s->index_id);
-					for(int i=0;i<element_count;i++) {
-						parm[0]=(i%(mm->tw>>2))*twd;
-						parm[1]=(i/(mm->tw>>2))*thd;
-						glVertexAttrib3fv(6,parm);
-						glDrawElements(gl_primitive[s->primitive],s->index_array_len, (s->array_len>(1<<16))?GL_UNSIGNED_INT:GL_UNSIGNED_SHORT,0);
-
-					}
-
-
-				} else {
-
-					for(int i=0;i<element_count;i++) {
-						//parm[0]=(i%(mm->tw>>2))*twd;
-						//parm[1]=(i/(mm->tw>>2))*thd;
-						glVertexAttrib3fv(6,parm);
-						glDrawArrays(gl_primitive[s->primitive],0,s->array_len);
-					}
-				 };
-
-			} else if (use_attribute_instancing) {
-				//if not, using atributes instead of uniforms can be really fast in forward rendering architectures
-				if (s->index_array_len>0) {
-
-
-					glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,s->index_id);
-					for(int i=0;i<element_count;i++) {
-						glVertexAttrib4fv(8,&elements[i].matrix[0]);
-						glVertexAttrib4fv(9,&elements[i].matrix[4]);
-						glVertexAttrib4fv(10,&elements[i].matrix[8]);
-						glVertexAttrib4fv(11,&elements[i].matrix[12]);
-						glDrawElements(gl_primitive[s->primitive],s->index_array_len, (s->array_len>(1<<16))?GL_UNSIGNED_INT:GL_UNSIGNED_SHORT,0);
-					}
-
+	// Loader state is shared, only the instance matrix changes between draws
+	_set_vertex_layout(layout, p_surface->array_local);
+	Transform dequant = layout.get_position_transform();
 
-				} else {
+	for (int b=0;b<multimesh_visible.size();b++) {
 
-					for(int i=0;i<element_count;i++) {
-						glVertexAttrib4fv(8,&elements[i].matrix[0]);
-						glVertexAttrib4fv(9,&elements[i].matrix[4]);
-						glVertexAttrib4fv(10,&elements[i].matrix[8]);
-						glVertexAttrib4fv(11,&elements[i].matrix[12]);
-						glDrawArrays(gl_primitive[s->primitive],0,s->array_len);
-					}
-				 };
+		const MultiMeshBatcher::Batch &run = multimesh_visible[b];
+		for (int i=run.from;i<run.from+run.count;i++) {
 
+			_set_uniform(scene_shader->location_modelview, p_xform * elements[i].xform * dequant);
+			_draw_surface(p_surface, layout, p_surface->index_array_local);
+		}
+	}
+}
 
-			} else {
+void RasterizerCitro3d::_render(const Geometry *p_geometry,const Material *p_material, const Skeleton* p_skeleton, const GeometryOwner *p_owner,const Transform& p_xform)
+{
+	_rinfo.object_count++;
+	
+	switch(p_geometry->type) {
 
-				//nothing to do, slow path (hope no hardware has to use it... but you never know)
+		case Geometry::GEOMETRY_SURFACE: {
 
-				if (s->index_array_len>0) {
+			Surface *s = (Surface*)p_geometry;
+			
+			const PicaVertexLayout &layout = s->layout;
 
-					glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,s->index_id);
-					for(int i=0;i<element_count;i++) {
+			print("stride:%d primitive:%d\n", layout.stride, (int)gl_primitive[s->primitive]);
 
-						glUniformMatrix4fv(material_shader.get_uniform_location(MaterialShaderGLES2::INSTANCE_TRANSFORM), 1, false, elements[i].matrix);
-						glDrawElements(gl_primitive[s->primitive],s->index_array_len, (s->array_len>(1<<16))?GL_UNSIGNED_INT:GL_UNSIGNED_SHORT,0);
-					}
+			// Packed positions are mapped back to model space by the modelview
+			_set_uniform(scene_shader->location_modelview, p_xform * layout.get_position_transform());
 
+			_set_vertex_layout(layout, s->array_local);
+			_draw_surface(s, layout, s->index_array_local);
+		} break;
 
-				} else {
+		case Geometry::GEOMETRY_MULTISURFACE: {
 
-					for(int i=0;i<element_count;i++) {
-						glUniformMatrix4fv(material_shader.get_uniform_location(MaterialShaderGLES2::INSTANCE_TRANSFORM), 1, false, elements[i].matrix);
-						glDrawArrays(gl_primitive[s->primitive],0,s->array_len);
-					}
-				 };
-			}
-*/
-		 } break;
+			Surface *s = static_cast<const MultiMeshSurface*>(p_geometry)->surface;
+			const MultiMesh *mm = static_cast<const MultiMesh*>(p_owner);
+			_render_multimesh(s, mm, p_xform);
+		} break;
 /*
 		case Geometry::GEOMETRY_IMMEDIATE: {
 
@@ -4636,72 +4787,6 @@ void RasterizerCitro3d::_render(const Geometry *p_geometry,const Material *p_mat
 	};
 }
 
-void RasterizerCitro3d::_draw_quad(const Rect2& p_rect)
-{	
-	VertexArray *varray = memnew(VertexArray(4));
-	varray->vertices[0].position = Vector3( p_rect.pos.x,p_rect.pos.y, 0.5f );
-	varray->vertices[1].position = Vector3( p_rect.pos.x+p_rect.size.width,p_rect.pos.y, 0.5f );
-	varray->vertices[2].position = Vector3( p_rect.pos.x+p_rect.size.width,p_rect.pos.y+p_rect.size.height, 0.5f );
-	varray->vertices[3].position = Vector3( p_rect.pos.x,p_rect.pos.y+p_rect.size.height, 0.5f );
-	
-	C3D_BufInfo* bufInfo = C3D_GetBufInfo();
-	BufInfo_Init(bufInfo);
-	BufInfo_Add(bufInfo, varray->vertices, sizeof(Vertex), 2, 0x10);
-	
-	C3D_DrawArrays(GPU_TRIANGLE_FAN, 0, 4);
-	
-	vertexArrays.push_back(varray);
-// 	C3D_Flush();
-// 	_draw_gui_primitive(4,coords,0,0);
-// 	_rinfo.ci_draw_commands++;
-}
-
-void RasterizerCitro3d::_draw_textured_quad(const Rect2& p_rect, const Rect2& p_src_region, const Size2& p_tex_size,bool p_h_flip, bool p_v_flip, bool p_transpose )
-{
-// 	print("_draw_textured_quad\n");
-	VertexArray *varray = memnew(VertexArray(4));
-	
-	Vertex v[4] = {
-		{
-			Vector3( p_rect.pos.x, p_rect.pos.y, 0.5f),
-			Vector2( p_src_region.pos.x/p_tex_size.width, p_src_region.pos.y/p_tex_size.height)
-		},{
-			Vector3( p_rect.pos.x+p_rect.size.width, p_rect.pos.y, 0.5f),
-			Vector2((p_src_region.pos.x+p_src_region.size.width)/p_tex_size.width, p_src_region.pos.y/p_tex_size.height)
-		},{
-			Vector3( p_rect.pos.x+p_rect.size.width, p_rect.pos.y+p_rect.size.height, 0.5f),
-			Vector2( (p_src_region.pos.x+p_src_region.size.width)/p_tex_size.width, (p_src_region.pos.y+p_src_region.size.height)/p_tex_size.height)
-		},{
-			Vector3( p_rect.pos.x,p_rect.pos.y+p_rect.size.height, 0.5f),
-			Vector2( p_src_region.pos.x/p_tex_size.width, (p_src_region.pos.y+p_src_region.size.height)/p_tex_size.height)
-		},
-	};
-	
-	memcpy(varray->vertices, v, sizeof(v));
-	
-	if (p_transpose) {
-		SWAP( varray->vertices[1].texcoord, varray->vertices[3].texcoord );
-	}
-	if (p_h_flip) {
-		SWAP( varray->vertices[0].texcoord, varray->vertices[1].texcoord );
-		SWAP( varray->vertices[2].texcoord, varray->vertices[3].texcoord );
-	}
-	if (p_v_flip) {
-		SWAP( varray->vertices[1].texcoord, varray->vertices[2].texcoord );
-		SWAP( varray->vertices[0].texcoord, varray->vertices[3].texcoord );
-	}
-	
-	C3D_BufInfo* bufInfo = C3D_GetBufInfo();
-	BufInfo_Init(bufInfo);
-	BufInfo_Add(bufInfo, varray->vertices, sizeof(Vertex), 2, 0x10);
-	
-	C3D_DrawArrays(GPU_TRIANGLE_FAN, 0, 4);
-
-	vertexArrays.push_back(varray);
-// 	_draw_gui_primitive(4,coords,0,texcoords);
-// 	_rinfo.ci_draw_commands++;
-}
-
 static const C3D_Material material =
 	{
 		{ 0.2f, 0.2f, 0.2f }, //ambient
@@ -4734,6 +4819,18 @@ void RasterizerCitro3d::init()
 	C3D_RenderTargetClear(base_framebuffer->target,C3D_CLEAR_ALL,CLEAR_COLOR,0);
 	base_framebuffer->texture_ptr = texture;
 	base_framebuffer->texture = texture_owner.make_rid( texture );
+	screen_framebuffers[SCREEN_TOP] = base_framebuffer;
+	current_screen = SCREEN_TOP;
+	
+	if (GLOBAL_DEF("rasterizer/3ds/stereo_3d", false)) {
+		stereo_target = C3D_RenderTargetCreate(STEREO_TARGET_WIDTH, STEREO_TARGET_HEIGHT, GPU_RB_RGBA8, GPU_RB_DEPTH24_STENCIL8);
+		ERR_FAIL_COND(!stereo_target);
+		C3D_RenderTargetSetOutput(stereo_target, GFX_TOP, GFX_LEFT, NATIVE_TRANSFER_FLAGS);
+		C3D_RenderTargetClear(stereo_target,C3D_CLEAR_ALL,CLEAR_COLOR,0);
+		gfxSet3D(true);
+	}
+	stereo_eye_separation = GLOBAL_DEF("rasterizer/3ds/stereo_eye_separation", 0.2);
+	stereo_convergence = GLOBAL_DEF("rasterizer/3ds/stereo_convergence", 5.0);
 	
 	// Frag lighting
 	C3D_LightEnvInit(&lightEnv);
@@ -4764,6 +4861,40 @@ void RasterizerCitro3d::init()
 	
 	opaque_render_list.init();
 	alpha_render_list.init();
+	
+	canvas_batch_indices = reinterpret_cast<u16*>(linearAlloc(CanvasBatcher::MAX_BATCH_QUADS * CanvasBatcher::INDICES_PER_QUAD * sizeof(u16)));
+	CanvasBatcher::fill_quad_indices(canvas_batch_indices, CanvasBatcher::MAX_BATCH_QUADS);
+	GSPGPU_FlushDataCache(canvas_batch_indices, CanvasBatcher::MAX_BATCH_QUADS * CanvasBatcher::INDICES_PER_QUAD * sizeof(u16));
+	
+	memory_budget.allocated(GPUMemoryBudget::CATEGORY_INDEX, CanvasBatcher::MAX_BATCH_QUADS * CanvasBatcher::INDICES_PER_QUAD * sizeof(u16));
+	
+	for (int i = 0; i < 2; ++i) {
+		canvas_vertex_arena[i] = reinterpret_cast<u8*>(linearAlloc(CANVAS_VERTEX_ARENA_SIZE));
+		canvas_vertex_overflow_size[i] = 0;
+		memory_budget.allocated(GPUMemoryBudget::CATEGORY_VERTEX, CANVAS_VERTEX_ARENA_SIZE);
+	}
+	canvas_vertex_arena_used = 0;
+	canvas_vertex_arena_index = 0;
+	
+	canvas_batch_backend.rasterizer = this;
+	canvas_batcher.set_backend(&canvas_batch_backend);
+
+	texture_format_options = pica_texture_get_project_options();
+
+	// 0 leaves the budget at three quarters of what is free after setup
+	int budget_kb = GLOBAL_DEF("rasterizer/3ds/video_memory_budget_kb", 0);
+	memory_budget.set_budget(budget_kb > 0 ? int64_t(budget_kb) * 1024 : int64_t(linearSpaceFree()) * 3 / 4);
+	memory_budget_backend.rasterizer = this;
+	memory_budget.set_backend(&memory_budget_backend);
+	release_textures_on_suspend = GLOBAL_DEF("rasterizer/3ds/release_textures_on_suspend", true);
+	// 1 keeps CPU and GPU in lockstep, 2 prepares the next frame while the GPU draws
+	set_max_frames_in_flight(CLAMP(int(GLOBAL_DEF("rasterizer/3ds/max_frames_in_flight", 1)), 1, (int)MAX_FRAMES_IN_FLIGHT));
+
+	texture_atlas_enabled = GLOBAL_DEF("rasterizer/3ds/texture_atlas", true);
+	multimesh_pretransform_max_vertices = GLOBAL_DEF("rasterizer/3ds/multimesh_pretransform_max_vertices", 64);
+	texture_atlas.set_page_size(GLOBAL_DEF("rasterizer/3ds/texture_atlas_page_size", (int)TextureAtlas::PAGE_SIZE));
+	texture_atlas_backend.rasterizer = this;
+	texture_atlas.set_backend(&texture_atlas_backend);
 }
 
 void RasterizerCitro3d::finish()
@@ -4772,8 +4903,36 @@ void RasterizerCitro3d::finish()
 	
 	memdelete(canvas_shader);
 	memdelete(scene_shader);
+	base_framebuffer = screen_framebuffers[SCREEN_TOP];
 	memdelete(base_framebuffer->texture_ptr);
 	memdelete(base_framebuffer);
+	if (screen_framebuffers[SCREEN_BOTTOM]) {
+		C3D_RenderTargetDelete(screen_framebuffers[SCREEN_BOTTOM]->target);
+		memdelete(screen_framebuffers[SCREEN_BOTTOM]);
+	}
+	for (int i = 0; i < SCREEN_MAX; ++i)
+		screen_framebuffers[i] = NULL;
+	if (stereo_target) {
+		C3D_RenderTargetDelete(stereo_target);
+		stereo_target = NULL;
+		gfxSet3D(false);
+	}
+
+	texture_atlas.clear();
+	
+	linearFree(canvas_batch_indices);
+	memory_budget.freed(GPUMemoryBudget::CATEGORY_INDEX, CanvasBatcher::MAX_BATCH_QUADS * CanvasBatcher::INDICES_PER_QUAD * sizeof(u16));
+	for (int i = 0; i < 2; ++i) {
+		linearFree(canvas_vertex_arena[i]);
+		for (int j = 0; j < canvas_vertex_overflow[i].size(); ++j)
+			linearFree(canvas_vertex_overflow[i][j]);
+		canvas_vertex_overflow[i].clear();
+		memory_budget.freed(GPUMemoryBudget::CATEGORY_VERTEX, CANVAS_VERTEX_ARENA_SIZE + canvas_vertex_overflow_size[i]);
+		canvas_vertex_overflow_size[i] = 0;
+		for (int j = 0; j < texture_free_queue[i].size(); ++j)
+			C3D_TexDelete(&texture_free_queue[i][j]);
+		texture_free_queue[i].clear();
+	}
 	
 	C3D_Fini();
 }
@@ -4808,20 +4967,45 @@ int RasterizerCitro3d::get_render_info(VS::RenderInfo p_info) {
 		} break;
 		case VS::INFO_USAGE_VIDEO_MEM_TOTAL: {
 
-			return 0;
+			return memory_budget.get_budget();
 		} break;
 		case VS::INFO_VIDEO_MEM_USED: {
 
-			return get_render_info(VS::INFO_TEXTURE_MEM_USED)+get_render_info(VS::INFO_VERTEX_MEM_USED);
+			return memory_budget.get_total_usage();
 		} break;
 		case VS::INFO_TEXTURE_MEM_USED: {
 
-			return _rinfo.texture_mem;
+			return memory_budget.get_usage(GPUMemoryBudget::CATEGORY_TEXTURE);
 		} break;
 		case VS::INFO_VERTEX_MEM_USED: {
 
-			return 0;
+			return memory_budget.get_usage(GPUMemoryBudget::CATEGORY_VERTEX);
+		} break;
+		case VS::INFO_INDEX_MEM_USED: {
+
+			return memory_budget.get_usage(GPUMemoryBudget::CATEGORY_INDEX);
+		} break;
+		case VS::INFO_TEXTURE_EVICTIONS: {
+
+			return memory_budget.get_eviction_count();
+		} break;
+		case VS::INFO_TEXTURE_ATLAS_PAGES: {
+
+			return texture_atlas.get_page_count();
 		} break;
+		case VS::INFO_TEXTURE_ATLAS_EFFICIENCY: {
+
+			return Math::fast_ftoi(texture_atlas.get_efficiency() * 100.0);
+		} break;
+		case VS::INFO_CANVAS_BATCHES_IN_FRAME: {
+
+			return canvas_batcher.get_batch_count();
+		} break;
+		case VS::INFO_TEXTURE_UPLOADS_IN_FRAME: {
+
+			return _rinfo.texture_uploads;
+		} break;
+		default: {}
 	}
 
 	return 0;
@@ -4840,7 +5024,7 @@ bool RasterizerCitro3d::has_feature(VS::Features p_feature) const
 		default:
 		case VS::FEATURE_MULTITHREADED:     return false;
 		case VS::FEATURE_SHADERS:           return true;
-		case VS::FEATURE_NEEDS_RELOAD_HOOK: return false;
+		case VS::FEATURE_NEEDS_RELOAD_HOOK: return release_textures_on_suspend;
 	}
 }
 
@@ -4854,7 +5038,21 @@ void RasterizerCitro3d::restore_framebuffer()
 RasterizerCitro3d::RasterizerCitro3d()
 : current_rt (NULL)
 {
-	
+	memset(&_rinfo, 0, sizeof(_rinfo));
+	texture_format_options = PICA_TEXTURE_ALLOW_COMPACT;
+	texture_atlas_enabled = false;
+	release_textures_on_suspend = false;
+	frame_begun = false;
+	canvas_vertex_arena_index = 0;
+	multimesh_pretransform_max_vertices = 0;
+	for (int i = 0; i < SCREEN_MAX; ++i)
+		screen_framebuffers[i] = NULL;
+	current_screen = SCREEN_TOP;
+	stereo_target = NULL;
+	stereo_eye_separation = 0;
+	stereo_convergence = 1;
+	stereo_depth = 0;
+	stereo_scene = false;
 };
 
 RasterizerCitro3d::~RasterizerCitro3d()
@@ -40,6 +40,11 @@
 #include "sort.h"
 
 #include "servers/visual/particle_system_sw.h"
+#include "canvas_batcher.h"
+#include "gpu_memory_budget.h"
+#include "multimesh_batcher.h"
+#include "texture_atlas.h"
+#include "vertex_format.h"
 
 // Need to avoid including conflicting ctrulib Thread type
 #ifdef _3DS
@@ -66,12 +71,25 @@ class RasterizerCitro3d : public Rasterizer {
 		uint32_t flags;
 		int width,height;
 		C3D_Tex tex;
+		PicaTextureFormat pica_format;
 		Image::Format format;
 		Image image[6];
-		Texture() {
+		TextureAtlas::Entry *atlas_entry; // when set, tex is unused and the data lives in the atlas page
+		bool atlas_allowed;
+		GPUMemoryBudget::Item budget_item;
+		bool evicted; // storage released over budget, image[0] is uploaded again on use
+		RID self;
+		ObjectID reloader; // restores the data when the copy in image[] was dropped
+		StringName reloader_func;
+		Texture() : budget_item(this) {
 			tex.data = NULL;
 			flags=width=height=0;
+			pica_format=PICA_TEXTURE_RGBA8;
 			format=Image::FORMAT_GRAYSCALE;
+			atlas_entry=NULL;
+			atlas_allowed=true;
+			evicted=false;
+			reloader=0;
 		}
 
 		~Texture() {
@@ -220,7 +238,8 @@ class RasterizerCitro3d : public Rasterizer {
 		ArrayData array[VS::ARRAY_MAX];
 		// support for vertex array objects
 		u32 array_object_id;
-		// Arrays stored in linearMem
+		// Arrays stored in linearMem, packed as described by layout
+		PicaVertexLayout layout;
 		u8 *array_local;
 		u8 *index_array_local;
 		Vector<AABB> skeleton_bone_aabb;
@@ -332,9 +351,16 @@ class RasterizerCitro3d : public Rasterizer {
 
 		//IDirect3DVertexBuffer9* instance_buffer;
 		Vector<Element> elements;
+		Vector<MultiMeshSurface> cache_surfaces;
+
+		// Culling batches, rebuilt when transforms or the mesh bounds change
+		Vector<MultiMeshBatcher::Batch> batches;
+		AABB batches_mesh_aabb;
+		bool batches_dirty;
 
 		MultiMesh() {
 			visible=-1;
+			batches_dirty=true;
 		}
 
 
@@ -513,7 +539,6 @@ class RasterizerCitro3d : public Rasterizer {
 
 	struct _Rinfo {
 
-		int texture_mem;
 		int vertex_count;
 		int object_count;
 		int mat_change_count;
@@ -521,6 +546,7 @@ class RasterizerCitro3d : public Rasterizer {
 		int shader_change_count;
 		int ci_draw_commands;
 		int draw_calls;
+		int texture_uploads;
 
 	} _rinfo;
 	
@@ -782,6 +808,8 @@ class RasterizerCitro3d : public Rasterizer {
 	
 	bool fragment_lighting;
 	bool draw_next_frame;
+	// The fence wait already began the citro3d frame
+	bool frame_begun;
 	
 	int last_light_id;
 	bool current_depth_test;
@@ -795,6 +823,7 @@ class RasterizerCitro3d : public Rasterizer {
 	Size2 camera_vp_size;
 	bool camera_ortho;
 	Plane camera_plane;
+	Vector<Plane> camera_planes;
 	
 	float canvas_opacity;
 	VS::MaterialBlendMode canvas_blend_mode;
@@ -806,27 +835,166 @@ class RasterizerCitro3d : public Rasterizer {
 	float scaled_time = 0.0;
 	int frame = 0;
 	
-	struct Vertex {
-		Vector3 position;
-		Vector2 texcoord;
-// 		Color   color;
+	/************/
+	/* TEXTURES */
+	/************/
+
+	uint32_t texture_format_options;
+
+	// Replaced texture storage waits two frames like the vertex arenas
+	Vector<C3D_Tex> texture_free_queue[2];
+
+	bool _texture_init(Texture *p_texture, PicaTextureFormat p_format);
+	void _texture_release(Texture *p_texture);
+	void _texture_upload(Texture *p_texture, const Image &p_image);
+	bool _texture_upload_ctex(Texture *p_texture, const Image &p_image);
+	void _free_deferred(int p_index);
+
+	int _frame_begin_flags() const;
+	virtual void _frame_fence_wait(uint64_t p_serial);
+
+	/*****************/
+	/* MEMORY BUDGET */
+	/*****************/
+
+	struct MemoryBudgetBackend : public GPUMemoryBudget::Backend {
+		RasterizerCitro3d *rasterizer;
+		virtual bool budget_evict(GPUMemoryBudget::Item *p_item) { return rasterizer->_budget_evict(p_item); }
 	};
-	
-	struct VertexArray {
-		Vertex *vertices;
-// 		int count;
-		VertexArray(int vertexCount) {
-// 			count = vertexCount;
-			vertices = reinterpret_cast<Vertex*>(linearAlloc(sizeof(Vertex) * vertexCount));
-		}
-		~VertexArray() {
-			linearFree(vertices);
+
+	GPUMemoryBudget memory_budget;
+	MemoryBudgetBackend memory_budget_backend;
+	bool release_textures_on_suspend;
+
+	bool _budget_evict(GPUMemoryBudget::Item *p_item);
+	bool _texture_use(Texture *p_texture);
+
+	/*****************/
+	/* TEXTURE ATLAS */
+	/*****************/
+
+	struct TextureAtlasBackend : public TextureAtlas::Backend {
+		RasterizerCitro3d *rasterizer;
+		virtual bool atlas_page_alloc(TextureAtlas::Page *p_page) { return rasterizer->_atlas_page_alloc(p_page); }
+		virtual void atlas_page_free(TextureAtlas::Page *p_page) { rasterizer->_atlas_page_free(p_page); }
+		virtual void atlas_page_changed(TextureAtlas::Page *p_page) { rasterizer->_atlas_page_changed(p_page); }
+	};
+
+	// Small 2D textures share pages so the canvas can batch across them
+	TextureAtlas texture_atlas;
+	TextureAtlasBackend texture_atlas_backend;
+	bool texture_atlas_enabled;
+
+	bool _atlas_page_alloc(TextureAtlas::Page *p_page);
+	void _atlas_page_free(TextureAtlas::Page *p_page);
+	void _atlas_page_changed(TextureAtlas::Page *p_page);
+
+	bool _texture_can_atlas(const Texture *p_texture, PicaTextureFormat p_format) const;
+	TextureAtlas::Entry *_texture_atlas_reserve(Texture *p_texture, PicaTextureFormat p_format, int p_border);
+	void _texture_atlas_remove(Texture *p_texture);
+	void _texture_atlas_evict(Texture *p_texture);
+	const Texture *_canvas_texture_remap(Texture *p_texture, Rect2 &r_region, Size2 &r_tex_size);
+
+	/******************/
+	/* CANVAS BATCHES */
+	/******************/
+
+	enum {
+		CANVAS_VERTEX_ARENA_SIZE=256*1024,
+	};
+
+	struct CanvasBatchBackend : public CanvasBatcher::Backend {
+		RasterizerCitro3d *rasterizer;
+		virtual void canvas_batch_draw(const CanvasBatcher::State &p_state, const CanvasBatcher::Vertex *p_vertices, int p_quad_count) {
+			rasterizer->_canvas_batch_draw(p_state,p_vertices,p_quad_count);
 		}
 	};
+
+	CanvasBatcher canvas_batcher;
+	CanvasBatchBackend canvas_batch_backend;
+	u16 *canvas_batch_indices;
+
+	// Vertices are copied into a per-frame linear arena, double buffered
+	// so the GPU is never reading a region that is being rewritten.
+	u8 *canvas_vertex_arena[2];
+	int canvas_vertex_arena_used;
+	int canvas_vertex_arena_index;
+	Vector<void*> canvas_vertex_overflow[2];
+	int canvas_vertex_overflow_size[2];
+
+	int canvas_applied_blend_mode;
+	bool canvas_applied_clip;
+	Rect2 canvas_applied_clip_rect;
+
+	void *_canvas_alloc_vertices(int p_size);
+	void _canvas_apply_blend_mode(int p_mode);
+	void _canvas_batch_draw(const CanvasBatcher::State &p_state, const CanvasBatcher::Vertex *p_vertices, int p_quad_count);
+	void _canvas_batch_submit(const CanvasBatcher::State &p_state, const void *p_vertices, int p_quad_count, float p_scissor_scale=1.0);
+	void _canvas_batch_end();
+	void _canvas_bind_program();
+
+	/*************/
+	/* MULTIMESH */
+	/*************/
+
+	// Meshes up to this many vertices are pre-transformed into the frame arena
+	int multimesh_pretransform_max_vertices;
+	Vector<MultiMeshBatcher::Batch> multimesh_visible;
+
+	void _multimesh_update_batches(MultiMesh *p_multimesh, const AABB &p_mesh_aabb);
+	void _render_multimesh(const Surface *p_surface, const MultiMesh *p_multimesh, const Transform &p_xform);
+
+	void _set_vertex_layout(const PicaVertexLayout &p_layout, const void *p_vertices);
+	void _draw_surface(const Surface *p_surface, const PicaVertexLayout &p_layout, const void *p_indices, int p_instances=1);
+
+	/***********/
+	/* SCREENS */
+	/***********/
+
+	enum {
+		SCREEN_TOP,
+		SCREEN_BOTTOM,
+		SCREEN_MAX,
+	};
+
+	// base_framebuffer is the framebuffer of current_screen. The bottom one
+	// is created the first time something is drawn there, at native
+	// resolution, and keeps its image on frames the screen is skipped.
+	RenderTarget *screen_framebuffers[SCREEN_MAX];
+	int current_screen;
+
+	/**********/
+	/* STEREO */
+	/**********/
+
+	enum {
+		STEREO_TARGET_WIDTH=240,
+		STEREO_TARGET_HEIGHT=400,
+	};
+
+	// The right eye uses the supersampled base framebuffer and the left eye
+	// a native resolution target, VRAM has no room for two supersampled
+	// ones. Canvas batches drawn to the screen are recorded and replayed on
+	// the left target, their vertices stay valid in the frame arena.
+	struct StereoCanvasBatch {
+		CanvasBatcher::State state;
+		const void *vertices;
+		int quad_count;
+	};
+
+	C3D_RenderTarget *stereo_target;
+	float stereo_eye_separation; // at full slider
+	float stereo_convergence;
+	float stereo_depth; // 3D slider position, read once per frame
+	bool stereo_scene;
+	CameraMatrix stereo_projection[2];
+	Vector<StereoCanvasBatch> stereo_canvas_batches;
+	VS::ViewportRect current_viewport;
+
+	bool _stereo_active() const;
+	void _stereo_canvas_replay();
 	
-	Vector<VertexArray*> vertexArrays;
-	
-	Error _surface_set_arrays(Surface *p_surface, uint8_t *p_mem,uint8_t *p_index_mem,const Array& p_arrays,bool p_main);
+	void _surface_free(Surface *p_surface);
 	
 	bool _setup_material(const Geometry *p_geometry, const Material *p_material, bool p_no_const_light, bool p_opaque_pass);
 // 	void _setup_skeleton(const Skeleton *p_skeleton);
@@ -839,15 +1007,13 @@ class RasterizerCitro3d : public Rasterizer {
 	void _set_uniform(int uniform_location, const Transform& p_transform);
 	void _set_uniform(int uniform_location, const CameraMatrix& p_matrix);
 	
-	void _set_canvas_scissor(CanvasItem* p_item);
+	Rect2 _get_canvas_scissor(CanvasItem* p_item) const;
 	Texture *_bind_texture(const RID& p_texture);
 	
 	void _add_geometry( const Geometry* p_geometry, const InstanceData *p_instance, const Geometry *p_geometry_cmp, const GeometryOwner *p_owner,int p_material=-1);
 	
 	void _render_list_forward(RenderList *p_render_list,const Transform& p_view_transform,const Transform& p_view_transform_inverse, const CameraMatrix& p_projection,bool p_reverse_cull=false,bool p_fragment_light=false,bool p_alpha_pass=false);
 	
-	void _draw_quad(const Rect2& p_rect);
-	void _draw_textured_quad(const Rect2& p_rect, const Rect2& p_src_region, const Size2& p_tex_size,bool p_h_flip=false, bool p_v_flip=false, bool p_transpose=false);
 	
 	template<bool use_normalmap>
 	_FORCE_INLINE_ void _canvas_item_render_commands(CanvasItem *p_item,CanvasItem *current_clip,bool &reclip);
@@ -1132,6 +1298,7 @@ public:
 	virtual void begin_frame();
 
 	virtual void set_viewport(const VS::ViewportRect& p_viewport);
+	virtual void set_screen(int p_screen);
 	virtual void set_time_scale(float p_scale);
 	virtual void set_render_target(RID p_render_target,bool p_transparent_bg=false,bool p_vflip=false);
 	virtual void clear_viewport(const Color& p_color);
@@ -1143,6 +1310,10 @@ public:
 
 	virtual void set_camera(const Transform& p_world,const CameraMatrix& p_projection,bool p_ortho_hint);
 
+	virtual float get_stereo_eye_separation() const;
+	virtual float get_stereo_convergence() const;
+	virtual void set_stereo_camera(const CameraMatrix &p_left_projection, const CameraMatrix &p_right_projection);
+
 	virtual void add_light( RID p_light_instance ); ///< all "add_light" calls happen before add_geometry calls
 
 
@@ -1240,6 +1411,8 @@ public:
 
 	virtual bool needs_to_draw_next_frame() const;
 
+	virtual void suspend(bool p_release_vram);
+
 	virtual bool has_feature(VS::Features p_feature) const;
 
 	virtual void restore_framebuffer();
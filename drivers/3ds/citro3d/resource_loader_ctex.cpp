@@ -0,0 +1,88 @@
+/*************************************************************************/
+/*  resource_loader_ctex.cpp                                             */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                    http://www.godotengine.org                         */
+/*************************************************************************/
+/* Copyright (c) 2007-2016 Juan Linietsky, Ariel Manzur.                 */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+#include "resource_loader_ctex.h"
+#include "texture_ctex.h"
+
+#include "os/file_access.h"
+#include "scene/resources/texture.h"
+
+RES ResourceFormatLoaderCTex::load(const String &p_path, const String &p_original_path, Error *r_error)
+{
+	if (r_error)
+		*r_error = ERR_CANT_OPEN;
+
+	Error err;
+	FileAccess *f = FileAccess::open(p_path, FileAccess::READ, &err);
+	ERR_FAIL_COND_V(err, RES());
+
+	DVector<uint8_t> data;
+	data.resize(f->get_len());
+	{
+		DVector<uint8_t>::Write w = data.write();
+		f->get_buffer(w.ptr(), data.size());
+	}
+	memdelete(f);
+
+	if (r_error)
+		*r_error = ERR_FILE_CORRUPT;
+
+	CTexHeader header;
+	{
+		DVector<uint8_t>::Read r = data.read();
+		ERR_EXPLAIN("Invalid pre-tiled texture: " + p_path);
+		ERR_FAIL_COND_V(ctex_decode_header(r.ptr(), data.size(), header) != OK, RES());
+	}
+
+	// The rasterizer takes the file as is and copies the texels
+	Ref<ImageTexture> texture = memnew(ImageTexture);
+	texture->create_from_image(Image(header.width, header.height, 0, Image::FORMAT_CUSTOM, data), header.flags);
+	texture->set_name(p_path.get_file());
+
+	if (r_error)
+		*r_error = OK;
+
+	return texture;
+}
+
+void ResourceFormatLoaderCTex::get_recognized_extensions(List<String> *p_extensions) const
+{
+	p_extensions->push_back("ctex");
+}
+
+bool ResourceFormatLoaderCTex::handles_type(const String &p_type) const
+{
+	return ObjectTypeDB::is_type(p_type, "Texture");
+}
+
+String ResourceFormatLoaderCTex::get_resource_type(const String &p_path) const
+{
+	if (p_path.extension().to_lower() == "ctex")
+		return "ImageTexture";
+	return "";
+}
@@ -0,0 +1,376 @@
+/*************************************************************************/
+/*  texture_atlas.cpp                                                    */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                    http://www.godotengine.org                         */
+/*************************************************************************/
+/* Copyright (c) 2007-2016 Juan Linietsky, Ariel Manzur.                 */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+#include "texture_atlas.h"
+#include "geometry.h"
+#include "texture_tiler.h"
+
+static _FORCE_INLINE_ int _align_tile(int p_size)
+{
+	return (p_size + TextureAtlas::TILE_SIZE - 1) & ~(TextureAtlas::TILE_SIZE - 1);
+}
+
+// Copies a block of whole tiles between two tiled surfaces. Positions are
+// in texels from the top left, tile rows are stored bottom to top.
+static void _copy_tile_block(uint8_t *p_dst, int p_dst_width, int p_dst_height, const Point2i &p_dst_pos, const uint8_t *p_src, int p_src_width, int p_src_height, const Point2i &p_src_pos, const Size2i &p_size, int p_bits_per_pixel)
+{
+	const int T = TextureAtlas::TILE_SIZE;
+	int tile_bytes = T * T * p_bits_per_pixel / 8;
+	int row_bytes = (p_size.width / T) * tile_bytes;
+
+	for (int j = 0; j < p_size.height / T; j++) {
+
+		int src_row = p_src_height / T - 1 - (p_src_pos.y / T + j);
+		int dst_row = p_dst_height / T - 1 - (p_dst_pos.y / T + j);
+		const uint8_t *src = p_src + (src_row * (p_src_width / T) + p_src_pos.x / T) * tile_bytes;
+		uint8_t *dst = p_dst + (dst_row * (p_dst_width / T) + p_dst_pos.x / T) * tile_bytes;
+		memcpy(dst, src, row_bytes);
+	}
+}
+
+Size2i TextureAtlas::Entry::get_cell_size() const
+{
+	return Size2i(_align_tile(width + border * 2), _align_tile(height + border * 2));
+}
+
+bool TextureAtlas::can_store(int p_width, int p_height, PicaTextureFormat p_format)
+{
+	if (p_format < 0 || p_format >= PICA_TEXTURE_MAX || pica_texture_format_is_etc(p_format))
+		return false;
+
+	return p_width > 0 && p_height > 0 && p_width <= MAX_ENTRY_SIZE && p_height <= MAX_ENTRY_SIZE;
+}
+
+void TextureAtlas::set_page_size(int p_size)
+{
+	ERR_FAIL_COND(p_size != PAGE_SIZE && p_size != PAGE_SIZE_LARGE);
+	// Existing pages keep their size
+	page_size = p_size;
+}
+
+bool TextureAtlas::_find_free(const Page *p_page, const Size2i &p_cell, Point2i &r_pos) const
+{
+	int cols = p_page->skyline.size();
+	int cw = p_cell.width / TILE_SIZE;
+	int best_y = p_page->size - p_cell.height + 1;
+
+	// Lowest spot on the skyline, leftmost on ties
+	for (int c = 0; c + cw <= cols; c++) {
+
+		int y = 0;
+		for (int i = 0; i < cw; i++)
+			y = MAX(y, p_page->skyline[c + i]);
+
+		if (y < best_y) {
+			best_y = y;
+			r_pos = Point2i(c * TILE_SIZE, y);
+		}
+	}
+
+	return best_y + p_cell.height <= p_page->size;
+}
+
+bool TextureAtlas::_layout(const Page *p_page, const Size2i &p_cell, Vector<Point2i> &r_positions) const
+{
+	Vector<Size2i> cells;
+	for (int i = 0; i < p_page->entries.size(); i++)
+		cells.push_back(p_page->entries[i]->get_cell_size());
+	cells.push_back(p_cell);
+
+	Size2i size;
+	Geometry::make_atlas(cells, r_positions, size);
+	return size.width <= p_page->size && size.height <= p_page->size;
+}
+
+void TextureAtlas::_update_skyline(Page *p_page)
+{
+	p_page->skyline.resize(p_page->size / TILE_SIZE);
+	for (int i = 0; i < p_page->skyline.size(); i++)
+		p_page->skyline[i] = 0;
+
+	for (int i = 0; i < p_page->entries.size(); i++) {
+
+		const Entry *e = p_page->entries[i];
+		Size2i cell = e->get_cell_size();
+		int bottom = e->cell_pos.y + cell.height;
+		for (int c = e->cell_pos.x / TILE_SIZE; c < (e->cell_pos.x + cell.width) / TILE_SIZE; c++)
+			p_page->skyline[c] = MAX(p_page->skyline[c], bottom);
+	}
+}
+
+bool TextureAtlas::_store_in_page(Page *p_page, Entry *p_entry, const Vector<Point2i> &p_positions)
+{
+	ERR_FAIL_COND_V(p_positions.size() != p_page->entries.size() + 1, false);
+
+	bool moved = false;
+	for (int i = 0; i < p_page->entries.size(); i++) {
+		if (p_page->entries[i]->cell_pos != p_positions[i]) {
+			moved = true;
+			break;
+		}
+	}
+
+	if (moved) {
+
+		// The GPU may still be sampling the old layout, repack into new storage
+		Page next = *p_page;
+		next.data = NULL;
+		next.userdata = NULL;
+		if (!backend->atlas_page_alloc(&next))
+			return false;
+
+		int bpp = pica_texture_format_get_bits_per_pixel(p_page->format);
+		for (int i = 0; i < p_page->entries.size(); i++) {
+			Entry *e = p_page->entries[i];
+			_copy_tile_block((uint8_t *)next.data, p_page->size, p_page->size, p_positions[i], (const uint8_t *)p_page->data, p_page->size, p_page->size, e->cell_pos, e->get_cell_size(), bpp);
+			e->cell_pos = p_positions[i];
+		}
+
+		backend->atlas_page_free(p_page);
+		p_page->data = next.data;
+		p_page->userdata = next.userdata;
+		repack_count++;
+		backend->atlas_page_changed(p_page);
+	}
+
+	p_entry->page = p_page;
+	p_entry->cell_pos = p_positions[p_positions.size() - 1];
+	p_page->entries.push_back(p_entry);
+	p_page->used_area += p_entry->width * p_entry->height;
+	_update_skyline(p_page);
+	return true;
+}
+
+TextureAtlas::Entry *TextureAtlas::add(int p_width, int p_height, PicaTextureFormat p_format, int p_border)
+{
+	ERR_FAIL_COND_V(!backend, NULL);
+	ERR_FAIL_COND_V(!can_store(p_width, p_height, p_format), NULL);
+	ERR_FAIL_COND_V(p_border < 0 || p_border >= TILE_SIZE, NULL);
+
+	Entry *entry = memnew(Entry);
+	entry->width = p_width;
+	entry->height = p_height;
+	entry->border = p_border;
+	Size2i cell = entry->get_cell_size();
+
+	// Free space first, existing cells stay where they are
+	Vector<Point2i> positions;
+	for (int i = 0; i < pages.size(); i++) {
+
+		Page *page = pages[i];
+		Point2i pos;
+		if (page->format != p_format || !_find_free(page, cell, pos))
+			continue;
+
+		for (int j = 0; j < page->entries.size(); j++)
+			positions.push_back(page->entries[j]->cell_pos);
+		positions.push_back(pos);
+		_store_in_page(page, entry, positions);
+		return entry;
+	}
+
+	// Then a fresh layout of a page, moving what is already there
+	for (int i = 0; i < pages.size(); i++) {
+
+		Page *page = pages[i];
+		if (page->format != p_format || !_layout(page, cell, positions))
+			continue;
+		if (_store_in_page(page, entry, positions))
+			return entry;
+	}
+
+	Page *page = memnew(Page);
+	page->format = p_format;
+	page->size = page_size;
+	if (!backend->atlas_page_alloc(page)) {
+		memdelete(page);
+		memdelete(entry);
+		ERR_FAIL_V(NULL);
+	}
+	pages.push_back(page);
+	_update_skyline(page);
+
+	positions.clear();
+	positions.push_back(Point2i());
+	_store_in_page(page, entry, positions);
+	return entry;
+}
+
+void TextureAtlas::remove(Entry *p_entry)
+{
+	ERR_FAIL_COND(!p_entry || !p_entry->page);
+
+	// Leaves a hole, it is reclaimed the next time the page is repacked
+	Page *page = p_entry->page;
+	page->entries.erase(p_entry);
+	page->used_area -= p_entry->width * p_entry->height;
+	memdelete(p_entry);
+	_update_skyline(page);
+
+	if (page->entries.empty()) {
+		backend->atlas_page_free(page);
+		pages.erase(page);
+		memdelete(page);
+	}
+}
+
+Error TextureAtlas::set_image(Entry *p_entry, const Image &p_image)
+{
+	ERR_FAIL_COND_V(!p_entry || !p_entry->page, ERR_INVALID_PARAMETER);
+	ERR_FAIL_COND_V(p_image.get_width() != p_entry->width || p_image.get_height() != p_entry->height, ERR_INVALID_PARAMETER);
+	ERR_FAIL_COND_V(p_image.is_compressed() || p_image.get_format() >= Image::FORMAT_INDEXED, ERR_INVALID_PARAMETER);
+
+	int w = p_entry->width;
+	int h = p_entry->height;
+	int b = p_entry->border;
+	Size2i cell = p_entry->get_cell_size();
+	int ps = Image::get_format_pixel_size(p_image.get_format());
+	int pitch = cell.width * ps;
+
+	// Place the content inside the cell and extrude its edges into the border
+	DVector<uint8_t> cell_data;
+	cell_data.resize(cell.width * cell.height * ps);
+	{
+		DVector<uint8_t>::Write wr = cell_data.write();
+		DVector<uint8_t> src_data = p_image.get_data();
+		DVector<uint8_t>::Read rd = src_data.read();
+		uint8_t *dst = wr.ptr();
+		memset(dst, 0, cell_data.size());
+
+		for (int y = 0; y < h; y++) {
+			uint8_t *row = &dst[(y + b) * pitch];
+			memcpy(&row[b * ps], &rd[y * w * ps], w * ps);
+			for (int x = 0; x < b; x++) {
+				memcpy(&row[x * ps], &row[b * ps], ps);
+				memcpy(&row[(b + w + x) * ps], &row[(b + w - 1) * ps], ps);
+			}
+		}
+		for (int y = 0; y < b; y++) {
+			memcpy(&dst[y * pitch], &dst[b * pitch], pitch);
+			memcpy(&dst[(b + h + y) * pitch], &dst[(b + h - 1) * pitch], pitch);
+		}
+	}
+
+	Page *page = p_entry->page;
+	int size = pica_texture_format_get_size(page->format, cell.width, cell.height);
+	uint8_t *tiled = (uint8_t *)memalloc(size);
+	ERR_FAIL_COND_V(!tiled, ERR_OUT_OF_MEMORY);
+
+	Error err = pica_texture_convert(tiled, cell.width, cell.height, Image(cell.width, cell.height, 0, p_image.get_format(), cell_data), Image(), page->format);
+	if (err == OK) {
+		_copy_tile_block((uint8_t *)page->data, page->size, page->size, p_entry->cell_pos, tiled, cell.width, cell.height, Point2i(), cell, pica_texture_format_get_bits_per_pixel(page->format));
+		backend->atlas_page_changed(page);
+	}
+
+	memfree(tiled);
+	return err;
+}
+
+Error TextureAtlas::set_tiled(Entry *p_entry, const uint8_t *p_data, int p_tex_width, int p_tex_height)
+{
+	ERR_FAIL_COND_V(!p_entry || !p_entry->page || !p_data, ERR_INVALID_PARAMETER);
+	ERR_FAIL_COND_V((p_tex_width % TILE_SIZE) || (p_tex_height % TILE_SIZE), ERR_INVALID_PARAMETER);
+	ERR_FAIL_COND_V(p_entry->width > p_tex_width || p_entry->height > p_tex_height, ERR_INVALID_PARAMETER);
+
+	Page *page = p_entry->page;
+	int bpp = pica_texture_format_get_bits_per_pixel(page->format);
+	Size2i cell = p_entry->get_cell_size();
+
+	if (p_entry->border == 0) {
+
+		ERR_FAIL_COND_V(cell.width > p_tex_width || cell.height > p_tex_height, ERR_INVALID_PARAMETER);
+		_copy_tile_block((uint8_t *)page->data, page->size, page->size, p_entry->cell_pos, p_data, p_tex_width, p_tex_height, Point2i(), cell, bpp);
+
+	} else {
+
+		// The content has to shift by the border, which no longer lines up
+		// with the tiles: move texel by texel, clamping to extrude the edges
+		ERR_FAIL_COND_V(bpp % 8, ERR_INVALID_PARAMETER);
+		int ps = bpp / 8;
+		int b = p_entry->border;
+		uint8_t *dst = (uint8_t *)page->data;
+
+		for (int y = 0; y < p_entry->height + b * 2; y++) {
+			int sy = CLAMP(y - b, 0, p_entry->height - 1);
+			for (int x = 0; x < p_entry->width + b * 2; x++) {
+				int sx = CLAMP(x - b, 0, p_entry->width - 1);
+				const uint8_t *s = p_data + texture_tile_get_index(sx, sy, p_tex_width, p_tex_height) * ps;
+				uint8_t *d = dst + texture_tile_get_index(p_entry->cell_pos.x + x, p_entry->cell_pos.y + y, page->size, page->size) * ps;
+				memcpy(d, s, ps);
+			}
+		}
+	}
+
+	backend->atlas_page_changed(page);
+	return OK;
+}
+
+const TextureAtlas::Page *TextureAtlas::get_page(int p_index) const
+{
+	ERR_FAIL_INDEX_V(p_index, pages.size(), NULL);
+	return pages[p_index];
+}
+
+float TextureAtlas::get_efficiency() const
+{
+	int64_t used = 0;
+	int64_t total = 0;
+	for (int i = 0; i < pages.size(); i++) {
+		used += pages[i]->used_area;
+		total += pages[i]->size * pages[i]->size;
+	}
+
+	return total ? float(used) / float(total) : 0.0;
+}
+
+void TextureAtlas::clear()
+{
+	for (int i = 0; i < pages.size(); i++) {
+
+		Page *page = pages[i];
+		for (int j = 0; j < page->entries.size(); j++)
+			memdelete(page->entries[j]);
+		if (backend)
+			backend->atlas_page_free(page);
+		memdelete(page);
+	}
+
+	pages.clear();
+}
+
+TextureAtlas::TextureAtlas()
+{
+	backend = NULL;
+	page_size = PAGE_SIZE;
+	repack_count = 0;
+}
+
+TextureAtlas::~TextureAtlas()
+{
+	clear();
+}
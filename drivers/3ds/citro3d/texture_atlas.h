@@ -0,0 +1,152 @@
+/*************************************************************************/
+/*  texture_atlas.h                                                      */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                    http://www.godotengine.org                         */
+/*************************************************************************/
+/* Copyright (c) 2007-2016 Juan Linietsky, Ariel Manzur.                 */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+#ifndef TEXTURE_ATLAS_H
+#define TEXTURE_ATLAS_H
+
+#include "math_2d.h"
+#include "texture_format.h"
+
+/**
+	Packs small textures into shared square pages, so that canvas items
+	using different textures can still be drawn in a single batch and NPOT
+	textures stop wasting the padding up to the next power of two.
+
+	Every entry lives in a cell aligned to the 8x8 GPU tiles, so moving it
+	around is a matter of copying whole tiles. Entries get a one texel
+	border extruded from their edges to keep bilinear filtering from
+	bleeding into the neighbours. New cells go on top of a per page
+	skyline without touching the others; when that fails the page is
+	laid out again with Geometry::make_atlas, which also reclaims the
+	holes left by removed entries, and repacked into fresh storage.
+
+	Page storage is owned by a Backend, which for the rasterizer is a
+	citro3d texture. The packing and tile copies are plain CPU code so
+	they can be tested on the host.
+*/
+
+class TextureAtlas {
+public:
+	enum {
+		PAGE_SIZE = 512,
+		PAGE_SIZE_LARGE = 1024,
+		MAX_ENTRY_SIZE = 256,
+		TILE_SIZE = 8,
+	};
+
+	struct Entry;
+
+	struct Page {
+		PicaTextureFormat format;
+		int size;
+		void *data; // tiled size x size texels, filled by the backend
+		void *userdata; // backend handle
+		Vector<Entry *> entries;
+		Vector<int> skyline; // first free row of each column of tiles
+		int used_area;
+
+		Page() {
+			format = PICA_TEXTURE_RGBA8;
+			size = 0;
+			data = NULL;
+			userdata = NULL;
+			used_area = 0;
+		}
+	};
+
+	struct Entry {
+		Page *page;
+		int width, height; // content size
+		int border;
+		Point2i cell_pos; // top left of the cell inside the page, in texels
+
+		// Content rect inside the page, in texels
+		Rect2 get_rect() const { return Rect2(cell_pos.x + border, cell_pos.y + border, width, height); }
+		Size2i get_cell_size() const;
+
+		Entry() {
+			page = NULL;
+			width = height = border = 0;
+		}
+	};
+
+	class Backend {
+	public:
+		// Must set p_page->data (and optionally userdata) to zeroed storage
+		// for p_page->size x p_page->size texels in p_page->format.
+		virtual bool atlas_page_alloc(Page *p_page) = 0;
+		// Storage may still be in use by the GPU, the backend defers as needed
+		virtual void atlas_page_free(Page *p_page) = 0;
+		virtual void atlas_page_changed(Page *p_page) {}
+		virtual ~Backend() {}
+	};
+
+private:
+	Backend *backend;
+	int page_size;
+	Vector<Page *> pages;
+	int repack_count;
+
+	bool _find_free(const Page *p_page, const Size2i &p_cell, Point2i &r_pos) const;
+	bool _layout(const Page *p_page, const Size2i &p_cell, Vector<Point2i> &r_positions) const;
+	bool _store_in_page(Page *p_page, Entry *p_entry, const Vector<Point2i> &p_positions);
+	void _update_skyline(Page *p_page);
+
+public:
+	static bool can_store(int p_width, int p_height, PicaTextureFormat p_format);
+
+	void set_backend(Backend *p_backend) { backend = p_backend; }
+	void set_page_size(int p_size);
+	int get_page_size() const { return page_size; }
+
+	// Reserves a cell, existing entries on the same page may move. The
+	// content must be written with set_image() or set_tiled() afterwards.
+	Entry *add(int p_width, int p_height, PicaTextureFormat p_format, int p_border = 1);
+	void remove(Entry *p_entry);
+
+	// p_image must already be in a format pica_texture_convert() accepts
+	// for the page format, ETC is never atlased.
+	Error set_image(Entry *p_entry, const Image &p_image);
+	// Copies from already tiled data whose content starts at the top left
+	// texel, as stored in .ctex files. Formats below 8 bits per texel are
+	// only accepted without a border.
+	Error set_tiled(Entry *p_entry, const uint8_t *p_data, int p_tex_width, int p_tex_height);
+
+	int get_page_count() const { return pages.size(); }
+	const Page *get_page(int p_index) const;
+	int get_repack_count() const { return repack_count; }
+	// Content texels over page texels, 0..1
+	float get_efficiency() const;
+
+	void clear();
+
+	TextureAtlas();
+	~TextureAtlas();
+};
+
+#endif
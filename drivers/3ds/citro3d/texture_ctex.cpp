@@ -0,0 +1,98 @@
+/*************************************************************************/
+/*  texture_ctex.cpp                                                     */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                    http://www.godotengine.org                         */
+/*************************************************************************/
+/* Copyright (c) 2007-2016 Juan Linietsky, Ariel Manzur.                 */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+#include "texture_ctex.h"
+
+#include "io/marshalls.h"
+
+#include <string.h>
+
+Error ctex_encode(const Image &p_image, uint32_t p_flags, uint32_t p_options, Vector<uint8_t> &r_data)
+{
+	ERR_FAIL_COND_V(p_image.empty(), ERR_INVALID_PARAMETER);
+
+	int w = p_image.get_width();
+	int h = p_image.get_height();
+	int tex_w = pica_texture_get_dimension(w);
+	int tex_h = pica_texture_get_dimension(h);
+	ERR_FAIL_COND_V(tex_w > PICA_TEXTURE_MAX_SIZE || tex_h > PICA_TEXTURE_MAX_SIZE, ERR_INVALID_PARAMETER);
+
+	Image image = p_image;
+	Image alpha;
+	PicaTextureFormat format = pica_texture_prepare(image, alpha, p_flags, p_options);
+	ERR_FAIL_COND_V(format == PICA_TEXTURE_MAX, ERR_INVALID_DATA);
+
+	int size = pica_texture_format_get_size(format, tex_w, tex_h);
+	r_data.resize(CTEX_HEADER_SIZE + size);
+
+	uint8_t *ptr = r_data.ptr();
+	memcpy(ptr, "CTEX", 4);
+	encode_uint32(CTEX_VERSION, ptr + 4);
+	encode_uint32(w, ptr + 8);
+	encode_uint32(h, ptr + 12);
+	encode_uint32(tex_w, ptr + 16);
+	encode_uint32(tex_h, ptr + 20);
+	encode_uint32(format, ptr + 24);
+	encode_uint32(p_flags, ptr + 28);
+	encode_uint32(size, ptr + 32);
+
+	// Texels outside the image stay transparent black
+	zeromem(ptr + CTEX_HEADER_SIZE, size);
+	return pica_texture_convert(ptr + CTEX_HEADER_SIZE, tex_w, tex_h, image, alpha, format);
+}
+
+Error ctex_decode_header(const uint8_t *p_data, int p_size, CTexHeader &r_header)
+{
+	ERR_FAIL_COND_V(p_size < CTEX_HEADER_SIZE, ERR_FILE_CORRUPT);
+	ERR_FAIL_COND_V(memcmp(p_data, "CTEX", 4) != 0, ERR_FILE_UNRECOGNIZED);
+
+	uint32_t version = decode_uint32(p_data + 4);
+	if (version != CTEX_VERSION) {
+		ERR_EXPLAIN("Unsupported .ctex version: " + itos(version));
+		ERR_FAIL_V(ERR_FILE_UNRECOGNIZED);
+	}
+
+	r_header.width = decode_uint32(p_data + 8);
+	r_header.height = decode_uint32(p_data + 12);
+	r_header.tex_width = decode_uint32(p_data + 16);
+	r_header.tex_height = decode_uint32(p_data + 20);
+	r_header.format = (PicaTextureFormat)decode_uint32(p_data + 24);
+	r_header.flags = decode_uint32(p_data + 28);
+	r_header.data_size = decode_uint32(p_data + 32);
+
+	ERR_FAIL_INDEX_V(r_header.format, PICA_TEXTURE_MAX, ERR_FILE_CORRUPT);
+	ERR_FAIL_COND_V(r_header.width <= 0 || r_header.width > r_header.tex_width, ERR_FILE_CORRUPT);
+	ERR_FAIL_COND_V(r_header.height <= 0 || r_header.height > r_header.tex_height, ERR_FILE_CORRUPT);
+	ERR_FAIL_COND_V(r_header.tex_width != pica_texture_get_dimension(r_header.tex_width), ERR_FILE_CORRUPT);
+	ERR_FAIL_COND_V(r_header.tex_height != pica_texture_get_dimension(r_header.tex_height), ERR_FILE_CORRUPT);
+	ERR_FAIL_COND_V(r_header.tex_width > PICA_TEXTURE_MAX_SIZE || r_header.tex_height > PICA_TEXTURE_MAX_SIZE, ERR_FILE_CORRUPT);
+	ERR_FAIL_COND_V(r_header.data_size != pica_texture_format_get_size(r_header.format, r_header.tex_width, r_header.tex_height), ERR_FILE_CORRUPT);
+	ERR_FAIL_COND_V(CTEX_HEADER_SIZE + r_header.data_size > p_size, ERR_FILE_CORRUPT);
+
+	return OK;
+}
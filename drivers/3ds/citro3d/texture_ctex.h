@@ -0,0 +1,64 @@
+/*************************************************************************/
+/*  texture_ctex.h                                                       */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                    http://www.godotengine.org                         */
+/*************************************************************************/
+/* Copyright (c) 2007-2016 Juan Linietsky, Ariel Manzur.                 */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+#ifndef TEXTURE_CTEX_H
+#define TEXTURE_CTEX_H
+
+#include "texture_format.h"
+#include "vector.h"
+
+/**
+	.ctex files hold a texture already converted to its PICA200 format and
+	tiled, written by the 3DS exporter so the device only has to copy it
+	into place. Layout, all fields little endian 32 bit:
+
+		"CTEX", version, width, height, GPU width, GPU height,
+		PicaTextureFormat, texture flags, data size, data
+
+	At runtime the whole file travels through an Image::FORMAT_CUSTOM
+	image, which the citro3d rasterizer recognizes.
+*/
+
+enum {
+	CTEX_VERSION = 1,
+	CTEX_HEADER_SIZE = 36,
+};
+
+struct CTexHeader {
+
+	int width, height;
+	int tex_width, tex_height;
+	PicaTextureFormat format;
+	uint32_t flags;
+	int data_size;
+};
+
+Error ctex_encode(const Image &p_image, uint32_t p_flags, uint32_t p_options, Vector<uint8_t> &r_data);
+Error ctex_decode_header(const uint8_t *p_data, int p_size, CTexHeader &r_header);
+
+#endif
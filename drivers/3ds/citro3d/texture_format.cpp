@@ -0,0 +1,519 @@
+/*************************************************************************/
+/*  texture_format.cpp                                                   */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                    http://www.godotengine.org                         */
+/*************************************************************************/
+/* Copyright (c) 2007-2016 Juan Linietsky, Ariel Manzur.                 */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+#include "texture_format.h"
+#include "texture_tiler.h"
+
+#include "error_macros.h"
+#include "globals.h"
+#include "os/memory.h"
+#include "servers/visual_server.h"
+
+#include <string.h>
+
+static const int format_bits[PICA_TEXTURE_MAX] = {
+	32, // RGBA8
+	24, // RGB8
+	16, // RGBA5551
+	16, // RGB565
+	16, // RGBA4
+	16, // LA8
+	16, // HILO8
+	8, // L8
+	8, // A8
+	8, // LA4
+	4, // L4
+	4, // A4
+	4, // ETC1
+	8, // ETC1A4
+};
+
+static const char *format_names[PICA_TEXTURE_MAX] = {
+	"RGBA8",
+	"RGB8",
+	"RGBA5551",
+	"RGB565",
+	"RGBA4",
+	"LA8",
+	"HILO8",
+	"L8",
+	"A8",
+	"LA4",
+	"L4",
+	"A4",
+	"ETC1",
+	"ETC1A4",
+};
+
+uint32_t pica_texture_get_project_options()
+{
+	uint32_t options = 0;
+	if (GLOBAL_DEF("rasterizer/3ds/compact_textures", true))
+		options |= PICA_TEXTURE_ALLOW_COMPACT;
+	if (GLOBAL_DEF("rasterizer/3ds/compress_textures", false))
+		options |= PICA_TEXTURE_ALLOW_ETC1;
+	return options;
+}
+
+PicaTextureFormat pica_texture_format_select(Image::Format p_format, uint32_t p_flags, Image::AlphaMode p_alpha, uint32_t p_options)
+{
+	if (p_flags & VS::TEXTURE_FLAG_VIDEO_SURFACE)
+		p_options &= ~PICA_TEXTURE_ALLOW_ETC1;
+
+	bool compact = p_options & PICA_TEXTURE_ALLOW_COMPACT;
+	bool etc1 = p_options & PICA_TEXTURE_ALLOW_ETC1;
+
+	switch (p_format) {
+		case Image::FORMAT_GRAYSCALE:
+			return PICA_TEXTURE_L8;
+		case Image::FORMAT_INTENSITY:
+			return PICA_TEXTURE_A8; // white with alpha, the color comes from the vertex
+		case Image::FORMAT_GRAYSCALE_ALPHA:
+			return PICA_TEXTURE_LA8;
+		case Image::FORMAT_ETC:
+			return PICA_TEXTURE_ETC1;
+		case Image::FORMAT_RGB:
+		case Image::FORMAT_INDEXED:
+		case Image::FORMAT_YUV_422:
+		case Image::FORMAT_YUV_444:
+			p_alpha = Image::ALPHA_NONE;
+			break;
+		default:
+			break; // RGBA, or decompressed to it
+	}
+
+	switch (p_alpha) {
+		case Image::ALPHA_NONE:
+			if (etc1)
+				return PICA_TEXTURE_ETC1;
+			return compact ? PICA_TEXTURE_RGB565 : PICA_TEXTURE_RGBA8;
+		case Image::ALPHA_BIT:
+			if (etc1)
+				return PICA_TEXTURE_ETC1A4;
+			return compact ? PICA_TEXTURE_RGBA5551 : PICA_TEXTURE_RGBA8;
+		default:
+			if (etc1)
+				return PICA_TEXTURE_ETC1A4;
+			return compact ? PICA_TEXTURE_RGBA4 : PICA_TEXTURE_RGBA8;
+	}
+}
+
+int pica_texture_format_get_bits_per_pixel(PicaTextureFormat p_format)
+{
+	ERR_FAIL_INDEX_V(p_format, PICA_TEXTURE_MAX, 0);
+	return format_bits[p_format];
+}
+
+int pica_texture_format_get_size(PicaTextureFormat p_format, int p_width, int p_height)
+{
+	return p_width * p_height * pica_texture_format_get_bits_per_pixel(p_format) / 8;
+}
+
+bool pica_texture_format_is_etc(PicaTextureFormat p_format)
+{
+	return p_format == PICA_TEXTURE_ETC1 || p_format == PICA_TEXTURE_ETC1A4;
+}
+
+bool pica_texture_format_is_alpha_only(PicaTextureFormat p_format)
+{
+	return p_format == PICA_TEXTURE_A8 || p_format == PICA_TEXTURE_A4;
+}
+
+const char *pica_texture_format_get_name(PicaTextureFormat p_format)
+{
+	ERR_FAIL_INDEX_V(p_format, PICA_TEXTURE_MAX, "");
+	return format_names[p_format];
+}
+
+/* CONVERSION */
+
+static void _pad_image(Image &p_image, int p_width, int p_height)
+{
+	if (p_image.get_width() == p_width && p_image.get_height() == p_height)
+		return;
+
+	Image padded(p_width, p_height, false, p_image.get_format());
+	padded.blit_rect(p_image, Rect2(0, 0, p_image.get_width(), p_image.get_height()), Point2());
+	p_image = padded;
+}
+
+PicaTextureFormat pica_texture_prepare(Image &r_image, Image &r_alpha, uint32_t p_flags, uint32_t p_options)
+{
+	r_alpha = Image();
+	ERR_FAIL_COND_V(r_image.empty(), PICA_TEXTURE_MAX);
+
+	if (r_image.is_compressed() && r_image.get_format() != Image::FORMAT_ETC)
+		r_image.decompress();
+
+	switch (r_image.get_format()) {
+		case Image::FORMAT_INDEXED:
+		case Image::FORMAT_YUV_422:
+		case Image::FORMAT_YUV_444: r_image.convert(Image::FORMAT_RGB); break;
+		case Image::FORMAT_INDEXED_ALPHA: r_image.convert(Image::FORMAT_RGBA); break;
+		default: break;
+	}
+	ERR_FAIL_COND_V(r_image.is_compressed() && r_image.get_format() != Image::FORMAT_ETC, PICA_TEXTURE_MAX);
+
+	Image::AlphaMode alpha = r_image.detect_alpha();
+	PicaTextureFormat format = pica_texture_format_select(r_image.get_format(), p_flags, alpha, p_options);
+	if (!pica_texture_format_is_etc(format) || r_image.get_format() == Image::FORMAT_ETC)
+		return format;
+
+	if (Image::_image_compress_etc_func) {
+
+		// The encoder wants power of two sizes, pad like the GPU texture
+		int w = pica_texture_get_dimension(r_image.get_width());
+		int h = pica_texture_get_dimension(r_image.get_height());
+
+		Image etc = r_image;
+		Image rgba;
+		if (format == PICA_TEXTURE_ETC1A4) {
+			rgba = r_image;
+			rgba.convert(Image::FORMAT_RGBA);
+			_pad_image(rgba, w, h);
+			etc = rgba;
+		}
+
+		etc.convert(Image::FORMAT_RGB);
+		_pad_image(etc, w, h);
+		etc.compress(Image::COMPRESS_ETC);
+
+		if (etc.get_format() == Image::FORMAT_ETC) {
+			r_image = etc;
+			r_alpha = rgba;
+			return format;
+		}
+	}
+
+	// etc1 module not built, or it refused the image
+	return pica_texture_format_select(r_image.get_format(), p_flags, alpha, p_options & ~PICA_TEXTURE_ALLOW_ETC1);
+}
+
+Error pica_texture_convert(void *p_dst, int p_dst_width, int p_dst_height, const Image &p_image, const Image &p_alpha, PicaTextureFormat p_format)
+{
+	ERR_FAIL_INDEX_V(p_format, PICA_TEXTURE_MAX, ERR_INVALID_PARAMETER);
+
+	int w = p_image.get_width();
+	int h = p_image.get_height();
+	ERR_FAIL_COND_V(w > p_dst_width || h > p_dst_height, ERR_INVALID_PARAMETER);
+
+	DVector<uint8_t> data = p_image.get_data();
+	DVector<uint8_t>::Read r = data.read();
+
+	if (pica_texture_format_is_etc(p_format)) {
+
+		ERR_FAIL_COND_V(p_image.get_format() != Image::FORMAT_ETC, ERR_INVALID_PARAMETER);
+		ERR_FAIL_COND_V((w & 3) || (h & 3), ERR_INVALID_PARAMETER);
+
+		DVector<uint8_t> alpha = p_alpha.get_data();
+		DVector<uint8_t>::Read ra = alpha.read();
+		if (p_format == PICA_TEXTURE_ETC1A4) {
+			ERR_FAIL_COND_V(p_alpha.get_format() != Image::FORMAT_RGBA, ERR_INVALID_PARAMETER);
+			ERR_FAIL_COND_V(p_alpha.get_width() != w || p_alpha.get_height() != h, ERR_INVALID_PARAMETER);
+		}
+
+		// Only the top level is uploaded, mipmaps are not used yet
+		pica_texture_tile_etc1(p_dst, p_dst_width, p_dst_height, r.ptr(), p_format == PICA_TEXTURE_ETC1A4 ? ra.ptr() : NULL, w, h);
+		return OK;
+	}
+
+	ERR_FAIL_COND_V(p_image.is_compressed() || p_image.get_format() >= Image::FORMAT_INDEXED, ERR_INVALID_PARAMETER);
+
+	if (p_format == PICA_TEXTURE_RGBA8 && p_image.get_format() == Image::FORMAT_RGBA) {
+		texture_tile(p_dst, p_dst_width, p_dst_height, r.ptr(), w, h, 4, true);
+		return OK;
+	}
+
+	int pixel_size = pica_texture_format_get_bits_per_pixel(p_format) / 8;
+	ERR_FAIL_COND_V(pixel_size != 1 && pixel_size != 2 && pixel_size != 4, ERR_INVALID_PARAMETER);
+
+	uint8_t *pixels = (uint8_t *)memalloc(w * h * pixel_size);
+	ERR_FAIL_COND_V(!pixels, ERR_OUT_OF_MEMORY);
+
+	pica_texture_encode(pixels, p_format, r.ptr(), Image::get_format_pixel_size(p_image.get_format()), w * h);
+	texture_tile(p_dst, p_dst_width, p_dst_height, pixels, w, h, pixel_size);
+	memfree(pixels);
+	return OK;
+}
+
+/* PIXEL PACKING */
+
+template <int channels>
+static _FORCE_INLINE_ void _read_rgba(const uint8_t *p_src, uint8_t &r, uint8_t &g, uint8_t &b, uint8_t &a)
+{
+	switch (channels) {
+		case 1: r = g = b = a = p_src[0]; break;
+		case 2: r = g = b = p_src[0]; a = p_src[1]; break;
+		case 3: r = p_src[0]; g = p_src[1]; b = p_src[2]; a = 255; break;
+		default: r = p_src[0]; g = p_src[1]; b = p_src[2]; a = p_src[3]; break;
+	}
+}
+
+template <int channels>
+static void _encode(uint8_t *p_dst, PicaTextureFormat p_format, const uint8_t *p_src, int p_pixel_count)
+{
+	uint16_t *dst16 = (uint16_t *)p_dst;
+	uint8_t r, g, b, a;
+
+	switch (p_format) {
+		case PICA_TEXTURE_RGBA8: {
+			for (int i = 0; i < p_pixel_count; i++, p_src += channels) {
+				_read_rgba<channels>(p_src, r, g, b, a);
+				p_dst[i * 4 + 0] = a;
+				p_dst[i * 4 + 1] = b;
+				p_dst[i * 4 + 2] = g;
+				p_dst[i * 4 + 3] = r;
+			}
+		} break;
+		case PICA_TEXTURE_RGB8: {
+			for (int i = 0; i < p_pixel_count; i++, p_src += channels) {
+				_read_rgba<channels>(p_src, r, g, b, a);
+				p_dst[i * 3 + 0] = b;
+				p_dst[i * 3 + 1] = g;
+				p_dst[i * 3 + 2] = r;
+			}
+		} break;
+		case PICA_TEXTURE_RGBA5551: {
+			for (int i = 0; i < p_pixel_count; i++, p_src += channels) {
+				_read_rgba<channels>(p_src, r, g, b, a);
+				dst16[i] = ((r >> 3) << 11) | ((g >> 3) << 6) | ((b >> 3) << 1) | (a >> 7);
+			}
+		} break;
+		case PICA_TEXTURE_RGB565: {
+			for (int i = 0; i < p_pixel_count; i++, p_src += channels) {
+				_read_rgba<channels>(p_src, r, g, b, a);
+				dst16[i] = ((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3);
+			}
+		} break;
+		case PICA_TEXTURE_RGBA4: {
+			for (int i = 0; i < p_pixel_count; i++, p_src += channels) {
+				_read_rgba<channels>(p_src, r, g, b, a);
+				dst16[i] = ((r >> 4) << 12) | ((g >> 4) << 8) | ((b >> 4) << 4) | (a >> 4);
+			}
+		} break;
+		case PICA_TEXTURE_LA8: {
+			for (int i = 0; i < p_pixel_count; i++, p_src += channels) {
+				_read_rgba<channels>(p_src, r, g, b, a);
+				dst16[i] = (r << 8) | a;
+			}
+		} break;
+		case PICA_TEXTURE_L8: {
+			for (int i = 0; i < p_pixel_count; i++, p_src += channels) {
+				_read_rgba<channels>(p_src, r, g, b, a);
+				p_dst[i] = r;
+			}
+		} break;
+		case PICA_TEXTURE_A8: {
+			for (int i = 0; i < p_pixel_count; i++, p_src += channels) {
+				_read_rgba<channels>(p_src, r, g, b, a);
+				p_dst[i] = a;
+			}
+		} break;
+		case PICA_TEXTURE_LA4: {
+			for (int i = 0; i < p_pixel_count; i++, p_src += channels) {
+				_read_rgba<channels>(p_src, r, g, b, a);
+				p_dst[i] = (r & 0xF0) | (a >> 4);
+			}
+		} break;
+		default: {
+			ERR_EXPLAIN(String("Can't pack pixels into ") + pica_texture_format_get_name(p_format));
+			ERR_FAIL();
+		}
+	}
+}
+
+void pica_texture_encode(void *p_dst, PicaTextureFormat p_format, const uint8_t *p_src, int p_src_channels, int p_pixel_count)
+{
+	switch (p_src_channels) {
+		case 1: _encode<1>((uint8_t *)p_dst, p_format, p_src, p_pixel_count); break;
+		case 2: _encode<2>((uint8_t *)p_dst, p_format, p_src, p_pixel_count); break;
+		case 3: _encode<3>((uint8_t *)p_dst, p_format, p_src, p_pixel_count); break;
+		case 4: _encode<4>((uint8_t *)p_dst, p_format, p_src, p_pixel_count); break;
+		default: {
+			ERR_EXPLAIN("Unsupported channel count: " + itos(p_src_channels));
+			ERR_FAIL();
+		}
+	}
+}
+
+/* ETC1 */
+
+static const int etc1_modifiers[8][2] = {
+	{ 2, 8 },
+	{ 5, 17 },
+	{ 9, 29 },
+	{ 13, 42 },
+	{ 18, 60 },
+	{ 24, 80 },
+	{ 33, 106 },
+	{ 47, 183 },
+};
+
+// Reverses the 4 bits of a nibble, i.e. the y order of one pixel column
+static const uint8_t nibble_reverse[16] = {
+	0x0, 0x8, 0x4, 0xC, 0x2, 0xA, 0x6, 0xE, 0x1, 0x9, 0x5, 0xD, 0x3, 0xB, 0x7, 0xF
+};
+
+static _FORCE_INLINE_ int _etc1_delta(uint8_t p_byte)
+{
+	int d = p_byte & 7;
+	return d >= 4 ? d - 8 : d;
+}
+
+static _FORCE_INLINE_ int _etc1_expand5(int p_c)
+{
+	return (p_c << 3) | (p_c >> 2);
+}
+
+void pica_etc1_block_flip(uint8_t *p_block)
+{
+	// Pixel indices are stored column major, x * 4 + y, so flipping is a
+	// bit reversal inside every nibble of both index planes
+	for (int i = 4; i < 8; i++)
+		p_block[i] = (nibble_reverse[p_block[i] >> 4] << 4) | nibble_reverse[p_block[i] & 0xF];
+
+	if (!(p_block[3] & 1))
+		return; // side by side sub-blocks stay where they are
+
+	// Top and bottom sub-blocks swap places
+	uint8_t tables = ((p_block[3] >> 3) & 0x1C) | ((p_block[3] << 3) & 0xE0);
+
+	if (!(p_block[3] & 2)) {
+		for (int i = 0; i < 3; i++)
+			p_block[i] = (p_block[i] << 4) | (p_block[i] >> 4);
+		p_block[3] = tables | (p_block[3] & 3);
+		return;
+	}
+
+	bool fits = true;
+	for (int i = 0; i < 3; i++)
+		fits = fits && _etc1_delta(p_block[i]) != -4;
+
+	if (fits) {
+		// Differential mode, the second color becomes the base
+		for (int i = 0; i < 3; i++) {
+			int base = p_block[i] >> 3;
+			int delta = _etc1_delta(p_block[i]);
+			p_block[i] = ((base + delta) << 3) | (-delta & 7);
+		}
+		p_block[3] = tables | (p_block[3] & 3);
+	} else {
+		// A delta of -4 can't be negated, fall back to individual mode
+		// and round both colors to 4 bits
+		for (int i = 0; i < 3; i++) {
+			int c1 = _etc1_expand5(p_block[i] >> 3);
+			int c2 = _etc1_expand5((p_block[i] >> 3) + _etc1_delta(p_block[i]));
+			p_block[i] = (((c2 + 8) / 17) << 4) | ((c1 + 8) / 17);
+		}
+		p_block[3] = tables | 1;
+	}
+}
+
+void pica_etc1_block_decode(const uint8_t *p_block, uint8_t *r_rgb)
+{
+	bool diff = p_block[3] & 2;
+	bool flip = p_block[3] & 1;
+	int tables[2] = { p_block[3] >> 5, (p_block[3] >> 2) & 7 };
+	int colors[2][3];
+
+	for (int i = 0; i < 3; i++) {
+		if (diff) {
+			int c = p_block[i] >> 3;
+			colors[0][i] = _etc1_expand5(c);
+			colors[1][i] = _etc1_expand5((c + _etc1_delta(p_block[i])) & 0x1F);
+		} else {
+			colors[0][i] = (p_block[i] >> 4) * 17;
+			colors[1][i] = (p_block[i] & 0xF) * 17;
+		}
+	}
+
+	int msb = (p_block[4] << 8) | p_block[5];
+	int lsb = (p_block[6] << 8) | p_block[7];
+
+	for (int y = 0; y < 4; y++) {
+		for (int x = 0; x < 4; x++) {
+			int bit = x * 4 + y;
+			int sub = flip ? (y >= 2) : (x >= 2);
+			int mod = etc1_modifiers[tables[sub]][(lsb >> bit) & 1];
+			if ((msb >> bit) & 1)
+				mod = -mod;
+
+			uint8_t *dst = r_rgb + (y * 4 + x) * 3;
+			for (int i = 0; i < 3; i++)
+				dst[i] = CLAMP(colors[sub][i] + mod, 0, 255);
+		}
+	}
+}
+
+void pica_texture_tile_etc1(void *p_dst, int p_dst_width, int p_dst_height, const uint8_t *p_blocks, const uint8_t *p_rgba, int p_width, int p_height)
+{
+	ERR_FAIL_COND((p_dst_width & 7) || (p_dst_height & 7));
+	ERR_FAIL_COND((p_width & 3) || (p_height & 3));
+	ERR_FAIL_COND(p_width > p_dst_width || p_height > p_dst_height);
+
+	int block_size = p_rgba ? 16 : 8;
+	int blocks_w = p_width / 4;
+	int blocks_h = p_height / 4;
+	int dst_blocks_h = p_dst_height / 4;
+	int dst_tiles_w = p_dst_width / 8;
+	uint8_t *dst = (uint8_t *)p_dst;
+
+	for (int by = 0; by < blocks_h; by++) {
+
+		// Rows are flipped like texture_tile() does, block by block
+		int dst_by = dst_blocks_h - 1 - by;
+
+		for (int bx = 0; bx < blocks_w; bx++) {
+
+			int tile = (dst_by >> 1) * dst_tiles_w + (bx >> 1);
+			int sub = (bx & 1) | ((dst_by & 1) << 1);
+			uint8_t *out = dst + (tile * 4 + sub) * block_size;
+
+			if (p_rgba) {
+				uint64_t alpha = 0;
+				for (int x = 0; x < 4; x++) {
+					for (int y = 0; y < 4; y++) {
+						int src_ofs = ((by * 4 + 3 - y) * p_width + bx * 4 + x) * 4 + 3;
+						alpha |= uint64_t(p_rgba[src_ofs] >> 4) << ((x * 4 + y) * 4);
+					}
+				}
+				for (int i = 0; i < 8; i++)
+					out[i] = (alpha >> (i * 8)) & 0xFF;
+				out += 8;
+			}
+
+			uint8_t block[8];
+			memcpy(block, p_blocks + (by * blocks_w + bx) * 8, 8);
+			pica_etc1_block_flip(block);
+
+			// Stored as a little endian 64 bit word
+			for (int i = 0; i < 8; i++)
+				out[i] = block[7 - i];
+		}
+	}
+}
@@ -0,0 +1,137 @@
+/*************************************************************************/
+/*  texture_format.h                                                     */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                    http://www.godotengine.org                         */
+/*************************************************************************/
+/* Copyright (c) 2007-2016 Juan Linietsky, Ariel Manzur.                 */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+#ifndef TEXTURE_FORMAT_H
+#define TEXTURE_FORMAT_H
+
+#include "image.h"
+
+/**
+	Native PICA200 texture formats and the conversions needed to feed them
+	from Godot images. Values match GPU_TEXCOLOR so they can be passed to
+	citro3d with a plain cast, but nothing in here depends on libctru: the
+	selection, pixel packing and ETC1 block layout are host testable.
+
+	16 bit formats are written as native (little endian) shorts, 8 bit
+	formats as single bytes. The result is still linear, texture_tile()
+	moves it into the tiled layout.
+*/
+
+enum PicaTextureFormat {
+	PICA_TEXTURE_RGBA8,
+	PICA_TEXTURE_RGB8,
+	PICA_TEXTURE_RGBA5551,
+	PICA_TEXTURE_RGB565,
+	PICA_TEXTURE_RGBA4,
+	PICA_TEXTURE_LA8,
+	PICA_TEXTURE_HILO8,
+	PICA_TEXTURE_L8,
+	PICA_TEXTURE_A8,
+	PICA_TEXTURE_LA4,
+	PICA_TEXTURE_L4,
+	PICA_TEXTURE_A4,
+	PICA_TEXTURE_ETC1,
+	PICA_TEXTURE_ETC1A4,
+	PICA_TEXTURE_MAX
+};
+
+enum PicaTextureOptions {
+	PICA_TEXTURE_ALLOW_COMPACT = 1, // trade color depth for memory (RGB565, RGBA5551, RGBA4)
+	PICA_TEXTURE_ALLOW_ETC1 = 2, // compress RGB and RGBA images to ETC1 / ETC1A4 on upload
+};
+
+enum {
+	PICA_TEXTURE_MIN_SIZE = 8,
+	PICA_TEXTURE_MAX_SIZE = 1024,
+};
+
+// Options from the project settings, shared by the rasterizer and the exporter
+uint32_t pica_texture_get_project_options();
+
+// GPU side size for an image dimension: power of two, at least one tile
+static inline int pica_texture_get_dimension(int p_size)
+{
+	int size = next_power_of_2(p_size);
+	return size < PICA_TEXTURE_MIN_SIZE ? PICA_TEXTURE_MIN_SIZE : size;
+}
+
+/**
+	Picks the smallest format able to hold p_format. p_alpha is the result
+	of Image::detect_alpha(), pass ALPHA_BLEND when the content is not known
+	yet. Video surfaces are updated every frame and never get compressed.
+*/
+PicaTextureFormat pica_texture_format_select(Image::Format p_format, uint32_t p_flags, Image::AlphaMode p_alpha, uint32_t p_options);
+
+int pica_texture_format_get_bits_per_pixel(PicaTextureFormat p_format);
+int pica_texture_format_get_size(PicaTextureFormat p_format, int p_width, int p_height);
+bool pica_texture_format_is_etc(PicaTextureFormat p_format);
+bool pica_texture_format_is_alpha_only(PicaTextureFormat p_format);
+const char *pica_texture_format_get_name(PicaTextureFormat p_format);
+
+/**
+	Turns p_image into something pica_texture_convert() can upload and
+	returns the format it will be uploaded as, PICA_TEXTURE_MAX on error.
+	Compressed and paletted images are expanded, and if ETC1 was picked
+	for an uncompressed image it gets compressed through the etc1 module
+	(padded to the GPU size). r_alpha then holds the RGBA source for the
+	ETC1A4 alpha blocks. Without the etc1 module a plain format is used.
+*/
+PicaTextureFormat pica_texture_prepare(Image &r_image, Image &r_alpha, uint32_t p_flags, uint32_t p_options);
+
+/**
+	Writes a prepared image into p_dst in the tiled GPU layout. The
+	destination is p_dst_width x p_dst_height texels of p_format.
+*/
+Error pica_texture_convert(void *p_dst, int p_dst_width, int p_dst_height, const Image &p_image, const Image &p_alpha, PicaTextureFormat p_format);
+
+/**
+	Packs p_pixel_count pixels of 1 (L or A), 2 (LA), 3 (RGB) or 4 (RGBA)
+	channels into p_format. Missing alpha is treated as opaque, missing
+	color as white. ETC formats are not handled here.
+*/
+void pica_texture_encode(void *p_dst, PicaTextureFormat p_format, const uint8_t *p_src, int p_src_channels, int p_pixel_count);
+
+/**
+	Lays out ETC1 blocks (Image::FORMAT_ETC, 8 bytes per 4x4 block, rows
+	top to bottom) the way the PICA200 expects them: 8x8 tiles holding four
+	blocks in Z order, stored bottom to top, each block flipped vertically
+	and byte swapped. With p_rgba set, a 4 bit alpha block taken from those
+	pixels is written in front of every color block (ETC1A4).
+
+	p_width and p_height are the image size in pixels, multiples of 4 and
+	no larger than the destination.
+*/
+void pica_texture_tile_etc1(void *p_dst, int p_dst_width, int p_dst_height, const uint8_t *p_blocks, const uint8_t *p_rgba, int p_width, int p_height);
+
+// Flips a single ETC1 block (spec byte order) upside down, in place
+void pica_etc1_block_flip(uint8_t *p_block);
+
+// Decodes a single ETC1 block (spec byte order) into 4x4 RGB pixels, for tests
+void pica_etc1_block_decode(const uint8_t *p_block, uint8_t *r_rgb);
+
+#endif
@@ -0,0 +1,176 @@
+/*************************************************************************/
+/*  texture_tiler.cpp                                                    */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                    http://www.godotengine.org                         */
+/*************************************************************************/
+/* Copyright (c) 2007-2016 Juan Linietsky, Ariel Manzur.                 */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+#include "texture_tiler.h"
+
+#include "error_macros.h"
+#include "ustring.h"
+
+#include <string.h>
+
+// Grabbed from Citra Emulator (citra/src/video_core/utils.h)
+static _FORCE_INLINE_ uint32_t _morton_interleave(uint32_t x, uint32_t y)
+{
+	uint32_t i = (x & 7) | ((y & 7) << 8); // ---- -210
+	i = (i ^ (i << 2)) & 0x1313;      // ---2 --10
+	i = (i ^ (i << 1)) & 0x1515;      // ---2 -1-0
+	i = (i | (i >> 7)) & 0x3F;
+	return i;
+}
+
+// Morton offset of the pixel pairs (x, x+1) for even x inside a tile, row
+// index already flipped. Bit 0 of the Morton index is x&1, so both pixels
+// of a pair are always adjacent in the destination.
+static const uint8_t morton_pair_table[8][4] = {
+	{ 42, 46, 58, 62 },
+	{ 40, 44, 56, 60 },
+	{ 34, 38, 50, 54 },
+	{ 32, 36, 48, 52 },
+	{ 10, 14, 26, 30 },
+	{ 8, 12, 24, 28 },
+	{ 2, 6, 18, 22 },
+	{ 0, 4, 16, 20 },
+};
+
+template <class T>
+static _FORCE_INLINE_ T _swap_pixel(T p_pixel)
+{
+	return p_pixel;
+}
+
+template <>
+_FORCE_INLINE_ uint32_t _swap_pixel<uint32_t>(uint32_t p_pixel)
+{
+	return __builtin_bswap32(p_pixel);
+}
+
+template <class T, bool swap>
+static void _tile(T *p_dst, int p_dst_width, int p_dst_height, const T *p_src, int p_width, int p_height)
+{
+	int full_w = p_width & ~7;
+	int full_h = p_height & ~7;
+
+	for (int y0 = 0; y0 < p_height; y0 += 8) {
+
+		// Source rows y0..y0+7 all land in the same destination tile row
+		T *dst_row = p_dst + (p_dst_height - 8 - y0) * p_dst_width;
+
+		for (int x0 = 0; x0 < p_width; x0 += 8) {
+
+			T *tile = dst_row + x0 * 8;
+			const T *src = p_src + y0 * p_width + x0;
+
+			if (x0 < full_w && y0 < full_h) {
+
+				for (int y = 0; y < 8; y++) {
+					const uint8_t *ofs = morton_pair_table[y];
+					const T *s = src + y * p_width;
+
+					if (swap) {
+						tile[ofs[0]] = _swap_pixel(s[0]);
+						tile[ofs[0] + 1] = _swap_pixel(s[1]);
+						tile[ofs[1]] = _swap_pixel(s[2]);
+						tile[ofs[1] + 1] = _swap_pixel(s[3]);
+						tile[ofs[2]] = _swap_pixel(s[4]);
+						tile[ofs[2] + 1] = _swap_pixel(s[5]);
+						tile[ofs[3]] = _swap_pixel(s[6]);
+						tile[ofs[3] + 1] = _swap_pixel(s[7]);
+					} else {
+						// Pairs are contiguous on both sides, move two pixels at once
+						memcpy(&tile[ofs[0]], &s[0], sizeof(T) * 2);
+						memcpy(&tile[ofs[1]], &s[2], sizeof(T) * 2);
+						memcpy(&tile[ofs[2]], &s[4], sizeof(T) * 2);
+						memcpy(&tile[ofs[3]], &s[6], sizeof(T) * 2);
+					}
+				}
+
+			} else {
+
+				// Partial tile on the right or top edge
+				int w = MIN(8, p_width - x0);
+				int h = MIN(8, p_height - y0);
+				for (int y = 0; y < h; y++) {
+					const T *s = src + y * p_width;
+					for (int x = 0; x < w; x++) {
+						T v = s[x];
+						tile[_morton_interleave(x, 7 - y)] = swap ? _swap_pixel(v) : v;
+					}
+				}
+			}
+		}
+	}
+}
+
+void texture_tile(void *p_dst, int p_dst_width, int p_dst_height, const void *p_src, int p_width, int p_height, int p_pixel_size, bool p_swap)
+{
+	ERR_FAIL_COND((p_dst_width & 7) || (p_dst_height & 7));
+	ERR_FAIL_COND(p_width > p_dst_width || p_height > p_dst_height);
+
+	switch (p_pixel_size) {
+		case 4: {
+			if (p_swap)
+				_tile<uint32_t, true>((uint32_t *)p_dst, p_dst_width, p_dst_height, (const uint32_t *)p_src, p_width, p_height);
+			else
+				_tile<uint32_t, false>((uint32_t *)p_dst, p_dst_width, p_dst_height, (const uint32_t *)p_src, p_width, p_height);
+		} break;
+		case 2: {
+			_tile<uint16_t, false>((uint16_t *)p_dst, p_dst_width, p_dst_height, (const uint16_t *)p_src, p_width, p_height);
+		} break;
+		case 1: {
+			_tile<uint8_t, false>((uint8_t *)p_dst, p_dst_width, p_dst_height, (const uint8_t *)p_src, p_width, p_height);
+		} break;
+		default: {
+			ERR_EXPLAIN("Unsupported pixel size: " + itos(p_pixel_size));
+			ERR_FAIL();
+		}
+	}
+}
+
+uint32_t texture_tile_get_index(int p_x, int p_y, int p_width, int p_height)
+{
+	int dst_y = p_height - 1 - p_y;
+	uint32_t coarse_y = dst_y & ~7;
+	return _morton_interleave(p_x, dst_y) + (p_x & ~7) * 8 + coarse_y * p_width;
+}
+
+void texture_tile_reference(void *p_dst, int p_dst_width, int p_dst_height, const void *p_src, int p_width, int p_height, int p_pixel_size, bool p_swap)
+{
+	uint8_t *dst = (uint8_t *)p_dst;
+	const uint8_t *src = (const uint8_t *)p_src;
+
+	for (int y = 0; y < p_height; y++) {
+		for (int x = 0; x < p_width; x++) {
+			uint32_t ofs = texture_tile_get_index(x, y, p_dst_width, p_dst_height);
+
+			const uint8_t *s = src + (y * p_width + x) * p_pixel_size;
+			uint8_t *d = dst + ofs * p_pixel_size;
+			for (int i = 0; i < p_pixel_size; i++)
+				d[i] = p_swap ? s[p_pixel_size - 1 - i] : s[i];
+		}
+	}
+}
@@ -0,0 +1,59 @@
+/*************************************************************************/
+/*  texture_tiler.h                                                      */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                    http://www.godotengine.org                         */
+/*************************************************************************/
+/* Copyright (c) 2007-2016 Juan Linietsky, Ariel Manzur.                 */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+#ifndef TEXTURE_TILER_H
+#define TEXTURE_TILER_H
+
+#include "typedefs.h"
+
+/**
+	Converts linear images into the PICA200 tiled layout: 8x8 tiles stored
+	left to right, bottom to top, with Morton ordered pixels inside each
+	tile. The image is flipped vertically on the way, matching the UV
+	convention used by the rasterizer.
+
+	Pixels are moved as opaque 1, 2 or 4 byte units. p_swap asks 4 byte
+	pixels to be byte swapped, turning Image RGBA into the ABGR order the
+	GPU expects for GPU_RGBA8.
+
+	The destination must be p_dst_width x p_dst_height pixels, both
+	multiples of 8 and at least as large as the source. Parts of the
+	destination outside the source are left untouched.
+
+	Plain CPU code, so it can be tested and benchmarked on the host.
+*/
+
+void texture_tile(void *p_dst, int p_dst_width, int p_dst_height, const void *p_src, int p_width, int p_height, int p_pixel_size, bool p_swap = false);
+
+// Index of texel (p_x, p_y), counted from the top left, inside a tiled surface
+uint32_t texture_tile_get_index(int p_x, int p_y, int p_width, int p_height);
+
+// Straightforward per-pixel version, kept as the reference for tests
+void texture_tile_reference(void *p_dst, int p_dst_width, int p_dst_height, const void *p_src, int p_width, int p_height, int p_pixel_size, bool p_swap = false);
+
+#endif
@@ -29,6 +29,7 @@
 #ifdef _3DS
 
 #include "util.h"
+#include "texture_tiler.h"
 
 u32 next_pow2(u32 v)
 {
@@ -42,39 +43,9 @@ u32 next_pow2(u32 v)
 	return v >= TEX_MIN_SIZE ? v : TEX_MIN_SIZE;
 }
 
-// Grabbed from Citra Emulator (citra/src/video_core/utils.h)
-static inline u32 morton_interleave(u32 x, u32 y)
-{
-	u32 i = (x & 7) | ((y & 7) << 8); // ---- -210
-	i = (i ^ (i << 2)) & 0x1313;      // ---2 --10
-	i = (i ^ (i << 1)) & 0x1515;      // ---2 -1-0
-	i = (i | (	i >> 7)) & 0x3F;
-	return i;
-}
-
-//Grabbed from Citra Emulator (citra/src/video_core/utils.h)
-static inline u32 get_morton_offset(u32 x, u32 y, u32 bytes_per_pixel)
-{
-	u32 i = morton_interleave(x, y);
-	unsigned int offset = (x & ~7) * 8;
-	return (i + offset) * bytes_per_pixel;
-}
-
 void texture_tile_sw(C3D_Tex *tex, const void *data, int w, int h)
-{	
-	const u32* src = reinterpret_cast<const u32*>(data);
-	u32* dest = reinterpret_cast<u32*>(tex->data);
-	for (int y = 0; y < h; y++)
-		for (int x = 0; x < w; x++)
-		{
-			int dest_y = (tex->height - 1 - y);
-			u32 coarse_y = dest_y & ~7;
-			u32 dst_offset = get_morton_offset(x, dest_y, 1) + coarse_y * tex->width;
-
-			u32 v = src[x + y * w];
-			dest[dst_offset] = __builtin_bswap32(v);
-		}
-
+{
+	texture_tile(tex->data, tex->width, tex->height, data, w, h, 4, true);
 	C3D_TexFlush(tex);
 }
 
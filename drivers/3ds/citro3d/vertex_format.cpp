@@ -0,0 +1,253 @@
+/*************************************************************************/
+/*  vertex_format.cpp                                                    */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                    http://www.godotengine.org                         */
+/*************************************************************************/
+/* Copyright (c) 2007-2016 Juan Linietsky, Ariel Manzur.                 */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+#include "vertex_format.h"
+#include "servers/visual_server.h"
+
+static const int _attrib_type_size[] = { 1, 1, 2, 4 };
+
+int PicaVertexLayout::Attrib::get_size() const
+{
+	return _attrib_type_size[type] * count;
+}
+
+const PicaVertexLayout::Attrib *PicaVertexLayout::get_attrib(int p_array) const
+{
+	for (int i = 0; i < attrib_count; i++) {
+		if (attribs[i].array == p_array)
+			return &attribs[i];
+	}
+
+	return NULL;
+}
+
+void PicaVertexLayout::update_offsets()
+{
+	int offset = 0;
+	int align = 1;
+	for (int i = 0; i < attrib_count; i++) {
+		int size = _attrib_type_size[attribs[i].type];
+		offset = (offset + size - 1) & ~(size - 1);
+		attribs[i].offset = offset;
+		offset += attribs[i].get_size();
+		align = MAX(align, size);
+	}
+	stride = (offset + align - 1) & ~(align - 1);
+}
+
+Transform PicaVertexLayout::get_position_transform() const
+{
+	return Transform(Matrix3().scaled(Vector3(position_scale, position_scale, position_scale)), position_origin);
+}
+
+uint64_t PicaVertexLayout::get_permutation() const
+{
+	uint64_t permutation = 0;
+	for (int i = 0; i < attrib_count; i++)
+		permutation |= uint64_t(i) << (i * 4);
+	return permutation;
+}
+
+PicaVertexLayout::PicaVertexLayout()
+{
+	attrib_count = 0;
+	stride = 0;
+	format = 0;
+	vertex_count = 0;
+	index_count = 0;
+	index_size = 0;
+	position_scale = 1.0;
+	has_alpha = false;
+}
+
+Error pica_vertex_layout_create(const Array &p_arrays, uint32_t p_format, PicaVertexLayout &r_layout)
+{
+	ERR_FAIL_COND_V(p_arrays.size() != VS::ARRAY_MAX, ERR_INVALID_PARAMETER);
+	ERR_FAIL_COND_V(p_arrays[VS::ARRAY_VERTEX].get_type() != Variant::VECTOR3_ARRAY, ERR_INVALID_PARAMETER);
+
+	r_layout = PicaVertexLayout();
+
+	DVector<Vector3> vertices = p_arrays[VS::ARRAY_VERTEX];
+	int count = vertices.size();
+	ERR_FAIL_COND_V(count == 0, ERR_INVALID_PARAMETER);
+	r_layout.vertex_count = count;
+
+	// Attributes in array order, each aligned to its component size
+	static const int arrays[] = { VS::ARRAY_VERTEX, VS::ARRAY_NORMAL, VS::ARRAY_COLOR, VS::ARRAY_TEX_UV };
+	static const PicaAttribType types[] = { PICA_ATTRIB_SHORT, PICA_ATTRIB_BYTE, PICA_ATTRIB_UNSIGNED_BYTE, PICA_ATTRIB_FLOAT };
+	static const int counts[] = { 3, 3, 4, 2 };
+
+	for (int i = 0; i < 4; i++) {
+
+		int a = arrays[i];
+		if (!(p_format & (1 << a)) || p_arrays[a].get_type() == Variant::NIL)
+			continue;
+
+		PicaVertexLayout::Attrib &attrib = r_layout.attribs[r_layout.attrib_count++];
+		attrib.array = a;
+		attrib.type = types[i];
+		attrib.count = counts[i];
+		r_layout.format |= 1 << a;
+	}
+	r_layout.update_offsets();
+
+	if ((p_format & VS::ARRAY_FORMAT_INDEX) && p_arrays[VS::ARRAY_INDEX].get_type() != Variant::NIL) {
+
+		ERR_FAIL_COND_V(p_arrays[VS::ARRAY_INDEX].get_type() != Variant::INT_ARRAY, ERR_INVALID_PARAMETER);
+		ERR_FAIL_COND_V(count > (1 << 16), ERR_INVALID_PARAMETER); // 32 bit indices not supported
+		r_layout.index_count = IntArray(p_arrays[VS::ARRAY_INDEX]).size();
+		r_layout.index_size = count > (1 << 8) ? 2 : 1;
+		r_layout.format |= VS::ARRAY_FORMAT_INDEX;
+	}
+
+	if (r_layout.format & VS::ARRAY_FORMAT_COLOR) {
+
+		ERR_FAIL_COND_V(p_arrays[VS::ARRAY_COLOR].get_type() != Variant::COLOR_ARRAY, ERR_INVALID_PARAMETER);
+		DVector<Color> colors = p_arrays[VS::ARRAY_COLOR];
+		DVector<Color>::Read r = colors.read();
+		for (int i = 0; i < colors.size(); i++) {
+			if (r[i].a < 0.98) {
+				r_layout.has_alpha = true;
+				break;
+			}
+		}
+	}
+
+	// Quantize around the center of the AABB, same step on every axis
+	DVector<Vector3>::Read r = vertices.read();
+	AABB aabb(r[0], Vector3());
+	for (int i = 1; i < count; i++)
+		aabb.expand_to(r[i]);
+
+	float extent = MAX(aabb.size.x, MAX(aabb.size.y, aabb.size.z)) * 0.5;
+	r_layout.aabb = aabb;
+	r_layout.position_origin = aabb.pos + aabb.size * 0.5;
+	r_layout.position_scale = extent > 0 ? extent / PicaVertexLayout::POSITION_RANGE : 1.0;
+
+	return OK;
+}
+
+template <class T>
+static _FORCE_INLINE_ T *_attrib_ptr(uint8_t *p_vertices, const PicaVertexLayout &p_layout, const PicaVertexLayout::Attrib *p_attrib, int p_index)
+{
+	return reinterpret_cast<T *>(p_vertices + p_index * p_layout.stride + p_attrib->offset);
+}
+
+Error pica_vertex_pack(const Array &p_arrays, const PicaVertexLayout &p_layout, uint8_t *r_vertices, uint8_t *r_indices)
+{
+	ERR_FAIL_COND_V(p_arrays.size() != VS::ARRAY_MAX, ERR_INVALID_PARAMETER);
+	ERR_FAIL_COND_V(!r_vertices, ERR_INVALID_PARAMETER);
+
+	int count = p_layout.vertex_count;
+
+	// Padding between attributes stays deterministic
+	zeromem(r_vertices, count * p_layout.stride);
+
+	for (int ai = 0; ai < p_layout.attrib_count; ai++) {
+
+		const PicaVertexLayout::Attrib *attrib = &p_layout.attribs[ai];
+
+		switch (attrib->array) {
+
+			case VS::ARRAY_VERTEX: {
+
+				DVector<Vector3> array = p_arrays[VS::ARRAY_VERTEX];
+				ERR_FAIL_COND_V(array.size() != count, ERR_INVALID_PARAMETER);
+				DVector<Vector3>::Read r = array.read();
+
+				float inv_scale = 1.0 / p_layout.position_scale;
+				for (int i = 0; i < count; i++) {
+					Vector3 v = (r[i] - p_layout.position_origin) * inv_scale;
+					int16_t *dst = _attrib_ptr<int16_t>(r_vertices, p_layout, attrib, i);
+					for (int j = 0; j < 3; j++)
+						dst[j] = CLAMP(Math::fast_ftoi(v[j]), -PicaVertexLayout::POSITION_RANGE, PicaVertexLayout::POSITION_RANGE);
+				}
+			} break;
+			case VS::ARRAY_NORMAL: {
+
+				ERR_FAIL_COND_V(p_arrays[VS::ARRAY_NORMAL].get_type() != Variant::VECTOR3_ARRAY, ERR_INVALID_PARAMETER);
+				DVector<Vector3> array = p_arrays[VS::ARRAY_NORMAL];
+				ERR_FAIL_COND_V(array.size() != count, ERR_INVALID_PARAMETER);
+				DVector<Vector3>::Read r = array.read();
+
+				for (int i = 0; i < count; i++) {
+					int8_t *dst = _attrib_ptr<int8_t>(r_vertices, p_layout, attrib, i);
+					for (int j = 0; j < 3; j++)
+						dst[j] = CLAMP(Math::fast_ftoi(r[i][j] * 127.0), -127, 127);
+				}
+			} break;
+			case VS::ARRAY_COLOR: {
+
+				ERR_FAIL_COND_V(p_arrays[VS::ARRAY_COLOR].get_type() != Variant::COLOR_ARRAY, ERR_INVALID_PARAMETER);
+				DVector<Color> array = p_arrays[VS::ARRAY_COLOR];
+				ERR_FAIL_COND_V(array.size() != count, ERR_INVALID_PARAMETER);
+				DVector<Color>::Read r = array.read();
+
+				for (int i = 0; i < count; i++) {
+					uint8_t *dst = _attrib_ptr<uint8_t>(r_vertices, p_layout, attrib, i);
+					for (int j = 0; j < 4; j++)
+						dst[j] = CLAMP(Math::fast_ftoi(r[i][j] * 255.0), 0, 255);
+				}
+			} break;
+			case VS::ARRAY_TEX_UV: {
+
+				ERR_FAIL_COND_V(p_arrays[VS::ARRAY_TEX_UV].get_type() != Variant::VECTOR2_ARRAY, ERR_INVALID_PARAMETER);
+				DVector<Vector2> array = p_arrays[VS::ARRAY_TEX_UV];
+				ERR_FAIL_COND_V(array.size() != count, ERR_INVALID_PARAMETER);
+				DVector<Vector2>::Read r = array.read();
+
+				for (int i = 0; i < count; i++) {
+					float *dst = _attrib_ptr<float>(r_vertices, p_layout, attrib, i);
+					dst[0] = r[i].x;
+					dst[1] = r[i].y;
+				}
+			} break;
+			default: {
+				ERR_FAIL_V(ERR_INVALID_PARAMETER);
+			}
+		}
+	}
+
+	if (p_layout.index_count) {
+
+		ERR_FAIL_COND_V(!r_indices, ERR_INVALID_PARAMETER);
+		IntArray array = p_arrays[VS::ARRAY_INDEX];
+		ERR_FAIL_COND_V(array.size() != p_layout.index_count, ERR_INVALID_PARAMETER);
+		IntArray::Read r = array.read();
+
+		for (int i = 0; i < p_layout.index_count; i++) {
+			ERR_FAIL_INDEX_V(r[i], count, ERR_INVALID_PARAMETER);
+			if (p_layout.index_size == 2)
+				reinterpret_cast<uint16_t *>(r_indices)[i] = r[i];
+			else
+				r_indices[i] = r[i];
+		}
+	}
+
+	return OK;
+}
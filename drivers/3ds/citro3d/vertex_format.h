@@ -0,0 +1,112 @@
+/*************************************************************************/
+/*  vertex_format.h                                                      */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                    http://www.godotengine.org                         */
+/*************************************************************************/
+/* Copyright (c) 2007-2016 Juan Linietsky, Ariel Manzur.                 */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+#ifndef VERTEX_FORMAT_H
+#define VERTEX_FORMAT_H
+
+#include "array.h"
+#include "math/aabb.h"
+#include "math/transform.h"
+
+/**
+	Packs mesh surface arrays once into the interleaved layout the PICA200
+	vertex loader fetches, using the smallest attribute types that hold
+	the data: positions as shorts, normals as signed bytes, colors as
+	unsigned bytes. Texture coordinates stay floats, the built-in shader
+	passes them straight through.
+
+	The loader converts attributes to float without normalizing, so
+	quantized positions come with a transform back to model space. Its
+	scale is the same on all axes, so folding it into the modelview
+	matrix does not skew normals, which the shader renormalizes anyway.
+
+	Attribute offsets follow the loader rules: each one is aligned to the
+	size of its component type, in array order.
+
+	Plain CPU code, tested on the host against the source arrays.
+*/
+
+enum PicaAttribType {
+	PICA_ATTRIB_BYTE, // same values as GPU_FORMATS
+	PICA_ATTRIB_UNSIGNED_BYTE,
+	PICA_ATTRIB_SHORT,
+	PICA_ATTRIB_FLOAT,
+};
+
+struct PicaVertexLayout {
+
+	enum {
+		MAX_ATTRIBS = 4,
+		POSITION_RANGE = 32767,
+	};
+
+	struct Attrib {
+		int array; // VS::ArrayType
+		PicaAttribType type;
+		int count;
+		int offset;
+
+		int get_size() const; // in bytes
+	};
+
+	Attrib attribs[MAX_ATTRIBS];
+	int attrib_count;
+	int stride;
+	uint32_t format; // VS::ARRAY_FORMAT_* bits actually packed
+
+	int vertex_count;
+	int index_count;
+	int index_size; // 1 or 2 bytes, 0 without indices
+
+	AABB aabb;
+	Vector3 position_origin;
+	float position_scale; // model space position = origin + scale * packed
+	bool has_alpha;
+
+	const Attrib *get_attrib(int p_array) const;
+	// Lays out attribs[] in order following the loader alignment rules
+	void update_offsets();
+	// Maps packed positions back to model space
+	Transform get_position_transform() const;
+
+	// BufInfo_Add permutation, when loaders are added in attribute order
+	uint64_t get_permutation() const;
+
+	PicaVertexLayout();
+};
+
+// p_format selects which of the arrays present get packed, the vertex
+// array is mandatory. Fails on malformed arrays or too many vertices
+// for 16 bit indices.
+Error pica_vertex_layout_create(const Array &p_arrays, uint32_t p_format, PicaVertexLayout &r_layout);
+
+// r_vertices must hold vertex_count * stride bytes and r_indices
+// index_count * index_size bytes.
+Error pica_vertex_pack(const Array &p_arrays, const PicaVertexLayout &p_layout, uint8_t *r_vertices, uint8_t *r_indices);
+
+#endif
@@ -0,0 +1,224 @@
+/*************************************************************************/
+/*  input_batcher.cpp                                                    */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                    http://www.godotengine.org                         */
+/*************************************************************************/
+/* Copyright (c) 2007-2016 Juan Linietsky, Ariel Manzur.                 */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+#include "input_batcher.h"
+#include "error_macros.h"
+#include "math_funcs.h"
+
+void InputBatcher::joy_button(int p_button, bool p_pressed)
+{
+	Pending p;
+	p.type = PENDING_BUTTON;
+	p.index = p_button;
+	p.pressed = p_pressed;
+	pending.push_back(p);
+	samples++;
+}
+
+void InputBatcher::joy_axis(int p_axis, float p_value)
+{
+	ERR_FAIL_INDEX(p_axis, JOY_AXIS_MAX);
+
+	axes[p_axis].value = Math::abs(p_value) < axis_deadzone ? 0 : CLAMP(p_value, -1.0f, 1.0f);
+	samples++;
+}
+
+void InputBatcher::_queue_drag()
+{
+	if (touch_pos == touch_sent_pos)
+		return;
+
+	Pending p;
+	p.type = PENDING_DRAG;
+	p.index = 0;
+	p.pressed = true;
+	p.pos = touch_pos;
+	p.relative = touch_pos - touch_sent_pos;
+	pending.push_back(p);
+	touch_sent_pos = touch_pos;
+}
+
+void InputBatcher::touch_press(const Point2 &p_pos)
+{
+	if (touching) {
+		touch_move(p_pos);
+		return;
+	}
+
+	samples++;
+	touching = true;
+	touch_pos = p_pos;
+	touch_sent_pos = p_pos;
+
+	Pending p;
+	p.type = PENDING_TOUCH;
+	p.index = 0;
+	p.pressed = true;
+	p.pos = p_pos;
+	pending.push_back(p);
+}
+
+void InputBatcher::touch_move(const Point2 &p_pos)
+{
+	// Only where it ends up matters, the drag is queued on flush or release
+	samples++;
+	if (touching)
+		touch_pos = p_pos;
+}
+
+void InputBatcher::touch_release()
+{
+	samples++;
+	if (!touching)
+		return;
+
+	// The drag up to the release point goes first, so the release lands where it should
+	_queue_drag();
+	touching = false;
+
+	Pending p;
+	p.type = PENDING_TOUCH;
+	p.index = 0;
+	p.pressed = false;
+	p.pos = touch_pos;
+	pending.push_back(p);
+}
+
+void InputBatcher::set_sensors(const Vector3 &p_accelerometer, const Vector3 &p_gyroscope)
+{
+	accelerometer = p_accelerometer;
+	gyroscope = p_gyroscope;
+	sensors_changed = true;
+	samples++;
+}
+
+uint32_t InputBatcher::_send_touch(uint32_t p_last_id, const Pending &p_pending)
+{
+	int x = p_pending.pos.x;
+	int y = p_pending.pos.y;
+
+	InputEvent mouse;
+	mouse.ID = ++p_last_id;
+	InputEvent touch;
+	touch.ID = ++p_last_id;
+	mouse.screen = touch.screen = TOUCH_SCREEN;
+
+	if (p_pending.type == PENDING_TOUCH) {
+		mouse.type = InputEvent::MOUSE_BUTTON;
+		mouse.mouse_button.button_index = BUTTON_LEFT;
+		mouse.mouse_button.button_mask = p_pending.pressed ? BUTTON_MASK_LEFT : 0;
+		mouse.mouse_button.pressed = p_pending.pressed;
+		mouse.mouse_button.x = mouse.mouse_button.global_x = x;
+		mouse.mouse_button.y = mouse.mouse_button.global_y = y;
+
+		touch.type = InputEvent::SCREEN_TOUCH;
+		touch.screen_touch.index = p_pending.index;
+		touch.screen_touch.pressed = p_pending.pressed;
+		touch.screen_touch.x = x;
+		touch.screen_touch.y = y;
+	} else {
+		mouse.type = InputEvent::MOUSE_MOTION;
+		mouse.mouse_motion.button_mask = BUTTON_MASK_LEFT;
+		mouse.mouse_motion.x = mouse.mouse_motion.global_x = x;
+		mouse.mouse_motion.y = mouse.mouse_motion.global_y = y;
+		mouse.mouse_motion.relative_x = p_pending.relative.x;
+		mouse.mouse_motion.relative_y = p_pending.relative.y;
+
+		touch.type = InputEvent::SCREEN_DRAG;
+		touch.screen_drag.index = p_pending.index;
+		touch.screen_drag.x = x;
+		touch.screen_drag.y = y;
+		touch.screen_drag.relative_x = p_pending.relative.x;
+		touch.screen_drag.relative_y = p_pending.relative.y;
+	}
+
+	sink->sink_input_event(mouse);
+	if (touch.type == InputEvent::SCREEN_DRAG) {
+		touch.screen_drag.speed_x = mouse.mouse_motion.speed_x;
+		touch.screen_drag.speed_y = mouse.mouse_motion.speed_y;
+	}
+	sink->sink_input_event(touch);
+
+	return p_last_id;
+}
+
+uint32_t InputBatcher::flush(uint32_t p_last_id)
+{
+	ERR_FAIL_COND_V(!sink, p_last_id);
+
+	if (touching)
+		_queue_drag();
+
+	for (int i = 0; i < pending.size(); i++) {
+
+		const Pending &p = pending[i];
+		if (p.type == PENDING_BUTTON)
+			p_last_id = sink->sink_joy_button(p_last_id, p.index, p.pressed);
+		else
+			p_last_id = _send_touch(p_last_id, p);
+	}
+	pending.clear();
+
+	for (int i = 0; i < JOY_AXIS_MAX; i++) {
+
+		Axis &axis = axes[i];
+		if (axis.value == axis.sent)
+			continue;
+		p_last_id = sink->sink_joy_axis(p_last_id, i, axis.value);
+		axis.sent = axis.value;
+	}
+
+	if (sensors_changed) {
+		sink->sink_sensors(accelerometer, gyroscope);
+		sensors_changed = false;
+	}
+
+	samples = 0;
+	return p_last_id;
+}
+
+void InputBatcher::clear()
+{
+	pending.clear();
+	for (int i = 0; i < JOY_AXIS_MAX; i++) {
+		axes[i].value = 0;
+		axes[i].sent = 0;
+	}
+	touching = false;
+	touch_pos = touch_sent_pos = Point2();
+	accelerometer = gyroscope = Vector3();
+	sensors_changed = false;
+	samples = 0;
+}
+
+InputBatcher::InputBatcher()
+{
+	sink = NULL;
+	axis_deadzone = 0;
+	clear();
+}
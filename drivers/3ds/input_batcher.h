@@ -0,0 +1,133 @@
+/*************************************************************************/
+/*  input_batcher.h                                                      */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                    http://www.godotengine.org                         */
+/*************************************************************************/
+/* Copyright (c) 2007-2016 Juan Linietsky, Ariel Manzur.                 */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+#ifndef INPUT_BATCHER_H
+#define INPUT_BATCHER_H
+
+#include "vector3.h"
+#include "os/input_event.h"
+#include "vector.h"
+
+/**
+	Turns the input state the platform reads each frame into one batch of
+	events. Button presses and touch begin/end are discrete and are sent
+	in order. Continuous sources only send what changed since the last
+	flush: an axis sends a motion when its value moved, a held touch sends
+	a single drag to where it is now, and sensors are set once. Reading
+	more than once between flushes is fine, continuous sources then only
+	keep the latest value.
+
+	Touch is reported both as the left mouse button and as screen touch
+	index 0, like on other touch platforms. The events are tagged with
+	TOUCH_SCREEN, so only viewports on the bottom screen receive them.
+*/
+
+class InputBatcher {
+public:
+	enum {
+		TOUCH_SCREEN = 1, // the bottom screen
+	};
+
+	class Sink {
+	public:
+		virtual uint32_t sink_joy_button(uint32_t p_last_id, int p_button, bool p_pressed) = 0;
+		virtual uint32_t sink_joy_axis(uint32_t p_last_id, int p_axis, float p_value) = 0;
+		// Mouse and screen events, the sink fills in mouse speeds
+		virtual void sink_input_event(InputEvent &p_event) = 0;
+		virtual void sink_sensors(const Vector3 &p_accelerometer, const Vector3 &p_gyroscope) = 0;
+		virtual ~Sink() {}
+	};
+
+private:
+	enum PendingType {
+		PENDING_BUTTON,
+		PENDING_TOUCH,
+		PENDING_DRAG,
+	};
+
+	struct Pending {
+		PendingType type;
+		int index;
+		bool pressed;
+		Point2 pos;
+		Point2 relative;
+	};
+
+	struct Axis {
+		float value;
+		float sent;
+	};
+
+	Sink *sink;
+	Vector<Pending> pending;
+
+	Axis axes[JOY_AXIS_MAX];
+	float axis_deadzone;
+
+	bool touching;
+	Point2 touch_pos;
+	Point2 touch_sent_pos;
+
+	Vector3 accelerometer;
+	Vector3 gyroscope;
+	bool sensors_changed;
+
+	int samples;
+
+	void _queue_drag();
+	uint32_t _send_touch(uint32_t p_last_id, const Pending &p_pending);
+
+public:
+	void set_sink(Sink *p_sink) { sink = p_sink; }
+
+	// Axis values closer to 0 than this are sent as 0
+	void set_axis_deadzone(float p_deadzone) { axis_deadzone = p_deadzone; }
+	float get_axis_deadzone() const { return axis_deadzone; }
+
+	void joy_button(int p_button, bool p_pressed);
+	void joy_axis(int p_axis, float p_value);
+
+	void touch_press(const Point2 &p_pos);
+	void touch_move(const Point2 &p_pos);
+	void touch_release();
+	bool is_touching() const { return touching; }
+
+	void set_sensors(const Vector3 &p_accelerometer, const Vector3 &p_gyroscope);
+
+	// Sends everything collected since the last flush, returns the last event id used
+	uint32_t flush(uint32_t p_last_id);
+
+	// Samples taken since the last flush, for statistics
+	int get_sample_count() const { return samples; }
+
+	void clear();
+
+	InputBatcher();
+};
+
+#endif // INPUT_BATCHER_H
@@ -45,8 +45,15 @@ Thread* Thread3ds::create_func_3ds(ThreadCreateCallback p_callback,void * p_user
 	else if (p_settings.priority == PRIORITY_HIGH)
 		priority--;
 	
-	ThreadCtrWrapper* thread_wrapper = memnew(ThreadCtrWrapper(p_callback, p_user, priority));
-	return memnew(Thread3ds(thread_wrapper));
+	Thread3ds* t = memnew(Thread3ds(p_callback, p_user));
+	t->thread = memnew(ThreadCtrWrapper(thread_callback, t, priority, p_settings.core));
+	return t;
+}
+
+void Thread3ds::thread_callback(void* p_userdata) {
+	Thread3ds* t = reinterpret_cast<Thread3ds*>(p_userdata);
+	t->callback(t->user);
+	Memory::release_thread_cache();
 }
 
 void Thread3ds::make_default() {
@@ -64,8 +71,10 @@ void Thread3ds::wait_to_finish_func_3ds(Thread* p_thread) {
 	t->thread->wait();
 }
 
-Thread3ds::Thread3ds(ThreadCtrWrapper* p_thread) {
-	thread = p_thread;
+Thread3ds::Thread3ds(ThreadCreateCallback p_callback, void* p_user) {
+	thread = NULL;
+	callback = p_callback;
+	user = p_user;
 }
 
 Thread3ds::~Thread3ds() {
@@ -137,5 +146,23 @@ void Semaphore3ds::make_default() {
 	Semaphore::create_func = &Semaphore3ds::create;
 }
 
+Error Semaphore3ds::wait() {
+	LightSemaphore_Acquire(&semaphore, 1);
+	return OK;
+}
+
+Error Semaphore3ds::post() {
+	LightSemaphore_Release(&semaphore, 1);
+	return OK;
+}
+
+int Semaphore3ds::get() const {
+	return semaphore.current_count;
+}
+
+Semaphore3ds::Semaphore3ds() {
+	LightSemaphore_Init(&semaphore, 0, 0x7FFF);
+}
+
 #endif
 
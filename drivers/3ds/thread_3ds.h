@@ -45,12 +45,15 @@ class Thread3ds : public Thread {
 
 	static Thread* create_func_3ds(ThreadCreateCallback p_callback,void * p_user,const Settings& p_settings=Settings());
 	static void wait_to_finish_func_3ds(Thread* p_thread);
+	static void thread_callback(void* p_userdata);
 	
 	ThreadCtrWrapper* thread;
+	ThreadCreateCallback callback;
+	void* user;
 	ID id;
 
 public:
-	Thread3ds(ThreadCtrWrapper* p_thread);
+	Thread3ds(ThreadCreateCallback p_callback, void* p_user);
 	~Thread3ds();
 	
 	virtual ID get_ID() const;
@@ -84,13 +87,17 @@ class Semaphore3ds : public Semaphore {
 
 	static Semaphore* create();
 
+	LightSemaphore semaphore;
+
 public:
-	virtual Error wait() { return OK; };
-	virtual Error post() { return OK; };
-	virtual int get() const { return 0; }; ///< get semaphore value
+	virtual Error wait();
+	virtual Error post();
+	virtual int get() const; ///< get semaphore value
 
 	static void make_default();
 
+	Semaphore3ds();
+
 };
 
 #endif
@@ -54,7 +54,8 @@ class ThreadCtrWrapper
 	Thread_tag* thread;
 	
 public:
-	ThreadCtrWrapper(ThreadCreateCallback p_callback, void* p_userdata, int32_t p_priority);
+	// p_core -1 runs on any core the application may use
+	ThreadCtrWrapper(ThreadCreateCallback p_callback, void* p_userdata, int32_t p_priority, int p_core = -1);
 	
 	void wait();
 	
@@ -10477,6 +10477,17 @@ int RasterizerGLES2::get_render_info(VS::RenderInfo p_info) {
 		} break;
 		case VS::INFO_VERTEX_MEM_USED: {
 
+			return 0;
+		} break;
+		case VS::INFO_TEXTURE_ATLAS_PAGES:
+		case VS::INFO_TEXTURE_ATLAS_EFFICIENCY:
+		case VS::INFO_INDEX_MEM_USED:
+		case VS::INFO_TEXTURE_EVICTIONS:
+		case VS::INFO_CULLING_TIME_USEC:
+		case VS::INFO_CANVAS_ITEMS_IN_FRAME:
+		case VS::INFO_CANVAS_BATCHES_IN_FRAME:
+		case VS::INFO_TEXTURE_UPLOADS_IN_FRAME: {
+
 			return 0;
 		} break;
 	}
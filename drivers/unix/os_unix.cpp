@@ -57,6 +57,7 @@
 #include <assert.h>
 #include <errno.h>
 #include <poll.h>
+#include <sched.h>
 #include <signal.h>
 #include <stdarg.h>
 #include <stdlib.h>
@@ -464,6 +465,11 @@ int OS_Unix::get_processor_count() const {
 	return sysconf(_SC_NPROCESSORS_CONF);
 }
 
+void OS_Unix::yield() {
+
+	sched_yield();
+}
+
 String OS_Unix::get_data_dir() const {
 
 	String an = get_safe_application_name();
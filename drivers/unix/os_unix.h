@@ -107,6 +107,7 @@ public:
 	virtual String get_locale() const;
 
 	virtual int get_processor_count() const;
+	virtual void yield();
 
 	virtual void debug_break();
 
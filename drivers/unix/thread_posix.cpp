@@ -59,11 +59,12 @@ void *ThreadPosix::thread_callback(void *userdata) {
 	t->callback(t->user);
 
 	ScriptServer::thread_exit();
+	Memory::release_thread_cache();
 
 	return NULL;
 }
 
-Thread *ThreadPosix::create_func_posix(ThreadCreateCallback p_callback, void *p_user, const Settings &) {
+Thread *ThreadPosix::create_func_posix(ThreadCreateCallback p_callback, void *p_user, const Settings &p_settings) {
 
 	ThreadPosix *tr = memnew(ThreadPosix);
 	tr->callback = p_callback;
@@ -71,6 +72,14 @@ Thread *ThreadPosix::create_func_posix(ThreadCreateCallback p_callback, void *p_
 	pthread_attr_init(&tr->pthread_attr);
 	pthread_attr_setdetachstate(&tr->pthread_attr, PTHREAD_CREATE_JOINABLE);
 	pthread_attr_setstacksize(&tr->pthread_attr, 256 * 1024);
+#if defined(__linux__) && !defined(__ANDROID__)
+	if (p_settings.core >= 0) {
+		cpu_set_t cpus;
+		CPU_ZERO(&cpus);
+		CPU_SET(p_settings.core, &cpus);
+		pthread_attr_setaffinity_np(&tr->pthread_attr, sizeof(cpus), &cpus);
+	}
+#endif
 
 	pthread_create(&tr->pthread, &tr->pthread_attr, thread_callback, tr);
 
@@ -303,6 +303,7 @@ void InputDefault::parse_input_event(const InputEvent &p_event) {
 				touch_event.y = p_event.mouse_button.y;
 				InputEvent ev;
 				ev.type = InputEvent::SCREEN_TOUCH;
+				ev.screen = p_event.screen;
 				ev.screen_touch = touch_event;
 				main_loop->input_event(ev);
 			}
@@ -326,6 +327,7 @@ void InputDefault::parse_input_event(const InputEvent &p_event) {
 
 				InputEvent ev;
 				ev.type = InputEvent::SCREEN_DRAG;
+				ev.screen = p_event.screen;
 				ev.screen_drag = drag_event;
 
 				main_loop->input_event(ev);
@@ -71,6 +71,8 @@
 #include "core/io/stream_peer_ssl.h"
 #include "core/io/stream_peer_tcp.h"
 #include "main/input_default.h"
+#include "os/job_system.h"
+#include "os/zone_profiler.h"
 #include "performance.h"
 #include "translation.h"
 #include "version.h"
@@ -82,6 +84,10 @@ static ScriptDebugger *script_debugger = NULL;
 
 static MessageQueue *message_queue = NULL;
 static Performance *performance = NULL;
+static JobSystem *job_system = NULL;
+#ifdef ZONE_PROFILER_ENABLED
+static String zone_trace_file;
+#endif
 static PathRemap *path_remap;
 static PackedData *packed_data = NULL;
 #ifdef MINIZIP_ENABLED
@@ -211,6 +217,7 @@ Error Main::setup(const char *execpath, int argc, char *argv[], bool p_second_ph
 	MAIN_PRINT("Main: Initialize Globals");
 
 	Thread::_main_thread_id = Thread::get_caller_ID();
+	ZoneProfiler::init();
 
 	globals = memnew(Globals);
 	input_map = memnew(InputMap);
@@ -860,6 +867,7 @@ error:
 
 	if (message_queue)
 		memdelete(message_queue);
+	ZoneProfiler::finish();
 	OS::get_singleton()->finalize_core();
 	locale = String();
 
@@ -872,6 +880,26 @@ Error Main::setup2(Thread::ID p_main_tid_override) {
 		Thread::_main_thread_id = p_main_tid_override;
 	}
 
+#ifdef ZONE_PROFILER_ENABLED
+	// written out on exit, open it in chrome://tracing
+	zone_trace_file = GLOBAL_DEF("debug/zone_profiler/trace_file", "");
+	ZoneProfiler::set_enabled(zone_trace_file != "");
+#endif
+
+	// up before the servers, so they can dispatch from their init. Without
+	// workers jobs run on the thread that waits for them; -1 is one worker
+	// per spare core, the default on the 3DS
+#ifdef _3DS
+	int job_threads = GLOBAL_DEF("core/job_threads", -1);
+#else
+	int job_threads = GLOBAL_DEF("core/job_threads", 0);
+#endif
+	job_system = memnew(JobSystem);
+	job_system->init(job_threads < 0 ? OS::get_singleton()->get_processor_count() - 1 : job_threads);
+
+	// samples every monitor each frame, off by default since some of them sync with the servers
+	performance->set_history_frames(GLOBAL_DEF("debug/performance/history_frames", 0));
+
 	OS::get_singleton()->initialize(video_mode, video_driver_idx, audio_driver_idx);
 	if (init_use_custom_pos) {
 		OS::get_singleton()->set_window_position(init_custom_pos);
@@ -1493,6 +1521,8 @@ static uint64_t idle_process_max = 0;
 
 bool Main::iteration() {
 
+	ZONE_SCOPE("Main::iteration");
+
 	uint64_t ticks = OS::get_singleton()->get_ticks_usec();
 	uint64_t ticks_elapsed = ticks - last_ticks;
 
@@ -1522,6 +1552,8 @@ bool Main::iteration() {
 
 	while (time_accum > frame_slice) {
 
+		ZONE_SCOPE("Main::fixed_process");
+
 		uint64_t fixed_begin = OS::get_singleton()->get_ticks_usec();
 
 		PhysicsServer::get_singleton()->sync();
@@ -1585,6 +1617,8 @@ bool Main::iteration() {
 	idle_process_max = MAX(idle_process_ticks, idle_process_max);
 	uint64_t frame_time = OS::get_singleton()->get_ticks_usec() - ticks;
 
+	performance->frame_update(USEC_TO_SEC(idle_process_ticks), USEC_TO_SEC(fixed_process_ticks));
+
 	for (int i = 0; i < ScriptServer::get_language_count(); i++) {
 		ScriptServer::get_language(i)->frame();
 	}
@@ -1675,6 +1709,16 @@ void Main::cleanup() {
 
 	OS::get_singleton()->finalize();
 
+#ifdef ZONE_PROFILER_ENABLED
+	if (zone_trace_file != "") {
+		ZoneProfiler::set_enabled(false);
+		ZoneProfiler::dump_chrome_trace(zone_trace_file);
+	}
+	zone_trace_file = String();
+#endif
+
+	if (job_system)
+		memdelete(job_system);
 	if (packed_data)
 		memdelete(packed_data);
 	if (file_access_network_client)
@@ -1696,6 +1740,7 @@ void Main::cleanup() {
 	unregister_core_types();
 
 	//PerformanceMetrics::finish();
+	ZoneProfiler::finish();
 	OS::get_singleton()->clear_last_error();
 	OS::get_singleton()->finalize_core();
 }
@@ -40,6 +40,9 @@ Performance *Performance::singleton = NULL;
 void Performance::_bind_methods() {
 
 	ObjectTypeDB::bind_method(_MD("get_monitor", "monitor"), &Performance::get_monitor);
+	ObjectTypeDB::bind_method(_MD("get_monitor_stat", "monitor", "stat"), &Performance::get_monitor_stat);
+	ObjectTypeDB::bind_method(_MD("set_history_frames", "frames"), &Performance::set_history_frames);
+	ObjectTypeDB::bind_method(_MD("get_history_frames"), &Performance::get_history_frames);
 
 	BIND_CONSTANT(TIME_FPS);
 	BIND_CONSTANT(TIME_PROCESS);
@@ -68,8 +71,20 @@ void Performance::_bind_methods() {
 	BIND_CONSTANT(PHYSICS_3D_ACTIVE_OBJECTS);
 	BIND_CONSTANT(PHYSICS_3D_COLLISION_PAIRS);
 	BIND_CONSTANT(PHYSICS_3D_ISLAND_COUNT);
+	BIND_CONSTANT(RENDER_CULLING_TIME);
+	BIND_CONSTANT(RENDER_CANVAS_ITEMS_IN_FRAME);
+	BIND_CONSTANT(RENDER_CANVAS_BATCHES_IN_FRAME);
+	BIND_CONSTANT(RENDER_TEXTURE_UPLOADS_IN_FRAME);
+	BIND_CONSTANT(MEMORY_STATIC_FRAGMENTATION);
+	BIND_CONSTANT(MEMORY_DYNAMIC_FRAGMENTATION);
+	BIND_CONSTANT(MEMORY_MESSAGE_BUFFER_FRAME_PEAK);
 
 	BIND_CONSTANT(MONITOR_MAX);
+
+	BIND_CONSTANT(STAT_MIN);
+	BIND_CONSTANT(STAT_AVG);
+	BIND_CONSTANT(STAT_MAX);
+	BIND_CONSTANT(STAT_P99);
 }
 
 String Performance::get_monitor_name(Monitor p_monitor) const {
@@ -104,6 +119,13 @@ String Performance::get_monitor_name(Monitor p_monitor) const {
 		"physics_3d/active_objects",
 		"physics_3d/collision_pairs",
 		"physics_3d/islands",
+		"raster/culling_time",
+		"raster/canvas_items",
+		"raster/canvas_batches",
+		"raster/texture_uploads",
+		"memory/static_fragmentation",
+		"memory/dynamic_fragmentation",
+		"memory/msg_buf_frame_peak",
 
 	};
 
@@ -149,6 +171,13 @@ float Performance::get_monitor(Monitor p_monitor) const {
 		case PHYSICS_3D_ACTIVE_OBJECTS: return PhysicsServer::get_singleton()->get_process_info(PhysicsServer::INFO_ACTIVE_OBJECTS);
 		case PHYSICS_3D_COLLISION_PAIRS: return PhysicsServer::get_singleton()->get_process_info(PhysicsServer::INFO_COLLISION_PAIRS);
 		case PHYSICS_3D_ISLAND_COUNT: return PhysicsServer::get_singleton()->get_process_info(PhysicsServer::INFO_ISLAND_COUNT);
+		case RENDER_CULLING_TIME: return USEC_TO_SEC(VS::get_singleton()->get_render_info(VS::INFO_CULLING_TIME_USEC));
+		case RENDER_CANVAS_ITEMS_IN_FRAME: return VS::get_singleton()->get_render_info(VS::INFO_CANVAS_ITEMS_IN_FRAME);
+		case RENDER_CANVAS_BATCHES_IN_FRAME: return VS::get_singleton()->get_render_info(VS::INFO_CANVAS_BATCHES_IN_FRAME);
+		case RENDER_TEXTURE_UPLOADS_IN_FRAME: return VS::get_singleton()->get_render_info(VS::INFO_TEXTURE_UPLOADS_IN_FRAME);
+		case MEMORY_STATIC_FRAGMENTATION: return Memory::get_static_mem_fragmentation() * 100.0;
+		case MEMORY_DYNAMIC_FRAGMENTATION: return Memory::get_dynamic_mem_fragmentation() * 100.0;
+		case MEMORY_MESSAGE_BUFFER_FRAME_PEAK: return _message_queue_frame_peak;
 
 		default: {
 		}
@@ -167,9 +196,59 @@ void Performance::set_fixed_process_time(float p_pt) {
 	_fixed_process_time = p_pt;
 }
 
+void Performance::set_history_frames(int p_frames) {
+
+	ERR_FAIL_COND(p_frames < 0);
+	history.resize(MONITOR_MAX, p_frames);
+}
+
+int Performance::get_history_frames() const {
+
+	return history.get_frame_capacity();
+}
+
+float Performance::get_monitor_stat(Monitor p_monitor, Stat p_stat) const {
+
+	ERR_FAIL_INDEX_V(p_monitor, MONITOR_MAX, 0);
+
+	switch (p_stat) {
+		case STAT_MIN: return history.get_min(p_monitor);
+		case STAT_AVG: return history.get_avg(p_monitor);
+		case STAT_MAX: return history.get_max(p_monitor);
+		case STAT_P99: return history.get_percentile(p_monitor, 0.99);
+	}
+
+	return 0;
+}
+
+void Performance::frame_update(float p_process_time, float p_fixed_process_time) {
+
+	_message_queue_frame_peak = MessageQueue::get_singleton()->get_frame_max_buffer_usage();
+	MessageQueue::get_singleton()->reset_frame_max_buffer_usage();
+
+	if (history.get_frame_capacity() == 0)
+		return;
+
+	float values[MONITOR_MAX];
+	for (int i = 0; i < MONITOR_MAX; i++) {
+		values[i] = get_monitor(Monitor(i));
+	}
+	// this frame's times, the monitors hold the worst of the last second
+	values[TIME_PROCESS] = p_process_time;
+	values[TIME_FIXED_PROCESS] = p_fixed_process_time;
+
+	push_frame(values);
+}
+
+void Performance::push_frame(const float *p_values) {
+
+	history.push(p_values);
+}
+
 Performance::Performance() {
 
 	_process_time = 0;
 	_fixed_process_time = 0;
+	_message_queue_frame_peak = 0;
 	singleton = this;
 }
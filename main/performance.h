@@ -32,6 +32,7 @@
 #define PERFORMANCE_H
 
 #include "object.h"
+#include "performance_history.h"
 
 #define PERF_WARN_OFFLINE_FUNCTION
 #define PERF_WARN_PROCESS_SYNC
@@ -45,6 +46,9 @@ class Performance : public Object {
 
 	float _process_time;
 	float _fixed_process_time;
+	float _message_queue_frame_peak;
+
+	PerformanceHistory history;
 
 public:
 	enum Monitor {
@@ -76,21 +80,45 @@ public:
 		PHYSICS_3D_ACTIVE_OBJECTS,
 		PHYSICS_3D_COLLISION_PAIRS,
 		PHYSICS_3D_ISLAND_COUNT,
+		RENDER_CULLING_TIME,
+		RENDER_CANVAS_ITEMS_IN_FRAME,
+		RENDER_CANVAS_BATCHES_IN_FRAME,
+		RENDER_TEXTURE_UPLOADS_IN_FRAME,
+		MEMORY_STATIC_FRAGMENTATION,
+		MEMORY_DYNAMIC_FRAGMENTATION,
+		MEMORY_MESSAGE_BUFFER_FRAME_PEAK,
 		//physics
 		MONITOR_MAX
 	};
 
+	enum Stat {
+		STAT_MIN,
+		STAT_AVG,
+		STAT_MAX,
+		STAT_P99,
+	};
+
 	float get_monitor(Monitor p_monitor) const;
 	String get_monitor_name(Monitor p_monitor) const;
 
 	void set_process_time(float p_pt);
 	void set_fixed_process_time(float p_pt);
 
+	// Rolling window over the last frames, 0 frames turns recording off
+	void set_history_frames(int p_frames);
+	int get_history_frames() const;
+	float get_monitor_stat(Monitor p_monitor, Stat p_stat) const;
+
+	// Called by Main once per iteration, p_values are MONITOR_MAX monitor readings
+	void frame_update(float p_process_time, float p_fixed_process_time);
+	void push_frame(const float *p_values);
+
 	static Performance *get_singleton() { return singleton; }
 
 	Performance();
 };
 
 VARIANT_ENUM_CAST(Performance::Monitor);
+VARIANT_ENUM_CAST(Performance::Stat);
 
 #endif // PERFORMANCE_H
@@ -0,0 +1,134 @@
+/*************************************************************************/
+/*  performance_history.cpp                                              */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "performance_history.h"
+#include "math_funcs.h"
+#include "sort.h"
+
+void PerformanceHistory::resize(int p_channels, int p_frames) {
+
+	ERR_FAIL_COND(p_channels < 0 || p_frames < 0);
+
+	channels = p_channels;
+	frames = p_frames;
+	samples.resize(channels * frames);
+	clear();
+}
+
+void PerformanceHistory::clear() {
+
+	pos = 0;
+	count = 0;
+}
+
+void PerformanceHistory::push(const float *p_values) {
+
+	if (frames == 0)
+		return;
+
+	float *w = samples.ptr() + pos * channels;
+	for (int i = 0; i < channels; i++) {
+		w[i] = p_values[i];
+	}
+
+	pos = (pos + 1) % frames;
+	if (count < frames)
+		count++;
+}
+
+float PerformanceHistory::get_min(int p_channel) const {
+
+	ERR_FAIL_INDEX_V(p_channel, channels, 0);
+	if (count == 0)
+		return 0;
+
+	const float *r = samples.ptr();
+	float v = r[p_channel];
+	for (int i = 1; i < count; i++) {
+		v = MIN(v, r[i * channels + p_channel]);
+	}
+	return v;
+}
+
+float PerformanceHistory::get_avg(int p_channel) const {
+
+	ERR_FAIL_INDEX_V(p_channel, channels, 0);
+	if (count == 0)
+		return 0;
+
+	const float *r = samples.ptr();
+	double sum = 0;
+	for (int i = 0; i < count; i++) {
+		sum += r[i * channels + p_channel];
+	}
+	return sum / count;
+}
+
+float PerformanceHistory::get_max(int p_channel) const {
+
+	ERR_FAIL_INDEX_V(p_channel, channels, 0);
+	if (count == 0)
+		return 0;
+
+	const float *r = samples.ptr();
+	float v = r[p_channel];
+	for (int i = 1; i < count; i++) {
+		v = MAX(v, r[i * channels + p_channel]);
+	}
+	return v;
+}
+
+float PerformanceHistory::get_percentile(int p_channel, float p_percentile) const {
+
+	ERR_FAIL_INDEX_V(p_channel, channels, 0);
+	if (count == 0)
+		return 0;
+
+	sorted.resize(count);
+	const float *r = samples.ptr();
+	float *w = sorted.ptr();
+	for (int i = 0; i < count; i++) {
+		w[i] = r[i * channels + p_channel];
+	}
+
+	SortArray<float> sort;
+	sort.sort(w, count);
+
+	int rank = Math::ceil(CLAMP(p_percentile, 0, 1) * count) - 1;
+	return w[CLAMP(rank, 0, count - 1)];
+}
+
+PerformanceHistory::PerformanceHistory() {
+
+	channels = 0;
+	frames = 0;
+	pos = 0;
+	count = 0;
+}
@@ -0,0 +1,71 @@
+/*************************************************************************/
+/*  performance_history.h                                                */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#ifndef PERFORMANCE_HISTORY_H
+#define PERFORMANCE_HISTORY_H
+
+#include "vector.h"
+
+/**
+	Keeps the last N frames of a fixed set of values (one channel per
+	monitor) and answers min/avg/max/percentile questions over that window.
+	Percentiles sort a copy of the channel, so they cost O(N log N) and are
+	meant for reading now and then, not every frame.
+*/
+
+class PerformanceHistory {
+
+	Vector<float> samples; // frame major, channels values per frame
+	int channels;
+	int frames;
+	int pos;
+	int count;
+
+	mutable Vector<float> sorted;
+
+public:
+	void resize(int p_channels, int p_frames);
+	void clear();
+
+	void push(const float *p_values);
+
+	int get_frame_capacity() const { return frames; }
+	int get_frame_count() const { return count; }
+
+	float get_min(int p_channel) const;
+	float get_avg(int p_channel) const;
+	float get_max(int p_channel) const;
+	// p_percentile in 0..1, nearest rank
+	float get_percentile(int p_channel, float p_percentile) const;
+
+	PerformanceHistory();
+};
+
+#endif // PERFORMANCE_HISTORY_H
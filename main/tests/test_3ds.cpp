@@ -0,0 +1,1487 @@
+/*************************************************************************/
+/*  test_3ds.cpp                                                         */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "test_3ds.h"
+
+#include "drivers/3ds/audio_pump.h"
+#include "drivers/3ds/citro3d/canvas_batcher.h"
+#include "drivers/3ds/citro3d/gpu_memory_budget.h"
+#include "drivers/3ds/citro3d/multimesh_batcher.h"
+#include "drivers/3ds/citro3d/texture_atlas.h"
+#include "drivers/3ds/citro3d/texture_ctex.h"
+#include "drivers/3ds/citro3d/texture_tiler.h"
+#include "drivers/3ds/citro3d/vertex_format.h"
+#include "drivers/3ds/input_batcher.h"
+#include "math_funcs.h"
+#include "os/os.h"
+#include "servers/visual_server.h"
+
+namespace Test3DS {
+
+#define CHECK(m_cond)                                                     \
+	if (!(m_cond)) {                                                      \
+		OS::get_singleton()->print("\tFailed check: %s\n", #m_cond);      \
+		return false;                                                     \
+	}
+
+bool test_canvas_batch_merge() {
+
+	OS::get_singleton()->print("\n\nTest: Canvas batcher merges quads sharing state\n");
+
+	CanvasBatchRecorder recorder;
+	CanvasBatcher batcher;
+	batcher.set_backend(&recorder);
+
+	int tex_a = 0, tex_b = 0;
+	float margin[4] = { 4, 4, 4, 4 };
+
+	// A style box followed by two rects with the same texture: one batch
+	batcher.set_texture(&tex_a);
+	batcher.add_nine_patch(Rect2(0, 0, 64, 32), Rect2(0, 0, 16, 16), Size2(16, 16), margin, true, Color(1, 1, 1));
+	batcher.add_quad(Rect2(10, 10, 8, 8), Rect2(0, 0, 8, 8), Size2(16, 16), Color(1, 0, 0));
+	batcher.set_transform(Matrix32(0, Vector2(100, 0)));
+	batcher.add_quad(Rect2(10, 10, 8, 8), Rect2(0, 0, 8, 8), Size2(16, 16), Color(1, 0, 0));
+
+	// Texture change, blend change and clip change each start a new batch
+	batcher.set_texture(&tex_b);
+	batcher.add_quad(Rect2(0, 0, 8, 8), Rect2(0, 0, 8, 8), Size2(8, 8), Color(1, 1, 1));
+	batcher.set_blend_mode(1);
+	batcher.add_quad(Rect2(0, 0, 8, 8), Rect2(0, 0, 8, 8), Size2(8, 8), Color(1, 1, 1));
+	batcher.set_clip(true, Rect2(0, 0, 50, 50));
+	batcher.add_quad(Rect2(0, 0, 8, 8), Rect2(0, 0, 8, 8), Size2(8, 8), Color(1, 1, 1));
+	batcher.set_clip(true, Rect2(0, 0, 50, 50));
+	batcher.add_quad(Rect2(0, 0, 8, 8), Rect2(0, 0, 8, 8), Size2(8, 8), Color(1, 1, 1));
+	batcher.flush();
+
+	OS::get_singleton()->print("\tbatches: %i quads: %i\n", batcher.get_batch_count(), batcher.get_quad_count());
+
+	CHECK(recorder.batches.size() == 4);
+	CHECK(batcher.get_batch_count() == 4);
+	CHECK(recorder.batches[0].quad_count == 11);
+	CHECK(recorder.batches[0].state.texture == &tex_a);
+	CHECK(recorder.batches[1].quad_count == 1);
+	CHECK(recorder.batches[2].state.blend_mode == 1);
+	CHECK(recorder.batches[3].quad_count == 2);
+	CHECK(recorder.batches[3].state.clip);
+	CHECK(recorder.vertices.size() == 15 * CanvasBatcher::VERTICES_PER_QUAD);
+
+	// The transform is applied on the CPU
+	const CanvasBatcher::Vertex &moved = recorder.vertices[10 * CanvasBatcher::VERTICES_PER_QUAD];
+	CHECK(moved.x == 110 && moved.y == 10);
+	CHECK(moved.u == 0 && moved.v == 0);
+	CHECK(moved.r == 1 && moved.g == 0);
+
+	return true;
+}
+
+bool test_canvas_batch_nine_patch() {
+
+	OS::get_singleton()->print("\n\nTest: Canvas batcher nine patch output\n");
+
+	CanvasBatchRecorder recorder;
+	CanvasBatcher batcher;
+	batcher.set_backend(&recorder);
+
+	int tex = 0;
+	batcher.set_texture(&tex);
+
+	// Zero margins collapse to the center piece only
+	float no_margin[4] = { 0, 0, 0, 0 };
+	batcher.add_nine_patch(Rect2(0, 0, 32, 32), Rect2(0, 0, 16, 16), Size2(16, 16), no_margin, true, Color(1, 1, 1));
+	batcher.flush();
+	CHECK(recorder.batches.size() == 1);
+	CHECK(recorder.batches[0].quad_count == 1);
+
+	const CanvasBatcher::Vertex *v = recorder.vertices.ptr();
+	CHECK(v[0].x == 0 && v[0].y == 0 && v[0].u == 0 && v[0].v == 0);
+	CHECK(v[2].x == 32 && v[2].y == 32 && v[2].u == 1 && v[2].v == 1);
+
+	// Without the center, a full margin box gives the 8 border pieces
+	recorder.clear();
+	float margin[4] = { 2, 2, 2, 2 };
+	batcher.add_nine_patch(Rect2(0, 0, 32, 32), Rect2(0, 0, 16, 16), Size2(16, 16), margin, false, Color(1, 1, 1));
+	batcher.flush();
+	CHECK(recorder.batches[0].quad_count == 8);
+
+	return true;
+}
+
+bool test_canvas_batch_limits() {
+
+	OS::get_singleton()->print("\n\nTest: Canvas batcher splits full batches\n");
+
+	CanvasBatchRecorder recorder;
+	CanvasBatcher batcher;
+	batcher.set_backend(&recorder);
+
+	int count = CanvasBatcher::MAX_BATCH_QUADS + 10;
+	for (int i = 0; i < count; i++)
+		batcher.add_quad(Rect2(i, 0, 1, 1), Rect2(), Size2(), Color(1, 1, 1));
+	batcher.flush();
+
+	CHECK(recorder.batches.size() == 2);
+	CHECK(recorder.batches[0].quad_count == CanvasBatcher::MAX_BATCH_QUADS);
+	CHECK(recorder.batches[1].quad_count == 10);
+
+	uint16_t indices[CanvasBatcher::INDICES_PER_QUAD * 2];
+	CanvasBatcher::fill_quad_indices(indices, 2);
+	CHECK(indices[6] == 4 && indices[8] == 6 && indices[11] == 7);
+
+	return true;
+}
+
+bool test_texture_tile() {
+
+	OS::get_singleton()->print("\n\nTest: Texture tiler matches the per-pixel reference\n");
+
+	static const int sizes[][4] = {
+		// w, h, dst w, dst h
+		{ 8, 8, 8, 8 },
+		{ 64, 64, 64, 64 },
+		{ 65, 33, 128, 64 },
+		{ 3, 17, 8, 32 },
+		{ 100, 60, 128, 64 },
+	};
+	static const int pixel_sizes[] = { 4, 2, 1 };
+
+	for (int i = 0; i < 5; i++) {
+		int w = sizes[i][0], h = sizes[i][1];
+		int dw = sizes[i][2], dh = sizes[i][3];
+
+		for (int p = 0; p < 3; p++) {
+			int ps = pixel_sizes[p];
+
+			Vector<uint8_t> src;
+			src.resize(w * h * ps);
+			for (int j = 0; j < src.size(); j++)
+				src[j] = Math::rand() & 0xFF;
+
+			for (int swap = 0; swap < (ps == 4 ? 2 : 1); swap++) {
+				Vector<uint8_t> fast, ref;
+				fast.resize(dw * dh * ps);
+				ref.resize(dw * dh * ps);
+				zeromem(fast.ptr(), fast.size());
+				zeromem(ref.ptr(), ref.size());
+
+				texture_tile(fast.ptr(), dw, dh, src.ptr(), w, h, ps, swap);
+				texture_tile_reference(ref.ptr(), dw, dh, src.ptr(), w, h, ps, swap);
+
+				if (memcmp(fast.ptr(), ref.ptr(), fast.size()) != 0) {
+					OS::get_singleton()->print("\tMismatch: %ix%i in %ix%i, %i bytes, swap %i\n", w, h, dw, dh, ps, swap);
+					return false;
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+bool test_texture_format_select() {
+
+	OS::get_singleton()->print("\n\nTest: Smallest PICA format is picked for each image\n");
+
+	const uint32_t compact = PICA_TEXTURE_ALLOW_COMPACT;
+	const uint32_t etc1 = PICA_TEXTURE_ALLOW_COMPACT | PICA_TEXTURE_ALLOW_ETC1;
+
+	CHECK(pica_texture_format_select(Image::FORMAT_GRAYSCALE, 0, Image::ALPHA_NONE, compact) == PICA_TEXTURE_L8);
+	CHECK(pica_texture_format_select(Image::FORMAT_INTENSITY, 0, Image::ALPHA_BLEND, compact) == PICA_TEXTURE_A8);
+	CHECK(pica_texture_format_select(Image::FORMAT_GRAYSCALE_ALPHA, 0, Image::ALPHA_BLEND, etc1) == PICA_TEXTURE_LA8);
+	CHECK(pica_texture_format_select(Image::FORMAT_RGB, 0, Image::ALPHA_NONE, compact) == PICA_TEXTURE_RGB565);
+	CHECK(pica_texture_format_select(Image::FORMAT_RGB, 0, Image::ALPHA_NONE, 0) == PICA_TEXTURE_RGBA8);
+	CHECK(pica_texture_format_select(Image::FORMAT_RGBA, 0, Image::ALPHA_NONE, compact) == PICA_TEXTURE_RGB565);
+	CHECK(pica_texture_format_select(Image::FORMAT_RGBA, 0, Image::ALPHA_BIT, compact) == PICA_TEXTURE_RGBA5551);
+	CHECK(pica_texture_format_select(Image::FORMAT_RGBA, 0, Image::ALPHA_BLEND, compact) == PICA_TEXTURE_RGBA4);
+	CHECK(pica_texture_format_select(Image::FORMAT_RGBA, 0, Image::ALPHA_BLEND, 0) == PICA_TEXTURE_RGBA8);
+	CHECK(pica_texture_format_select(Image::FORMAT_RGB, 0, Image::ALPHA_NONE, etc1) == PICA_TEXTURE_ETC1);
+	CHECK(pica_texture_format_select(Image::FORMAT_RGBA, 0, Image::ALPHA_BIT, etc1) == PICA_TEXTURE_ETC1A4);
+	CHECK(pica_texture_format_select(Image::FORMAT_ETC, 0, Image::ALPHA_NONE, 0) == PICA_TEXTURE_ETC1);
+	CHECK(pica_texture_format_select(Image::FORMAT_RGBA, VS::TEXTURE_FLAG_VIDEO_SURFACE, Image::ALPHA_BLEND, etc1) == PICA_TEXTURE_RGBA4);
+
+	CHECK(pica_texture_format_get_size(PICA_TEXTURE_RGBA8, 64, 64) == 64 * 64 * 4);
+	CHECK(pica_texture_format_get_size(PICA_TEXTURE_RGB565, 64, 64) == 64 * 64 * 2);
+	CHECK(pica_texture_format_get_size(PICA_TEXTURE_ETC1, 64, 64) == 64 * 64 / 2);
+	CHECK(pica_texture_format_get_size(PICA_TEXTURE_ETC1A4, 64, 64) == 64 * 64);
+
+	// Intensity images have no color of their own, it comes from the vertex
+	CHECK(pica_texture_format_is_alpha_only(PICA_TEXTURE_A8) && pica_texture_format_is_alpha_only(PICA_TEXTURE_A4));
+	CHECK(!pica_texture_format_is_alpha_only(PICA_TEXTURE_L8) && !pica_texture_format_is_alpha_only(PICA_TEXTURE_LA8));
+
+	return true;
+}
+
+bool test_texture_encode() {
+
+	OS::get_singleton()->print("\n\nTest: Pixels are packed into native formats\n");
+
+	const uint8_t rgba[8] = { 0xFF, 0x80, 0x08, 0x40, 0x00, 0xFF, 0x00, 0xFF };
+	uint16_t out16[2];
+	uint8_t out8[8];
+
+	pica_texture_encode(out16, PICA_TEXTURE_RGB565, rgba, 4, 2);
+	CHECK(out16[0] == ((0x1F << 11) | (0x20 << 5) | 0x01));
+	CHECK(out16[1] == (0x3F << 5));
+
+	pica_texture_encode(out16, PICA_TEXTURE_RGBA5551, rgba, 4, 2);
+	CHECK(out16[0] == ((0x1F << 11) | (0x10 << 6) | (0x01 << 1) | 0));
+	CHECK(out16[1] == ((0x1F << 6) | 1));
+
+	pica_texture_encode(out16, PICA_TEXTURE_RGBA4, rgba, 4, 2);
+	CHECK(out16[0] == 0xF804);
+	CHECK(out16[1] == 0x0F0F);
+
+	pica_texture_encode(out8, PICA_TEXTURE_RGBA8, rgba, 4, 2);
+	CHECK(out8[0] == 0x40 && out8[1] == 0x08 && out8[2] == 0x80 && out8[3] == 0xFF);
+
+	// RGB input is opaque
+	pica_texture_encode(out16, PICA_TEXTURE_RGBA4, rgba, 3, 1);
+	CHECK(out16[0] == 0xF80F);
+
+	const uint8_t la[4] = { 0x12, 0x34, 0x56, 0x78 };
+	pica_texture_encode(out16, PICA_TEXTURE_LA8, la, 2, 2);
+	CHECK(out16[0] == 0x1234 && out16[1] == 0x5678);
+
+	pica_texture_encode(out8, PICA_TEXTURE_A8, la, 1, 4);
+	CHECK(out8[0] == 0x12 && out8[3] == 0x78);
+
+	return true;
+}
+
+static bool _etc1_block_valid(const uint8_t *p_block) {
+
+	if (!(p_block[3] & 2))
+		return true;
+
+	for (int i = 0; i < 3; i++) {
+		int d = p_block[i] & 7;
+		int c = (p_block[i] >> 3) + (d >= 4 ? d - 8 : d);
+		if (c < 0 || c > 31)
+			return false; // would be an ETC2 mode
+	}
+	return true;
+}
+
+static void _etc1_random_block(uint8_t *r_block) {
+
+	do {
+		for (int i = 0; i < 8; i++)
+			r_block[i] = Math::rand() & 0xFF;
+	} while (!_etc1_block_valid(r_block));
+}
+
+bool test_etc1_block_flip() {
+
+	OS::get_singleton()->print("\n\nTest: Flipped ETC1 blocks decode upside down\n");
+
+	int lossy = 0;
+
+	for (int i = 0; i < 2000; i++) {
+		uint8_t block[8], flipped[8];
+		_etc1_random_block(block);
+		if (i < 8) {
+			// Make sure the differential corner cases show up
+			block[3] |= 3;
+			block[i % 3] = (block[i % 3] & 0xF8) | 4;
+			if ((block[i % 3] >> 3) < 4)
+				block[i % 3] |= 0x20;
+		}
+		if (!_etc1_block_valid(block))
+			continue;
+		memcpy(flipped, block, 8);
+		pica_etc1_block_flip(flipped);
+
+		uint8_t a[48], b[48];
+		pica_etc1_block_decode(block, a);
+		pica_etc1_block_decode(flipped, b);
+
+		// Only a -4 delta has to be requantized
+		int tolerance = 0;
+		if ((block[3] & 3) == 3 && ((block[0] & 7) == 4 || (block[1] & 7) == 4 || (block[2] & 7) == 4)) {
+			tolerance = 9;
+			lossy++;
+		}
+
+		for (int y = 0; y < 4; y++) {
+			for (int x = 0; x < 4; x++) {
+				for (int c = 0; c < 3; c++) {
+					int diff = a[(y * 4 + x) * 3 + c] - b[((3 - y) * 4 + x) * 3 + c];
+					if (ABS(diff) > tolerance) {
+						OS::get_singleton()->print("\tMismatch in block %i at %i,%i\n", i, x, y);
+						return false;
+					}
+				}
+			}
+		}
+	}
+
+	CHECK(lossy > 0);
+	return true;
+}
+
+// Samples a tiled ETC1/ETC1A4 texture the way the GPU does
+static void _etc1_sample(const uint8_t *p_tex, int p_width, int x, int y, bool p_alpha, uint8_t *r_rgba) {
+
+	int block_size = p_alpha ? 16 : 8;
+	int tile = (y / 8) * (p_width / 8) + x / 8;
+	int sub = (x % 8) / 4 + 2 * ((y % 8) / 4);
+	const uint8_t *ptr = p_tex + (tile * 4 + sub) * block_size;
+	x %= 4;
+	y %= 4;
+
+	r_rgba[3] = 255;
+	if (p_alpha) {
+		uint64_t alpha = 0;
+		for (int i = 0; i < 8; i++)
+			alpha |= uint64_t(ptr[i]) << (i * 8);
+		r_rgba[3] = ((alpha >> ((x * 4 + y) * 4)) & 0xF) * 17;
+		ptr += 8;
+	}
+
+	uint8_t block[8], rgb[48];
+	for (int i = 0; i < 8; i++)
+		block[i] = ptr[7 - i];
+	pica_etc1_block_decode(block, rgb);
+	for (int c = 0; c < 3; c++)
+		r_rgba[c] = rgb[(y * 4 + x) * 3 + c];
+}
+
+bool test_etc1_tile() {
+
+	OS::get_singleton()->print("\n\nTest: ETC1 blocks land where the GPU samples them\n");
+
+	// 16x8 image in a 16x16 texture, so the flip moves whole tiles
+	const int w = 16, h = 8, dw = 16, dh = 16;
+	const int blocks = (w / 4) * (h / 4);
+
+	Vector<uint8_t> etc;
+	etc.resize(blocks * 8);
+	for (int i = 0; i < blocks; i++)
+		_etc1_random_block(&etc[i * 8]);
+
+	Vector<uint8_t> rgba;
+	rgba.resize(w * h * 4);
+	for (int i = 0; i < rgba.size(); i++)
+		rgba[i] = Math::rand() & 0xFF;
+
+	for (int with_alpha = 0; with_alpha < 2; with_alpha++) {
+
+		Vector<uint8_t> tex;
+		tex.resize(pica_texture_format_get_size(with_alpha ? PICA_TEXTURE_ETC1A4 : PICA_TEXTURE_ETC1, dw, dh));
+		zeromem(tex.ptr(), tex.size());
+		pica_texture_tile_etc1(tex.ptr(), dw, dh, etc.ptr(), with_alpha ? rgba.ptr() : NULL, w, h);
+
+		for (int y = 0; y < h; y++) {
+			for (int x = 0; x < w; x++) {
+				// Source pixel
+				uint8_t rgb[48];
+				int bi = (y / 4) * (w / 4) + x / 4;
+				pica_etc1_block_decode(&etc[bi * 8], rgb);
+				const uint8_t *expected = &rgb[((y % 4) * 4 + x % 4) * 3];
+
+				uint8_t got[4];
+				_etc1_sample(tex.ptr(), dw, x, dh - 1 - y, with_alpha, got);
+
+				bool lossy = (etc[bi * 8 + 3] & 3) == 3;
+				for (int c = 0; c < 3; c++) {
+					int diff = expected[c] - got[c];
+					CHECK(ABS(diff) <= (lossy ? 9 : 0));
+				}
+				if (with_alpha)
+					CHECK(got[3] == (rgba[(y * w + x) * 4 + 3] >> 4) * 17);
+			}
+		}
+	}
+
+	return true;
+}
+
+bool test_ctex_roundtrip() {
+
+	OS::get_singleton()->print("\n\nTest: Pre-tiled .ctex textures match runtime conversion\n");
+
+	const int w = 20, h = 12;
+
+	DVector<uint8_t> pixels;
+	pixels.resize(w * h * 4);
+	{
+		DVector<uint8_t>::Write wr = pixels.write();
+		for (int i = 0; i < w * h; i++) {
+			wr[i * 4 + 0] = Math::rand() & 0xFF;
+			wr[i * 4 + 1] = Math::rand() & 0xFF;
+			wr[i * 4 + 2] = Math::rand() & 0xFF;
+			wr[i * 4 + 3] = (i & 1) ? 255 : 0; // one bit alpha
+		}
+	}
+	Image image(w, h, 0, Image::FORMAT_RGBA, pixels);
+
+	Vector<uint8_t> file;
+	CHECK(ctex_encode(image, VS::TEXTURE_FLAG_FILTER, PICA_TEXTURE_ALLOW_COMPACT, file) == OK);
+
+	CTexHeader header;
+	CHECK(ctex_decode_header(file.ptr(), file.size(), header) == OK);
+	CHECK(header.width == w && header.height == h);
+	CHECK(header.tex_width == 32 && header.tex_height == 16);
+	CHECK(header.format == PICA_TEXTURE_RGBA5551);
+	CHECK(header.flags == VS::TEXTURE_FLAG_FILTER);
+	CHECK(header.data_size == 32 * 16 * 2);
+	CHECK(file.size() == CTEX_HEADER_SIZE + header.data_size);
+
+	// Same texels the rasterizer would produce from the image
+	Vector<uint16_t> packed, tiled;
+	packed.resize(w * h);
+	tiled.resize(32 * 16);
+	zeromem(tiled.ptr(), tiled.size() * 2);
+	DVector<uint8_t>::Read r = pixels.read();
+	pica_texture_encode(packed.ptr(), PICA_TEXTURE_RGBA5551, r.ptr(), 4, w * h);
+	texture_tile_reference(tiled.ptr(), 32, 16, packed.ptr(), w, h, 2);
+	CHECK(memcmp(file.ptr() + CTEX_HEADER_SIZE, tiled.ptr(), header.data_size) == 0);
+
+	// Grayscale goes to L8 whatever the options
+	Image gray = image;
+	gray.convert(Image::FORMAT_GRAYSCALE);
+	CHECK(ctex_encode(gray, 0, 0, file) == OK);
+	CHECK(ctex_decode_header(file.ptr(), file.size(), header) == OK);
+	CHECK(header.format == PICA_TEXTURE_L8 && header.data_size == 32 * 16);
+
+	// Damaged files are refused
+	OS::get_singleton()->print("\t(errors below are expected)\n");
+	CHECK(ctex_decode_header(file.ptr(), file.size() - 1, header) != OK);
+	file[0] = 'X';
+	CHECK(ctex_decode_header(file.ptr(), file.size(), header) != OK);
+
+	return true;
+}
+
+class TextureAtlasHeapBackend : public TextureAtlas::Backend {
+public:
+	int allocs;
+	int frees;
+
+	virtual bool atlas_page_alloc(TextureAtlas::Page *p_page) {
+		int size = pica_texture_format_get_size(p_page->format, p_page->size, p_page->size);
+		p_page->data = memalloc(size);
+		zeromem(p_page->data, size);
+		allocs++;
+		return true;
+	}
+	virtual void atlas_page_free(TextureAtlas::Page *p_page) {
+		memfree(p_page->data);
+		p_page->data = NULL;
+		frees++;
+	}
+
+	TextureAtlasHeapBackend() {
+		allocs = frees = 0;
+	}
+};
+
+static bool _atlas_cells_valid(const TextureAtlas &p_atlas) {
+
+	for (int i = 0; i < p_atlas.get_page_count(); i++) {
+
+		const TextureAtlas::Page *page = p_atlas.get_page(i);
+		for (int j = 0; j < page->entries.size(); j++) {
+
+			const TextureAtlas::Entry *e = page->entries[j];
+			Rect2 cell(e->cell_pos, e->get_cell_size());
+			if (e->page != page || (e->cell_pos.x & 7) || (e->cell_pos.y & 7))
+				return false;
+			if (cell.pos.x < 0 || cell.pos.y < 0 || cell.pos.x + cell.size.x > page->size || cell.pos.y + cell.size.y > page->size)
+				return false;
+
+			for (int k = 0; k < j; k++) {
+				const TextureAtlas::Entry *o = page->entries[k];
+				if (cell.intersects(Rect2(o->cell_pos, o->get_cell_size())))
+					return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+bool test_texture_atlas_pack() {
+
+	OS::get_singleton()->print("\n\nTest: Texture atlas packs NPOT textures into shared pages\n");
+
+	TextureAtlasHeapBackend backend;
+	TextureAtlas atlas;
+	atlas.set_backend(&backend);
+
+	CHECK(!TextureAtlas::can_store(300, 16, PICA_TEXTURE_RGBA4));
+	CHECK(!TextureAtlas::can_store(16, 16, PICA_TEXTURE_ETC1));
+	CHECK(TextureAtlas::can_store(100, 30, PICA_TEXTURE_RGBA4));
+
+	Vector<TextureAtlas::Entry *> entries;
+	int area = 0;
+	for (int i = 0; i < 120; i++) {
+		int w = 5 + Math::rand() % 60;
+		int h = 5 + Math::rand() % 60;
+		TextureAtlas::Entry *e = atlas.add(w, h, PICA_TEXTURE_RGBA4);
+		CHECK(e);
+		entries.push_back(e);
+		area += w * h;
+	}
+
+	OS::get_singleton()->print("\t%i pages, %i repacks, efficiency %.1f%%\n", atlas.get_page_count(), atlas.get_repack_count(), atlas.get_efficiency() * 100.0);
+	// Would be over a hundred pow2 textures on their own
+	CHECK(atlas.get_page_count() == 1);
+	CHECK(atlas.get_efficiency() > 0.4);
+
+	// One format mixed in gets its own page
+	TextureAtlas::Entry *gray = atlas.add(33, 17, PICA_TEXTURE_L8);
+	CHECK(gray && gray->page->format == PICA_TEXTURE_L8);
+	CHECK(gray->get_rect() == Rect2(gray->cell_pos.x + 1, gray->cell_pos.y + 1, 33, 17));
+	CHECK(gray->get_cell_size() == Size2i(40, 24));
+
+	CHECK(_atlas_cells_valid(atlas));
+
+	int page_area = 0;
+	for (int i = 0; i < atlas.get_page_count(); i++)
+		page_area += atlas.get_page(i)->size * atlas.get_page(i)->size;
+	area += 33 * 17;
+
+	CHECK(backend.allocs - backend.frees == atlas.get_page_count());
+	CHECK(Math::abs(atlas.get_efficiency() - float(area) / page_area) < 0.001);
+
+	// Holes are reused once the page is repacked
+	for (int i = 0; i < entries.size(); i += 2) {
+		atlas.remove(entries[i]);
+		entries[i] = NULL;
+	}
+	int pages = atlas.get_page_count();
+	for (int i = 0; i < 30; i++)
+		CHECK(atlas.add(20, 20, PICA_TEXTURE_RGBA4));
+	CHECK(atlas.get_page_count() == pages);
+	CHECK(_atlas_cells_valid(atlas));
+
+	atlas.remove(gray);
+	CHECK(atlas.get_page_count() == pages - 1);
+
+	atlas.clear();
+	CHECK(atlas.get_page_count() == 0 && atlas.get_efficiency() == 0);
+	CHECK(backend.allocs == backend.frees);
+
+	return true;
+}
+
+static bool _atlas_entry_matches(const TextureAtlas::Entry *p_entry, const uint8_t *p_pixels) {
+
+	const TextureAtlas::Page *page = p_entry->page;
+	const uint8_t *data = (const uint8_t *)page->data;
+	int w = p_entry->width;
+	int h = p_entry->height;
+	int b = p_entry->border;
+
+	// Content plus the border, which repeats the closest edge texel
+	for (int y = -b; y < h + b; y++) {
+		for (int x = -b; x < w + b; x++) {
+			int px = p_entry->cell_pos.x + b + x;
+			int py = p_entry->cell_pos.y + b + y;
+			uint8_t expected = p_pixels[CLAMP(y, 0, h - 1) * w + CLAMP(x, 0, w - 1)];
+			if (data[texture_tile_get_index(px, py, page->size, page->size)] != expected)
+				return false;
+		}
+	}
+
+	return true;
+}
+
+bool test_texture_atlas_blit() {
+
+	OS::get_singleton()->print("\n\nTest: Texture atlas keeps texels in place across repacks\n");
+
+	TextureAtlasHeapBackend backend;
+	TextureAtlas atlas;
+	atlas.set_backend(&backend);
+
+	Vector<TextureAtlas::Entry *> entries;
+	Vector<DVector<uint8_t> > pixels;
+
+	for (int i = 0; i < 40; i++) {
+
+		int w = 3 + Math::rand() % 50;
+		int h = 3 + Math::rand() % 50;
+		DVector<uint8_t> data;
+		data.resize(w * h);
+		{
+			DVector<uint8_t>::Write wr = data.write();
+			for (int j = 0; j < w * h; j++)
+				wr[j] = Math::rand() & 0xFF;
+		}
+
+		TextureAtlas::Entry *e = atlas.add(w, h, PICA_TEXTURE_L8);
+		CHECK(e);
+
+		if (i & 1) {
+			CHECK(atlas.set_image(e, Image(w, h, 0, Image::FORMAT_GRAYSCALE, data)) == OK);
+		} else {
+			// Pre-tiled, as loaded from a .ctex
+			int tw = pica_texture_get_dimension(w);
+			int th = pica_texture_get_dimension(h);
+			Vector<uint8_t> tiled;
+			tiled.resize(tw * th);
+			zeromem(tiled.ptr(), tiled.size());
+			DVector<uint8_t>::Read r = data.read();
+			texture_tile(tiled.ptr(), tw, th, r.ptr(), w, h, 1);
+			CHECK(atlas.set_tiled(e, tiled.ptr(), tw, th) == OK);
+		}
+
+		entries.push_back(e);
+		pixels.push_back(data);
+	}
+
+	// Punch holes and keep adding until the page has to be laid out again
+	for (int i = 0; i < entries.size(); i += 3) {
+		atlas.remove(entries[i]);
+		entries[i] = NULL;
+	}
+	for (int i = 0; i < 100 && atlas.get_repack_count() == 0; i++)
+		CHECK(atlas.add(40, 40, PICA_TEXTURE_L8));
+
+	CHECK(atlas.get_repack_count() > 0);
+	CHECK(_atlas_cells_valid(atlas));
+
+	for (int i = 0; i < entries.size(); i++) {
+		if (!entries[i])
+			continue;
+		DVector<uint8_t>::Read r = pixels[i].read();
+		CHECK(_atlas_entry_matches(entries[i], r.ptr()));
+	}
+
+	// Borderless entries copy whole tiles
+	DVector<uint8_t> data;
+	data.resize(16 * 8);
+	{
+		DVector<uint8_t>::Write wr = data.write();
+		for (int j = 0; j < data.size(); j++)
+			wr[j] = j;
+	}
+	uint8_t tiled[16 * 8];
+	DVector<uint8_t>::Read r = data.read();
+	texture_tile(tiled, 16, 8, r.ptr(), 16, 8, 1);
+	TextureAtlas::Entry *e = atlas.add(16, 8, PICA_TEXTURE_L8, 0);
+	CHECK(e && e->get_cell_size() == Size2i(16, 8));
+	CHECK(atlas.set_tiled(e, tiled, 16, 8) == OK);
+	CHECK(_atlas_entry_matches(e, r.ptr()));
+
+	return true;
+}
+
+class MemoryBudgetStub : public GPUMemoryBudget::Backend {
+public:
+	GPUMemoryBudget *budget;
+	Vector<int> evicted; // owner ids, in eviction order
+	int pinned; // refuses to evict this owner
+	int suspend_evictions;
+
+	virtual bool budget_evict(GPUMemoryBudget::Item *p_item) {
+		int id = (intptr_t)p_item->owner;
+		if (id == pinned)
+			return false;
+		budget->remove(p_item);
+		evicted.push_back(id);
+		if (budget->is_suspending())
+			suspend_evictions++;
+		return true;
+	}
+
+	MemoryBudgetStub() {
+		budget = NULL;
+		pinned = -1;
+		suspend_evictions = 0;
+	}
+};
+
+bool test_memory_budget() {
+
+	OS::get_singleton()->print("\n\nTest: GPU memory budget accounting and LRU eviction\n");
+
+	GPUMemoryBudget budget;
+	MemoryBudgetStub stub;
+	stub.budget = &budget;
+	budget.set_backend(&stub);
+
+	GPUMemoryBudget::Item items[6];
+	for (int i = 0; i < 6; i++)
+		items[i].owner = (void *)(intptr_t)i;
+
+	// Accounting per category
+	budget.allocated(GPUMemoryBudget::CATEGORY_VERTEX, 4000);
+	budget.allocated(GPUMemoryBudget::CATEGORY_INDEX, 1000);
+	for (int i = 0; i < 6; i++)
+		budget.add(&items[i], GPUMemoryBudget::CATEGORY_TEXTURE, 1000);
+	CHECK(budget.get_usage(GPUMemoryBudget::CATEGORY_TEXTURE) == 6000);
+	CHECK(budget.get_usage(GPUMemoryBudget::CATEGORY_VERTEX) == 4000);
+	CHECK(budget.get_usage(GPUMemoryBudget::CATEGORY_INDEX) == 1000);
+	CHECK(budget.get_total_usage() == 11000);
+
+	budget.remove(&items[5]);
+	budget.freed(GPUMemoryBudget::CATEGORY_VERTEX, 1000);
+	CHECK(budget.get_total_usage() == 9000 && budget.get_peak_usage() == 11000);
+
+	// No budget, nothing goes
+	CHECK(budget.enforce());
+	budget.set_budget(6000);
+
+	// Everything was used this frame, nothing can go yet
+	CHECK(!budget.enforce());
+	CHECK(stub.evicted.size() == 0);
+
+	// Bind order 3, 0, 4 over the frames, 1 and 2 stay untouched
+	for (int i = 0; i < GPUMemoryBudget::EVICT_FRAME_DELAY; i++)
+		budget.advance_frame();
+	budget.touch(&items[3]);
+	budget.touch(&items[0]);
+	budget.touch(&items[4]);
+	budget.advance_frame();
+
+	// Only 1 and 2 are idle long enough, 3 and 0 are still busy
+	CHECK(!budget.enforce());
+	CHECK(stub.evicted.size() == 2 && stub.evicted[0] == 1 && stub.evicted[1] == 2);
+	CHECK(budget.get_total_usage() == 7000);
+
+	// Least recently bound goes first once idle, pinned items are skipped
+	budget.advance_frame();
+	stub.pinned = 3;
+	CHECK(budget.enforce());
+	CHECK(stub.evicted.size() == 3 && stub.evicted[2] == 0);
+	CHECK(items[3].tracked && !items[0].tracked && items[4].tracked);
+	CHECK(budget.get_eviction_count() == 3);
+
+	// Making room for a new allocation
+	stub.pinned = -1;
+	CHECK(budget.enforce(2000));
+	CHECK(stub.evicted.size() == 5 && stub.evicted[3] == 3 && stub.evicted[4] == 4);
+	CHECK(budget.get_usage(GPUMemoryBudget::CATEGORY_TEXTURE) == 0);
+
+	// Non evictable items count but never go
+	budget.add(&items[0], GPUMemoryBudget::CATEGORY_TEXTURE, 8000, false);
+	for (int i = 0; i < 4; i++)
+		budget.advance_frame();
+	CHECK(!budget.enforce());
+	CHECK(items[0].tracked && stub.evicted.size() == 5);
+	budget.set_evictable(&items[0], true);
+	CHECK(budget.evict(1) == 8000);
+	CHECK(budget.get_total_usage() == 4000);
+
+	budget.freed(GPUMemoryBudget::CATEGORY_VERTEX, 3000);
+	budget.freed(GPUMemoryBudget::CATEGORY_INDEX, 1000);
+	CHECK(budget.get_total_usage() == 0);
+
+	return true;
+}
+
+bool test_memory_budget_suspend() {
+
+	OS::get_singleton()->print("\n\nTest: GPU memory release on suspend and lazy restore\n");
+
+	GPUMemoryBudget budget;
+	MemoryBudgetStub stub;
+	stub.budget = &budget;
+	budget.set_backend(&stub);
+	budget.set_budget(100000);
+
+	GPUMemoryBudget::Item items[5];
+	for (int i = 0; i < 5; i++) {
+		items[i].owner = (void *)(intptr_t)i;
+		budget.add(&items[i], GPUMemoryBudget::CATEGORY_TEXTURE, 1000, i != 4);
+	}
+	budget.allocated(GPUMemoryBudget::CATEGORY_VERTEX, 500);
+
+	// All of them were bound this frame, regular eviction leaves them alone
+	CHECK(budget.evict(5000) == 0);
+	CHECK(!budget.is_suspending());
+
+	// Suspending doesn't wait for items to go idle, but still skips pinned
+	// and non evictable ones
+	stub.pinned = 2;
+	CHECK(budget.suspend() == 3000);
+	CHECK(!budget.is_suspending());
+	CHECK(stub.suspend_evictions == 3 && stub.evicted.size() == 3);
+	CHECK(items[0].suspended && items[1].suspended && items[3].suspended);
+	CHECK(!items[2].suspended && items[2].tracked);
+	CHECK(!items[4].suspended && items[4].tracked);
+	CHECK(budget.get_usage(GPUMemoryBudget::CATEGORY_TEXTURE) == 2000);
+	CHECK(budget.get_total_usage() == 2500);
+
+	// Nothing comes back until it is used
+	budget.advance_frame();
+	CHECK(budget.get_restore_count() == 0);
+	budget.add(&items[3], GPUMemoryBudget::CATEGORY_TEXTURE, 1000);
+	CHECK(!items[3].suspended && budget.get_restore_count() == 1);
+	CHECK(items[0].suspended && items[1].suspended);
+
+	// A later eviction over budget is not a suspend
+	for (int i = 0; i < GPUMemoryBudget::EVICT_FRAME_DELAY; i++)
+		budget.advance_frame();
+	stub.pinned = -1;
+	CHECK(budget.evict(1) == 1000);
+	CHECK(stub.suspend_evictions == 3 && !items[2].suspended);
+
+	budget.add(&items[0], GPUMemoryBudget::CATEGORY_TEXTURE, 1000);
+	CHECK(budget.get_restore_count() == 2);
+
+	budget.remove(&items[0]);
+	budget.remove(&items[3]);
+	budget.remove(&items[4]);
+	budget.freed(GPUMemoryBudget::CATEGORY_VERTEX, 500);
+	CHECK(budget.get_total_usage() == 0);
+
+	return true;
+}
+
+static float _rand_range(float p_from, float p_to) {
+
+	return p_from + (p_to - p_from) * (Math::rand() % 10001) / 10000.0;
+}
+
+static Array _make_vertex_arrays(int p_vertices, int p_indices, bool p_colors) {
+
+	DVector<Vector3> vertices, normals;
+	DVector<Vector2> uvs;
+	DVector<Color> colors;
+	IntArray indices;
+
+	for (int i = 0; i < p_vertices; i++) {
+		vertices.push_back(Vector3(_rand_range(-3, 5), _rand_range(10, 10.5), _rand_range(-100, 0)));
+		normals.push_back(Vector3(_rand_range(-1, 1), _rand_range(-1, 1), _rand_range(-1, 1)).normalized());
+		uvs.push_back(Vector2(_rand_range(0, 1), _rand_range(-2, 2)));
+		colors.push_back(Color(_rand_range(0, 1), _rand_range(0, 1), _rand_range(0, 1), 1.0));
+	}
+	for (int i = 0; i < p_indices; i++)
+		indices.push_back(Math::rand() % p_vertices);
+
+	Array arrays;
+	arrays.resize(VS::ARRAY_MAX);
+	arrays[VS::ARRAY_VERTEX] = vertices;
+	arrays[VS::ARRAY_NORMAL] = normals;
+	arrays[VS::ARRAY_TEX_UV] = uvs;
+	if (p_colors)
+		arrays[VS::ARRAY_COLOR] = colors;
+	if (p_indices)
+		arrays[VS::ARRAY_INDEX] = indices;
+	return arrays;
+}
+
+static bool _check_vertex_pack(const Array &p_arrays, uint32_t p_format) {
+
+	PicaVertexLayout layout;
+	CHECK(pica_vertex_layout_create(p_arrays, p_format, layout) == OK);
+
+	Vector<uint8_t> vertex_data, index_data;
+	vertex_data.resize(layout.vertex_count * layout.stride);
+	index_data.resize(MAX(layout.index_count * layout.index_size, 1));
+	CHECK(pica_vertex_pack(p_arrays, layout, vertex_data.ptr(), index_data.ptr()) == OK);
+
+	// Loader rules: component aligned offsets, in order, inside the stride
+	int end = 0;
+	for (int i = 0; i < layout.attrib_count; i++) {
+		const PicaVertexLayout::Attrib &a = layout.attribs[i];
+		CHECK(a.offset % (a.get_size() / a.count) == 0 && a.offset >= end);
+		end = a.offset + a.get_size();
+		CHECK(end <= layout.stride);
+	}
+
+	Transform xform = layout.get_position_transform();
+	const uint8_t *data = vertex_data.ptr();
+
+	DVector<Vector3> vertices = p_arrays[VS::ARRAY_VERTEX];
+	const PicaVertexLayout::Attrib *pos = layout.get_attrib(VS::ARRAY_VERTEX);
+	CHECK(pos && pos->type == PICA_ATTRIB_SHORT && pos->count == 3);
+	for (int i = 0; i < vertices.size(); i++) {
+		const int16_t *p = (const int16_t *)(data + i * layout.stride + pos->offset);
+		Vector3 v = xform.xform(Vector3(p[0], p[1], p[2]));
+		CHECK(layout.aabb.grow(layout.position_scale).has_point(v));
+		CHECK((v - vertices[i]).length() <= layout.position_scale);
+	}
+
+	const PicaVertexLayout::Attrib *normal = layout.get_attrib(VS::ARRAY_NORMAL);
+	CHECK(bool(normal) == bool(p_format & VS::ARRAY_FORMAT_NORMAL));
+	if (normal) {
+		DVector<Vector3> normals = p_arrays[VS::ARRAY_NORMAL];
+		for (int i = 0; i < normals.size(); i++) {
+			const int8_t *n = (const int8_t *)(data + i * layout.stride + normal->offset);
+			Vector3 decoded = Vector3(n[0], n[1], n[2]).normalized();
+			CHECK(decoded.dot(normals[i]) > 0.999);
+		}
+	}
+
+	const PicaVertexLayout::Attrib *color = layout.get_attrib(VS::ARRAY_COLOR);
+	if (color) {
+		DVector<Color> colors = p_arrays[VS::ARRAY_COLOR];
+		for (int i = 0; i < colors.size(); i++) {
+			const uint8_t *c = data + i * layout.stride + color->offset;
+			for (int j = 0; j < 4; j++)
+				CHECK(Math::abs(c[j] / 255.0 - colors[i][j]) <= 0.5 / 255.0 + CMP_EPSILON);
+		}
+	}
+
+	const PicaVertexLayout::Attrib *uv = layout.get_attrib(VS::ARRAY_TEX_UV);
+	if (uv) {
+		DVector<Vector2> uvs = p_arrays[VS::ARRAY_TEX_UV];
+		for (int i = 0; i < uvs.size(); i++) {
+			const float *t = (const float *)(data + i * layout.stride + uv->offset);
+			CHECK(t[0] == uvs[i].x && t[1] == uvs[i].y);
+		}
+	}
+
+	if (layout.index_count) {
+		IntArray indices = p_arrays[VS::ARRAY_INDEX];
+		CHECK(layout.index_size == (layout.vertex_count > 256 ? 2 : 1));
+		for (int i = 0; i < indices.size(); i++) {
+			int index = layout.index_size == 2 ? ((const uint16_t *)index_data.ptr())[i] : index_data[i];
+			CHECK(index == indices[i]);
+		}
+	}
+
+	return true;
+}
+
+bool test_vertex_pack() {
+
+	OS::get_singleton()->print("\n\nTest: Compact interleaved vertex packing\n");
+
+	uint32_t all = VS::ARRAY_FORMAT_VERTEX | VS::ARRAY_FORMAT_NORMAL | VS::ARRAY_FORMAT_COLOR | VS::ARRAY_FORMAT_TEX_UV | VS::ARRAY_FORMAT_INDEX;
+
+	// Everything: short3 at 0, byte3 at 6, ubyte4 at 9, float2 at 16
+	Array arrays = _make_vertex_arrays(200, 600, true);
+	PicaVertexLayout layout;
+	CHECK(pica_vertex_layout_create(arrays, all, layout) == OK);
+	CHECK(layout.attrib_count == 4 && layout.stride == 24);
+	CHECK(layout.attribs[2].offset == 9 && layout.attribs[3].offset == 16);
+	CHECK(layout.get_permutation() == 0x3210);
+	CHECK(!layout.has_alpha);
+	CHECK(_check_vertex_pack(arrays, all));
+
+	// Rasterizer format, 16 bit indices; 20 bytes per vertex against 32 as floats
+	arrays = _make_vertex_arrays(1000, 3000, false);
+	uint32_t format = VS::ARRAY_FORMAT_VERTEX | VS::ARRAY_FORMAT_NORMAL | VS::ARRAY_FORMAT_TEX_UV | VS::ARRAY_FORMAT_INDEX;
+	CHECK(pica_vertex_layout_create(arrays, format, layout) == OK);
+	CHECK(layout.stride == 20 && layout.index_size == 2);
+	CHECK(_check_vertex_pack(arrays, format));
+
+	// Positions only, unindexed
+	CHECK(_check_vertex_pack(arrays, VS::ARRAY_FORMAT_VERTEX));
+	CHECK(pica_vertex_layout_create(arrays, VS::ARRAY_FORMAT_VERTEX, layout) == OK);
+	CHECK(layout.attrib_count == 1 && layout.stride == 6 && layout.index_count == 0);
+
+	// Degenerate extent still decodes
+	arrays = _make_vertex_arrays(3, 3, false);
+	DVector<Vector3> flat;
+	for (int i = 0; i < 3; i++)
+		flat.push_back(Vector3(1, 2, 3));
+	arrays[VS::ARRAY_VERTEX] = flat;
+	CHECK(_check_vertex_pack(arrays, format));
+
+	// Translucent vertex colors
+	arrays = _make_vertex_arrays(10, 0, true);
+	DVector<Color> colors = arrays[VS::ARRAY_COLOR];
+	colors.set(3, Color(1, 1, 1, 0.5));
+	arrays[VS::ARRAY_COLOR] = colors;
+	CHECK(pica_vertex_layout_create(arrays, all, layout) == OK);
+	CHECK(layout.has_alpha);
+
+	// Malformed input
+	OS::get_singleton()->print("\t(errors below are expected)\n");
+	arrays = _make_vertex_arrays(10, 6, false);
+	IntArray bad_indices = arrays[VS::ARRAY_INDEX];
+	bad_indices.set(2, 10);
+	arrays[VS::ARRAY_INDEX] = bad_indices;
+	CHECK(pica_vertex_layout_create(arrays, format, layout) == OK);
+	Vector<uint8_t> vertex_data, index_data;
+	vertex_data.resize(layout.vertex_count * layout.stride);
+	index_data.resize(layout.index_count);
+	CHECK(pica_vertex_pack(arrays, layout, vertex_data.ptr(), index_data.ptr()) != OK);
+
+	// UVs are read as Vector2, a Vector3 array is rejected instead of misread
+	arrays = _make_vertex_arrays(10, 6, false);
+	DVector<Vector3> uv3;
+	for (int i = 0; i < 10; i++)
+		uv3.push_back(Vector3(i, i, i));
+	arrays[VS::ARRAY_TEX_UV] = uv3;
+	CHECK(pica_vertex_layout_create(arrays, format, layout) == OK);
+	vertex_data.resize(layout.vertex_count * layout.stride);
+	index_data.resize(layout.index_count * layout.index_size);
+	CHECK(pica_vertex_pack(arrays, layout, vertex_data.ptr(), index_data.ptr()) != OK);
+
+	arrays[VS::ARRAY_VERTEX] = Variant();
+	CHECK(pica_vertex_layout_create(arrays, format, layout) != OK);
+
+	return true;
+}
+
+bool test_multimesh_batches() {
+
+	OS::get_singleton()->print("\n\nTest: MultiMesh batch bounds and culling\n");
+
+	// A row of 100 instances along +x, one unit apart
+	Vector<Transform> xforms;
+	for (int i = 0; i < 100; i++)
+		xforms.push_back(Transform(Matrix3(), Vector3(i, 0, 0)));
+
+	AABB mesh_aabb(Vector3(-0.5, -0.5, -0.5), Vector3(1, 1, 1));
+	Vector<MultiMeshBatcher::Batch> batches;
+	MultiMeshBatcher::build_batches(xforms.ptr(), xforms.size(), sizeof(Transform), mesh_aabb, batches);
+	CHECK(batches.size() == 4);
+	CHECK(batches[3].from == 96 && batches[3].count == 4);
+	for (int b = 0; b < batches.size(); b++) {
+		const MultiMeshBatcher::Batch &batch = batches[b];
+		CHECK((batch.aabb.pos - Vector3(batch.from - 0.5, -0.5, -0.5)).length() < CMP_EPSILON);
+		CHECK(Math::abs(batch.aabb.size.x - batch.count) < CMP_EPSILON);
+	}
+
+	// Slab keeping 20 < x < 70, everything visible is merged into one run
+	Plane planes[2] = { Plane(Vector3(-1, 0, 0), -20), Plane(Vector3(1, 0, 0), 70) };
+	Vector<MultiMeshBatcher::Batch> visible;
+	MultiMeshBatcher::cull_batches(batches, 100, Transform(), planes, 2, visible);
+	CHECK(visible.size() == 1 && visible[0].from == 0 && visible[0].count == 96);
+
+	// The multimesh moved by 40, first batch leaves the slab
+	MultiMeshBatcher::cull_batches(batches, 100, Transform(Matrix3(), Vector3(-40, 0, 0)), planes, 2, visible);
+	CHECK(visible.size() == 1 && visible[0].from == 32 && visible[0].count == 68);
+
+	// Visible instance limit cuts the last run short
+	MultiMeshBatcher::cull_batches(batches, 70, Transform(Matrix3(), Vector3(-40, 0, 0)), planes, 2, visible);
+	CHECK(visible.size() == 1 && visible[0].count == 38);
+
+	// Gaps keep runs apart
+	Plane far_planes[1] = { Plane(Vector3(0, -1, 0), 5) };
+	for (int i = 32; i < 64; i++)
+		xforms[i].origin.y = -10;
+	MultiMeshBatcher::build_batches(xforms.ptr(), xforms.size(), sizeof(Transform), mesh_aabb, batches);
+	MultiMeshBatcher::cull_batches(batches, 100, Transform(), far_planes, 1, visible);
+	CHECK(visible.size() == 2 && visible[0].count == 32 && visible[1].from == 64);
+
+	return true;
+}
+
+bool test_multimesh_pretransform() {
+
+	OS::get_singleton()->print("\n\nTest: MultiMesh CPU pre-transform\n");
+
+	Array arrays = _make_vertex_arrays(24, 36, false);
+	uint32_t format = VS::ARRAY_FORMAT_VERTEX | VS::ARRAY_FORMAT_NORMAL | VS::ARRAY_FORMAT_TEX_UV | VS::ARRAY_FORMAT_INDEX;
+
+	PicaVertexLayout layout;
+	CHECK(pica_vertex_layout_create(arrays, format, layout) == OK);
+	Vector<uint8_t> vertex_data, index_data;
+	vertex_data.resize(layout.vertex_count * layout.stride);
+	index_data.resize(layout.index_count * layout.index_size);
+	CHECK(pica_vertex_pack(arrays, layout, vertex_data.ptr(), index_data.ptr()) == OK);
+
+	PicaVertexLayout dest;
+	MultiMeshBatcher::make_pretransform_layout(layout, dest);
+	CHECK(dest.attribs[0].type == PICA_ATTRIB_FLOAT && dest.stride == 24 && dest.index_size == 2);
+	CHECK(MultiMeshBatcher::get_pretransform_max_instances(layout) == 65536 / 24);
+
+	const int count = 5;
+	Vector<Transform> xforms;
+	for (int i = 0; i < count; i++)
+		xforms.push_back(Transform(Matrix3(Vector3(0, 1, 0), i * 0.7).scaled(Vector3(1 + i, 1 + i, 1 + i)), Vector3(i * 10, -i, 3)));
+
+	Vector<uint8_t> out_vertices;
+	Vector<uint16_t> out_indices;
+	out_vertices.resize(count * layout.vertex_count * dest.stride);
+	out_indices.resize(count * layout.index_count);
+	MultiMeshBatcher::pretransform(layout, vertex_data.ptr(), index_data.ptr(), dest, xforms.ptr(), count, sizeof(Transform), out_vertices.ptr(), out_indices.ptr());
+
+	DVector<Vector3> vertices = arrays[VS::ARRAY_VERTEX];
+	DVector<Vector3> normals = arrays[VS::ARRAY_NORMAL];
+	DVector<Vector2> uvs = arrays[VS::ARRAY_TEX_UV];
+	IntArray indices = arrays[VS::ARRAY_INDEX];
+
+	for (int n = 0; n < count; n++) {
+		float tolerance = layout.position_scale * (1 + n) * 2;
+		for (int i = 0; i < layout.vertex_count; i++) {
+			const uint8_t *v = out_vertices.ptr() + (n * layout.vertex_count + i) * dest.stride;
+			const float *pos = (const float *)(v + dest.attribs[0].offset);
+			CHECK((Vector3(pos[0], pos[1], pos[2]) - xforms[n].xform(vertices[i])).length() <= tolerance);
+
+			const int8_t *nrm = (const int8_t *)(v + dest.attribs[1].offset);
+			Vector3 expected = xforms[n].basis.xform(normals[i]).normalized();
+			CHECK(Vector3(nrm[0], nrm[1], nrm[2]).normalized().dot(expected) > 0.998);
+
+			const float *uv = (const float *)(v + dest.attribs[2].offset);
+			CHECK(uv[0] == uvs[i].x && uv[1] == uvs[i].y);
+		}
+		for (int i = 0; i < layout.index_count; i++)
+			CHECK(out_indices[n * layout.index_count + i] == n * layout.vertex_count + indices[i]);
+	}
+
+	return true;
+}
+
+bool test_audio_convert() {
+
+	OS::get_singleton()->print("\n\nTest: Saturating int32 to int16 sample conversion\n");
+
+	const int32_t edge[] = { 0x7FFFFFFF, 0x7FFF8000, 0x7FFF7FFF, -0x7FFFFFFF - 1, -1, 0, 0x8000, 0x7FFF, -0x8000, -0x8001, 0x12345678 };
+	const int16_t expected[] = { 32767, 32767, 32767, -32768, 0, 0, 1, 0, 0, -1, 0x1234 };
+	const int edge_count = sizeof(edge) / sizeof(edge[0]);
+
+	// Every count and both alignments, including the odd leftovers
+	int16_t out[edge_count + 2];
+	for (int offset = 0; offset < 2; offset++) {
+		for (int count = 0; count <= edge_count; count++) {
+			for (int i = 0; i < edge_count + 2; i++)
+				out[i] = 0x5555;
+			AudioPump::convert_to_int16(edge, out + offset, count);
+			for (int i = 0; i < count; i++)
+				CHECK(out[offset + i] == expected[i]);
+			CHECK(out[offset + count] == 0x5555);
+			if (offset)
+				CHECK(out[0] == 0x5555);
+		}
+	}
+
+	return true;
+}
+
+// Plays back buffers when told to, like the DSP would
+class FakeAudioSink : public AudioPump::Sink {
+public:
+	int16_t buffers[4][64];
+	bool done[4];
+	int queue[64];
+	int queue_first, queue_last;
+	int submitted;
+
+	virtual int16_t *sink_get_buffer(int p_index) {
+		done[p_index] = false;
+		return buffers[p_index];
+	}
+	virtual bool sink_is_buffer_done(int p_index) const { return done[p_index]; }
+	virtual void sink_submit_buffer(int p_index, int p_frames) {
+		queue[queue_last++ % 64] = p_index;
+		submitted++;
+	}
+
+	void play(int p_buffers) {
+		for (int i = 0; i < p_buffers && queue_first < queue_last; i++)
+			done[queue[queue_first++ % 64]] = true;
+	}
+
+	FakeAudioSink() {
+		for (int i = 0; i < 4; i++)
+			done[i] = true;
+		queue_first = queue_last = 0;
+		submitted = 0;
+	}
+};
+
+static void _audio_test_mix(void *p_userdata, int p_frames, int32_t *r_buffer) {
+
+	int *counter = (int *)p_userdata;
+	for (int i = 0; i < p_frames * 2; i++)
+		r_buffer[i] = (*counter) << 16;
+	(*counter)++;
+}
+
+bool test_audio_pump() {
+
+	OS::get_singleton()->print("\n\nTest: Audio pump ring and underruns\n");
+
+	FakeAudioSink sink;
+	int mixed = 0;
+	AudioPump pump;
+	pump.setup(&sink, 3, 32, 2, _audio_test_mix, &mixed);
+
+	// Not started yet, the ring fills with silence
+	CHECK(pump.pump(false) == 3);
+	CHECK(mixed == 0 && sink.buffers[1][5] == 0);
+	CHECK(pump.pump(false) == 0);
+
+	// Silence running out is not an underrun
+	sink.play(3);
+	CHECK(pump.pump(true) == 3);
+	CHECK(pump.get_underrun_count() == 0);
+	CHECK(mixed == 3);
+
+	// Refills follow playback order, one mix per buffer
+	sink.play(1);
+	CHECK(pump.pump(true) == 1);
+	CHECK(sink.queue[(sink.queue_last - 1) % 64] == 0);
+	CHECK(sink.buffers[0][63] == 3);
+	sink.play(2);
+	CHECK(pump.pump(true) == 2);
+	CHECK(sink.buffers[1][0] == 4 && sink.buffers[2][0] == 5);
+	CHECK(pump.get_underrun_count() == 0);
+
+	// The DSP plays everything before the pump runs
+	sink.play(3);
+	CHECK(pump.pump(true) == 3);
+	CHECK(pump.get_underrun_count() == 1);
+	CHECK(pump.pump(true) == 0);
+	CHECK(pump.get_underrun_count() == 1);
+
+	CHECK(sink.submitted == 12);
+	CHECK(pump.get_next_buffer() == 0);
+
+	return true;
+}
+
+class RecordingInputSink : public InputBatcher::Sink {
+public:
+	Vector<InputEvent> events;
+	int axis_events[JOY_AXIS_MAX];
+	float axis_values[JOY_AXIS_MAX];
+	int sensor_updates;
+	Vector3 accelerometer;
+
+	virtual uint32_t sink_joy_button(uint32_t p_last_id, int p_button, bool p_pressed) {
+		InputEvent ev;
+		ev.ID = ++p_last_id;
+		ev.type = InputEvent::JOYSTICK_BUTTON;
+		ev.joy_button.button_index = p_button;
+		ev.joy_button.pressed = p_pressed;
+		events.push_back(ev);
+		return p_last_id;
+	}
+	virtual uint32_t sink_joy_axis(uint32_t p_last_id, int p_axis, float p_value) {
+		axis_events[p_axis]++;
+		axis_values[p_axis] = p_value;
+		return p_last_id + 1;
+	}
+	virtual void sink_input_event(InputEvent &p_event) {
+		if (p_event.type == InputEvent::MOUSE_MOTION)
+			p_event.mouse_motion.speed_x = 7;
+		events.push_back(p_event);
+	}
+	virtual void sink_sensors(const Vector3 &p_accelerometer, const Vector3 &p_gyroscope) {
+		sensor_updates++;
+		accelerometer = p_accelerometer;
+	}
+
+	void reset() {
+		events.clear();
+		for (int i = 0; i < JOY_AXIS_MAX; i++) {
+			axis_events[i] = 0;
+			axis_values[i] = 0;
+		}
+		sensor_updates = 0;
+	}
+
+	RecordingInputSink() { reset(); }
+};
+
+bool test_input_batcher() {
+
+	OS::get_singleton()->print("\n\nTest: Input events batched per frame\n");
+
+	RecordingInputSink sink;
+	InputBatcher batcher;
+	batcher.set_sink(&sink);
+	batcher.set_axis_deadzone(0.1);
+
+	// Many pad samples in one frame make a single motion per axis, with the last value
+	for (int i = 0; i < 50; i++) {
+		batcher.joy_axis(JOY_ANALOG_0_X, i / 50.0);
+		batcher.joy_axis(JOY_ANALOG_0_Y, -0.5);
+	}
+	uint32_t id = batcher.flush(100);
+	CHECK(id == 102);
+	CHECK(sink.axis_events[JOY_ANALOG_0_X] == 1 && sink.axis_events[JOY_ANALOG_0_Y] == 1);
+	CHECK(sink.axis_values[JOY_ANALOG_0_X] == 49 / 50.0f && sink.axis_values[JOY_ANALOG_0_Y] == -0.5f);
+	CHECK(sink.axis_events[JOY_ANALOG_1_X] == 0);
+	CHECK(batcher.get_sample_count() == 0);
+
+	// Unchanged axes stay quiet, noise around the center reads as 0 and is clamped to the range
+	sink.reset();
+	batcher.joy_axis(JOY_ANALOG_0_Y, -0.5);
+	batcher.joy_axis(JOY_ANALOG_1_X, 0.05);
+	batcher.joy_axis(JOY_ANALOG_1_Y, 3);
+	id = batcher.flush(id);
+	CHECK(sink.axis_events[JOY_ANALOG_0_Y] == 0 && sink.axis_events[JOY_ANALOG_1_X] == 0);
+	CHECK(sink.axis_events[JOY_ANALOG_1_Y] == 1 && sink.axis_values[JOY_ANALOG_1_Y] == 1);
+
+	// Buttons are never merged and keep their order
+	sink.reset();
+	batcher.joy_button(JOY_BUTTON_0, true);
+	batcher.joy_button(JOY_BUTTON_0, false);
+	batcher.joy_button(JOY_BUTTON_1, true);
+	id = batcher.flush(id);
+	CHECK(sink.events.size() == 3);
+	CHECK(sink.events[0].joy_button.pressed && !sink.events[1].joy_button.pressed);
+	CHECK(sink.events[2].joy_button.button_index == JOY_BUTTON_1);
+
+	// A touch with a long drag in one frame: press, one drag to the end point, release
+	sink.reset();
+	batcher.touch_press(Point2(10, 20));
+	for (int i = 1; i <= 30; i++)
+		batcher.touch_press(Point2(10 + i, 20 + i * 2));
+	batcher.touch_release();
+	CHECK(!batcher.is_touching());
+	id = batcher.flush(id);
+	CHECK(sink.events.size() == 6);
+	CHECK(sink.events[0].type == InputEvent::MOUSE_BUTTON && sink.events[0].mouse_button.pressed);
+	CHECK(sink.events[1].type == InputEvent::SCREEN_TOUCH && sink.events[1].screen_touch.x == 10);
+	CHECK(sink.events[2].type == InputEvent::MOUSE_MOTION && sink.events[2].mouse_motion.relative_y == 60);
+	CHECK(sink.events[3].type == InputEvent::SCREEN_DRAG && sink.events[3].screen_drag.x == 40);
+	CHECK(sink.events[3].screen_drag.speed_x == 7);
+	CHECK(sink.events[4].type == InputEvent::MOUSE_BUTTON && !sink.events[4].mouse_button.pressed);
+	CHECK(sink.events[5].type == InputEvent::SCREEN_TOUCH && sink.events[5].screen_touch.y == 80);
+	CHECK(sink.events[5].ID > sink.events[0].ID && id == sink.events[5].ID);
+	CHECK(sink.events[0].screen == InputBatcher::TOUCH_SCREEN && sink.events[3].screen == InputBatcher::TOUCH_SCREEN);
+
+	// Held across frames: one drag per frame, none while it doesn't move
+	sink.reset();
+	batcher.touch_press(Point2(100, 100));
+	id = batcher.flush(id);
+	CHECK(sink.events.size() == 2);
+	batcher.touch_move(Point2(100, 100));
+	id = batcher.flush(id);
+	CHECK(sink.events.size() == 2);
+	for (int i = 0; i < 8; i++)
+		batcher.touch_move(Point2(100 + i, 100));
+	id = batcher.flush(id);
+	CHECK(sink.events.size() == 4 && sink.events[3].screen_drag.relative_x == 7);
+	batcher.touch_release();
+	id = batcher.flush(id);
+	CHECK(sink.events.size() == 6 && sink.events[5].screen_touch.x == 107);
+
+	// Sensors are state, set once per frame with the latest reading
+	sink.reset();
+	for (int i = 0; i < 10; i++)
+		batcher.set_sensors(Vector3(0, -9.8, i), Vector3());
+	id = batcher.flush(id);
+	CHECK(sink.sensor_updates == 1 && sink.accelerometer.z == 9);
+	id = batcher.flush(id);
+	CHECK(sink.sensor_updates == 1);
+
+	// Sampling at 1 kHz for a 60 Hz frame
+	sink.reset();
+	int samples = 0;
+	for (int i = 0; i < 16; i++) {
+		batcher.joy_axis(JOY_ANALOG_0_X, Math::sin(i * 0.1));
+		batcher.joy_axis(JOY_ANALOG_1_X, Math::cos(i * 0.1));
+		batcher.touch_press(Point2(i, i));
+		batcher.set_sensors(Vector3(i, 0, 0), Vector3());
+		samples += 4;
+	}
+	CHECK(batcher.get_sample_count() == samples);
+	id = batcher.flush(id);
+	int events = sink.events.size() + sink.sensor_updates;
+	for (int i = 0; i < JOY_AXIS_MAX; i++)
+		events += sink.axis_events[i];
+	OS::get_singleton()->print("\t%i samples in a frame became %i events\n", samples, events);
+	CHECK(events == 6);
+
+	return true;
+}
+
+bool test_texture_tile_benchmark() {
+
+	OS::get_singleton()->print("\n\nTest: Texture tiler throughput\n");
+
+	const int size = 512;
+	const int iterations = 20;
+	static const int pixel_sizes[] = { 4, 2, 1 };
+
+	for (int p = 0; p < 3; p++) {
+		int ps = pixel_sizes[p];
+
+		Vector<uint8_t> src, dst;
+		src.resize(size * size * ps);
+		dst.resize(size * size * ps);
+		for (int j = 0; j < src.size(); j++)
+			src[j] = j & 0xFF;
+
+		uint64_t begin = OS::get_singleton()->get_ticks_usec();
+		for (int i = 0; i < iterations; i++)
+			texture_tile_reference(dst.ptr(), size, size, src.ptr(), size, size, ps, ps == 4);
+		uint64_t ref_usec = OS::get_singleton()->get_ticks_usec() - begin;
+
+		begin = OS::get_singleton()->get_ticks_usec();
+		for (int i = 0; i < iterations; i++)
+			texture_tile(dst.ptr(), size, size, src.ptr(), size, size, ps, ps == 4);
+		uint64_t fast_usec = OS::get_singleton()->get_ticks_usec() - begin;
+
+		double mpix = double(size * size * iterations) / 1000000.0;
+		OS::get_singleton()->print("\t%i bytes/pixel: reference %.1f MPix/s, tiled %.1f MPix/s\n", ps,
+				mpix / MAX(ref_usec, 1) * 1000000.0, mpix / MAX(fast_usec, 1) * 1000000.0);
+	}
+
+	return true;
+}
+
+typedef bool (*TestFunc)(void);
+
+TestFunc test_funcs[] = {
+
+	test_canvas_batch_merge,
+	test_canvas_batch_nine_patch,
+	test_canvas_batch_limits,
+	test_texture_tile,
+	test_texture_tile_benchmark,
+	test_texture_format_select,
+	test_texture_encode,
+	test_etc1_block_flip,
+	test_etc1_tile,
+	test_ctex_roundtrip,
+	test_texture_atlas_pack,
+	test_texture_atlas_blit,
+	test_memory_budget,
+	test_memory_budget_suspend,
+	test_vertex_pack,
+	test_multimesh_batches,
+	test_multimesh_pretransform,
+	test_audio_convert,
+	test_audio_pump,
+	test_input_batcher,
+	0
+};
+
+MainLoop *test() {
+
+	int count = 0;
+	int passed = 0;
+
+	while (true) {
+		if (!test_funcs[count])
+			break;
+		bool pass = test_funcs[count]();
+		if (pass)
+			passed++;
+		OS::get_singleton()->print("\t%s\n", pass ? "PASS" : "FAILED");
+
+		count++;
+	}
+
+	OS::get_singleton()->print("\n\n\n");
+	OS::get_singleton()->print("*************\n");
+	OS::get_singleton()->print("***TOTALS!***\n");
+	OS::get_singleton()->print("*************\n");
+
+	OS::get_singleton()->print("Passed %i of %i tests\n", passed, count);
+
+	return NULL;
+}
+} // namespace Test3DS
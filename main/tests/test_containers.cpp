@@ -30,7 +30,10 @@
 
 #include "test_containers.h"
 #include "dvector.h"
+#include "hash_map.h"
 #include "math_funcs.h"
+#include "oa_hash_map.h"
+#include "os/os.h"
 #include "print_string.h"
 #include "set.h"
 
@@ -40,8 +43,213 @@
 
 namespace TestContainers {
 
+template <class M, class K>
+static void _bench_map(const char *p_name, const Vector<K> &p_keys, int p_rounds) {
+
+	uint64_t insert_usec = 0, lookup_usec = 0, miss_usec = 0, iterate_usec = 0, erase_usec = 0;
+	int found = 0;
+	int64_t sum = 0;
+
+	for (int r = 0; r < p_rounds; r++) {
+
+		M map;
+		int half = p_keys.size() / 2;
+
+		uint64_t t = OS::get_singleton()->get_ticks_usec();
+		for (int i = 0; i < half; i++)
+			map[p_keys[i]] = i;
+		insert_usec += OS::get_singleton()->get_ticks_usec() - t;
+
+		t = OS::get_singleton()->get_ticks_usec();
+		for (int i = 0; i < half; i++) {
+			const int *v = map.getptr(p_keys[i]);
+			if (v)
+				found += *v == i;
+		}
+		lookup_usec += OS::get_singleton()->get_ticks_usec() - t;
+
+		// The other half was never inserted
+		t = OS::get_singleton()->get_ticks_usec();
+		for (int i = half; i < p_keys.size(); i++)
+			found += map.has(p_keys[i]);
+		miss_usec += OS::get_singleton()->get_ticks_usec() - t;
+
+		t = OS::get_singleton()->get_ticks_usec();
+		const K *k = NULL;
+		while ((k = map.next(k)))
+			sum += map[*k];
+		iterate_usec += OS::get_singleton()->get_ticks_usec() - t;
+
+		t = OS::get_singleton()->get_ticks_usec();
+		for (int i = 0; i < half; i += 2)
+			map.erase(p_keys[i]);
+		erase_usec += OS::get_singleton()->get_ticks_usec() - t;
+	}
+
+	print_line(String(p_name) + ": insert " + itos(insert_usec) + " usec, lookup " + itos(lookup_usec) + ", miss " + itos(miss_usec) + ", iterate " + itos(iterate_usec) + ", erase " + itos(erase_usec) + " (check " + itos(found) + "/" + itos(sum) + ")");
+}
+
+// Random inserts and erases applied to both maps, which must agree throughout
+static bool _check_oa_hash_map() {
+
+	HashMap<uint32_t, int> reference;
+	OAHashMap<uint32_t, int> map;
+
+	for (int i = 0; i < 20000; i++) {
+
+		uint32_t key = Math::rand() % 2048;
+		if (Math::rand() % 3) {
+			reference[key] = i;
+			map[key] = i;
+		} else {
+			if (reference.erase(key) != map.erase(key))
+				return false;
+		}
+	}
+
+	if (reference.size() != map.size())
+		return false;
+
+	const uint32_t *k = NULL;
+	int visited = 0;
+	while ((k = map.next(k))) {
+		const int *v = reference.getptr(*k);
+		if (!v || *v != map[*k])
+			return false;
+		visited++;
+	}
+
+	// Iterating from a copy of the key, as Variant does for dictionaries
+	uint32_t key_copy = *map.next(NULL);
+	if (map.next(&key_copy) != map.next(map.next(NULL)))
+		return false;
+
+	OAHashMap<uint32_t, int> copy = map;
+	map.clear();
+	return visited == (int)reference.size() && copy.size() == reference.size() && map.empty();
+}
+
+// Insertion order survives erasing, re-adding and copy on write
+static bool _check_dictionary() {
+
+	Dictionary d;
+	for (int i = 0; i < 1000; i++)
+		d[i * 7] = i;
+	for (int i = 0; i < 1000; i += 3)
+		d.erase(i * 7);
+	d["last"] = true;
+	d[7] = "moved";
+
+	Dictionary copy = d;
+	d.erase(14);
+
+	if (copy.size() != 667 || d.size() != 666 || !copy.has(14) || d.has(14))
+		return false;
+
+	Array keys = copy.keys();
+	Array values = copy.values();
+	int idx = 0;
+	for (int i = 0; i < 1000; i++) {
+		if (i % 3 == 0)
+			continue;
+		if (int(keys[idx]) != i * 7 || (i != 1 && int(values[idx]) != i))
+			return false;
+		idx++;
+	}
+	if (String(keys[idx]) != "last" || String(values[0]) != "moved")
+		return false;
+
+	// Variant iteration hands copies of the keys to next()
+	Variant v = copy;
+	Variant iter;
+	bool valid;
+	int count = 0;
+	if (v.iter_init(iter, valid)) {
+		do {
+			if (iter != keys[count++])
+				return false;
+		} while (v.iter_next(iter, valid));
+	}
+	if (count != copy.size())
+		return false;
+
+	Dictionary small;
+	small["b"] = 1;
+	small["a"] = 2;
+	small["c"] = 3;
+	if (small.to_json() != "{\"b\":1, \"a\":2, \"c\":3}")
+		return false;
+
+	while (copy.size())
+		copy.erase(copy.keys()[copy.size() / 2]);
+	return copy.empty() && !copy.next(NULL) && d.size() == 666;
+}
+
+static void _bench_dictionary() {
+
+	uint64_t insert_usec = 0, lookup_usec = 0, iterate_usec = 0, keys_usec = 0, erase_usec = 0;
+	int64_t sum = 0;
+
+	for (int r = 0; r < 10; r++) {
+
+		Dictionary d(true);
+
+		uint64_t t = OS::get_singleton()->get_ticks_usec();
+		for (int i = 0; i < 20000; i++)
+			d[i] = i;
+		insert_usec += OS::get_singleton()->get_ticks_usec() - t;
+
+		t = OS::get_singleton()->get_ticks_usec();
+		for (int i = 0; i < 20000; i++)
+			sum += int(d[i]);
+		lookup_usec += OS::get_singleton()->get_ticks_usec() - t;
+
+		t = OS::get_singleton()->get_ticks_usec();
+		const Variant *k = NULL;
+		while ((k = d.next(k)))
+			sum += int(*k);
+		iterate_usec += OS::get_singleton()->get_ticks_usec() - t;
+
+		t = OS::get_singleton()->get_ticks_usec();
+		sum += d.keys().size() + d.values().size();
+		keys_usec += OS::get_singleton()->get_ticks_usec() - t;
+
+		t = OS::get_singleton()->get_ticks_usec();
+		for (int i = 0; i < 20000; i += 2)
+			d.erase(i);
+		erase_usec += OS::get_singleton()->get_ticks_usec() - t;
+	}
+
+	print_line("Dictionary: insert " + itos(insert_usec) + " usec, lookup " + itos(lookup_usec) + ", iterate " + itos(iterate_usec) + ", keys/values " + itos(keys_usec) + ", erase " + itos(erase_usec) + " (check " + itos(sum) + ")");
+}
+
+static void _bench_hash_maps() {
+
+	print_line("OAHashMap consistency: " + String(_check_oa_hash_map() ? "ok" : "FAILED"));
+
+	Vector<uint32_t> int_keys;
+	Vector<String> string_keys;
+	for (int i = 0; i < 100000; i++) {
+		// Object ids are sequential, so are half of these
+		int_keys.push_back(i & 1 ? Math::rand() : i);
+		if (i < 20000)
+			string_keys.push_back("key_" + itos(Math::rand()) + "_" + itos(i));
+	}
+
+	_bench_map<HashMap<uint32_t, int>, uint32_t>("HashMap<uint32_t>", int_keys, 10);
+	_bench_map<OAHashMap<uint32_t, int>, uint32_t>("OAHashMap<uint32_t>", int_keys, 10);
+	_bench_map<HashMap<String, int>, String>("HashMap<String>", string_keys, 10);
+	_bench_map<OAHashMap<String, int>, String>("OAHashMap<String>", string_keys, 10);
+
+	print_line("Dictionary consistency: " + String(_check_dictionary() ? "ok" : "FAILED"));
+	_bench_dictionary();
+}
+
 MainLoop *test() {
 
+	_bench_hash_maps();
+
+
 	/*
 	HashMap<int,int> int_map;
 
@@ -890,8 +890,160 @@ static void _disassemble_class(const Ref<GDScript> &p_class, const Vector<String
 	}
 }
 
+// Every bench_* function is run through the VM and timed
+static const char *_benchmark_code =
+		"extends Reference\n"
+		"\n"
+		"var counter = 0\n"
+		"var pos = Vector2()\n"
+		"\n"
+		"func _add(a, b):\n"
+		"\treturn a + b\n"
+		"\n"
+		"func bench_dict_int_insert():\n"
+		"\tvar d = {}\n"
+		"\tfor i in range(10000):\n"
+		"\t\td[i] = i\n"
+		"\treturn d.size()\n"
+		"\n"
+		"func bench_dict_string_lookup():\n"
+		"\tvar d = {}\n"
+		"\tfor i in range(1000):\n"
+		"\t\td[\"key_\" + str(i)] = i\n"
+		"\tvar n = 0\n"
+		"\tfor r in range(10):\n"
+		"\t\tfor i in range(1000):\n"
+		"\t\t\tn += d[\"key_\" + str(i)]\n"
+		"\treturn n\n"
+		"\n"
+		"func bench_dict_iterate():\n"
+		"\tvar d = {}\n"
+		"\tfor i in range(1000):\n"
+		"\t\td[i] = i\n"
+		"\tvar n = 0\n"
+		"\tfor r in range(20):\n"
+		"\t\tfor k in d:\n"
+		"\t\t\tn += d[k]\n"
+		"\treturn n\n"
+		"\n"
+		"func bench_dict_keys_values():\n"
+		"\tvar d = {}\n"
+		"\tfor i in range(1000):\n"
+		"\t\td[i] = str(i)\n"
+		"\tvar n = 0\n"
+		"\tfor r in range(50):\n"
+		"\t\tn += d.keys().size() + d.values().size()\n"
+		"\treturn n\n"
+		"\n"
+		"func bench_dict_erase():\n"
+		"\tvar d = {}\n"
+		"\tfor i in range(10000):\n"
+		"\t\td[i] = i\n"
+		"\tfor i in range(0, 10000, 2):\n"
+		"\t\td.erase(i)\n"
+		"\treturn d.size()\n"
+		"\n"
+		"func bench_str_ui_labels():\n"
+		"\tvar n = 0\n"
+		"\tfor i in range(5000):\n"
+		"\t\tvar score = \"Score: %d  Lives: %02d\" % [i, i % 10]\n"
+		"\t\tvar hp = \"HP \" + str(i % 97) + \"/\" + str(100)\n"
+		"\t\tn += score.length() + hp.length()\n"
+		"\treturn n\n"
+		"\n"
+		"func bench_str_save_file():\n"
+		"\tvar lines = []\n"
+		"\tfor i in range(2000):\n"
+		"\t\tlines.append(\"slot_%d = \\\"%s\\\" ; %5.1f\" % [i, str(\"item\", i), i * 0.5])\n"
+		"\tvar text = \"\"\n"
+		"\tfor l in lines:\n"
+		"\t\ttext += l + \"\\n\"\n"
+		"\treturn text.length()\n"
+		"\n"
+		"func bench_dict_to_json():\n"
+		"\tvar d = {}\n"
+		"\tfor i in range(200):\n"
+		"\t\td[\"field_\" + str(i)] = { \"x\": i, \"name\": str(i) }\n"
+		"\treturn d.to_json().length()\n"
+		"\n"
+		"func bench_vm_loop():\n"
+		"\tvar i = 0\n"
+		"\tvar n = 0\n"
+		"\twhile i < 200000:\n"
+		"\t\tif i & 1:\n"
+		"\t\t\tn += i & 7\n"
+		"\t\ti += 1\n"
+		"\treturn n\n"
+		"\n"
+		"func bench_vm_math():\n"
+		"\tvar v = Vector2(1, 0)\n"
+		"\tvar f = 0.0\n"
+		"\tfor i in range(20000):\n"
+		"\t\tv = v.rotated(0.01) * 1.0001\n"
+		"\t\tf += sqrt(v.x * v.x + v.y * v.y) + abs(sin(i * 0.1))\n"
+		"\treturn int(f)\n"
+		"\n"
+		"func bench_vm_property():\n"
+		"\tcounter = 0\n"
+		"\tpos = Vector2()\n"
+		"\tfor i in range(50000):\n"
+		"\t\tcounter += 1\n"
+		"\t\tpos.x = pos.x + 0.5\n"
+		"\t\tself.counter = self.counter + 1\n"
+		"\treturn counter + int(pos.x)\n"
+		"\n"
+		"func bench_vm_call():\n"
+		"\tvar n = 0\n"
+		"\tfor i in range(50000):\n"
+		"\t\tn = _add(n, i & 3)\n"
+		"\treturn n\n";
+
+static void _run_benchmarks(const String &p_code, int p_rounds) {
+
+	Ref<GDScript> script = memnew(GDScript);
+	script->set_source_code(p_code);
+	Error err = script->reload();
+	if (err) {
+		print_line("Benchmark script failed to compile");
+		return;
+	}
+
+	Ref<Reference> instance = memnew(Reference);
+	instance->set_script(script.get_ref_ptr());
+
+	List<StringName> benchmarks;
+	for (const Map<StringName, GDFunction *>::Element *E = script->get_member_functions().front(); E; E = E->next()) {
+
+		if (String(E->key()).begins_with("bench_"))
+			benchmarks.push_back(E->key());
+	}
+	benchmarks.sort_custom<StringName::AlphCompare>();
+
+	for (List<StringName>::Element *E = benchmarks.front(); E; E = E->next()) {
+
+		Variant result;
+		uint64_t best = 0;
+		for (int i = 0; i < p_rounds; i++) {
+
+			uint64_t t = OS::get_singleton()->get_ticks_usec();
+			result = instance->call(E->get());
+			t = OS::get_singleton()->get_ticks_usec() - t;
+			if (i == 0 || t < best)
+				best = t;
+		}
+
+		print_line(String(E->get()) + ": " + itos(best) + " usec (" + String(result) + ")");
+	}
+}
+
 MainLoop *test(TestType p_test) {
 
+	if (p_test == TEST_BENCHMARK) {
+
+		_run_benchmarks(_benchmark_code, 5);
+		return NULL;
+	}
+
 	List<String> cmdlargs = OS::get_singleton()->get_cmdline_args();
 
 	if (cmdlargs.empty()) {
@@ -33,6 +33,7 @@
 
 #ifdef DEBUG_ENABLED
 
+#include "test_3ds.h"
 #include "test_containers.h"
 #include "test_detailer.h"
 #include "test_gdscript.h"
@@ -41,6 +42,7 @@
 #include "test_io.h"
 #include "test_math.h"
 #include "test_misc.h"
+#include "test_os.h"
 #include "test_particles.h"
 #include "test_physics.h"
 #include "test_physics_2d.h"
@@ -61,8 +63,10 @@ const char **tests_get_names() {
 		"multimesh",
 		"gui",
 		"io",
+		"os",
 		"shaderlang",
 		"physics",
+		"3ds",
 		NULL
 	};
 
@@ -123,6 +127,11 @@ MainLoop *test_main(String p_test, const List<String> &p_args) {
 		return TestIO::test();
 	}
 
+	if (p_test == "os") {
+
+		return TestOS::test();
+	}
+
 	if (p_test == "particles") {
 
 		return TestParticles::test();
@@ -158,6 +167,16 @@ MainLoop *test_main(String p_test, const List<String> &p_args) {
 		return TestGDScript::test(TestGDScript::TEST_BYTECODE);
 	}
 
+	if (p_test == "gd_bench") {
+
+		return TestGDScript::test(TestGDScript::TEST_BENCHMARK);
+	}
+
+	if (p_test == "3ds") {
+
+		return Test3DS::test();
+	}
+
 	if (p_test == "image") {
 
 		return TestImage::test();
@@ -0,0 +1,1466 @@
+/*************************************************************************/
+/*  test_os.cpp                                                          */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "test_os.h"
+
+#include "camera_matrix.h"
+#include "main/performance_history.h"
+#include "map.h"
+#include "math_funcs.h"
+#include "os/job_system.h"
+#include "os/keyboard.h"
+#include "os/memory_pool_dynamic_compact.h"
+#include "os/memory_pool_static_slab.h"
+#include "os/os.h"
+#include "os/thread.h"
+#include "os/zone_profiler.h"
+#include "pool_allocator.h"
+#include "scene/main/scene_main_loop.h"
+#include "scene/main/viewport.h"
+#include "servers/audio/audio_mixer_hw.h"
+#include "servers/audio/audio_server_sw.h"
+#include "servers/audio/sample_manager_sw.h"
+#include "servers/visual/rasterizer_dummy.h"
+#include "servers/visual/visual_server_raster.h"
+
+namespace TestOS {
+
+#define CHECK(m_cond)                                                     \
+	if (!(m_cond)) {                                                      \
+		OS::get_singleton()->print("\tFailed check: %s\n", #m_cond);      \
+		return false;                                                     \
+	}
+
+static void _job_double(void *p_userdata, int p_index) {
+
+	int *values = (int *)p_userdata;
+	values[p_index] = p_index * 2;
+}
+
+struct NestedJobs {
+	JobSystem *js;
+	int values[16][64];
+};
+
+static void _job_nested(void *p_userdata, int p_index) {
+
+	NestedJobs *nested = (NestedJobs *)p_userdata;
+	JobSystem::Group group;
+	nested->js->dispatch(_job_double, nested->values[p_index], 64, &group, 8);
+	nested->js->wait(&group);
+}
+
+bool test_job_system() {
+
+	OS::get_singleton()->print("\n\nTest: Job system dispatch, batching and nesting\n");
+
+	static int values[1000];
+
+	// No workers, wait() does all the work
+	{
+		JobSystem js;
+		CHECK(js.get_worker_count() == 0);
+		for (int i = 0; i < 1000; i++)
+			values[i] = -1;
+		js.run(_job_double, values, 1000);
+		bool ok = true;
+		for (int i = 0; i < 1000; i++)
+			ok = ok && values[i] == i * 2;
+		CHECK(ok);
+	}
+
+	JobSystem js;
+	js.init(3);
+	CHECK(js.get_worker_count() == 3);
+
+	// Batches that don't divide the count evenly
+	for (int i = 0; i < 1000; i++)
+		values[i] = -1;
+	JobSystem::Group group;
+	js.dispatch(_job_double, values, 1000, &group, 7);
+	js.wait(&group);
+	CHECK(group.pending == 0);
+	bool ok = true;
+	for (int i = 0; i < 1000; i++)
+		ok = ok && values[i] == i * 2;
+	CHECK(ok);
+
+	// More jobs than a queue holds still all run
+	for (int i = 0; i < 1000; i++)
+		values[i] = -1;
+	js.run(_job_double, values, 1000);
+	ok = true;
+	for (int i = 0; i < 1000; i++)
+		ok = ok && values[i] == i * 2;
+	CHECK(ok);
+
+	// Jobs that dispatch and wait on their own jobs
+	static NestedJobs nested;
+	nested.js = &js;
+	for (int i = 0; i < 16; i++)
+		for (int j = 0; j < 64; j++)
+			nested.values[i][j] = -1;
+	js.run(_job_nested, &nested, 16);
+	ok = true;
+	for (int i = 0; i < 16; i++)
+		for (int j = 0; j < 64; j++)
+			ok = ok && nested.values[i][j] == j * 2;
+	CHECK(ok);
+
+	// Workers can be restarted
+	js.finish();
+	CHECK(js.get_worker_count() == 0);
+	js.init(2);
+	CHECK(js.get_worker_count() == 2);
+	js.run(_job_double, values, 10);
+	CHECK(values[9] == 18);
+
+	return true;
+}
+
+static void _job_heavy(void *p_userdata, int p_index) {
+
+	float *values = (float *)p_userdata;
+	float v = p_index;
+	for (int i = 0; i < 200; i++)
+		v = Math::sqrt(v * v + 1.0f);
+	values[p_index] = v;
+}
+
+bool test_job_system_benchmark() {
+
+	OS::get_singleton()->print("\n\nTest: Job system throughput\n");
+
+	const int count = 1 << 16;
+	Vector<float> values;
+	values.resize(count);
+
+	uint64_t begin = OS::get_singleton()->get_ticks_usec();
+	for (int i = 0; i < count; i++)
+		_job_heavy(values.ptr(), i);
+	uint64_t serial_usec = OS::get_singleton()->get_ticks_usec() - begin;
+
+	JobSystem js;
+	js.init(OS::get_singleton()->get_processor_count() - 1);
+
+	static const int batches[] = { 1, 64, 1024 };
+	for (int b = 0; b < 3; b++) {
+
+		uint32_t steals = js.get_steal_count();
+		begin = OS::get_singleton()->get_ticks_usec();
+		js.run(_job_heavy, values.ptr(), count, batches[b]);
+		uint64_t usec = OS::get_singleton()->get_ticks_usec() - begin;
+
+		OS::get_singleton()->print("\t%i workers, batch %i: serial %.2f ms, jobs %.2f ms (x%.2f), %i steals\n",
+				js.get_worker_count(), batches[b], serial_usec / 1000.0, usec / 1000.0,
+				double(serial_usec) / MAX(usec, 1), int(js.get_steal_count() - steals));
+	}
+
+	return true;
+}
+
+static void _zone_nested(int p_levels) {
+
+	ZoneProfiler::Scope scope("nested");
+	if (p_levels > 1)
+		_zone_nested(p_levels - 1);
+}
+
+bool test_zone_profiler() {
+
+	OS::get_singleton()->print("\n\nTest: Zone profiler nesting, ring wrap and trace output\n");
+
+	ZoneProfiler::init();
+	Thread::ID self = Thread::get_caller_ID();
+	static ZoneProfiler::Zone zones[ZoneProfiler::RING_SIZE];
+
+	// Nothing is recorded while disabled
+	{
+		ZoneProfiler::Scope scope("disabled");
+	}
+	CHECK(ZoneProfiler::get_zones(self, zones, ZoneProfiler::RING_SIZE) == 0);
+
+	ZoneProfiler::set_enabled(true);
+	ZoneProfiler::clear();
+
+	// Inner zones finish first and sit inside their parent
+	{
+		ZoneProfiler::Scope outer("outer");
+		{
+			ZoneProfiler::Scope inner("inner");
+			OS::get_singleton()->delay_usec(1000);
+		}
+	}
+	CHECK(ZoneProfiler::get_zones(self, zones, ZoneProfiler::RING_SIZE) == 2);
+	CHECK(String(zones[0].name) == "inner" && zones[0].depth == 1);
+	CHECK(String(zones[1].name) == "outer" && zones[1].depth == 0);
+	CHECK(zones[0].duration >= 1000);
+	CHECK(zones[0].begin >= zones[1].begin);
+	CHECK(zones[0].begin + zones[0].duration <= zones[1].begin + zones[1].duration);
+
+	// Only the newest RING_SIZE zones are kept, oldest first
+	ZoneProfiler::clear();
+	_zone_nested(ZoneProfiler::RING_SIZE + 10);
+	CHECK(ZoneProfiler::get_zones(self, zones, ZoneProfiler::RING_SIZE) == ZoneProfiler::RING_SIZE);
+	CHECK(zones[0].depth == ZoneProfiler::RING_SIZE - 1);
+	CHECK(zones[ZoneProfiler::RING_SIZE - 1].depth == 0);
+	CHECK(ZoneProfiler::get_zones(self, zones, 16) == 16);
+
+	ZoneProfiler::clear();
+	ZoneProfiler::set_thread_name("Test \"main\"");
+	{
+		ZoneProfiler::Scope scope("traced");
+	}
+	String trace = ZoneProfiler::get_chrome_trace();
+	CHECK(trace.begins_with("{\"traceEvents\":["));
+	CHECK(trace.find("\"name\":\"traced\",\"ph\":\"X\"") != -1);
+	CHECK(trace.find("Test \\\"main\\\"") != -1);
+
+	ZoneProfiler::finish();
+	return true;
+}
+
+bool test_performance_monitors() {
+
+	OS::get_singleton()->print("\n\nTest: Rolling monitor statistics and new render/allocator stats\n");
+
+	// Window keeps the newest frames only
+	PerformanceHistory history;
+	history.resize(2, 100);
+	CHECK(history.get_avg(0) == 0 && history.get_percentile(0, 0.99) == 0);
+	for (int i = 0; i < 300; i++) {
+		float values[2] = { float(i), float(i % 100 == 50 ? 1000 : 1) };
+		history.push(values);
+	}
+	CHECK(history.get_frame_count() == 100);
+	CHECK(history.get_min(0) == 200);
+	CHECK(history.get_max(0) == 299);
+	CHECK(Math::abs(history.get_avg(0) - 249.5) < 0.001);
+	CHECK(history.get_percentile(0, 0.99) == 298);
+	CHECK(history.get_percentile(0, 0.5) == 249);
+	// One spike in a hundred frames is the max but not the p99 of a tighter window
+	CHECK(history.get_max(1) == 1000);
+	CHECK(history.get_percentile(1, 0.99) == 1);
+	CHECK(history.get_percentile(1, 1.0) == 1000);
+
+	// Holes left by frees count as fragmentation, compaction needs the free block to be contiguous
+	{
+		PoolAllocator pool(16, 1024 * 16);
+		PoolAllocator::ID ids[16];
+		for (int i = 0; i < 16; i++) {
+			ids[i] = pool.alloc(1024);
+		}
+		CHECK(pool.get_largest_free_block() == 0);
+		for (int i = 0; i < 16; i += 2) {
+			pool.free(ids[i]);
+		}
+		CHECK(pool.get_free_mem() == 1024 * 8);
+		CHECK(pool.get_largest_free_block() == 1024);
+		pool.free(ids[1]);
+		CHECK(pool.get_largest_free_block() == 1024 * 3);
+	}
+
+	// Canvas items are counted as the visual server collects them
+	RasterizerDummy *rasterizer = memnew(RasterizerDummy);
+	VisualServerRaster *vs = memnew(VisualServerRaster(rasterizer));
+	vs->init();
+
+	VS::ViewportRect rect;
+	rect.width = 400;
+	rect.height = 240;
+	RID viewport = vs->viewport_create();
+	vs->viewport_set_rect(viewport, rect);
+	vs->viewport_attach_to_screen(viewport, 0);
+	RID canvas = vs->canvas_create();
+	vs->viewport_attach_canvas(viewport, canvas);
+
+	RID items[3];
+	for (int i = 0; i < 3; i++) {
+		items[i] = vs->canvas_item_create();
+		vs->canvas_item_set_parent(items[i], i == 2 ? items[1] : canvas);
+		vs->canvas_item_add_rect(items[i], Rect2(0, 0, 10, 10), Color(1, 1, 1));
+	}
+	RID offscreen = vs->canvas_item_create();
+	vs->canvas_item_set_parent(offscreen, canvas);
+	vs->canvas_item_add_rect(offscreen, Rect2(1000, 1000, 10, 10), Color(1, 1, 1));
+
+	vs->draw();
+	CHECK(vs->get_render_info(VS::INFO_CANVAS_ITEMS_IN_FRAME) == 3);
+	CHECK(vs->get_render_info(VS::INFO_CULLING_TIME_USEC) == 0);
+	vs->draw();
+	CHECK(vs->get_render_info(VS::INFO_CANVAS_ITEMS_IN_FRAME) == 3);
+	CHECK(vs->get_render_info(VS::INFO_CANVAS_BATCHES_IN_FRAME) == 0);
+
+	vs->free(offscreen);
+	for (int i = 2; i >= 0; i--)
+		vs->free(items[i]);
+	vs->viewport_detach(viewport);
+	vs->free(viewport);
+	vs->free(canvas);
+	vs->finish();
+	memdelete(vs);
+	memdelete(rasterizer);
+
+	return true;
+}
+
+struct SlabThreadTest {
+	MemoryPoolStaticSlab *pool;
+	void *blocks[256];
+};
+
+static void _slab_thread_alloc(void *p_userdata) {
+
+	SlabThreadTest *t = (SlabThreadTest *)p_userdata;
+	for (int i = 0; i < 256; i++) {
+		t->blocks[i] = t->pool->alloc(8 + (i % 100) * 8);
+	}
+	t->pool->release_thread_cache();
+}
+
+bool test_slab_allocator() {
+
+	OS::get_singleton()->print("\n\nTest: Slab allocator size classes, realloc and fragmentation\n");
+
+	MemoryPoolStatic *default_pool = MemoryPoolStatic::get_singleton();
+	MemoryPoolStaticSlab *pool = memnew(MemoryPoolStaticSlab(1024 * 1024, false));
+	CHECK(MemoryPoolStatic::get_singleton() == default_pool);
+	CHECK(pool->get_arena_size() == 1024 * 1024);
+
+	// Blocks of every size are usable and don't overlap
+	static void *blocks[2048];
+	for (int i = 0; i < 2048; i++) {
+		int size = 1 + i;
+		blocks[i] = pool->alloc(size);
+		CHECK(blocks[i] && (uintptr_t(blocks[i]) & 7) == 0);
+		memset(blocks[i], i & 0xFF, size);
+	}
+	bool ok = true;
+	for (int i = 0; i < 2048; i++) {
+		const uint8_t *b = (const uint8_t *)blocks[i];
+		for (int j = 0; j <= i; j++)
+			ok = ok && b[j] == (i & 0xFF);
+	}
+	CHECK(ok);
+	CHECK(pool->get_alloc_count() == 2048);
+	CHECK(pool->get_large_usage() > 0);
+	for (int i = 0; i < 2048; i++) {
+		pool->free(blocks[i]);
+	}
+	CHECK(pool->get_alloc_count() == 0);
+	CHECK(pool->get_total_usage() == 0);
+	CHECK(pool->get_max_usage() > 0);
+
+	// Realloc stays in place within a class and keeps contents across classes
+	uint8_t *p = (uint8_t *)pool->alloc(40);
+	for (int i = 0; i < 40; i++)
+		p[i] = i;
+	CHECK(pool->realloc(p, 48) == p);
+	p = (uint8_t *)pool->realloc(p, 600);
+	p = (uint8_t *)pool->realloc(p, 5000);
+	p = (uint8_t *)pool->realloc(p, 9000);
+	p = (uint8_t *)pool->realloc(p, 20);
+	ok = true;
+	for (int i = 0; i < 20; i++)
+		ok = ok && p[i] == i;
+	CHECK(ok);
+	CHECK(pool->get_total_usage() == 24);
+	pool->free(p);
+
+	// Holes in pages count as fragmentation until the pages are emptied
+	pool->release_thread_cache();
+	CHECK(pool->get_fragmentation() == 0);
+	CHECK(pool->get_available_mem() == 1024 * 1024);
+	for (int i = 0; i < 2048; i++) {
+		blocks[i] = pool->alloc(64);
+	}
+	for (int i = 0; i < 2048; i += 2) {
+		pool->free(blocks[i]);
+	}
+	pool->release_thread_cache();
+	float fragmentation = pool->get_fragmentation();
+	CHECK(fragmentation > 0.05 && fragmentation < 1);
+	for (int i = 1; i < 2048; i += 2) {
+		pool->free(blocks[i]);
+	}
+	pool->release_thread_cache();
+	CHECK(pool->get_fragmentation() == 0);
+	CHECK(pool->get_available_mem() == 1024 * 1024);
+
+	// Blocks from another thread can be freed here
+	SlabThreadTest thread_test;
+	thread_test.pool = pool;
+	Thread *thread = Thread::create(_slab_thread_alloc, &thread_test);
+	Thread::wait_to_finish(thread);
+	memdelete(thread);
+	CHECK(pool->get_alloc_count() == 256);
+	for (int i = 0; i < 256; i++) {
+		pool->free(thread_test.blocks[i]);
+	}
+	CHECK(pool->get_alloc_count() == 0);
+	CHECK(pool->get_total_usage() == 0);
+
+	// More pools than thread slots don't strand the blocks cached for the first ones
+	pool->release_thread_cache();
+	MemoryPoolStaticSlab *others[6];
+	for (int i = 0; i < 6; i++) {
+		others[i] = memnew(MemoryPoolStaticSlab(MemoryPoolStaticSlab::PAGE_SIZE * 4, false));
+	}
+	for (int round = 0; round < 2; round++) {
+		pool->free(pool->alloc(64));
+		for (int i = 0; i < 6; i++) {
+			others[i]->free(others[i]->alloc(64));
+		}
+	}
+	pool->release_thread_cache();
+	CHECK(pool->get_fragmentation() == 0);
+	CHECK(pool->get_available_mem() == 1024 * 1024);
+	for (int i = 0; i < 6; i++) {
+		others[i]->release_thread_cache();
+		CHECK(others[i]->get_fragmentation() == 0);
+		CHECK(others[i]->get_alloc_count() == 0);
+		memdelete(others[i]);
+	}
+	memdelete(pool);
+
+	// A full arena falls through to malloc
+	pool = memnew(MemoryPoolStaticSlab(MemoryPoolStaticSlab::PAGE_SIZE * 2, false));
+	for (int i = 0; i < 64; i++) {
+		blocks[i] = pool->alloc(1000);
+		CHECK(blocks[i]);
+	}
+	CHECK(pool->get_large_usage() > 0);
+	CHECK(pool->get_available_mem() == 0 || pool->get_fragmentation() == 1);
+	for (int i = 0; i < 64; i++) {
+		pool->free(blocks[i]);
+	}
+	CHECK(pool->get_alloc_count() == 0);
+	memdelete(pool);
+
+	return true;
+}
+
+struct SlabChurn {
+	MemoryPoolStaticSlab *pool; // NULL churns malloc
+	int ops;
+	uint32_t seed;
+	uint64_t usec;
+};
+
+static void _slab_churn(void *p_userdata) {
+
+	SlabChurn *churn = (SlabChurn *)p_userdata;
+	const int live = 4096;
+	void *blocks[live];
+	for (int i = 0; i < live; i++)
+		blocks[i] = NULL;
+
+	uint32_t seed = churn->seed;
+	uint64_t begin = OS::get_singleton()->get_ticks_usec();
+	for (int i = 0; i < churn->ops; i++) {
+
+		seed = seed * 1664525 + 1013904223;
+		int slot = (seed >> 8) % live;
+		// mostly small engine objects, some strings and arrays
+		int size = (seed >> 28) < 14 ? 8 + ((seed >> 4) & 0xF) * 16 : 1024 + ((seed >> 4) & 0xFFF);
+
+		if (churn->pool) {
+			if (blocks[slot])
+				churn->pool->free(blocks[slot]);
+			blocks[slot] = churn->pool->alloc(size);
+		} else {
+			if (blocks[slot])
+				::free(blocks[slot]);
+			blocks[slot] = ::malloc(size);
+		}
+		*(uint32_t *)blocks[slot] = i;
+	}
+	churn->usec = OS::get_singleton()->get_ticks_usec() - begin;
+
+	for (int i = 0; i < live; i++) {
+		if (!blocks[i])
+			continue;
+		if (churn->pool)
+			churn->pool->free(blocks[i]);
+		else
+			::free(blocks[i]);
+	}
+	if (churn->pool)
+		churn->pool->release_thread_cache();
+}
+
+bool test_slab_allocator_benchmark() {
+
+	OS::get_singleton()->print("\n\nTest: Slab allocator churn against malloc\n");
+
+	const int ops = 1000000;
+	MemoryPoolStaticSlab *pool = memnew(MemoryPoolStaticSlab(16 * 1024 * 1024, false));
+
+	for (int threads = 1; threads <= 2; threads++) {
+
+		uint64_t usec[2] = { 0, 0 };
+		for (int use_slab = 0; use_slab < 2; use_slab++) {
+
+			SlabChurn churn[2];
+			Thread *thread[2];
+			for (int t = 0; t < threads; t++) {
+				churn[t].pool = use_slab ? pool : NULL;
+				churn[t].ops = ops / threads;
+				churn[t].seed = 1234 + t;
+				thread[t] = Thread::create(_slab_churn, &churn[t]);
+			}
+			for (int t = 0; t < threads; t++) {
+				Thread::wait_to_finish(thread[t]);
+				memdelete(thread[t]);
+				usec[use_slab] = MAX(usec[use_slab], churn[t].usec);
+			}
+		}
+
+		OS::get_singleton()->print("\t%i thread(s), %i ops: malloc %.2f ms, slab %.2f ms (x%.2f), slab peak %i KB\n",
+				threads, ops, usec[0] / 1000.0, usec[1] / 1000.0, double(usec[0]) / MAX(usec[1], 1),
+				int(pool->get_max_usage() / 1024));
+	}
+
+	CHECK(pool->get_alloc_count() == 0);
+	memdelete(pool);
+
+	return true;
+}
+
+struct CompactBlock {
+
+	MemoryPoolDynamicCompact::ID id;
+	int size;
+	uint8_t seed;
+	const void *pinned; // address while held locked, NULL if not pinned
+};
+
+static void _compact_fill(MemoryPoolDynamicCompact *p_pool, CompactBlock &p_block) {
+
+	p_pool->lock(p_block.id);
+	uint8_t *data = (uint8_t *)p_pool->get(p_block.id);
+	for (int i = 0; i < p_block.size; i++)
+		data[i] = p_block.seed + i * 7;
+	p_pool->unlock(p_block.id);
+}
+
+static bool _compact_verify(MemoryPoolDynamicCompact *p_pool, const CompactBlock &p_block, int p_size) {
+
+	p_pool->lock(p_block.id);
+	const uint8_t *data = (const uint8_t *)p_pool->get(p_block.id);
+	bool ok = true;
+	for (int i = 0; i < p_size && ok; i++)
+		ok = data[i] == uint8_t(p_block.seed + i * 7);
+	p_pool->unlock(p_block.id);
+	return ok;
+}
+
+bool test_compacting_dynamic_pool() {
+
+	OS::get_singleton()->print("\n\nTest: Compacting dynamic pool stress\n");
+
+	const int arena = 4 * 1024 * 1024;
+	MemoryPoolDynamicCompact *pool = memnew(MemoryPoolDynamicCompact(arena, 4096, false));
+
+	{
+		// blocks bigger than the arena overflow to the heap and keep their ID
+		MemoryPoolDynamicCompact::ID big = pool->alloc(arena * 2, "big");
+		CHECK(pool->is_valid(big));
+		CHECK(pool->get_heap_block_count() == 1);
+		CHECK(pool->realloc(big, 1024) == OK);
+		CHECK(pool->get_size(big) == 1024);
+		pool->defragment();
+		CHECK(pool->get_heap_block_count() == 0);
+		CHECK(pool->is_valid(big));
+		pool->free(big);
+		CHECK(!pool->is_valid(big));
+		CHECK(pool->get_total_usage() == 0);
+	}
+
+	const int live = 512;
+	const int pinned = 16;
+	CompactBlock blocks[live];
+	for (int i = 0; i < live; i++)
+		blocks[i].id = 0xFFFFFFFF;
+
+	uint32_t seed = 4321;
+	float peak_frag = 0;
+	bool realloc_kept_data = true;
+
+	for (int i = 0; i < 40000; i++) {
+
+		seed = seed * 1664525 + 1013904223;
+		int slot = (seed >> 8) % live;
+		// mostly small arrays, now and then an image sized one
+		int size = (seed >> 28) < 13 ? 64 + ((seed >> 4) & 0xFFF) : 16384 + ((seed >> 2) & 0xFFFF);
+
+		CompactBlock &b = blocks[slot];
+		if (b.id == 0xFFFFFFFF) {
+
+			b.id = pool->alloc(size, "stress");
+			b.size = size;
+			b.seed = seed >> 16;
+			b.pinned = NULL;
+			CHECK(pool->is_valid(b.id));
+			_compact_fill(pool, b);
+
+		} else if (b.pinned) {
+
+			continue;
+
+		} else if ((seed >> 24) & 1) {
+
+			int keep = MIN(b.size, size);
+			CHECK(pool->realloc(b.id, size) == OK);
+			b.size = size;
+			realloc_kept_data = realloc_kept_data && _compact_verify(pool, b, keep);
+			_compact_fill(pool, b);
+
+		} else {
+
+			CHECK(_compact_verify(pool, b, b.size));
+			pool->free(b.id);
+			b.id = 0xFFFFFFFF;
+		}
+
+		if ((i & 15) == 0)
+			peak_frag = MAX(peak_frag, pool->get_fragmentation());
+
+		// hold a few blocks locked throughout, like buffers mid-upload
+		if (i == 20000) {
+			for (int j = 0; j < pinned; j++) {
+				CompactBlock &p = blocks[j];
+				if (p.id == 0xFFFFFFFF)
+					continue;
+				pool->lock(p.id);
+				p.pinned = pool->get(p.id);
+			}
+		}
+	}
+	CHECK(realloc_kept_data);
+
+	float frag_before = pool->get_fragmentation();
+	int heap_before = pool->get_heap_block_count();
+	uint64_t begin = OS::get_singleton()->get_ticks_usec();
+	pool->defragment();
+	uint64_t usec = OS::get_singleton()->get_ticks_usec() - begin;
+	float frag_after = pool->get_fragmentation();
+
+	OS::get_singleton()->print("\tpeak fragmentation %.3f, at end %.3f, after defragment %.3f (%.2f ms)\n", peak_frag, frag_before, frag_after, usec / 1000.0);
+	OS::get_singleton()->print("\theap overflow blocks %i -> %i, arena free %i KB, largest hole %i KB\n", heap_before, pool->get_heap_block_count(),
+			int(pool->get_available_mem() / 1024), int(pool->get_largest_free_block() / 1024));
+
+	CHECK(frag_after <= frag_before);
+
+	for (int i = 0; i < live; i++) {
+		CompactBlock &b = blocks[i];
+		if (b.id == 0xFFFFFFFF)
+			continue;
+		if (b.pinned) {
+			// locked blocks must not move
+			CHECK(pool->get(b.id) == b.pinned);
+			pool->unlock(b.id);
+			b.pinned = NULL;
+		}
+		CHECK(_compact_verify(pool, b, b.size));
+	}
+
+	// with nothing locked all free space ends up in one piece
+	pool->defragment();
+	CHECK(pool->get_fragmentation() == 0);
+	CHECK(pool->get_largest_free_block() == pool->get_available_mem());
+
+	for (int i = 0; i < live; i++) {
+		if (blocks[i].id == 0xFFFFFFFF)
+			continue;
+		CHECK(_compact_verify(pool, blocks[i], blocks[i].size));
+		pool->free(blocks[i].id);
+	}
+	CHECK(pool->get_total_usage() == 0);
+	CHECK(pool->get_heap_block_count() == 0);
+	memdelete(pool);
+
+	return true;
+}
+
+bool test_stereo_projection() {
+
+	OS::get_singleton()->print("\n\nTest: Stereo eye projections and widened culling frustum\n");
+
+	const float sep = 0.3;
+	const float conv = 4.0;
+
+	CameraMatrix mono, left, right;
+	mono.set_perspective(60, 400.0 / 240.0, 0.1, 50, false);
+	left.set_perspective(60, 400.0 / 240.0, 0.1, 50, false, 1, sep, conv);
+	right.set_perspective(60, 400.0 / 240.0, 0.1, 50, false, 2, sep, conv);
+
+	// Eye 0 is the mono projection
+	CameraMatrix center;
+	center.set_perspective(60, 400.0 / 240.0, 0.1, 50, false, 0, sep, conv);
+	for (int i = 0; i < 4; i++)
+		for (int j = 0; j < 4; j++)
+			CHECK(Math::abs(center.matrix[i][j] - mono.matrix[i][j]) < CMP_EPSILON);
+
+	// Both eyes agree at the convergence distance and disagree elsewhere
+	Vector3 l = left.xform(Vector3(0, 0, -conv));
+	Vector3 r = right.xform(Vector3(0, 0, -conv));
+	CHECK(Math::abs(l.x - r.x) < 0.001);
+	l = left.xform(Vector3(0, 0, -1));
+	r = right.xform(Vector3(0, 0, -1));
+	CHECK(l.x > r.x + 0.01); // crossed disparity in front of the screen plane
+
+	// Everything either eye can see passes the single culling frustum
+	Transform camera(Matrix3(Vector3(0, 1, 0), 0.7), Vector3(3, 1, -2));
+	Vector<Plane> planes = mono.get_stereo_projection_planes(camera, sep, conv);
+	CHECK(planes.size() == 6);
+
+	const CameraMatrix *eyes[2] = { &left, &right };
+	for (int e = 0; e < 2; e++) {
+		Vector3 points[8];
+		CHECK(eyes[e]->get_endpoints(camera, points));
+		for (int i = 0; i < 8; i++)
+			for (int p = 0; p < planes.size(); p++)
+				CHECK(planes[p].distance_to(points[i]) < 0.001);
+	}
+
+	// Widening only grows the mono frustum
+	Vector<Plane> mono_planes = mono.get_projection_planes(camera);
+	Vector3 mono_points[8];
+	CHECK(mono.get_endpoints(camera, mono_points));
+	for (int i = 0; i < 8; i++)
+		for (int p = 0; p < planes.size(); p++)
+			CHECK(planes[p].distance_to(mono_points[i]) < 0.001);
+
+	return true;
+}
+
+// A GPU on a virtual clock: each frame runs for gpu_usec once the GPU is
+// free, and frames that finished by the time the CPU looks are signalled
+class SimulatedGPURasterizer : public RasterizerDummy {
+public:
+	uint64_t clock;
+	uint64_t gpu_usec;
+	uint64_t gpu_free_at;
+	Vector<uint64_t> finish_times;
+	int max_seen_in_flight;
+
+	void _retire() {
+		uint64_t serial = get_frame_fence_completed();
+		while (serial < (uint64_t)finish_times.size() && finish_times[serial] <= clock)
+			serial++;
+		frame_fence_signal(serial);
+	}
+
+	virtual void _frame_fence_wait(uint64_t p_serial) {
+		if (finish_times[p_serial - 1] > clock)
+			clock = finish_times[p_serial - 1];
+		_retire();
+	}
+
+	virtual void begin_frame() {
+		_retire();
+		RasterizerDummy::begin_frame();
+	}
+
+	virtual void end_frame() {
+		RasterizerDummy::end_frame();
+		gpu_free_at = MAX(gpu_free_at, clock) + gpu_usec;
+		finish_times.push_back(gpu_free_at);
+		max_seen_in_flight = MAX(max_seen_in_flight, get_frames_in_flight());
+	}
+
+	SimulatedGPURasterizer(uint64_t p_gpu_usec) {
+		clock = 0;
+		gpu_usec = p_gpu_usec;
+		gpu_free_at = 0;
+		max_seen_in_flight = 0;
+	}
+};
+
+static uint64_t run_simulated_frames(SimulatedGPURasterizer *p_rasterizer, int p_frames, uint64_t p_cpu_usec, uint64_t p_record_usec) {
+
+	for (int i = 0; i < p_frames; i++) {
+		p_rasterizer->clock += p_cpu_usec;
+		p_rasterizer->begin_frame();
+		p_rasterizer->clock += p_record_usec;
+		p_rasterizer->end_frame();
+	}
+	return p_rasterizer->clock;
+}
+
+bool test_frame_fence() {
+
+	OS::get_singleton()->print("\n\nTest: Frame fence and pipelined frames\n");
+
+	// Without a GPU behind it every wait completes at once
+	RasterizerDummy *dummy = memnew(RasterizerDummy);
+	CHECK(dummy->get_max_frames_in_flight() == 1);
+	for (int i = 0; i < 10; i++) {
+		dummy->begin_frame();
+		CHECK(dummy->get_frames_in_flight() == 0);
+		dummy->end_frame();
+	}
+	CHECK(dummy->get_frame_fence_submitted() == 10);
+	CHECK(dummy->frame_fence_is_complete(9) && !dummy->frame_fence_is_complete(10));
+	CHECK(dummy->get_frame_fence_stall_count() == 9);
+
+	OS::get_singleton()->print("\t(errors below are expected)\n");
+	dummy->set_max_frames_in_flight(0);
+	dummy->set_max_frames_in_flight(Rasterizer::MAX_FRAMES_IN_FLIGHT + 1);
+	CHECK(dummy->get_max_frames_in_flight() == 1);
+	// Can't complete what wasn't submitted
+	dummy->frame_fence_signal(11);
+	CHECK(dummy->get_frame_fence_completed() == 9);
+	memdelete(dummy);
+
+	// CPU 6 ms of scene work and 4 ms recording, GPU 8 ms per frame
+	const int frames = 60;
+	SimulatedGPURasterizer *lockstep = memnew(SimulatedGPURasterizer(8000));
+	uint64_t lockstep_time = run_simulated_frames(lockstep, frames, 6000, 4000);
+	CHECK(lockstep->max_seen_in_flight == 1);
+	CHECK(lockstep->get_frame_fence_stall_count() > 0);
+
+	SimulatedGPURasterizer *pipelined = memnew(SimulatedGPURasterizer(8000));
+	pipelined->set_max_frames_in_flight(2);
+	uint64_t pipelined_time = run_simulated_frames(pipelined, frames, 6000, 4000);
+	CHECK(pipelined->max_seen_in_flight <= 2);
+	CHECK(pipelined->get_frame_fence_stall_count() == 0);
+	CHECK(pipelined_time < lockstep_time);
+
+	OS::get_singleton()->print("\tlockstep %.2f ms/frame, pipelined %.2f ms/frame\n", lockstep_time / 1000.0 / frames, pipelined_time / 1000.0 / frames);
+
+	// A GPU slower than the CPU can't get further than two frames behind
+	SimulatedGPURasterizer *gpu_bound = memnew(SimulatedGPURasterizer(20000));
+	gpu_bound->set_max_frames_in_flight(2);
+	uint64_t gpu_bound_time = run_simulated_frames(gpu_bound, frames, 2000, 2000);
+	CHECK(gpu_bound->max_seen_in_flight == 2);
+	CHECK(gpu_bound->get_frame_fence_stall_count() > 0);
+	// The GPU never idles after the first frame, the CPU waits on it instead
+	CHECK(gpu_bound->gpu_free_at == 4000 + uint64_t(frames) * 20000);
+	CHECK(gpu_bound_time + 2 * 20000 >= gpu_bound->gpu_free_at);
+
+	memdelete(lockstep);
+	memdelete(pipelined);
+	memdelete(gpu_bound);
+
+	return true;
+}
+
+// Counts which screens the visual server asked to draw
+class ScreenRecordRasterizer : public RasterizerDummy {
+public:
+	int screen_draws[2];
+
+	virtual void set_screen(int p_screen) {
+		if (p_screen >= 0 && p_screen < 2)
+			screen_draws[p_screen]++;
+	}
+
+	ScreenRecordRasterizer() {
+		screen_draws[0] = 0;
+		screen_draws[1] = 0;
+	}
+};
+
+bool test_screen_update_modes() {
+
+	OS::get_singleton()->print("\n\nTest: Bottom screen only redraws when dirty\n");
+
+	ScreenRecordRasterizer *rasterizer = memnew(ScreenRecordRasterizer);
+	VisualServerRaster *vs = memnew(VisualServerRaster(rasterizer));
+	vs->init();
+
+	VS::ViewportRect rect;
+	RID viewports[2], canvases[2];
+	for (int i = 0; i < 2; i++) {
+		viewports[i] = vs->viewport_create();
+		rect.width = i ? 320 : 400;
+		rect.height = 240;
+		vs->viewport_set_rect(viewports[i], rect);
+		vs->viewport_attach_to_screen(viewports[i], i);
+		canvases[i] = vs->canvas_create();
+		vs->viewport_attach_canvas(viewports[i], canvases[i]);
+	}
+
+	RID top_item = vs->canvas_item_create();
+	vs->canvas_item_set_parent(top_item, canvases[0]);
+	RID panel = vs->canvas_item_create();
+	vs->canvas_item_set_parent(panel, canvases[1]);
+	RID button = vs->canvas_item_create();
+	vs->canvas_item_set_parent(button, panel);
+
+	CHECK(vs->screen_get_update_mode(1) == VS::SCREEN_UPDATE_ALWAYS);
+	vs->screen_set_update_mode(1, VS::SCREEN_UPDATE_WHEN_DIRTY);
+	CHECK(vs->screen_get_update_mode(1) == VS::SCREEN_UPDATE_WHEN_DIRTY);
+
+	// First frame always draws, then the static screen is left alone
+	vs->draw();
+	CHECK(rasterizer->screen_draws[1] == 1);
+	vs->draw();
+	vs->draw();
+	CHECK(rasterizer->screen_draws[1] == 1);
+	CHECK(rasterizer->screen_draws[0] > 0);
+
+	// Top screen canvas changes stay on the top screen
+	vs->canvas_item_add_rect(top_item, Rect2(0, 0, 10, 10), Color(1, 0, 0));
+	vs->canvas_item_set_transform(top_item, Matrix32(0, Vector2(5, 5)));
+	vs->draw();
+	CHECK(rasterizer->screen_draws[1] == 1);
+
+	// A nested item on the bottom canvas marks it for one frame
+	vs->canvas_item_add_rect(button, Rect2(0, 0, 10, 10), Color(0, 1, 0));
+	vs->draw();
+	CHECK(rasterizer->screen_draws[1] == 2);
+	vs->draw();
+	CHECK(rasterizer->screen_draws[1] == 2);
+
+	vs->canvas_set_modulate(canvases[1], Color(0.5, 0.5, 0.5));
+	vs->draw();
+	CHECK(rasterizer->screen_draws[1] == 3);
+
+	// Z, clip and triangle arrays are attributed to their screen too
+	vs->canvas_item_set_z(top_item, 2);
+	vs->canvas_item_set_clip(top_item, true);
+	vs->draw();
+	CHECK(rasterizer->screen_draws[1] == 3);
+
+	vs->canvas_item_set_z(button, 1);
+	vs->draw();
+	CHECK(rasterizer->screen_draws[1] == 4);
+
+	vs->canvas_item_set_clip(panel, true);
+	vs->draw();
+	CHECK(rasterizer->screen_draws[1] == 5);
+
+	Vector<int> indices;
+	Vector<Point2> points;
+	points.push_back(Point2(0, 0));
+	points.push_back(Point2(10, 0));
+	points.push_back(Point2(0, 10));
+	vs->canvas_item_add_triangle_array(button, indices, points, Vector<Color>(), Vector<Point2>(), RID(), 1);
+	vs->draw();
+	CHECK(rasterizer->screen_draws[1] == 6);
+	vs->draw();
+	CHECK(rasterizer->screen_draws[1] == 6);
+
+	// A 3D scene only shown on the top screen
+	RID scenario = vs->scenario_create();
+	vs->viewport_set_scenario(viewports[0], scenario);
+	RID camera = vs->camera_create();
+	vs->viewport_attach_camera(viewports[0], camera);
+	RID instance = vs->instance_create();
+	vs->instance_set_scenario(instance, scenario);
+	vs->instance_set_transform(instance, Transform(Matrix3(), Vector3(1, 2, 3)));
+	vs->camera_set_transform(camera, Transform(Matrix3(), Vector3(0, 0, 5)));
+	vs->draw();
+	CHECK(rasterizer->screen_draws[1] == 6);
+
+	// Resources can be used anywhere, every screen is redrawn
+	RID texture = vs->texture_create();
+	vs->texture_set_flags(texture, 0);
+	vs->draw();
+	CHECK(rasterizer->screen_draws[1] == 7);
+
+	vs->viewport_set_rect(viewports[1], rect);
+	vs->draw();
+	CHECK(rasterizer->screen_draws[1] == 8);
+
+	vs->screen_set_update_mode(1, VS::SCREEN_UPDATE_ALWAYS);
+	vs->draw();
+	vs->draw();
+	CHECK(rasterizer->screen_draws[1] == 10);
+
+	vs->free(instance);
+	vs->free(camera);
+	vs->free(scenario);
+	vs->free(texture);
+	vs->free(button);
+	vs->free(panel);
+	vs->free(top_item);
+	for (int i = 0; i < 2; i++) {
+		vs->viewport_detach(viewports[i]);
+		vs->free(viewports[i]);
+		vs->free(canvases[i]);
+	}
+	vs->finish();
+	memdelete(vs);
+	memdelete(rasterizer);
+
+	return true;
+}
+
+// Counts the input events that reach it through its viewport
+class InputRecorder : public Node {
+
+	OBJ_TYPE(InputRecorder, Node);
+
+	void _input(const InputEvent &p_event) { events++; }
+
+protected:
+	static void _bind_methods() {
+		ObjectTypeDB::bind_method(_MD("_input"), &InputRecorder::_input);
+	}
+
+public:
+	int events;
+
+	InputRecorder() { events = 0; }
+};
+
+bool test_touch_screen_routing() {
+
+	OS::get_singleton()->print("\n\nTest: Touch on the bottom screen skips top screen viewports\n");
+
+	RasterizerDummy *rasterizer = memnew(RasterizerDummy);
+	VisualServerRaster *vs = memnew(VisualServerRaster(rasterizer));
+	vs->init();
+
+	SceneTree *tree = memnew(SceneTree);
+	tree->init();
+
+	InputRecorder *top = memnew(InputRecorder);
+	tree->get_root()->add_child(top);
+	top->set_process_input(true);
+
+	// Without a second screen the viewport stays nested on the main one
+	bool bottom_screen = OS::get_singleton()->get_screen_count() > 1;
+	Viewport *bottom = memnew(Viewport);
+	if (bottom_screen)
+		bottom->set_screen(1);
+	tree->get_root()->add_child(bottom);
+	InputRecorder *bottom_node = memnew(InputRecorder);
+	bottom->add_child(bottom_node);
+	bottom_node->set_process_input(true);
+
+	// Nested viewports take the screen of the one they are drawn in
+	Viewport *nested = memnew(Viewport);
+	bottom->add_child(nested);
+	InputRecorder *nested_node = memnew(InputRecorder);
+	nested->add_child(nested_node);
+	nested_node->set_process_input(true);
+
+	InputEvent ev;
+	ev.type = InputEvent::SCREEN_TOUCH;
+	ev.screen = 1;
+	ev.screen_touch.pressed = true;
+	ev.screen_touch.x = 20;
+	ev.screen_touch.y = 30;
+	tree->input_event(ev);
+	ev.type = InputEvent::MOUSE_BUTTON;
+	ev.mouse_button.button_index = BUTTON_LEFT;
+	ev.mouse_button.pressed = true;
+	tree->input_event(ev);
+	CHECK(top->events == 0);
+	if (bottom_screen)
+		CHECK(bottom_node->events == 2 && nested_node->events == 2);
+
+	// Pointer events on the main screen stay off the bottom one
+	int bottom_events = bottom_node->events;
+	ev.screen = 0;
+	tree->input_event(ev);
+	CHECK(top->events == 1);
+	if (bottom_screen)
+		CHECK(bottom_node->events == bottom_events && nested_node->events == bottom_events);
+
+	// Other events have no screen and reach every viewport
+	bottom_events = bottom_node->events;
+	InputEvent key;
+	key.type = InputEvent::KEY;
+	key.key.pressed = true;
+	key.key.scancode = KEY_A;
+	tree->input_event(key);
+	CHECK(top->events == 2 && bottom_node->events == bottom_events + 1 && nested_node->events == bottom_events + 1);
+
+	tree->finish();
+	memdelete(tree);
+	vs->finish();
+	memdelete(vs);
+	memdelete(rasterizer);
+
+	return true;
+}
+
+// Sample bookkeeping without an AudioServer to lock
+class StubSampleManager : public SampleManagerSW {
+	struct Sample {
+		AS::SampleFormat format;
+		bool stereo;
+		int length;
+		AS::SampleLoopFormat loop_format;
+		int loop_begin;
+		int loop_end;
+		int mix_rate;
+		Vector<uint8_t> data;
+	};
+
+	mutable RID_Owner<Sample> owner;
+
+public:
+	virtual RID sample_create(AS::SampleFormat p_format, bool p_stereo, int p_length) {
+		Sample *s = memnew(Sample);
+		s->format = p_format;
+		s->stereo = p_stereo;
+		s->length = p_length;
+		s->loop_format = AS::SAMPLE_LOOP_NONE;
+		s->loop_begin = 0;
+		s->loop_end = 0;
+		s->mix_rate = 44100;
+		s->data.resize(p_length * 4 + 16);
+		for (int i = 0; i < s->data.size(); i++)
+			s->data[i] = 0;
+		return owner.make_rid(s);
+	}
+	virtual void sample_set_description(RID p_sample, const String &p_description) {}
+	virtual String sample_get_description(RID p_sample) const { return String(); }
+	virtual AS::SampleFormat sample_get_format(RID p_sample) const { return owner.get(p_sample)->format; }
+	virtual bool sample_is_stereo(RID p_sample) const { return owner.get(p_sample)->stereo; }
+	virtual int sample_get_length(RID p_sample) const { return owner.get(p_sample)->length; }
+	virtual void sample_set_data(RID p_sample, const DVector<uint8_t> &p_buffer) {}
+	virtual const DVector<uint8_t> sample_get_data(RID p_sample) const { return DVector<uint8_t>(); }
+	virtual void *sample_get_data_ptr(RID p_sample) const { return owner.get(p_sample)->data.ptr(); }
+	virtual uint32_t sample_get_version(RID p_sample) const { return 1; } // data is never set
+	virtual void sample_set_mix_rate(RID p_sample, int p_rate) { owner.get(p_sample)->mix_rate = p_rate; }
+	virtual int sample_get_mix_rate(RID p_sample) const { return owner.get(p_sample)->mix_rate; }
+	virtual void sample_set_loop_format(RID p_sample, AS::SampleLoopFormat p_format) { owner.get(p_sample)->loop_format = p_format; }
+	virtual AS::SampleLoopFormat sample_get_loop_format(RID p_sample) const { return owner.get(p_sample)->loop_format; }
+	virtual void sample_set_loop_begin(RID p_sample, int p_pos) { owner.get(p_sample)->loop_begin = p_pos; }
+	virtual int sample_get_loop_begin(RID p_sample) const { return owner.get(p_sample)->loop_begin; }
+	virtual void sample_set_loop_end(RID p_sample, int p_pos) { owner.get(p_sample)->loop_end = p_pos; }
+	virtual int sample_get_loop_end(RID p_sample) const { return owner.get(p_sample)->loop_end; }
+	virtual bool is_sample(RID p_sample) const { return owner.owns(p_sample); }
+	virtual void free(RID p_sample) {
+		Sample *s = owner.get(p_sample);
+		owner.free(p_sample);
+		memdelete(s);
+	}
+};
+
+// Voices that play until told they finished
+class StubVoiceBackend : public AudioMixerHW::Backend {
+public:
+	struct Voice {
+		bool playing;
+		RID sample;
+		int from;
+		int mix_rate;
+		float left, right;
+		int position;
+	};
+
+	Voice voices[2];
+	int stops;
+
+	virtual int backend_get_voice_count() const { return 2; }
+	virtual bool backend_voice_start(int p_voice, const Sample &p_sample, int p_from_frame, int p_mix_rate, float p_left, float p_right) {
+		Voice &v = voices[p_voice];
+		v.playing = true;
+		v.sample = p_sample.rid;
+		v.from = p_from_frame;
+		v.mix_rate = p_mix_rate;
+		v.left = p_left;
+		v.right = p_right;
+		v.position = p_from_frame;
+		return true;
+	}
+	virtual void backend_voice_stop(int p_voice) {
+		voices[p_voice].playing = false;
+		stops++;
+	}
+	virtual void backend_voice_set_mix_rate(int p_voice, int p_mix_rate) { voices[p_voice].mix_rate = p_mix_rate; }
+	virtual void backend_voice_set_volume(int p_voice, float p_left, float p_right) {
+		voices[p_voice].left = p_left;
+		voices[p_voice].right = p_right;
+	}
+	virtual bool backend_voice_is_playing(int p_voice) const { return voices[p_voice].playing; }
+	virtual int backend_voice_get_position(int p_voice) const { return voices[p_voice].position; }
+
+	StubVoiceBackend() {
+		for (int i = 0; i < 2; i++)
+			voices[i].playing = false;
+		stops = 0;
+	}
+};
+
+bool test_hardware_voices() {
+
+	OS::get_singleton()->print("\n\nTest: Hardware voice routing and stealing\n");
+
+	StubSampleManager samples;
+	AudioMixerSW software(&samples, 10, 44100, AudioMixerSW::MIX_STEREO);
+	StubVoiceBackend backend;
+	AudioMixerHW mixer(&samples, &software, &backend);
+
+	RID one_shot = samples.sample_create(AS::SAMPLE_FORMAT_PCM16, false, 1000);
+	samples.sample_set_mix_rate(one_shot, 22050);
+	RID looped = samples.sample_create(AS::SAMPLE_FORMAT_PCM8, true, 1000);
+	samples.sample_set_loop_format(looped, AS::SAMPLE_LOOP_FORWARD);
+	samples.sample_set_loop_begin(looped, 100);
+	samples.sample_set_loop_end(looped, 1000);
+	RID adpcm = samples.sample_create(AS::SAMPLE_FORMAT_IMA_ADPCM, false, 1000);
+
+	// Nothing is routed until update, settings made before it count
+	AudioMixer::ChannelID loop = mixer.channel_alloc(looped);
+	mixer.channel_set_volume(loop, 0.1);
+	mixer.channel_set_pan(loop, -1);
+	AudioMixer::ChannelID filtered = mixer.channel_alloc(one_shot);
+	mixer.channel_set_filter(filtered, AudioMixer::FILTER_LOWPASS, 1000, 1);
+	AudioMixer::ChannelID compressed = mixer.channel_alloc(adpcm);
+	CHECK(mixer.channel_is_valid(loop) && mixer.get_hardware_voices_used() == 0);
+
+	mixer.update();
+	CHECK(mixer.channel_is_hardware(loop));
+	CHECK(!mixer.channel_is_hardware(filtered) && mixer.channel_is_valid(filtered));
+	CHECK(!mixer.channel_is_hardware(compressed) && mixer.channel_is_valid(compressed));
+	CHECK(backend.voices[0].sample == looped);
+	CHECK(Math::abs(backend.voices[0].left - 0.1) < 0.001 && backend.voices[0].right == 0);
+
+	// Volume, pan and rate go straight to the voice
+	mixer.set_mixer_volume(0.5);
+	CHECK(Math::abs(backend.voices[0].left - 0.05) < 0.001);
+	mixer.set_mixer_volume(1.0);
+	mixer.channel_set_mix_rate(loop, 11025);
+	CHECK(backend.voices[0].mix_rate == 11025);
+
+	// Gaining reverb moves a voice to software where the hardware left off
+	AudioMixer::ChannelID effect = mixer.channel_alloc(one_shot);
+	mixer.update();
+	CHECK(mixer.channel_is_hardware(effect) && backend.voices[1].mix_rate == 22050);
+	backend.voices[1].position = 300;
+	mixer.channel_set_reverb(effect, AudioMixer::REVERB_SMALL, 0.5);
+	CHECK(!mixer.channel_is_hardware(effect) && mixer.channel_is_valid(effect));
+	CHECK(!backend.voices[1].playing && mixer.get_hardware_voices_used() == 1);
+	CHECK(mixer.channel_get_reverb(effect) == 0.5);
+
+	// A finished voice is reaped and its channel goes away
+	AudioMixer::ChannelID short_shot = mixer.channel_alloc(one_shot);
+	mixer.channel_set_volume(short_shot, 0.2);
+	mixer.update();
+	CHECK(mixer.channel_is_hardware(short_shot));
+	backend.voices[1].playing = false;
+	CHECK(!mixer.channel_is_valid(short_shot));
+	int stops = backend.stops;
+	mixer.update();
+	CHECK(backend.stops == stops + 1 && mixer.get_hardware_voices_used() == 1);
+
+	// Fill the hardware, then let the next one spill to software
+	AudioMixer::ChannelID quiet = mixer.channel_alloc(one_shot);
+	mixer.channel_set_volume(quiet, 0.2);
+	AudioMixer::ChannelID spill = mixer.channel_alloc(one_shot);
+	mixer.update();
+	CHECK(mixer.channel_is_hardware(quiet));
+	CHECK(!mixer.channel_is_hardware(spill) && mixer.channel_is_valid(spill));
+
+	// Exhaust software too, using channels loud enough not to be picked
+	AudioMixer::ChannelID busy = 0;
+	do {
+		busy = software.channel_alloc(one_shot);
+	} while (busy != AudioMixer::INVALID_CHANNEL);
+
+	// The quietest one-shot is stolen, the quieter loop is left alone
+	AudioMixer::ChannelID loud = mixer.channel_alloc(one_shot);
+	mixer.update();
+	CHECK(mixer.get_steal_count() == 1);
+	CHECK(!mixer.channel_is_valid(quiet));
+	CHECK(mixer.channel_is_hardware(loud) && mixer.channel_is_valid(loop));
+
+	// A new channel quieter than everything playing is dropped instead
+	AudioMixer::ChannelID faint = mixer.channel_alloc(one_shot);
+	mixer.channel_set_volume(faint, 0.05);
+	mixer.update();
+	CHECK(!mixer.channel_is_valid(faint));
+	CHECK(mixer.get_steal_count() == 1);
+
+	mixer.channel_free(loop);
+	CHECK(!backend.voices[0].playing && !mixer.channel_is_valid(loop));
+
+	samples.free(one_shot);
+	samples.free(looped);
+	samples.free(adpcm);
+
+	return true;
+}
+
+// Lets SampleManagerMallocSW lock the audio server without a device
+class LockOnlyAudioDriver : public AudioDriverSW {
+public:
+	virtual const char *get_name() const { return "Test"; }
+	virtual Error init() { return OK; }
+	virtual void start() {}
+	virtual int get_mix_rate() const { return 44100; }
+	virtual OutputFormat get_output_format() const { return OUTPUT_STEREO; }
+	virtual void lock() {}
+	virtual void unlock() {}
+	virtual void finish() {}
+};
+
+// Keeps a private copy of each sample it plays, the way the 3DS voices copy
+// to linear memory, and reuses it while the sample version stays the same
+class CopyingVoiceBackend : public AudioMixerHW::Backend {
+public:
+	struct Copy {
+		uint32_t version;
+		Vector<uint8_t> data;
+	};
+
+	Map<RID, Copy> copies;
+	int copy_count;
+	int played[2];
+
+	virtual int backend_get_voice_count() const { return 2; }
+	virtual bool backend_voice_start(int p_voice, const Sample &p_sample, int p_from_frame, int p_mix_rate, float p_left, float p_right) {
+		Map<RID, Copy>::Element *E = copies.find(p_sample.rid);
+		if (!E || E->get().version != p_sample.version) {
+			Copy copy;
+			copy.version = p_sample.version;
+			copy.data.resize(p_sample.length);
+			copymem(copy.data.ptr(), p_sample.data, p_sample.length);
+			E = copies.insert(p_sample.rid, copy);
+			copy_count++;
+		}
+		played[p_voice] = E->get().data[p_from_frame];
+		return true;
+	}
+	virtual void backend_voice_stop(int p_voice) {}
+	virtual void backend_voice_set_mix_rate(int p_voice, int p_mix_rate) {}
+	virtual void backend_voice_set_volume(int p_voice, float p_left, float p_right) {}
+	virtual bool backend_voice_is_playing(int p_voice) const { return true; }
+	virtual int backend_voice_get_position(int p_voice) const { return 0; }
+
+	CopyingVoiceBackend() {
+		copy_count = 0;
+		played[0] = played[1] = -1;
+	}
+};
+
+static int _play_first_frame(AudioMixerHW &p_mixer, CopyingVoiceBackend &p_backend, RID p_sample) {
+
+	AudioMixer::ChannelID channel = p_mixer.channel_alloc(p_sample);
+	p_mixer.update();
+	int played = p_mixer.channel_is_hardware(channel) ? p_backend.played[0] : -1;
+	p_mixer.channel_free(channel);
+	return played;
+}
+
+bool test_hardware_voice_sample_data() {
+
+	OS::get_singleton()->print("\n\nTest: Hardware voices play sample data set after the first play\n");
+
+	LockOnlyAudioDriver driver;
+	driver.set_singleton();
+	SampleManagerMallocSW samples;
+	AudioServerSW *server = memnew(AudioServerSW(&samples));
+
+	AudioMixerSW software(&samples, 10, 44100, AudioMixerSW::MIX_STEREO);
+	CopyingVoiceBackend backend;
+	AudioMixerHW mixer(&samples, &software, &backend);
+
+	DVector<uint8_t> data;
+	data.resize(64);
+	for (int i = 0; i < 64; i++)
+		data.set(i, 0x10);
+
+	RID sample = samples.sample_create(AS::SAMPLE_FORMAT_PCM8, false, 64);
+	samples.sample_set_data(sample, data);
+	uint32_t version = samples.sample_get_version(sample);
+	CHECK(_play_first_frame(mixer, backend, sample) == 0x10);
+	CHECK(_play_first_frame(mixer, backend, sample) == 0x10);
+	CHECK(backend.copy_count == 1 && samples.sample_get_version(sample) == version);
+
+	// Rewritten in place: same RID, pointer and size, new data
+	for (int i = 0; i < 64; i++)
+		data.set(i, 0x20);
+	samples.sample_set_data(sample, data);
+	CHECK(samples.sample_get_version(sample) != version);
+	CHECK(_play_first_frame(mixer, backend, sample) == 0x20);
+	CHECK(backend.copy_count == 2);
+
+	// A new sample never matches a copy of a freed one
+	version = samples.sample_get_version(sample);
+	samples.free(sample);
+	for (int i = 0; i < 64; i++)
+		data.set(i, 0x30);
+	sample = samples.sample_create(AS::SAMPLE_FORMAT_PCM8, false, 64);
+	samples.sample_set_data(sample, data);
+	CHECK(samples.sample_get_version(sample) != version);
+	CHECK(_play_first_frame(mixer, backend, sample) == 0x30);
+
+	samples.free(sample);
+	memdelete(server);
+
+	return true;
+}
+
+typedef bool (*TestFunc)(void);
+
+TestFunc test_funcs[] = {
+
+	test_job_system,
+	test_job_system_benchmark,
+	test_zone_profiler,
+	test_performance_monitors,
+	test_slab_allocator,
+	test_slab_allocator_benchmark,
+	test_compacting_dynamic_pool,
+	test_stereo_projection,
+	test_frame_fence,
+	test_screen_update_modes,
+	test_touch_screen_routing,
+	test_hardware_voices,
+	test_hardware_voice_sample_data,
+	0
+};
+
+MainLoop *test() {
+
+	int count = 0;
+	int passed = 0;
+
+	while (true) {
+		if (!test_funcs[count])
+			break;
+		bool pass = test_funcs[count]();
+		if (pass)
+			passed++;
+		OS::get_singleton()->print("\t%s\n", pass ? "PASS" : "FAILED");
+
+		count++;
+	}
+
+	OS::get_singleton()->print("\n\n\n");
+	OS::get_singleton()->print("*************\n");
+	OS::get_singleton()->print("***TOTALS!***\n");
+	OS::get_singleton()->print("*************\n");
+
+	OS::get_singleton()->print("Passed %i of %i tests\n", passed, count);
+
+	return NULL;
+}
+} // namespace TestOS
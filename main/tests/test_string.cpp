@@ -29,9 +29,12 @@
 /*************************************************************************/
 
 #include "ustring.h"
+#include "string_builder.h"
 #include <wchar.h>
 //#include "math_funcs.h"
 #include "core/io/ip_address.h"
+#include "core/os/thread.h"
+#include "core/string_db.h"
 #include "drivers/nrex/regex.h"
 #include "os/os.h"
 #include <stdio.h>
@@ -866,6 +869,215 @@ bool test_29() {
 	return state;
 };
 
+bool test_30() {
+
+	OS::get_singleton()->print("\n\nTest 30: StringBuilder\n");
+
+	bool state = true;
+
+	StringBuilder sb;
+	state = state && sb.empty() && sb.as_string() == "";
+
+	sb += "Hello";
+	sb += String(" World");
+	sb += (CharType)'!';
+	state = state && sb.get_length() == 12 && sb.as_string() == "Hello World!";
+
+	// Grow past the inline storage, the result must match plain concatenation
+	String expected;
+	sb.clear();
+	for (int i = 0; i < 100; i++) {
+		String part = "item_" + itos(i) + ", ";
+		expected += part;
+		sb += part;
+	}
+	state = state && sb.as_string() == expected;
+	OS::get_singleton()->print("\tGrown to %i chars: %s\n", sb.get_length(), sb.as_string() == expected ? "OK" : "FAIL");
+
+	sb.clear();
+	sb.append_repeat('-', 3);
+	sb.append(L"abcdef", 2);
+	sb.append_repeat('-', 0);
+	state = state && sb.as_string() == "---ab";
+
+	// Strings built by concatenation and formatting
+	String a = "abc";
+	state = state && (a + "") == "abc" && (String() + a) == "abc" && (a + "def") == "abcdef";
+	state = state && ("xy" + a) == "xyabc" && (a.substr(0, 3) == a) && a.substr(1, 5) == "bc";
+	state = state && String("a-b-c").replace("-", "+") == "a+b+c" && String("abc").replace("x", "y") == "abc";
+	state = state && String("a-b-c").replace_first("-", "") == "ab-c" && String("aXbXX").replace("X", "YY") == "aYYbYYYY";
+
+	Array args;
+	args.push_back(42);
+	args.push_back("ten");
+	bool error;
+	String formatted = String("Score: %05d, %s%%!").sprintf(args, &error);
+	OS::get_singleton()->print("\tFormatted: %ls\n", formatted.c_str());
+	state = state && !error && formatted == "Score: 00042, ten%!";
+
+	return state;
+}
+
+bool test_31() {
+
+	OS::get_singleton()->print("\n\nTest 31: Benchmark UI text and save file generation\n");
+
+	const int frames = 20000;
+	uint64_t begin = OS::get_singleton()->get_ticks_usec();
+	int total = 0;
+	for (int i = 0; i < frames; i++) {
+
+		Array args;
+		args.push_back(i);
+		args.push_back(i % 100);
+		bool error;
+		String label = String("Score: %d  Lives: %02d").sprintf(args, &error);
+		String hp = "HP " + itos(i % 97) + "/" + itos(100);
+		total += label.length() + hp.length();
+	}
+	uint64_t ui_usec = OS::get_singleton()->get_ticks_usec() - begin;
+	OS::get_singleton()->print("\tUI labels: %i frames in %i usec (%i chars)\n", frames, int(ui_usec), total);
+
+	const int lines = 5000;
+	begin = OS::get_singleton()->get_ticks_usec();
+	String save_concat;
+	for (int i = 0; i < lines; i++) {
+
+		save_concat += "slot_" + itos(i) + " = \"" + String::num(i * 0.5, 1) + "\"\n";
+	}
+	uint64_t concat_usec = OS::get_singleton()->get_ticks_usec() - begin;
+
+	begin = OS::get_singleton()->get_ticks_usec();
+	StringBuilder save;
+	for (int i = 0; i < lines; i++) {
+
+		save += "slot_";
+		save += itos(i);
+		save += " = \"";
+		save += String::num(i * 0.5, 1);
+		save += "\"\n";
+	}
+	String save_built = save.as_string();
+	uint64_t builder_usec = OS::get_singleton()->get_ticks_usec() - begin;
+
+	OS::get_singleton()->print("\tSave file, %i lines: += %i usec, StringBuilder %i usec\n", lines, int(concat_usec), int(builder_usec));
+
+	return save_built == save_concat;
+}
+
+struct StringNameChurn {
+
+	enum Mode {
+		SHARED_NAMES,
+		THREAD_NAMES,
+		CACHED_NAMES,
+		MODE_MAX
+	};
+
+	Mode mode;
+	int iterations;
+	char names[4][32];
+	uint32_t hash_sum;
+};
+
+static void _string_name_churn(void *p_userdata) {
+
+	StringNameChurn *churn = (StringNameChurn *)p_userdata;
+	uint32_t sum = 0;
+
+	// the kind of names call_deferred and emit_signal build every frame
+	for (int i = 0; i < churn->iterations; i++) {
+
+		switch (churn->mode) {
+			case StringNameChurn::SHARED_NAMES: {
+				sum += StringName("_process").hash();
+				sum += StringName("_input_event").hash();
+				sum += StringName("update_worlds").hash();
+				sum += StringName("timeout").hash();
+			} break;
+			case StringNameChurn::THREAD_NAMES: {
+				for (int n = 0; n < 4; n++)
+					sum += StringName(churn->names[n]).hash();
+			} break;
+			case StringNameChurn::CACHED_NAMES: {
+				sum += SNAME("_process").hash();
+				sum += SNAME("_input_event").hash();
+				sum += SNAME("update_worlds").hash();
+				sum += SNAME("timeout").hash();
+			} break;
+			default: {}
+		}
+	}
+
+	churn->hash_sum = sum;
+}
+
+bool test_32() {
+
+	OS::get_singleton()->print("\n\nTest 32: StringName interning contention\n");
+
+	bool state = true;
+
+	// Cached and runtime names intern to the same entry
+	StringName runtime_name = "timeout";
+	state = state && SNAME("timeout") == runtime_name && SNAME("timeout").hash() == String("timeout").hash();
+	state = state && StringName(String("_process")) == SNAME("_process");
+	state = state && StringName::search(L"update_worlds") == SNAME("update_worlds");
+#if __cplusplus >= 201103L
+	state = state && StringName::hash_static("_input_event") == String::hash("_input_event");
+#endif
+
+	const char *mode_names[StringNameChurn::MODE_MAX] = { "same names", "per-thread names", "SNAME" };
+	const int iterations = 50000;
+	const int thread_counts[] = { 1, 4 };
+
+	StringNameChurn churn[4];
+	Vector<StringName> held;
+	for (int t = 0; t < 4; t++) {
+		for (int n = 0; n < 4; n++) {
+			snprintf(churn[t].names[n], 32, "node_%i_signal_%i", t, n);
+			held.push_back(churn[t].names[n]);
+		}
+	}
+
+	// Keep the names alive like method tables do, so the loops only look them up
+	held.push_back("_process");
+	held.push_back("_input_event");
+	held.push_back("update_worlds");
+	held.push_back("timeout");
+
+	for (int m = 0; m < StringNameChurn::MODE_MAX; m++) {
+
+		for (int c = 0; c < 2; c++) {
+
+			int thread_count = thread_counts[c];
+			Thread *threads[4];
+
+			uint64_t begin = OS::get_singleton()->get_ticks_usec();
+			for (int t = 0; t < thread_count; t++) {
+
+				churn[t].mode = StringNameChurn::Mode(m);
+				churn[t].iterations = iterations;
+				churn[t].hash_sum = 0;
+				threads[t] = Thread::create(_string_name_churn, &churn[t]);
+			}
+
+			for (int t = 0; t < thread_count; t++) {
+
+				Thread::wait_to_finish(threads[t]);
+				memdelete(threads[t]);
+				if (m != StringNameChurn::THREAD_NAMES)
+					state = state && churn[t].hash_sum == churn[0].hash_sum;
+			}
+			uint64_t usec = OS::get_singleton()->get_ticks_usec() - begin;
+
+			OS::get_singleton()->print("\t%s, %i thread(s): %i lookups in %i usec\n", mode_names[m], thread_count, thread_count * iterations * 4, int(usec));
+		}
+	}
+
+	return state;
+}
+
 typedef bool (*TestFunc)(void);
 
 TestFunc test_funcs[] = {
@@ -899,6 +1111,9 @@ TestFunc test_funcs[] = {
 	test_27,
 	test_28,
 	test_29,
+	test_30,
+	test_31,
+	test_32,
 	0
 
 };
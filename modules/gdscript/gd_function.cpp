@@ -161,8 +161,108 @@ static String _get_var_type(const Variant *p_type) {
 	return basestr;
 }
 
+// With GCC and Clang each opcode handler jumps straight to the next one
+// through a table of label addresses (computed goto), so every handler gets
+// its own indirect branch instead of all of them sharing the one at the top
+// of the switch. Other compilers, or builds defining
+// GDSCRIPT_SWITCH_DISPATCH, run the same handlers through the switch.
+#if defined(__GNUC__) && !defined(GDSCRIPT_SWITCH_DISPATCH)
+
+#if __cplusplus >= 201103L
+#define OPCODES_TABLE_CHECK \
+	static_assert(sizeof(switch_table_ops) / sizeof(switch_table_ops[0]) == (OPCODE_END + 1), "Opcodes in jump table aren't the same as opcodes in enum.");
+#else
+#define OPCODES_TABLE_CHECK
+#endif
+
+#define OPCODES_TABLE                                   \
+	static const void *switch_table_ops[] = {           \
+		&&OPCODE_OPERATOR,                              \
+		&&OPCODE_EXTENDS_TEST,                          \
+		&&OPCODE_SET,                                   \
+		&&OPCODE_GET,                                   \
+		&&OPCODE_SET_NAMED,                             \
+		&&OPCODE_GET_NAMED,                             \
+		&&OPCODE_ASSIGN,                                \
+		&&OPCODE_ASSIGN_TRUE,                           \
+		&&OPCODE_ASSIGN_FALSE,                          \
+		&&OPCODE_CONSTRUCT,                             \
+		&&OPCODE_CONSTRUCT_ARRAY,                       \
+		&&OPCODE_CONSTRUCT_DICTIONARY,                  \
+		&&OPCODE_CALL,                                  \
+		&&OPCODE_CALL_RETURN,                           \
+		&&OPCODE_CALL_BUILT_IN,                         \
+		&&OPCODE_CALL_SELF,                             \
+		&&OPCODE_CALL_SELF_BASE,                        \
+		&&OPCODE_YIELD,                                 \
+		&&OPCODE_YIELD_SIGNAL,                          \
+		&&OPCODE_YIELD_RESUME,                          \
+		&&OPCODE_JUMP,                                  \
+		&&OPCODE_JUMP_IF,                               \
+		&&OPCODE_JUMP_IF_NOT,                           \
+		&&OPCODE_JUMP_TO_DEF_ARGUMENT,                  \
+		&&OPCODE_RETURN,                                \
+		&&OPCODE_ITERATE_BEGIN,                         \
+		&&OPCODE_ITERATE,                               \
+		&&OPCODE_ASSERT,                                \
+		&&OPCODE_BREAKPOINT,                            \
+		&&OPCODE_LINE,                                  \
+		&&OPCODE_END                                    \
+	};                                                  \
+	OPCODES_TABLE_CHECK
+
+#define OPCODE(m_op) \
+	m_op:
+#define OPCODE_ILLEGAL \
+	OPSILLEGAL:
+#define OPCODE_WHILE(m_test)
+#define OPCODE_SWITCH(m_test) DISPATCH_OPCODE;
+#define DISPATCH_OPCODE                                 \
+	{                                                   \
+		if (ip >= _code_size)                           \
+			OPCODE_OUT;                                 \
+		last_opcode = _code_ptr[ip];                    \
+		if ((unsigned int)last_opcode > OPCODE_END)     \
+			goto OPSILLEGAL;                            \
+		goto *switch_table_ops[last_opcode];            \
+	}
+#define OPCODE_BREAK goto OPSEXIT
+#define OPCODE_OUT goto OPSOUT
+#define OPCODES_END \
+	OPSEXIT:
+#define OPCODES_OUT \
+	OPSOUT:
+
+#else
+
+#define OPCODES_TABLE
+#define OPCODE(m_op) case m_op:
+#define OPCODE_ILLEGAL default:
+#define OPCODE_WHILE(m_test) while (m_test)
+#define OPCODE_SWITCH(m_test)   \
+	last_opcode = m_test;       \
+	switch (last_opcode)
+#define DISPATCH_OPCODE continue
+#define OPCODE_BREAK break
+#define OPCODE_OUT break
+#define OPCODES_END
+#define OPCODES_OUT
+
+#endif
+
+#define GD_ERR_BREAK(m_cond)                                                                                           \
+	{                                                                                                                  \
+		if (m_cond) {                                                                                                  \
+			_err_print_error(FUNCTION_STR, __FILE__, __LINE__, "Condition ' " _STR(m_cond) " ' is true. Breaking..:"); \
+			OPCODE_BREAK;                                                                                              \
+		} else                                                                                                         \
+			_err_error_exists = false;                                                                                 \
+	}
+
 Variant GDFunction::call(GDInstance *p_instance, const Variant **p_args, int p_argcount, Variant::CallError &r_err, CallState *p_state) {
 
+	OPCODES_TABLE;
+
 	if (!_code_ptr) {
 
 		return Variant();
@@ -266,25 +366,32 @@ Variant GDFunction::call(GDInstance *p_instance, const Variant **p_args, int p_a
 
 	String err_text;
 
+// Stack slots are most of the operands, so they are decoded in place and
+// only the other addressing modes go through _get_variant
+#define DECODE_ADDRESS(m_address)                                                                                                     \
+	(((unsigned int)((m_address) - (ADDR_TYPE_STACK << ADDR_BITS)) < (2 << ADDR_BITS) && ((m_address)&ADDR_MASK) < _stack_size) ? \
+					&stack[(m_address)&ADDR_MASK] :                                                                                        \
+					_get_variant((m_address), p_instance, _class, self, stack, err_text))
+
 #ifdef DEBUG_ENABLED
 
 	if (ScriptDebugger::get_singleton())
 		GDScriptLanguage::get_singleton()->enter_function(p_instance, this, stack, &ip, &line);
 
 #define CHECK_SPACE(m_space) \
-	ERR_BREAK((ip + m_space) > _code_size)
+	GD_ERR_BREAK((ip + m_space) > _code_size)
 
-#define GET_VARIANT_PTR(m_v, m_code_ofs)                                                       \
-	Variant *m_v;                                                                              \
-	m_v = _get_variant(_code_ptr[ip + m_code_ofs], p_instance, _class, self, stack, err_text); \
-	if (!m_v)                                                                                  \
-		break;
+#define GET_VARIANT_PTR(m_v, m_code_ofs)         \
+	Variant *m_v;                                \
+	m_v = DECODE_ADDRESS(_code_ptr[ip + m_code_ofs]); \
+	if (!m_v)                                    \
+		OPCODE_BREAK;
 
 #else
 #define CHECK_SPACE(m_space)
 #define GET_VARIANT_PTR(m_v, m_code_ofs) \
 	Variant *m_v;                        \
-	m_v = _get_variant(_code_ptr[ip + m_code_ofs], p_instance, _class, self, stack, err_text);
+	m_v = DECODE_ADDRESS(_code_ptr[ip + m_code_ofs]);
 
 #endif
 
@@ -301,19 +408,19 @@ Variant GDFunction::call(GDInstance *p_instance, const Variant **p_args, int p_a
 	}
 #endif
 	bool exit_ok = false;
+	int last_opcode = 0;
 
-	while (ip < _code_size) {
+	OPCODE_WHILE(ip < _code_size) {
 
-		int last_opcode = _code_ptr[ip];
-		switch (_code_ptr[ip]) {
+		OPCODE_SWITCH(_code_ptr[ip]) {
 
-			case OPCODE_OPERATOR: {
+			OPCODE(OPCODE_OPERATOR) {
 
 				CHECK_SPACE(5);
 
 				bool valid;
 				Variant::Operator op = (Variant::Operator)_code_ptr[ip + 1];
-				ERR_BREAK(op >= Variant::OP_MAX);
+				GD_ERR_BREAK(op >= Variant::OP_MAX);
 
 				GET_VARIANT_PTR(a, 2);
 				GET_VARIANT_PTR(b, 3);
@@ -337,7 +444,7 @@ Variant GDFunction::call(GDInstance *p_instance, const Variant **p_args, int p_a
 						err_text = "Invalid operands '" + Variant::get_type_name(a->get_type()) + "' and '" + Variant::get_type_name(b->get_type()) + "' in operator '" + Variant::get_operator_name(op) + "'.";
 					}
 #endif
-					break;
+					OPCODE_BREAK;
 				}
 #ifdef DEBUG_ENABLED
 				*dst = ret;
@@ -345,8 +452,8 @@ Variant GDFunction::call(GDInstance *p_instance, const Variant **p_args, int p_a
 
 				ip += 5;
 			}
-				continue;
-			case OPCODE_EXTENDS_TEST: {
+				DISPATCH_OPCODE;
+			OPCODE(OPCODE_EXTENDS_TEST) {
 
 				CHECK_SPACE(4);
 
@@ -359,12 +466,12 @@ Variant GDFunction::call(GDInstance *p_instance, const Variant **p_args, int p_a
 				if (a->get_type() != Variant::OBJECT || a->operator Object *() == NULL) {
 
 					err_text = "Left operand of 'extends' is not an instance of anything.";
-					break;
+					OPCODE_BREAK;
 				}
 				if (b->get_type() != Variant::OBJECT || b->operator Object *() == NULL) {
 
 					err_text = "Right operand of 'extends' is not a class.";
-					break;
+					OPCODE_BREAK;
 				}
 #endif
 
@@ -402,7 +509,7 @@ Variant GDFunction::call(GDInstance *p_instance, const Variant **p_args, int p_a
 					if (!nc) {
 
 						err_text = "Right operand of 'extends' is not a class (type: '" + obj_B->get_type() + "').";
-						break;
+						OPCODE_BREAK;
 					}
 
 					extends_ok = ObjectTypeDB::is_type(obj_A->get_type_name(), nc->get_name());
@@ -411,8 +518,8 @@ Variant GDFunction::call(GDInstance *p_instance, const Variant **p_args, int p_a
 				*dst = extends_ok;
 				ip += 4;
 			}
-				continue;
-			case OPCODE_SET: {
+				DISPATCH_OPCODE;
+			OPCODE(OPCODE_SET) {
 
 				CHECK_SPACE(3);
 
@@ -431,13 +538,13 @@ Variant GDFunction::call(GDInstance *p_instance, const Variant **p_args, int p_a
 						v = "of type '" + _get_var_type(index) + "'";
 					}
 					err_text = "Invalid set index " + v + " (on base: '" + _get_var_type(dst) + "').";
-					break;
+					OPCODE_BREAK;
 				}
 
 				ip += 4;
 			}
-				continue;
-			case OPCODE_GET: {
+				DISPATCH_OPCODE;
+			OPCODE(OPCODE_GET) {
 
 				CHECK_SPACE(3);
 
@@ -461,15 +568,15 @@ Variant GDFunction::call(GDInstance *p_instance, const Variant **p_args, int p_a
 						v = "of type '" + _get_var_type(index) + "'";
 					}
 					err_text = "Invalid get index " + v + " (on base: '" + _get_var_type(src) + "').";
-					break;
+					OPCODE_BREAK;
 				}
 #ifdef DEBUG_ENABLED
 				*dst = ret;
 #endif
 				ip += 4;
 			}
-				continue;
-			case OPCODE_SET_NAMED: {
+				DISPATCH_OPCODE;
+			OPCODE(OPCODE_SET_NAMED) {
 
 				CHECK_SPACE(3);
 
@@ -478,7 +585,7 @@ Variant GDFunction::call(GDInstance *p_instance, const Variant **p_args, int p_a
 
 				int indexname = _code_ptr[ip + 2];
 
-				ERR_BREAK(indexname < 0 || indexname >= _global_names_count);
+				GD_ERR_BREAK(indexname < 0 || indexname >= _global_names_count);
 				const StringName *index = &_global_names_ptr[indexname];
 
 				bool valid;
@@ -487,13 +594,13 @@ Variant GDFunction::call(GDInstance *p_instance, const Variant **p_args, int p_a
 				if (!valid) {
 					String err_type;
 					err_text = "Invalid set index '" + String(*index) + "' (on base: '" + _get_var_type(dst) + "').";
-					break;
+					OPCODE_BREAK;
 				}
 
 				ip += 4;
 			}
-				continue;
-			case OPCODE_GET_NAMED: {
+				DISPATCH_OPCODE;
+			OPCODE(OPCODE_GET_NAMED) {
 
 				CHECK_SPACE(3);
 
@@ -502,7 +609,7 @@ Variant GDFunction::call(GDInstance *p_instance, const Variant **p_args, int p_a
 
 				int indexname = _code_ptr[ip + 2];
 
-				ERR_BREAK(indexname < 0 || indexname >= _global_names_count);
+				GD_ERR_BREAK(indexname < 0 || indexname >= _global_names_count);
 				const StringName *index = &_global_names_ptr[indexname];
 
 				bool valid;
@@ -520,15 +627,15 @@ Variant GDFunction::call(GDInstance *p_instance, const Variant **p_args, int p_a
 					} else {
 						err_text = "Invalid get index '" + index->operator String() + "' (on base: '" + _get_var_type(src) + "').";
 					}
-					break;
+					OPCODE_BREAK;
 				}
 #ifdef DEBUG_ENABLED
 				*dst = ret;
 #endif
 				ip += 4;
 			}
-				continue;
-			case OPCODE_ASSIGN: {
+				DISPATCH_OPCODE;
+			OPCODE(OPCODE_ASSIGN) {
 
 				CHECK_SPACE(3);
 				GET_VARIANT_PTR(dst, 1);
@@ -538,8 +645,8 @@ Variant GDFunction::call(GDInstance *p_instance, const Variant **p_args, int p_a
 
 				ip += 3;
 			}
-				continue;
-			case OPCODE_ASSIGN_TRUE: {
+				DISPATCH_OPCODE;
+			OPCODE(OPCODE_ASSIGN_TRUE) {
 
 				CHECK_SPACE(2);
 				GET_VARIANT_PTR(dst, 1);
@@ -548,8 +655,8 @@ Variant GDFunction::call(GDInstance *p_instance, const Variant **p_args, int p_a
 
 				ip += 2;
 			}
-				continue;
-			case OPCODE_ASSIGN_FALSE: {
+				DISPATCH_OPCODE;
+			OPCODE(OPCODE_ASSIGN_FALSE) {
 
 				CHECK_SPACE(2);
 				GET_VARIANT_PTR(dst, 1);
@@ -558,8 +665,8 @@ Variant GDFunction::call(GDInstance *p_instance, const Variant **p_args, int p_a
 
 				ip += 2;
 			}
-				continue;
-			case OPCODE_CONSTRUCT: {
+				DISPATCH_OPCODE;
+			OPCODE(OPCODE_CONSTRUCT) {
 
 				CHECK_SPACE(2);
 				Variant::Type t = Variant::Type(_code_ptr[ip + 1]);
@@ -578,14 +685,14 @@ Variant GDFunction::call(GDInstance *p_instance, const Variant **p_args, int p_a
 				if (err.error != Variant::CallError::CALL_OK) {
 
 					err_text = _get_call_error(err, "'" + Variant::get_type_name(t) + "' constructor", (const Variant **)argptrs);
-					break;
+					OPCODE_BREAK;
 				}
 
 				ip += 4 + argc;
 				//construct a basic type
 			}
-				continue;
-			case OPCODE_CONSTRUCT_ARRAY: {
+				DISPATCH_OPCODE;
+			OPCODE(OPCODE_CONSTRUCT_ARRAY) {
 
 				CHECK_SPACE(1);
 				int argc = _code_ptr[ip + 1];
@@ -604,8 +711,8 @@ Variant GDFunction::call(GDInstance *p_instance, const Variant **p_args, int p_a
 
 				ip += 3 + argc;
 			}
-				continue;
-			case OPCODE_CONSTRUCT_DICTIONARY: {
+				DISPATCH_OPCODE;
+			OPCODE(OPCODE_CONSTRUCT_DICTIONARY) {
 
 				CHECK_SPACE(1);
 				int argc = _code_ptr[ip + 1];
@@ -626,9 +733,9 @@ Variant GDFunction::call(GDInstance *p_instance, const Variant **p_args, int p_a
 
 				ip += 3 + argc * 2;
 			}
-				continue;
-			case OPCODE_CALL_RETURN:
-			case OPCODE_CALL: {
+				DISPATCH_OPCODE;
+			OPCODE(OPCODE_CALL_RETURN)
+			OPCODE(OPCODE_CALL) {
 
 				CHECK_SPACE(4);
 				bool call_ret = _code_ptr[ip] == OPCODE_CALL_RETURN;
@@ -637,10 +744,10 @@ Variant GDFunction::call(GDInstance *p_instance, const Variant **p_args, int p_a
 				GET_VARIANT_PTR(base, 2);
 				int nameg = _code_ptr[ip + 3];
 
-				ERR_BREAK(nameg < 0 || nameg >= _global_names_count);
+				GD_ERR_BREAK(nameg < 0 || nameg >= _global_names_count);
 				const StringName *methodname = &_global_names_ptr[nameg];
 
-				ERR_BREAK(argc < 0);
+				GD_ERR_BREAK(argc < 0);
 				ip += 4;
 				CHECK_SPACE(argc + 1);
 				Variant **argptrs = call_args;
@@ -692,29 +799,29 @@ Variant GDFunction::call(GDInstance *p_instance, const Variant **p_args, int p_a
 
 							if (base->is_ref()) {
 								err_text = "Attempted to free a reference.";
-								break;
+								OPCODE_BREAK;
 							} else if (base->get_type() == Variant::OBJECT) {
 
 								err_text = "Attempted to free a locked object (calling or emitting).";
-								break;
+								OPCODE_BREAK;
 							}
 						}
 					}
 					err_text = _get_call_error(err, "function '" + methodstr + "' in base '" + basestr + "'", (const Variant **)argptrs);
-					break;
+					OPCODE_BREAK;
 				}
 
 				//_call_func(NULL,base,*methodname,ip,argc,p_instance,stack);
 				ip += argc + 1;
 			}
-				continue;
-			case OPCODE_CALL_BUILT_IN: {
+				DISPATCH_OPCODE;
+			OPCODE(OPCODE_CALL_BUILT_IN) {
 
 				CHECK_SPACE(4);
 
 				GDFunctions::Function func = GDFunctions::Function(_code_ptr[ip + 1]);
 				int argc = _code_ptr[ip + 2];
-				ERR_BREAK(argc < 0);
+				GD_ERR_BREAK(argc < 0);
 
 				ip += 3;
 				CHECK_SPACE(argc + 1);
@@ -740,15 +847,16 @@ Variant GDFunction::call(GDInstance *p_instance, const Variant **p_args, int p_a
 					} else {
 						err_text = _get_call_error(err, "built-in function '" + methodstr + "'", (const Variant **)argptrs);
 					}
-					break;
+					OPCODE_BREAK;
 				}
 				ip += argc + 1;
 			}
-				continue;
-			case OPCODE_CALL_SELF: {
+				DISPATCH_OPCODE;
+			OPCODE(OPCODE_CALL_SELF) {
 
-			} break;
-			case OPCODE_CALL_SELF_BASE: {
+			}
+				OPCODE_BREAK;
+			OPCODE(OPCODE_CALL_SELF_BASE) {
 
 				CHECK_SPACE(2);
 				int self_fun = _code_ptr[ip + 1];
@@ -757,7 +865,7 @@ Variant GDFunction::call(GDInstance *p_instance, const Variant **p_args, int p_a
 				if (self_fun < 0 || self_fun >= _global_names_count) {
 
 					err_text = "compiler bug, function name not found";
-					break;
+					OPCODE_BREAK;
 				}
 #endif
 				const StringName *methodname = &_global_names_ptr[self_fun];
@@ -817,14 +925,14 @@ Variant GDFunction::call(GDInstance *p_instance, const Variant **p_args, int p_a
 					String methodstr = *methodname;
 					err_text = _get_call_error(err, "function '" + methodstr + "'", (const Variant **)argptrs);
 
-					break;
+					OPCODE_BREAK;
 				}
 
 				ip += 4 + argc;
 			}
-				continue;
-			case OPCODE_YIELD:
-			case OPCODE_YIELD_SIGNAL: {
+				DISPATCH_OPCODE;
+			OPCODE(OPCODE_YIELD)
+			OPCODE(OPCODE_YIELD_SIGNAL) {
 
 				int ipofs = 1;
 				if (_code_ptr[ip] == OPCODE_YIELD_SIGNAL) {
@@ -864,11 +972,11 @@ Variant GDFunction::call(GDInstance *p_instance, const Variant **p_args, int p_a
 
 					if (argobj->get_type() != Variant::OBJECT) {
 						err_text = "First argument of yield() not of type object.";
-						break;
+						OPCODE_BREAK;
 					}
 					if (argname->get_type() != Variant::STRING) {
 						err_text = "Second argument of yield() not a string (for signal name).";
-						break;
+						OPCODE_BREAK;
 					}
 					Object *obj = argobj->operator Object *();
 					String signal = argname->operator String();
@@ -876,53 +984,54 @@ Variant GDFunction::call(GDInstance *p_instance, const Variant **p_args, int p_a
 
 					if (!obj) {
 						err_text = "First argument of yield() is null.";
-						break;
+						OPCODE_BREAK;
 					}
 					if (ScriptDebugger::get_singleton()) {
 						if (!ObjectDB::instance_validate(obj)) {
 							err_text = "First argument of yield() is a previously freed instance.";
-							break;
+							OPCODE_BREAK;
 						}
 					}
 					if (signal.length() == 0) {
 
 						err_text = "Second argument of yield() is an empty string (for signal name).";
-						break;
+						OPCODE_BREAK;
 					}
 
 #endif
 					Error err = obj->connect(signal, gdfs.ptr(), "_signal_callback", varray(gdfs), Object::CONNECT_ONESHOT);
 					if (err != OK) {
 						err_text = "Error connecting to signal: " + signal + " during yield().";
-						break;
+						OPCODE_BREAK;
 					}
 				}
 
 				exit_ok = true;
 
-			} break;
-			case OPCODE_YIELD_RESUME: {
+			}
+				OPCODE_BREAK;
+			OPCODE(OPCODE_YIELD_RESUME) {
 
 				CHECK_SPACE(2);
 				if (!p_state) {
 					err_text = ("Invalid Resume (bug?)");
-					break;
+					OPCODE_BREAK;
 				}
 				GET_VARIANT_PTR(result, 1);
 				*result = p_state->result;
 				ip += 2;
 			}
-				continue;
-			case OPCODE_JUMP: {
+				DISPATCH_OPCODE;
+			OPCODE(OPCODE_JUMP) {
 
 				CHECK_SPACE(2);
 				int to = _code_ptr[ip + 1];
 
-				ERR_BREAK(to < 0 || to > _code_size);
+				GD_ERR_BREAK(to < 0 || to > _code_size);
 				ip = to;
 			}
-				continue;
-			case OPCODE_JUMP_IF: {
+				DISPATCH_OPCODE;
+			OPCODE(OPCODE_JUMP_IF) {
 
 				CHECK_SPACE(3);
 
@@ -934,19 +1043,19 @@ Variant GDFunction::call(GDInstance *p_instance, const Variant **p_args, int p_a
 				if (!valid) {
 
 					err_text = "cannot evaluate conditional expression of type: " + Variant::get_type_name(test->get_type());
-					break;
+					OPCODE_BREAK;
 				}
 #endif
 				if (result) {
 					int to = _code_ptr[ip + 2];
-					ERR_BREAK(to < 0 || to > _code_size);
+					GD_ERR_BREAK(to < 0 || to > _code_size);
 					ip = to;
-					continue;
+					DISPATCH_OPCODE;
 				}
 				ip += 3;
 			}
-				continue;
-			case OPCODE_JUMP_IF_NOT: {
+				DISPATCH_OPCODE;
+			OPCODE(OPCODE_JUMP_IF_NOT) {
 
 				CHECK_SPACE(3);
 
@@ -958,33 +1067,34 @@ Variant GDFunction::call(GDInstance *p_instance, const Variant **p_args, int p_a
 				if (!valid) {
 
 					err_text = "cannot evaluate conditional expression of type: " + Variant::get_type_name(test->get_type());
-					break;
+					OPCODE_BREAK;
 				}
 #endif
 				if (!result) {
 					int to = _code_ptr[ip + 2];
-					ERR_BREAK(to < 0 || to > _code_size);
+					GD_ERR_BREAK(to < 0 || to > _code_size);
 					ip = to;
-					continue;
+					DISPATCH_OPCODE;
 				}
 				ip += 3;
 			}
-				continue;
-			case OPCODE_JUMP_TO_DEF_ARGUMENT: {
+				DISPATCH_OPCODE;
+			OPCODE(OPCODE_JUMP_TO_DEF_ARGUMENT) {
 
 				CHECK_SPACE(2);
 				ip = _default_arg_ptr[defarg];
 			}
-				continue;
-			case OPCODE_RETURN: {
+				DISPATCH_OPCODE;
+			OPCODE(OPCODE_RETURN) {
 
 				CHECK_SPACE(2);
 				GET_VARIANT_PTR(r, 1);
 				retvalue = *r;
 				exit_ok = true;
 
-			} break;
-			case OPCODE_ITERATE_BEGIN: {
+			}
+				OPCODE_BREAK;
+			OPCODE(OPCODE_ITERATE_BEGIN) {
 
 				CHECK_SPACE(8); //space for this an regular iterate
 
@@ -995,25 +1105,25 @@ Variant GDFunction::call(GDInstance *p_instance, const Variant **p_args, int p_a
 				if (!container->iter_init(*counter, valid)) {
 					if (!valid) {
 						err_text = "Unable to iterate on object of type  " + Variant::get_type_name(container->get_type()) + "'.";
-						break;
+						OPCODE_BREAK;
 					}
 					int jumpto = _code_ptr[ip + 3];
-					ERR_BREAK(jumpto < 0 || jumpto > _code_size);
+					GD_ERR_BREAK(jumpto < 0 || jumpto > _code_size);
 					ip = jumpto;
-					continue;
+					DISPATCH_OPCODE;
 				}
 				GET_VARIANT_PTR(iterator, 4);
 
 				*iterator = container->iter_get(*counter, valid);
 				if (!valid) {
 					err_text = "Unable to obtain iterator object of type  " + Variant::get_type_name(container->get_type()) + "'.";
-					break;
+					OPCODE_BREAK;
 				}
 
 				ip += 5; //skip regular iterate which is always next
 			}
-				continue;
-			case OPCODE_ITERATE: {
+				DISPATCH_OPCODE;
+			OPCODE(OPCODE_ITERATE) {
 
 				CHECK_SPACE(4);
 
@@ -1024,25 +1134,25 @@ Variant GDFunction::call(GDInstance *p_instance, const Variant **p_args, int p_a
 				if (!container->iter_next(*counter, valid)) {
 					if (!valid) {
 						err_text = "Unable to iterate on object of type  " + Variant::get_type_name(container->get_type()) + "' (type changed since first iteration?).";
-						break;
+						OPCODE_BREAK;
 					}
 					int jumpto = _code_ptr[ip + 3];
-					ERR_BREAK(jumpto < 0 || jumpto > _code_size);
+					GD_ERR_BREAK(jumpto < 0 || jumpto > _code_size);
 					ip = jumpto;
-					continue;
+					DISPATCH_OPCODE;
 				}
 				GET_VARIANT_PTR(iterator, 4);
 
 				*iterator = container->iter_get(*counter, valid);
 				if (!valid) {
 					err_text = "Unable to obtain iterator object of type  " + Variant::get_type_name(container->get_type()) + "' (but was obtained on first iteration?).";
-					break;
+					OPCODE_BREAK;
 				}
 
 				ip += 5; //loop again
 			}
-				continue;
-			case OPCODE_ASSERT: {
+				DISPATCH_OPCODE;
+			OPCODE(OPCODE_ASSERT) {
 				CHECK_SPACE(2);
 				GET_VARIANT_PTR(test, 1);
 
@@ -1053,21 +1163,21 @@ Variant GDFunction::call(GDInstance *p_instance, const Variant **p_args, int p_a
 				if (!valid) {
 
 					err_text = "cannot evaluate conditional expression of type: " + Variant::get_type_name(test->get_type());
-					break;
+					OPCODE_BREAK;
 				}
 
 				if (!result) {
 
 					err_text = "Assertion failed.";
-					break;
+					OPCODE_BREAK;
 				}
 
 #endif
 
 				ip += 2;
 			}
-				continue;
-			case OPCODE_BREAKPOINT: {
+				DISPATCH_OPCODE;
+			OPCODE(OPCODE_BREAKPOINT) {
 #ifdef DEBUG_ENABLED
 				if (ScriptDebugger::get_singleton()) {
 					GDScriptLanguage::get_singleton()->debug_break("Breakpoint Statement", true);
@@ -1075,8 +1185,8 @@ Variant GDFunction::call(GDInstance *p_instance, const Variant **p_args, int p_a
 #endif
 				ip += 1;
 			}
-				continue;
-			case OPCODE_LINE: {
+				DISPATCH_OPCODE;
+			OPCODE(OPCODE_LINE) {
 				CHECK_SPACE(2);
 
 				line = _code_ptr[ip + 1];
@@ -1104,21 +1214,23 @@ Variant GDFunction::call(GDInstance *p_instance, const Variant **p_args, int p_a
 					ScriptDebugger::get_singleton()->line_poll();
 				}
 			}
-				continue;
-			case OPCODE_END: {
+				DISPATCH_OPCODE;
+			OPCODE(OPCODE_END) {
 
 				exit_ok = true;
-				break;
-
-			} break;
-			default: {
+			}
+				OPCODE_BREAK;
+			OPCODE_ILLEGAL {
 
 				err_text = "Illegal opcode " + itos(_code_ptr[ip]) + " at address " + itos(ip);
-			} break;
+			}
+				OPCODE_BREAK;
 		}
 
+		OPCODES_END;
+
 		if (exit_ok)
-			break;
+			OPCODE_OUT;
 		//error
 		// function, file, line, error, explanation
 		String err_file;
@@ -1142,9 +1254,11 @@ Variant GDFunction::call(GDInstance *p_instance, const Variant **p_args, int p_a
 			_err_print_error(err_func.utf8().get_data(), err_file.utf8().get_data(), err_line, err_text.utf8().get_data(), ERR_HANDLER_SCRIPT);
 		}
 
-		break;
+		OPCODE_OUT;
 	}
 
+	OPCODES_OUT;
+
 #ifdef DEBUG_ENABLED
 	if (GDScriptLanguage::get_singleton()->profiling) {
 		uint64_t time_taken = OS::get_singleton()->get_ticks_usec() - function_start_time;
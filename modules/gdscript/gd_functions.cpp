@@ -36,6 +36,7 @@
 #include "object_type_db.h"
 #include "os/os.h"
 #include "reference.h"
+#include "string_builder.h"
 #include "variant_parser.h"
 
 const char *GDFunctions::get_func_name(Function p_func) {
@@ -535,18 +536,18 @@ void GDFunctions::call(Function p_func, const Variant **p_args, int p_arg_count,
 		} break;
 		case TEXT_STR: {
 
-			String str;
-			for (int i = 0; i < p_arg_count; i++) {
+			if (p_arg_count == 1) {
+				r_ret = p_args[0]->operator String();
+				break;
+			}
 
-				String os = p_args[i]->operator String();
+			StringBuilder str;
+			for (int i = 0; i < p_arg_count; i++) {
 
-				if (i == 0)
-					str = os;
-				else
-					str += os;
+				str += p_args[i]->operator String();
 			}
 
-			r_ret = str;
+			r_ret = str.as_string();
 
 		} break;
 		case TEXT_PRINT: {
@@ -28,9 +28,63 @@
 /*************************************************************************/
 #include "export.h"
 #include "platform/3ds/logo.gen.h"
+#include "drivers/3ds/citro3d/texture_ctex.h"
 #include "editor/editor_import_export.h"
+#include "io/image_loader.h"
+#include "io/resource_loader.h"
+#include "scene/io/resource_format_image.h"
 #include "scene/resources/texture.h"
 
+static const char *_3ds_platform_name = "Nintendo 3DS";
+
+// Stores textures pre-tiled in their GPU format (.ctex), so the device
+// only copies them into place when loading
+class EditorTextureExportPlugin3DS : public EditorExportPlugin {
+
+	OBJ_TYPE(EditorTextureExportPlugin3DS, EditorExportPlugin);
+
+public:
+	virtual Vector<uint8_t> custom_export(String &p_path, const Ref<EditorExportPlatform> &p_platform) {
+
+		if (p_platform.is_null() || p_platform->get_name() != _3ds_platform_name)
+			return Vector<uint8_t>();
+
+		Image image;
+		uint32_t flags = 0;
+		String ext = p_path.extension().to_lower();
+
+		if (ext == "tex") {
+
+			Ref<ImageTexture> texture = ResourceLoader::load(p_path);
+			if (texture.is_null())
+				return Vector<uint8_t>(); // atlas or large texture, keep as is
+			image = texture->get_data();
+			flags = texture->get_flags();
+
+		} else if (ImageLoader::recognize(ext)) {
+
+			if (ImageLoader::load_image(p_path, &image) != OK)
+				return Vector<uint8_t>();
+			flags = ResourceFormatLoaderImage::load_image_flags(p_path);
+
+		} else {
+			return Vector<uint8_t>();
+		}
+
+		if (image.empty() || flags & (VS::TEXTURE_FLAG_CUBEMAP | VS::TEXTURE_FLAG_VIDEO_SURFACE))
+			return Vector<uint8_t>();
+
+		Vector<uint8_t> data;
+		if (ctex_encode(image, flags, pica_texture_get_project_options(), data) != OK)
+			return Vector<uint8_t>();
+
+		p_path = p_path.basename() + ".ctex";
+		return data;
+	}
+
+	EditorTextureExportPlugin3DS() {}
+};
+
 void register_3ds_exporter() {
 
 	Image img(_3ds_logo);
@@ -42,9 +96,11 @@ void register_3ds_exporter() {
 		exporter->set_binary_extension("elf");
 		exporter->set_release_binary32("3ds_release");
 		exporter->set_debug_binary32("3ds_debug");
-		exporter->set_name("Nintendo 3DS");
+		exporter->set_name(_3ds_platform_name);
 		exporter->set_logo(logo);
 		EditorImportExport::get_singleton()->add_export_platform(exporter);
 	}
 
+	EditorImportExport::get_singleton()->add_export_plugin(Ref<EditorTextureExportPlugin3DS>(memnew(EditorTextureExportPlugin3DS)));
+
 }
@@ -29,18 +29,20 @@
 #include "servers/visual/visual_server_raster.h"
 // #include "servers/visual/rasterizer_dummy.h"
 #include "drivers/3ds/citro3d/rasterizer_citro3d.h"
+#include "drivers/3ds/citro3d/resource_loader_ctex.h"
 #include "os_3ds.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include <sys/time.h>
+#include "globals.h"
 #include "print_string.h"
 #include "servers/physics/physics_server_sw.h"
 #include "errno.h"
 
-#include "drivers/unix/memory_pool_static_malloc.h"
-#include "os/memory_pool_dynamic_static.h"
+#include "os/memory_pool_static_slab.h"
+#include "os/memory_pool_dynamic_compact.h"
 // #include "thread_posix.h"
 // #include "semaphore_posix.h"
 // #include "mutex_posix.h"
@@ -69,8 +71,16 @@ static aptHookCookie apt_hook_cookie;
 
 static void apt_hook_callback(APT_HookType hook, void* param)
 {
-	if (hook == APTHOOK_ONRESTORE || hook == APTHOOK_ONWAKEUP) {
-		
+	OS_3DS *os = reinterpret_cast<OS_3DS*>(param);
+	
+	switch (hook) {
+		// Home menu, other applets may want the memory
+		case APTHOOK_ONSUSPEND: os->suspend(true); break;
+		// Lid closed, nothing else runs meanwhile
+		case APTHOOK_ONSLEEP: os->suspend(false); break;
+		case APTHOOK_ONRESTORE:
+		case APTHOOK_ONWAKEUP: os->resume(); break;
+		default: break;
 	}
 }
 
@@ -88,6 +98,11 @@ OS_3DS::OS_3DS()
 	_render_thread_mode=RENDER_THREAD_UNSAFE;
 	AudioDriverManagerSW::add_driver(&audio_driver);
 	use_vsync = true;
+	suspended = false;
+	motion_sensors = false;
+	gyro_raw_to_dps = 1;
+	main_loop = NULL;
+	rasterizer = NULL;
 	last_id = 1;
 }
 
@@ -96,6 +111,32 @@ OS_3DS::~OS_3DS()
 	gfxExit();
 }
 
+void OS_3DS::suspend(bool p_release_vram)
+{
+	// Hooks run from aptMainLoop(), between two iterations
+	if (suspended)
+		return;
+	suspended = true;
+	
+	if (main_loop)
+		main_loop->notification(MainLoop::NOTIFICATION_WM_FOCUS_OUT);
+	audio_driver.set_pause(true);
+	if (rasterizer)
+		rasterizer->suspend(p_release_vram);
+}
+
+void OS_3DS::resume()
+{
+	if (!suspended)
+		return;
+	suspended = false;
+	
+	// Released textures come back lazily as they get drawn
+	audio_driver.set_pause(false);
+	if (main_loop)
+		main_loop->notification(MainLoop::NOTIFICATION_WM_FOCUS_IN);
+}
+
 void OS_3DS::run()
 {
 	if (!main_loop)
@@ -118,8 +159,13 @@ void OS_3DS::run()
 	main_loop->finish();
 }
 
-static MemoryPoolStaticMalloc *mempool_static=NULL;
-static MemoryPoolDynamicStatic *mempool_dynamic=NULL;
+// Small objects live in their own arena so churn doesn't fragment the newlib heap
+#define SLAB_ARENA_SIZE (8 * 1024 * 1024)
+// Pool arrays and image data live in a movable arena, compacted on scene change
+#define DYNAMIC_ARENA_SIZE (16 * 1024 * 1024)
+
+static MemoryPoolStaticSlab *mempool_static=NULL;
+static MemoryPoolDynamicCompact *mempool_dynamic=NULL;
 
 void OS_3DS::initialize_core()
 {
@@ -127,8 +173,8 @@ void OS_3DS::initialize_core()
 	Semaphore3ds::make_default();
 	Mutex3ds::make_default();
 	
-	mempool_static = new MemoryPoolStaticMalloc;
-	mempool_dynamic = memnew( MemoryPoolDynamicStatic );
+	mempool_static = new MemoryPoolStaticSlab(SLAB_ARENA_SIZE);
+	mempool_dynamic = memnew( MemoryPoolDynamicCompact(DYNAMIC_ARENA_SIZE) );
 	FileAccess::make_default<FileAccessUnix>(FileAccess::ACCESS_RESOURCES);
 	FileAccess::make_default<FileAccessUnix>(FileAccess::ACCESS_USERDATA);
 	FileAccess::make_default<FileAccessUnix>(FileAccess::ACCESS_FILESYSTEM);
@@ -185,6 +231,19 @@ void OS_3DS::initialize(const VideoMode& p_desired,int p_video_driver,int p_audi
 	physics_2d_server->init();
 
 	input = memnew( InputDefault );
+	input_sink.input = input;
+	input_batcher.set_sink(&input_sink);
+	input_batcher.set_axis_deadzone(GLOBAL_DEF("input/3ds/axis_deadzone", 0.1));
+	
+	motion_sensors = GLOBAL_DEF("input/3ds/motion_sensors", true);
+	if (motion_sensors) {
+		HIDUSER_EnableAccelerometer();
+		HIDUSER_EnableGyroscope();
+		HIDUSER_GetGyroscopeRawToDpsCoefficient(&gyro_raw_to_dps);
+	}
+	
+	resource_loader_ctex = memnew( ResourceFormatLoaderCTex );
+	ResourceLoader::add_resource_format_loader(resource_loader_ctex);
 }
 
 void OS_3DS::delete_main_loop()
@@ -211,7 +270,13 @@ void OS_3DS::finalize()
 	spatial_sound_2d_server->finish();
 	memdelete(spatial_sound_2d_server);
 
+	if (motion_sensors) {
+		HIDUSER_DisableAccelerometer();
+		HIDUSER_DisableGyroscope();
+	}
+	input_batcher.set_sink(NULL);
 	memdelete(input);
+	memdelete(resource_loader_ctex);
 	
 	memdelete(sample_manager);
 
@@ -358,13 +423,24 @@ void OS_3DS::swap_buffers()
 {
  	//gfxFlushBuffers();
 	gfxSwapBuffersGpu();
-	if (use_vsync)
+	// With frames pipelined the rasterizer waits for vblank when the next
+	// frame begins, leaving the CPU free to work on it until then
+	if (use_vsync && (!rasterizer || rasterizer->get_max_frames_in_flight() == 1))
 		gspWaitForVBlank();
 }
 
 int OS_3DS::get_processor_count() const
 {
-	return 1;
+	// The application core, the system core under the CPU time limit set
+	// at startup, and the third core on the New 3DS. The fourth is reserved.
+	bool new_3ds = false;
+	APT_CheckNew3DS(&new_3ds);
+	return new_3ds ? 3 : 2;
+}
+
+void OS_3DS::yield()
+{
+	svcSleepThread(0);
 }
 
 static u32 buttons[16] = {
@@ -386,18 +462,81 @@ static u32 buttons[16] = {
 	KEY_DRIGHT,
 };
 
+// Raw ranges, the pads rarely go all the way so these are a bit under the limit
+#define CIRCLE_PAD_MAX 150.0f
+#define CSTICK_MAX 146.0f
+// The accelerometer reports about 512 per G
+#define ACCEL_TO_MS2 (9.80665f / 512.0f)
+
+uint32_t OS_3DS::InputSink::sink_joy_axis(uint32_t p_last_id, int p_axis, float p_value)
+{
+	InputDefault::JoyAxis value;
+	value.min = -1;
+	value.value = p_value;
+	return input->joy_axis(p_last_id, 0, p_axis, value);
+}
+
+void OS_3DS::InputSink::sink_input_event(InputEvent &p_event)
+{
+	if (p_event.type == InputEvent::MOUSE_MOTION) {
+		input->set_mouse_pos(Point2(p_event.mouse_motion.x, p_event.mouse_motion.y));
+		Point2 speed = input->get_mouse_speed();
+		p_event.mouse_motion.speed_x = speed.x;
+		p_event.mouse_motion.speed_y = speed.y;
+	} else if (p_event.type == InputEvent::MOUSE_BUTTON) {
+		input->set_mouse_pos(Point2(p_event.mouse_button.x, p_event.mouse_button.y));
+	}
+	input->parse_input_event(p_event);
+}
+
+void OS_3DS::InputSink::sink_sensors(const Vector3 &p_accelerometer, const Vector3 &p_gyroscope)
+{
+	input->set_accelerometer(p_accelerometer);
+	input->set_gyroscope(p_gyroscope);
+}
+
 void OS_3DS::processInput()
 {
 	hidScanInput();
 	u32 kDown = hidKeysDown();
 	u32 kUp = hidKeysUp();
-	last_id++;
 	
 	for (int i = 0; i < 16; ++i)
 	{
 		if (buttons[i] & kDown)
-			last_id = input->joy_button(last_id, 0, i, true);
+			input_batcher.joy_button(i, true);
 		else if (buttons[i] & kUp)
-			last_id = input->joy_button(last_id, 0, i, false);
+			input_batcher.joy_button(i, false);
+	}
+	
+	// Bottom screen pixels
+	if (hidKeysHeld() & KEY_TOUCH) {
+		touchPosition touch;
+		hidTouchRead(&touch);
+		input_batcher.touch_press(Point2(touch.px, touch.py));
+	} else if (input_batcher.is_touching()) {
+		input_batcher.touch_release();
 	}
+	
+	// Up is positive on the pads, down is positive for joysticks
+	circlePosition pad;
+	hidCircleRead(&pad);
+	input_batcher.joy_axis(JOY_ANALOG_0_X, pad.dx / CIRCLE_PAD_MAX);
+	input_batcher.joy_axis(JOY_ANALOG_0_Y, -pad.dy / CIRCLE_PAD_MAX);
+	
+	// Always centered on the original 3DS
+	hidCstickRead(&pad);
+	input_batcher.joy_axis(JOY_ANALOG_1_X, pad.dx / CSTICK_MAX);
+	input_batcher.joy_axis(JOY_ANALOG_1_Y, -pad.dy / CSTICK_MAX);
+	
+	if (motion_sensors) {
+		accelVector accel;
+		angularRate rate;
+		hidAccelRead(&accel);
+		hidGyroRead(&rate);
+		float gyro_to_rad = Math_PI / 180.0f / gyro_raw_to_dps;
+		input_batcher.set_sensors(Vector3(accel.x, accel.y, accel.z) * ACCEL_TO_MS2, Vector3(rate.x, rate.y, rate.z) * gyro_to_rad);
+	}
+	
+	last_id = input_batcher.flush(last_id);
 }
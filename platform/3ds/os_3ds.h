@@ -32,6 +32,7 @@
 
 #include "os/os.h"
 #include "os/input.h"
+#include "io/resource_loader.h"
 #include "servers/visual_server.h"
 #include "servers/visual/visual_server_wrap_mt.h"
 #include "servers/visual/rasterizer.h"
@@ -45,6 +46,7 @@
 #include "servers/physics_2d/physics_2d_server_wrap_mt.h"
 #include "main/input_default.h"
 #include "drivers/3ds/audio_driver_3ds.h"
+#include "drivers/3ds/input_batcher.h"
 
 /**
 	@author Thomas Edvalson <machin3@gmail.com>
@@ -56,6 +58,21 @@ class OS_3DS : public OS {
 	Rasterizer *rasterizer;
 	VisualServer *visual_server;
 	InputDefault *input;
+	ResourceFormatLoader *resource_loader_ctex;
+
+	struct InputSink : public InputBatcher::Sink {
+		InputDefault *input;
+		virtual uint32_t sink_joy_button(uint32_t p_last_id, int p_button, bool p_pressed) { return input->joy_button(p_last_id, 0, p_button, p_pressed); }
+		virtual uint32_t sink_joy_axis(uint32_t p_last_id, int p_axis, float p_value);
+		virtual void sink_input_event(InputEvent &p_event);
+		virtual void sink_sensors(const Vector3 &p_accelerometer, const Vector3 &p_gyroscope);
+	};
+
+	// Read once per iteration in processInput() and sent as one batch of events
+	InputBatcher input_batcher;
+	InputSink input_sink;
+	bool motion_sensors;
+	float gyro_raw_to_dps;
 	
 	PhysicsServer *physics_server;
 	Physics2DServer *physics_2d_server;
@@ -71,6 +88,7 @@ class OS_3DS : public OS {
 	VideoMode video_mode;
 	
 	bool use_vsync;
+	bool suspended;
 	
 	uint64_t ticks_start;
 	int last_id;
@@ -125,11 +143,11 @@ public:
 	virtual void set_window_title(const String& p_title) {};
 
 	virtual void set_video_mode(const VideoMode& p_video_mode,int p_screen=0) {}
-	virtual VideoMode get_video_mode(int p_screen=0) const { return video_mode; }
+	virtual VideoMode get_video_mode(int p_screen=0) const { return p_screen == 1 ? VideoMode(320, 240, true, false, false) : video_mode; }
 	virtual void get_fullscreen_mode_list(List<VideoMode> *p_list,int p_screen=0) const {}
 
 
-// 	virtual int get_screen_count() const{ return 1; }
+	virtual int get_screen_count() const { return 2; } // bottom screen is 1
 // 	virtual int get_current_screen() const { return 0; }
 // 	virtual void set_current_screen(int p_screen) { }
 // 	virtual Point2 get_screen_position(int p_screen=0) const { return Point2(); }
@@ -171,7 +189,7 @@ public:
 
 // 	String get_custom_level() const { return _custom_level; }
 
-// 	virtual void yield();
+	virtual void yield();
 
 
 	virtual Date get_date(bool local=false) const;
@@ -281,13 +299,17 @@ public:
 // 	virtual void set_context(int p_context);
 
 	virtual void set_use_vsync(bool p_enable) { use_vsync = p_enable; }
-	virtual bool is_vsnc_enabled() const { return use_vsync; }
+	virtual bool is_vsync_enabled() const { return use_vsync; }
 
 // 	Dictionary get_engine_version() const;
 
 	void run();
 	void processInput();
 
+	// APT events, suspend releases reloadable textures when p_release_vram is set
+	void suspend(bool p_release_vram);
+	void resume();
+
 	OS_3DS();
 	virtual ~OS_3DS();
 };
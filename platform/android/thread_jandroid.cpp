@@ -51,6 +51,7 @@ void *ThreadAndroid::thread_callback(void *userdata) {
 	t->id = (ID)pthread_self();
 	t->callback(t->user);
 	ScriptServer::thread_exit();
+	Memory::release_thread_cache();
 	return NULL;
 }
 
@@ -36,6 +36,7 @@
 #include "node.h"
 #include "os/keyboard.h"
 #include "os/os.h"
+#include "os/zone_profiler.h"
 #include "print_string.h"
 #include "scene/resources/material.h"
 #include "scene/resources/mesh.h"
@@ -324,7 +325,7 @@ void SceneTree::input_text(const String &p_text) {
 
 	root_lock++;
 
-	call_group(GROUP_CALL_REALTIME, "_viewports", "_vp_input_text", p_text); //special one for GUI, as controls use their own process check
+	call_group(GROUP_CALL_REALTIME, SNAME("_viewports"), SNAME("_vp_input_text"), p_text); //special one for GUI, as controls use their own process check
 
 	root_lock--;
 }
@@ -420,7 +421,7 @@ void SceneTree::input_event(const InputEvent &p_event) {
 	//transform for the rest
 #else
 
-	call_group(GROUP_CALL_REALTIME, "_viewports", "_vp_input", ev); //special one for GUI, as controls use their own process check
+	call_group(GROUP_CALL_REALTIME, SNAME("_viewports"), SNAME("_vp_input"), ev); //special one for GUI, as controls use their own process check
 
 #endif
 	if (ScriptDebugger::get_singleton() && ScriptDebugger::get_singleton()->is_remote() && ev.type == InputEvent::KEY && ev.key.pressed && !ev.key.echo && ev.key.scancode == KEY_F8) {
@@ -445,7 +446,7 @@ void SceneTree::input_event(const InputEvent &p_event) {
 		}
 #else
 
-		call_group(GROUP_CALL_REALTIME, "_viewports", "_vp_unhandled_input", ev); //special one for GUI, as controls use their own process check
+		call_group(GROUP_CALL_REALTIME, SNAME("_viewports"), SNAME("_vp_unhandled_input"), ev); //special one for GUI, as controls use their own process check
 
 #endif
 		input_handled = true;
@@ -472,6 +473,8 @@ void SceneTree::init() {
 
 bool SceneTree::iteration(float p_time) {
 
+	ZONE_SCOPE("SceneTree::iteration");
+
 	root_lock++;
 
 	current_frame++;
@@ -481,12 +484,12 @@ bool SceneTree::iteration(float p_time) {
 	MainLoop::iteration(p_time);
 	fixed_process_time = p_time;
 
-	emit_signal("fixed_frame");
+	emit_signal(SNAME("fixed_frame"));
 
-	_notify_group_pause("fixed_process", Node::NOTIFICATION_FIXED_PROCESS);
+	_notify_group_pause(SNAME("fixed_process"), Node::NOTIFICATION_FIXED_PROCESS);
 	_flush_ugc();
 	_flush_transform_notifications();
-	call_group(GROUP_CALL_REALTIME, "_viewports", "update_worlds");
+	call_group(GROUP_CALL_REALTIME, SNAME("_viewports"), SNAME("update_worlds"));
 	root_lock--;
 
 	_flush_delete_queue();
@@ -496,6 +499,8 @@ bool SceneTree::iteration(float p_time) {
 
 bool SceneTree::idle(float p_time) {
 
+	ZONE_SCOPE("SceneTree::idle");
+
 	//	print_line("ram: "+itos(OS::get_singleton()->get_static_memory_usage())+" sram: "+itos(OS::get_singleton()->get_dynamic_memory_usage()));
 	//	print_line("node count: "+itos(get_node_count()));
 	//	print_line("TEXTURE RAM: "+itos(VS::get_singleton()->get_render_info(VS::INFO_TEXTURE_MEM_USED)));
@@ -506,11 +511,11 @@ bool SceneTree::idle(float p_time) {
 
 	idle_process_time = p_time;
 
-	emit_signal("idle_frame");
+	emit_signal(SNAME("idle_frame"));
 
 	_flush_transform_notifications();
 
-	_notify_group_pause("idle_process", Node::NOTIFICATION_PROCESS);
+	_notify_group_pause(SNAME("idle_process"), Node::NOTIFICATION_PROCESS);
 
 	Size2 win_size = Size2(OS::get_singleton()->get_video_mode().width, OS::get_singleton()->get_video_mode().height);
 	if (win_size != last_screen_size) {
@@ -523,7 +528,7 @@ bool SceneTree::idle(float p_time) {
 
 	_flush_ugc();
 	_flush_transform_notifications(); //transforms after world update, to avoid unnecesary enter/exit notifications
-	call_group(GROUP_CALL_REALTIME, "_viewports", "update_worlds");
+	call_group(GROUP_CALL_REALTIME, SNAME("_viewports"), SNAME("update_worlds"));
 
 	root_lock--;
 
@@ -1140,6 +1145,10 @@ void SceneTree::_change_scene(Node *p_to) {
 	if (current_scene) {
 		memdelete(current_scene);
 		current_scene = NULL;
+
+		// the old scene's buffers just left holes behind, a good time to close them
+		if (defragment_on_scene_change)
+			Memory::defragment_dynamic_mem();
 	}
 
 	if (p_to) {
@@ -1642,6 +1651,7 @@ SceneTree::SceneTree() {
 	debug_navigation_color = GLOBAL_DEF("debug/navigation_geometry_color", Color(0.1, 1.0, 0.7, 0.4));
 	debug_navigation_disabled_color = GLOBAL_DEF("debug/navigation_disabled_geometry_color", Color(1.0, 0.7, 0.1, 0.4));
 	collision_debug_contacts = GLOBAL_DEF("debug/collision_max_contacts_displayed", 10000);
+	defragment_on_scene_change = GLOBAL_DEF("memory/defragment_on_scene_change", true);
 
 	tree_version = 1;
 	fixed_process_time = 1;
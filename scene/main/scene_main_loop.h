@@ -107,6 +107,7 @@ private:
 
 	int64_t current_frame;
 	int node_count;
+	bool defragment_on_scene_change;
 
 #ifdef TOOLS_ENABLED
 	Node *edited_scene_root;
@@ -56,7 +56,7 @@ void Timer::_notification(int p_what) {
 				else
 					stop();
 
-				emit_signal("timeout");
+				emit_signal(SNAME("timeout"));
 			}
 
 		} break;
@@ -70,7 +70,7 @@ void Timer::_notification(int p_what) {
 					time_left += wait_time;
 				else
 					stop();
-				emit_signal("timeout");
+				emit_signal(SNAME("timeout"));
 			}
 
 		} break;
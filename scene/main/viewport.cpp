@@ -220,9 +220,14 @@ void Viewport::_vp_enter_tree() {
 		VisualServer::get_singleton()->canvas_item_attach_viewport(canvas_item, viewport);
 		parent_control->connect("resized", this, "_parent_resized");
 		parent_control->connect("visibility_changed", this, "_parent_visibility_changed");
-	} else if (!parent) {
+	} else if (_is_screen_root()) {
 
-		VisualServer::get_singleton()->viewport_attach_to_screen(viewport, 0);
+		if (screen > 0 && rect.size == Size2()) {
+			OS::VideoMode vm = OS::get_singleton()->get_video_mode(screen);
+			set_rect(Rect2(0, 0, vm.width, vm.height));
+		}
+		VisualServer::get_singleton()->viewport_attach_to_screen(viewport, screen);
+		VisualServer::get_singleton()->screen_set_update_mode(screen, VS::ScreenUpdateMode(screen_update_mode));
 	}
 }
 
@@ -244,12 +249,31 @@ void Viewport::_vp_exit_tree() {
 		canvas_item = RID();
 	}
 
-	if (!parent) {
+	if (!parent_control && _is_screen_root()) {
 
 		VisualServer::get_singleton()->viewport_detach(viewport);
 	}
 }
 
+bool Viewport::_is_screen_root() const {
+
+	// viewports placed on another screen are roots of their own
+	return !parent || screen > 0;
+}
+
+bool Viewport::_is_input_for_other_screen(const InputEvent &p_ev) const {
+
+	if (p_ev.type != InputEvent::MOUSE_BUTTON && p_ev.type != InputEvent::MOUSE_MOTION && p_ev.type != InputEvent::SCREEN_TOUCH && p_ev.type != InputEvent::SCREEN_DRAG)
+		return false;
+
+	// nested viewports are on the screen of the root they are drawn in
+	const Viewport *root = this;
+	while (!root->_is_screen_root())
+		root = root->parent;
+
+	return p_ev.screen != root->screen;
+}
+
 void Viewport::update_worlds() {
 
 	if (!is_inside_tree())
@@ -1176,6 +1200,37 @@ Viewport::RenderTargetUpdateMode Viewport::get_render_target_update_mode() const
 
 	return render_target_update_mode;
 }
+
+void Viewport::set_screen(int p_screen) {
+
+	ERR_FAIL_INDEX(p_screen, OS::get_singleton()->get_screen_count());
+	if (screen == p_screen)
+		return;
+
+	bool attached = is_inside_tree() && !render_target;
+	if (attached)
+		_vp_exit_tree();
+	screen = p_screen;
+	if (attached)
+		_vp_enter_tree();
+}
+
+int Viewport::get_screen() const {
+
+	return screen;
+}
+
+void Viewport::set_screen_update_mode(ScreenUpdateMode p_mode) {
+
+	screen_update_mode = p_mode;
+	if (is_inside_tree() && !render_target && !parent_control && _is_screen_root())
+		VS::get_singleton()->screen_set_update_mode(screen, VS::ScreenUpdateMode(p_mode));
+}
+
+Viewport::ScreenUpdateMode Viewport::get_screen_update_mode() const {
+
+	return screen_update_mode;
+}
 //RID get_render_target_texture() const;
 
 void Viewport::queue_screen_capture() {
@@ -1351,6 +1406,9 @@ void Viewport::_vp_input(const InputEvent &p_ev) {
 	if (disable_input)
 		return;
 
+	if (_is_input_for_other_screen(p_ev))
+		return;
+
 #ifdef TOOLS_ENABLED
 	if (get_tree()->is_editor_hint() && get_tree()->get_edited_scene_root() && get_tree()->get_edited_scene_root()->is_a_parent_of(this)) {
 		return;
@@ -1375,6 +1433,9 @@ void Viewport::_vp_unhandled_input(const InputEvent &p_ev) {
 
 	if (disable_input)
 		return;
+
+	if (_is_input_for_other_screen(p_ev))
+		return;
 #ifdef TOOLS_ENABLED
 	if (get_tree()->is_editor_hint() && get_tree()->get_edited_scene_root() && get_tree()->get_edited_scene_root()->is_a_parent_of(this)) {
 		return;
@@ -2253,7 +2314,7 @@ void Viewport::_gui_grab_click_focus(Control *p_control) {
 		mb.y = click.y;
 		mb.button_index = gui.mouse_focus_button;
 		mb.pressed = false;
-		gui.mouse_focus->call_deferred("_input_event", ie);
+		gui.mouse_focus->call_deferred(SNAME("_input_event"), ie);
 
 		gui.mouse_focus = p_control;
 		gui.focus_inv_xform = gui.mouse_focus->get_global_transform_with_canvas().affine_inverse();
@@ -2262,7 +2323,7 @@ void Viewport::_gui_grab_click_focus(Control *p_control) {
 		mb.y = click.y;
 		mb.button_index = gui.mouse_focus_button;
 		mb.pressed = true;
-		gui.mouse_focus->call_deferred("_input_event", ie);
+		gui.mouse_focus->call_deferred(SNAME("_input_event"), ie);
 	}
 }
 
@@ -2459,6 +2520,11 @@ void Viewport::_bind_methods() {
 	ObjectTypeDB::bind_method(_MD("set_render_target_update_mode", "mode"), &Viewport::set_render_target_update_mode);
 	ObjectTypeDB::bind_method(_MD("get_render_target_update_mode"), &Viewport::get_render_target_update_mode);
 
+	ObjectTypeDB::bind_method(_MD("set_screen", "screen"), &Viewport::set_screen);
+	ObjectTypeDB::bind_method(_MD("get_screen"), &Viewport::get_screen);
+	ObjectTypeDB::bind_method(_MD("set_screen_update_mode", "mode"), &Viewport::set_screen_update_mode);
+	ObjectTypeDB::bind_method(_MD("get_screen_update_mode"), &Viewport::get_screen_update_mode);
+
 	ObjectTypeDB::bind_method(_MD("get_render_target_texture:RenderTargetTexture"), &Viewport::get_render_target_texture);
 
 	ObjectTypeDB::bind_method(_MD("set_physics_object_picking", "enable"), &Viewport::set_physics_object_picking);
@@ -2505,6 +2571,8 @@ void Viewport::_bind_methods() {
 	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "render_target/filter"), _SCS("set_render_target_filter"), _SCS("get_render_target_filter"));
 	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "render_target/gen_mipmaps"), _SCS("set_render_target_gen_mipmaps"), _SCS("get_render_target_gen_mipmaps"));
 	ADD_PROPERTY(PropertyInfo(Variant::INT, "render_target/update_mode", PROPERTY_HINT_ENUM, "Disabled,Once,When Visible,Always"), _SCS("set_render_target_update_mode"), _SCS("get_render_target_update_mode"));
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "screen/index", PROPERTY_HINT_RANGE, "0,8,1"), _SCS("set_screen"), _SCS("get_screen"));
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "screen/update_mode", PROPERTY_HINT_ENUM, "Always,When Dirty"), _SCS("set_screen_update_mode"), _SCS("get_screen_update_mode"));
 	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "audio_listener/enable_2d"), _SCS("set_as_audio_listener_2d"), _SCS("is_audio_listener_2d"));
 	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "audio_listener/enable_3d"), _SCS("set_as_audio_listener"), _SCS("is_audio_listener"));
 	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "physics/object_picking"), _SCS("set_physics_object_picking"), _SCS("get_physics_object_picking"));
@@ -2516,6 +2584,9 @@ void Viewport::_bind_methods() {
 	BIND_CONSTANT(RENDER_TARGET_UPDATE_ONCE);
 	BIND_CONSTANT(RENDER_TARGET_UPDATE_WHEN_VISIBLE);
 	BIND_CONSTANT(RENDER_TARGET_UPDATE_ALWAYS);
+
+	BIND_CONSTANT(SCREEN_UPDATE_ALWAYS);
+	BIND_CONSTANT(SCREEN_UPDATE_WHEN_DIRTY);
 }
 
 Viewport::Viewport() {
@@ -2540,6 +2611,8 @@ Viewport::Viewport() {
 	render_target_clear_on_new_frame = true;
 	//render_target_clear=true;
 	render_target_update_mode = RENDER_TARGET_UPDATE_WHEN_VISIBLE;
+	screen = 0;
+	screen_update_mode = SCREEN_UPDATE_ALWAYS;
 	render_target_texture = Ref<RenderTargetTexture>(memnew(RenderTargetTexture(this)));
 
 	physics_object_picking = false;
@@ -84,6 +84,11 @@ public:
 		RENDER_TARGET_UPDATE_ALWAYS
 	};
 
+	enum ScreenUpdateMode {
+		SCREEN_UPDATE_ALWAYS,
+		SCREEN_UPDATE_WHEN_DIRTY,
+	};
+
 private:
 	friend class RenderTargetTexture;
 
@@ -166,6 +171,11 @@ private:
 	bool render_target;
 	RenderTargetUpdateMode render_target_update_mode;
 	RID render_target_texture_rid;
+
+	int screen;
+	ScreenUpdateMode screen_update_mode;
+	bool _is_screen_root() const;
+	bool _is_input_for_other_screen(const InputEvent &p_ev) const;
 	Ref<RenderTargetTexture> render_target_texture;
 
 	struct GUI {
@@ -333,6 +343,12 @@ public:
 
 	void set_render_target_update_mode(RenderTargetUpdateMode p_mode);
 	RenderTargetUpdateMode get_render_target_update_mode() const;
+
+	void set_screen(int p_screen);
+	int get_screen() const;
+
+	void set_screen_update_mode(ScreenUpdateMode p_mode);
+	ScreenUpdateMode get_screen_update_mode() const;
 	Ref<RenderTargetTexture> get_render_target_texture() const;
 
 	Vector2 get_camera_coords(const Vector2 &p_viewport_coords) const;
@@ -371,4 +387,5 @@ public:
 };
 
 VARIANT_ENUM_CAST(Viewport::RenderTargetUpdateMode);
+VARIANT_ENUM_CAST(Viewport::ScreenUpdateMode);
 #endif
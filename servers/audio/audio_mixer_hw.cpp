@@ -0,0 +1,575 @@
+/*************************************************************************/
+/*  audio_mixer_hw.cpp                                                   */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "audio_mixer_hw.h"
+
+int AudioMixerHW::_get_voice(ChannelID p_channel) const {
+
+	if (p_channel == INVALID_CHANNEL) {
+		return -1;
+	}
+
+	int idx = p_channel % MAX_VOICES;
+	int check = p_channel / MAX_VOICES;
+	if (voices[idx].check != check) {
+		return -1;
+	}
+	if (!voices[idx].active) {
+		return -1;
+	}
+
+	return idx;
+}
+
+bool AudioMixerHW::_can_offload(const Voice &p_voice) const {
+
+	if (sample_manager->sample_get_format(p_voice.sample) == AS::SAMPLE_FORMAT_IMA_ADPCM)
+		return false;
+	if (sample_manager->sample_get_loop_format(p_voice.sample) == AS::SAMPLE_LOOP_PING_PONG)
+		return false;
+	return true;
+}
+
+bool AudioMixerHW::_needs_software(const Voice &p_voice) const {
+
+	return p_voice.filter_type != FILTER_NONE || p_voice.chorus_send > 0 || p_voice.reverb_send > 0;
+}
+
+bool AudioMixerHW::_is_looping(const Voice &p_voice) const {
+
+	return sample_manager->sample_get_loop_format(p_voice.sample) != AS::SAMPLE_LOOP_NONE;
+}
+
+bool AudioMixerHW::_is_lower_priority(const Voice &p_a, const Voice &p_b) const {
+
+	bool a_loop = _is_looping(p_a);
+	bool b_loop = _is_looping(p_b);
+	if (a_loop != b_loop)
+		return b_loop;
+	if (p_a.vol != p_b.vol)
+		return p_a.vol < p_b.vol;
+	return p_a.serial < p_b.serial;
+}
+
+void AudioMixerHW::_get_gains(const Voice &p_voice, float &r_left, float &r_right) const {
+
+	// same pan law as the software mixer, so a channel sounds the same on either side
+	float vol = p_voice.vol * mixer_volume;
+	float pan = p_voice.pan * 0.5 + 0.5;
+	r_left = vol * (1.0f - pan);
+	r_right = vol * pan;
+}
+
+void AudioMixerHW::_stop(Voice &p_voice) {
+
+	if (p_voice.route == ROUTE_HARDWARE) {
+		backend->backend_voice_stop(p_voice.hw_voice);
+		hw_owner[p_voice.hw_voice] = -1;
+	} else if (p_voice.route == ROUTE_SOFTWARE) {
+		software->channel_free(p_voice.sw_channel);
+	}
+
+	p_voice.route = ROUTE_PENDING;
+	p_voice.active = false;
+}
+
+bool AudioMixerHW::_start_hardware(Voice &p_voice, int p_hw_voice, int p_from_frame) {
+
+	Backend::Sample sample;
+	sample.rid = p_voice.sample;
+	sample.data = sample_manager->sample_get_data_ptr(p_voice.sample);
+	sample.version = sample_manager->sample_get_version(p_voice.sample);
+	sample.format = sample_manager->sample_get_format(p_voice.sample);
+	sample.stereo = sample_manager->sample_is_stereo(p_voice.sample);
+	sample.length = sample_manager->sample_get_length(p_voice.sample);
+	sample.loop_format = sample_manager->sample_get_loop_format(p_voice.sample);
+	sample.loop_begin = sample_manager->sample_get_loop_begin(p_voice.sample);
+	sample.loop_end = sample_manager->sample_get_loop_end(p_voice.sample);
+
+	float left, right;
+	_get_gains(p_voice, left, right);
+	if (!backend->backend_voice_start(p_hw_voice, sample, p_from_frame, p_voice.speed, left, right))
+		return false;
+
+	hw_owner[p_hw_voice] = &p_voice - voices;
+	p_voice.hw_voice = p_hw_voice;
+	p_voice.route = ROUTE_HARDWARE;
+	return true;
+}
+
+bool AudioMixerHW::_start_software(Voice &p_voice, int p_from_frame) {
+
+	ChannelID channel = software->channel_alloc(p_voice.sample);
+	if (channel == INVALID_CHANNEL)
+		return false;
+
+	software->channel_set_volume(channel, p_voice.vol);
+	software->channel_set_pan(channel, p_voice.pan, p_voice.depth, p_voice.height);
+	if (p_voice.filter_type != FILTER_NONE)
+		software->channel_set_filter(channel, p_voice.filter_type, p_voice.filter_cutoff, p_voice.filter_resonance, p_voice.filter_gain);
+	software->channel_set_chorus(channel, p_voice.chorus_send);
+	software->channel_set_reverb(channel, p_voice.reverb_room, p_voice.reverb_send);
+	software->channel_set_mix_rate(channel, p_voice.speed);
+	software->channel_set_positional(channel, p_voice.positional);
+	if (p_from_frame > 0)
+		software->channel_set_sample_offset(channel, p_from_frame);
+
+	p_voice.sw_channel = channel;
+	p_voice.route = ROUTE_SOFTWARE;
+	return true;
+}
+
+void AudioMixerHW::_move_to_software(Voice &p_voice) {
+
+	int hw_voice = p_voice.hw_voice;
+	int position = backend->backend_voice_get_position(hw_voice);
+
+	// without a free software channel the effect is skipped rather than the sound
+	if (!_start_software(p_voice, position))
+		return;
+
+	backend->backend_voice_stop(hw_voice);
+	hw_owner[hw_voice] = -1;
+}
+
+void AudioMixerHW::_route(Voice &p_voice) {
+
+	bool offload = !_needs_software(p_voice) && _can_offload(p_voice);
+
+	if (offload) {
+		for (int i = 0; i < hw_voice_count; i++) {
+
+			if (hw_owner[i] != -1)
+				continue;
+			if (_start_hardware(p_voice, i, 0))
+				return;
+
+			offload = false; // the backend can't take this sample
+			break;
+		}
+	}
+
+	if (_start_software(p_voice, 0))
+		return;
+
+	// out of channels, take one from a playing voice that matters less
+	int victim = -1;
+	for (int i = 0; i < MAX_VOICES; i++) {
+
+		const Voice &v = voices[i];
+		if (!v.active || v.route == ROUTE_PENDING)
+			continue;
+		if (v.route == ROUTE_HARDWARE && !offload)
+			continue;
+		if (victim == -1 || _is_lower_priority(v, voices[victim]))
+			victim = i;
+	}
+
+	if (victim == -1 || !_is_lower_priority(voices[victim], p_voice)) {
+		p_voice.active = false;
+		return;
+	}
+
+	Voice &v = voices[victim];
+	bool was_hardware = v.route == ROUTE_HARDWARE;
+	int hw_voice = v.hw_voice;
+	_stop(v);
+	steal_count++;
+
+	bool started = was_hardware ? _start_hardware(p_voice, hw_voice, 0) : _start_software(p_voice, 0);
+	if (!started)
+		p_voice.active = false;
+}
+
+void AudioMixerHW::update() {
+
+	for (int i = 0; i < MAX_VOICES; i++) {
+
+		Voice &v = voices[i];
+		if (!v.active)
+			continue;
+
+		if (v.route == ROUTE_HARDWARE && !backend->backend_voice_is_playing(v.hw_voice)) {
+			backend->backend_voice_stop(v.hw_voice);
+			hw_owner[v.hw_voice] = -1;
+			v.route = ROUTE_PENDING;
+			v.active = false;
+		} else if (v.route == ROUTE_SOFTWARE && !software->channel_is_valid(v.sw_channel)) {
+			v.route = ROUTE_PENDING;
+			v.active = false;
+		}
+	}
+
+	for (int i = 0; i < MAX_VOICES; i++) {
+
+		Voice &v = voices[i];
+		if (v.active && v.route == ROUTE_PENDING)
+			_route(v);
+	}
+}
+
+AudioMixer::ChannelID AudioMixerHW::channel_alloc(RID p_sample) {
+
+	ERR_FAIL_COND_V(!sample_manager->is_sample(p_sample), INVALID_CHANNEL);
+
+	int index = -1;
+	for (int i = 0; i < MAX_VOICES; i++) {
+
+		if (!voices[i].active) {
+			index = i;
+			break;
+		}
+	}
+
+	if (index == -1)
+		return INVALID_CHANNEL;
+
+	Voice &v = voices[index];
+
+	v.sample = p_sample;
+	v.route = ROUTE_PENDING;
+	v.hw_voice = -1;
+	v.sw_channel = INVALID_CHANNEL;
+	v.vol = 1;
+	v.pan = 0;
+	v.depth = 0;
+	v.height = 0;
+	v.chorus_send = 0;
+	v.reverb_send = 0;
+	v.reverb_room = REVERB_HALL;
+	v.filter_type = FILTER_NONE;
+	v.filter_cutoff = 8000;
+	v.filter_resonance = 0;
+	v.filter_gain = 0;
+	v.speed = sample_manager->sample_get_mix_rate(p_sample);
+	v.positional = false;
+	v.serial = serial_count++;
+	v.check = check_count;
+	v.active = true;
+
+	// keep ids clear of INVALID_CHANNEL
+	check_count = (check_count + 1) & 0xFFFFFF;
+
+	return index + v.check * MAX_VOICES;
+}
+
+void AudioMixerHW::channel_set_volume(ChannelID p_channel, float p_gain) {
+
+	int idx = _get_voice(p_channel);
+	if (idx < 0)
+		return;
+
+	Voice &v = voices[idx];
+	v.vol = CLAMP(p_gain, 0, 3);
+
+	if (v.route == ROUTE_HARDWARE) {
+		float left, right;
+		_get_gains(v, left, right);
+		backend->backend_voice_set_volume(v.hw_voice, left, right);
+	} else if (v.route == ROUTE_SOFTWARE) {
+		software->channel_set_volume(v.sw_channel, p_gain);
+	}
+}
+
+void AudioMixerHW::channel_set_pan(ChannelID p_channel, float p_pan, float p_depth, float p_height) {
+
+	int idx = _get_voice(p_channel);
+	if (idx < 0)
+		return;
+
+	Voice &v = voices[idx];
+	v.pan = p_pan;
+	v.depth = p_depth;
+	v.height = p_height;
+
+	if (v.route == ROUTE_HARDWARE) {
+		float left, right;
+		_get_gains(v, left, right);
+		backend->backend_voice_set_volume(v.hw_voice, left, right);
+	} else if (v.route == ROUTE_SOFTWARE) {
+		software->channel_set_pan(v.sw_channel, p_pan, p_depth, p_height);
+	}
+}
+
+void AudioMixerHW::channel_set_filter(ChannelID p_channel, FilterType p_type, float p_cutoff, float p_resonance, float p_gain) {
+
+	int idx = _get_voice(p_channel);
+	if (idx < 0)
+		return;
+
+	Voice &v = voices[idx];
+	v.filter_type = p_type;
+	v.filter_cutoff = p_cutoff;
+	v.filter_resonance = p_resonance;
+	v.filter_gain = p_gain;
+
+	if (v.route == ROUTE_SOFTWARE)
+		software->channel_set_filter(v.sw_channel, p_type, p_cutoff, p_resonance, p_gain);
+	else if (v.route == ROUTE_HARDWARE && _needs_software(v))
+		_move_to_software(v);
+}
+
+void AudioMixerHW::channel_set_chorus(ChannelID p_channel, float p_chorus) {
+
+	int idx = _get_voice(p_channel);
+	if (idx < 0)
+		return;
+
+	Voice &v = voices[idx];
+	v.chorus_send = p_chorus;
+
+	if (v.route == ROUTE_SOFTWARE)
+		software->channel_set_chorus(v.sw_channel, p_chorus);
+	else if (v.route == ROUTE_HARDWARE && _needs_software(v))
+		_move_to_software(v);
+}
+
+void AudioMixerHW::channel_set_reverb(ChannelID p_channel, ReverbRoomType p_room_type, float p_reverb) {
+
+	ERR_FAIL_INDEX(p_room_type, MAX_REVERBS);
+	int idx = _get_voice(p_channel);
+	if (idx < 0)
+		return;
+
+	Voice &v = voices[idx];
+	v.reverb_room = p_room_type;
+	v.reverb_send = p_reverb;
+
+	if (v.route == ROUTE_SOFTWARE)
+		software->channel_set_reverb(v.sw_channel, p_room_type, p_reverb);
+	else if (v.route == ROUTE_HARDWARE && _needs_software(v))
+		_move_to_software(v);
+}
+
+void AudioMixerHW::channel_set_mix_rate(ChannelID p_channel, int p_mix_rate) {
+
+	int idx = _get_voice(p_channel);
+	if (idx < 0)
+		return;
+
+	Voice &v = voices[idx];
+	v.speed = p_mix_rate;
+
+	if (v.route == ROUTE_HARDWARE)
+		backend->backend_voice_set_mix_rate(v.hw_voice, p_mix_rate);
+	else if (v.route == ROUTE_SOFTWARE)
+		software->channel_set_mix_rate(v.sw_channel, p_mix_rate);
+}
+
+void AudioMixerHW::channel_set_positional(ChannelID p_channel, bool p_positional) {
+
+	int idx = _get_voice(p_channel);
+	if (idx < 0)
+		return;
+
+	Voice &v = voices[idx];
+	v.positional = p_positional;
+
+	if (v.route == ROUTE_SOFTWARE)
+		software->channel_set_positional(v.sw_channel, p_positional);
+}
+
+float AudioMixerHW::channel_get_volume(ChannelID p_channel) const {
+
+	int idx = _get_voice(p_channel);
+	if (idx < 0)
+		return 0;
+	return voices[idx].vol;
+}
+
+float AudioMixerHW::channel_get_pan(ChannelID p_channel) const {
+
+	int idx = _get_voice(p_channel);
+	if (idx < 0)
+		return 0;
+	return voices[idx].pan;
+}
+
+float AudioMixerHW::channel_get_pan_depth(ChannelID p_channel) const {
+
+	int idx = _get_voice(p_channel);
+	if (idx < 0)
+		return 0;
+	return voices[idx].depth;
+}
+
+float AudioMixerHW::channel_get_pan_height(ChannelID p_channel) const {
+
+	int idx = _get_voice(p_channel);
+	if (idx < 0)
+		return 0;
+	return voices[idx].height;
+}
+
+AudioMixer::FilterType AudioMixerHW::channel_get_filter_type(ChannelID p_channel) const {
+
+	int idx = _get_voice(p_channel);
+	if (idx < 0)
+		return FILTER_NONE;
+	return voices[idx].filter_type;
+}
+
+float AudioMixerHW::channel_get_filter_cutoff(ChannelID p_channel) const {
+
+	int idx = _get_voice(p_channel);
+	if (idx < 0)
+		return 0;
+	return voices[idx].filter_cutoff;
+}
+
+float AudioMixerHW::channel_get_filter_resonance(ChannelID p_channel) const {
+
+	int idx = _get_voice(p_channel);
+	if (idx < 0)
+		return 0;
+	return voices[idx].filter_resonance;
+}
+
+float AudioMixerHW::channel_get_filter_gain(ChannelID p_channel) const {
+
+	int idx = _get_voice(p_channel);
+	if (idx < 0)
+		return 0;
+	return voices[idx].filter_gain;
+}
+
+float AudioMixerHW::channel_get_chorus(ChannelID p_channel) const {
+
+	int idx = _get_voice(p_channel);
+	if (idx < 0)
+		return 0;
+	return voices[idx].chorus_send;
+}
+
+AudioMixer::ReverbRoomType AudioMixerHW::channel_get_reverb_type(ChannelID p_channel) const {
+
+	int idx = _get_voice(p_channel);
+	if (idx < 0)
+		return REVERB_HALL;
+	return voices[idx].reverb_room;
+}
+
+float AudioMixerHW::channel_get_reverb(ChannelID p_channel) const {
+
+	int idx = _get_voice(p_channel);
+	if (idx < 0)
+		return 0;
+	return voices[idx].reverb_send;
+}
+
+int AudioMixerHW::channel_get_mix_rate(ChannelID p_channel) const {
+
+	int idx = _get_voice(p_channel);
+	if (idx < 0)
+		return 0;
+	return voices[idx].speed;
+}
+
+bool AudioMixerHW::channel_is_positional(ChannelID p_channel) const {
+
+	int idx = _get_voice(p_channel);
+	if (idx < 0)
+		return false;
+	return voices[idx].positional;
+}
+
+bool AudioMixerHW::channel_is_valid(ChannelID p_channel) const {
+
+	int idx = _get_voice(p_channel);
+	if (idx < 0)
+		return false;
+
+	const Voice &v = voices[idx];
+	if (v.route == ROUTE_HARDWARE)
+		return backend->backend_voice_is_playing(v.hw_voice);
+	if (v.route == ROUTE_SOFTWARE)
+		return software->channel_is_valid(v.sw_channel);
+	return true;
+}
+
+void AudioMixerHW::channel_free(ChannelID p_channel) {
+
+	int idx = _get_voice(p_channel);
+	if (idx < 0)
+		return;
+
+	_stop(voices[idx]);
+}
+
+void AudioMixerHW::set_mixer_volume(float p_volume) {
+
+	mixer_volume = p_volume;
+	software->set_mixer_volume(p_volume);
+
+	for (int i = 0; i < hw_voice_count; i++) {
+
+		if (hw_owner[i] == -1)
+			continue;
+
+		float left, right;
+		_get_gains(voices[hw_owner[i]], left, right);
+		backend->backend_voice_set_volume(i, left, right);
+	}
+}
+
+bool AudioMixerHW::channel_is_hardware(ChannelID p_channel) const {
+
+	int idx = _get_voice(p_channel);
+	if (idx < 0)
+		return false;
+	return voices[idx].route == ROUTE_HARDWARE;
+}
+
+int AudioMixerHW::get_hardware_voices_used() const {
+
+	int used = 0;
+	for (int i = 0; i < hw_voice_count; i++) {
+		if (hw_owner[i] != -1)
+			used++;
+	}
+	return used;
+}
+
+AudioMixerHW::AudioMixerHW(SampleManagerSW *p_sample_manager, AudioMixerSW *p_software, Backend *p_backend) {
+
+	sample_manager = p_sample_manager;
+	software = p_software;
+	backend = p_backend;
+
+	hw_voice_count = backend ? MIN(backend->backend_get_voice_count(), int(MAX_HARDWARE_VOICES)) : 0;
+	for (int i = 0; i < MAX_HARDWARE_VOICES; i++) {
+		hw_owner[i] = -1;
+	}
+
+	serial_count = 0;
+	check_count = 0;
+	mixer_volume = 1.0;
+	steal_count = 0;
+}
@@ -0,0 +1,195 @@
+/*************************************************************************/
+/*  audio_mixer_hw.h                                                     */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#ifndef AUDIO_MIXER_HW_H
+#define AUDIO_MIXER_HW_H
+
+#include "servers/audio/audio_mixer_sw.h"
+
+/**
+	Plays channels on hardware voices where the audio driver has them, and
+	hands everything else to the software mixer. A channel is routed the
+	first time update() runs after it was allocated, so the settings sent
+	right after channel_alloc() are known by then: samples the hardware
+	can't loop, and channels with a filter, chorus or reverb send, are
+	mixed in software. A hardware channel that gains one of those later
+	moves to software, picking up at the position the hardware reached.
+
+	When both hardware and software channels are exhausted, a playing
+	channel is stolen: one-shots go before loops, then the quietest, then
+	the oldest. A new channel that ranks below every playing one is dropped
+	instead, so channel_is_valid() reports it as gone.
+
+	The backend only knows how to start, stop and adjust numbered voices,
+	so the routing policy runs unchanged against a stub in tests.
+*/
+
+class AudioMixerHW : public AudioMixer {
+public:
+	enum {
+		MAX_HARDWARE_VOICES = 24,
+		MAX_VOICES = 128,
+	};
+
+	class Backend {
+	public:
+		struct Sample {
+			RID rid;
+			const void *data;
+			uint32_t version; // see SampleManagerSW::sample_get_version()
+			AS::SampleFormat format;
+			bool stereo;
+			int length;
+			AS::SampleLoopFormat loop_format;
+			int loop_begin;
+			int loop_end;
+		};
+
+		virtual int backend_get_voice_count() const = 0;
+		// Returns false when the sample can't be played, the channel then goes to software
+		virtual bool backend_voice_start(int p_voice, const Sample &p_sample, int p_from_frame, int p_mix_rate, float p_left, float p_right) = 0;
+		// Also called once a voice has finished by itself, so it can let go of the sample
+		virtual void backend_voice_stop(int p_voice) = 0;
+		virtual void backend_voice_set_mix_rate(int p_voice, int p_mix_rate) = 0;
+		virtual void backend_voice_set_volume(int p_voice, float p_left, float p_right) = 0;
+		virtual bool backend_voice_is_playing(int p_voice) const = 0;
+		virtual int backend_voice_get_position(int p_voice) const = 0;
+		virtual ~Backend() {}
+	};
+
+private:
+	enum Route {
+		ROUTE_PENDING,
+		ROUTE_HARDWARE,
+		ROUTE_SOFTWARE,
+	};
+
+	struct Voice {
+
+		RID sample;
+		Route route;
+		int hw_voice;
+		ChannelID sw_channel;
+
+		float vol;
+		float pan;
+		float depth;
+		float height;
+		float chorus_send;
+		ReverbRoomType reverb_room;
+		float reverb_send;
+		FilterType filter_type;
+		float filter_cutoff;
+		float filter_resonance;
+		float filter_gain;
+		int speed;
+		bool positional;
+
+		uint64_t serial;
+		int check;
+		bool active;
+
+		Voice() {
+			active = false;
+			check = -1;
+		}
+	};
+
+	SampleManagerSW *sample_manager;
+	AudioMixerSW *software;
+	Backend *backend;
+
+	Voice voices[MAX_VOICES];
+	int hw_owner[MAX_HARDWARE_VOICES];
+	int hw_voice_count;
+
+	uint64_t serial_count;
+	int check_count;
+	float mixer_volume;
+	uint32_t steal_count;
+
+	int _get_voice(ChannelID p_channel) const;
+	bool _can_offload(const Voice &p_voice) const;
+	bool _needs_software(const Voice &p_voice) const;
+	bool _is_looping(const Voice &p_voice) const;
+	bool _is_lower_priority(const Voice &p_a, const Voice &p_b) const;
+	void _get_gains(const Voice &p_voice, float &r_left, float &r_right) const;
+
+	void _stop(Voice &p_voice);
+	int _steal(const Voice &p_for, bool p_hardware_only);
+	bool _start_hardware(Voice &p_voice, int p_hw_voice, int p_from_frame);
+	bool _start_software(Voice &p_voice, int p_from_frame);
+	void _move_to_software(Voice &p_voice);
+	void _route(Voice &p_voice);
+
+public:
+	/* CHANNEL API */
+
+	virtual ChannelID channel_alloc(RID p_sample);
+
+	virtual void channel_set_volume(ChannelID p_channel, float p_gain);
+	virtual void channel_set_pan(ChannelID p_channel, float p_pan, float p_depth = 0, float height = 0);
+	virtual void channel_set_filter(ChannelID p_channel, FilterType p_type, float p_cutoff, float p_resonance, float p_gain = 1.0);
+	virtual void channel_set_chorus(ChannelID p_channel, float p_chorus);
+	virtual void channel_set_reverb(ChannelID p_channel, ReverbRoomType p_room_type, float p_reverb);
+	virtual void channel_set_mix_rate(ChannelID p_channel, int p_mix_rate);
+	virtual void channel_set_positional(ChannelID p_channel, bool p_positional);
+
+	virtual float channel_get_volume(ChannelID p_channel) const;
+	virtual float channel_get_pan(ChannelID p_channel) const;
+	virtual float channel_get_pan_depth(ChannelID p_channel) const;
+	virtual float channel_get_pan_height(ChannelID p_channel) const;
+	virtual FilterType channel_get_filter_type(ChannelID p_channel) const;
+	virtual float channel_get_filter_cutoff(ChannelID p_channel) const;
+	virtual float channel_get_filter_resonance(ChannelID p_channel) const;
+	virtual float channel_get_filter_gain(ChannelID p_channel) const;
+	virtual float channel_get_chorus(ChannelID p_channel) const;
+	virtual ReverbRoomType channel_get_reverb_type(ChannelID p_channel) const;
+	virtual float channel_get_reverb(ChannelID p_channel) const;
+
+	virtual int channel_get_mix_rate(ChannelID p_channel) const;
+	virtual bool channel_is_positional(ChannelID p_channel) const;
+	virtual bool channel_is_valid(ChannelID p_channel) const;
+
+	virtual void channel_free(ChannelID p_channel);
+
+	virtual void set_mixer_volume(float p_volume);
+
+	// Reaps finished channels and routes new ones, call before mixing the software side
+	void update();
+
+	bool channel_is_hardware(ChannelID p_channel) const;
+	int get_hardware_voices_used() const;
+	uint32_t get_steal_count() const { return steal_count; }
+
+	AudioMixerHW(SampleManagerSW *p_sample_manager, AudioMixerSW *p_software, Backend *p_backend);
+};
+
+#endif // AUDIO_MIXER_HW_H
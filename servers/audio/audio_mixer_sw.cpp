@@ -925,6 +925,18 @@ void AudioMixerSW::channel_set_positional(ChannelID p_channel, bool p_positional
 	c.positional = p_positional;
 }
 
+void AudioMixerSW::channel_set_sample_offset(ChannelID p_channel, int p_frame) {
+
+	int chan = _get_channel(p_channel);
+	if (chan < 0 || chan >= MAX_CHANNELS)
+		return;
+
+	Channel &c = channels[chan];
+	ERR_FAIL_COND(sample_manager->sample_get_format(c.sample) == AudioServer::SAMPLE_FORMAT_IMA_ADPCM);
+	ERR_FAIL_INDEX(p_frame, sample_manager->sample_get_length(c.sample));
+	c.mix.offset = (int64_t)p_frame << MIX_FRAC_BITS;
+}
+
 float AudioMixerSW::channel_get_volume(ChannelID p_channel) const {
 
 	int chan = _get_channel(p_channel);
@@ -234,6 +234,7 @@ public:
 	virtual void channel_set_reverb(ChannelID p_channel, ReverbRoomType p_room_type, float p_reverb);
 	virtual void channel_set_mix_rate(ChannelID p_channel, int p_mix_rate);
 	virtual void channel_set_positional(ChannelID p_channel, bool p_positional);
+	void channel_set_sample_offset(ChannelID p_channel, int p_frame); // PCM only, resumes a channel started elsewhere
 
 	virtual float channel_get_volume(ChannelID p_channel) const;
 	virtual float channel_get_pan(ChannelID p_channel) const; //pan and depth go from -1 to 1
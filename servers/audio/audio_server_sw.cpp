@@ -97,7 +97,7 @@ void AudioServerSW::driver_process_chunk(int p_frames, int32_t *p_buffer) {
 
 				Voice *v = al->self();
 				if (v->channel != AudioMixer::INVALID_CHANNEL) {
-					mixer->channel_set_volume(v->channel, v->volume * fx_volume_scale);
+					voice_mixer->channel_set_volume(v->channel, v->volume * fx_volume_scale);
 				}
 				al = al->next();
 			}
@@ -116,15 +116,15 @@ void AudioServerSW::driver_process_chunk(int p_frames, int32_t *p_buffer) {
 			case VoiceRBSW::Command::CMD_PLAY: {
 
 				if (v->channel != AudioMixer::INVALID_CHANNEL)
-					mixer->channel_free(v->channel);
+					voice_mixer->channel_free(v->channel);
 
 				RID sample = cmd.play.sample;
 				if (!sample_manager->is_sample(sample))
 					continue;
 
-				v->channel = mixer->channel_alloc(sample);
+				v->channel = voice_mixer->channel_alloc(sample);
 				v->volume = 1.0;
-				mixer->channel_set_volume(v->channel, fx_volume_scale);
+				voice_mixer->channel_set_volume(v->channel, fx_volume_scale);
 				if (v->channel == AudioMixer::INVALID_CHANNEL) {
 #ifdef AUDIO_DEBUG
 					WARN_PRINT("AUDIO: all channels used, failed to allocate voice");
@@ -141,7 +141,7 @@ void AudioServerSW::driver_process_chunk(int p_frames, int32_t *p_buffer) {
 			case VoiceRBSW::Command::CMD_STOP: {
 
 				if (v->channel != AudioMixer::INVALID_CHANNEL) {
-					mixer->channel_free(v->channel);
+					voice_mixer->channel_free(v->channel);
 					if (v->active_item.in_list()) {
 						active_list.remove(&v->active_item);
 					}
@@ -152,43 +152,43 @@ void AudioServerSW::driver_process_chunk(int p_frames, int32_t *p_buffer) {
 
 				if (v->channel != AudioMixer::INVALID_CHANNEL) {
 					v->volume = cmd.volume.volume;
-					mixer->channel_set_volume(v->channel, cmd.volume.volume * fx_volume_scale);
+					voice_mixer->channel_set_volume(v->channel, cmd.volume.volume * fx_volume_scale);
 				}
 
 			} break;
 			case VoiceRBSW::Command::CMD_SET_PAN: {
 
 				if (v->channel != AudioMixer::INVALID_CHANNEL)
-					mixer->channel_set_pan(v->channel, cmd.pan.pan, cmd.pan.depth, cmd.pan.height);
+					voice_mixer->channel_set_pan(v->channel, cmd.pan.pan, cmd.pan.depth, cmd.pan.height);
 
 			} break;
 			case VoiceRBSW::Command::CMD_SET_FILTER: {
 
 				if (v->channel != AudioMixer::INVALID_CHANNEL)
-					mixer->channel_set_filter(v->channel, (AudioMixer::FilterType)cmd.filter.type, cmd.filter.cutoff, cmd.filter.resonance, cmd.filter.gain);
+					voice_mixer->channel_set_filter(v->channel, (AudioMixer::FilterType)cmd.filter.type, cmd.filter.cutoff, cmd.filter.resonance, cmd.filter.gain);
 			} break;
 			case VoiceRBSW::Command::CMD_SET_CHORUS: {
 
 				if (v->channel != AudioMixer::INVALID_CHANNEL)
-					mixer->channel_set_chorus(v->channel, cmd.chorus.send);
+					voice_mixer->channel_set_chorus(v->channel, cmd.chorus.send);
 
 			} break;
 			case VoiceRBSW::Command::CMD_SET_REVERB: {
 
 				if (v->channel != AudioMixer::INVALID_CHANNEL)
-					mixer->channel_set_reverb(v->channel, (AudioMixer::ReverbRoomType)cmd.reverb.room, cmd.reverb.send);
+					voice_mixer->channel_set_reverb(v->channel, (AudioMixer::ReverbRoomType)cmd.reverb.room, cmd.reverb.send);
 
 			} break;
 			case VoiceRBSW::Command::CMD_SET_MIX_RATE: {
 
 				if (v->channel != AudioMixer::INVALID_CHANNEL)
-					mixer->channel_set_mix_rate(v->channel, cmd.mix_rate.mix_rate);
+					voice_mixer->channel_set_mix_rate(v->channel, cmd.mix_rate.mix_rate);
 
 			} break;
 			case VoiceRBSW::Command::CMD_SET_POSITIONAL: {
 
 				if (v->channel != AudioMixer::INVALID_CHANNEL)
-					mixer->channel_set_positional(v->channel, cmd.positional.positional);
+					voice_mixer->channel_set_positional(v->channel, cmd.positional.positional);
 
 			} break;
 			default: {
@@ -196,6 +196,8 @@ void AudioServerSW::driver_process_chunk(int p_frames, int32_t *p_buffer) {
 		}
 	}
 
+	if (hw_mixer)
+		hw_mixer->update();
 	mixer->mix(internal_buffer, p_frames);
 	//uint64_t stepsize=mixer->get_step_usecs();
 
@@ -293,7 +295,7 @@ void AudioServerSW::driver_process_chunk(int p_frames, int32_t *p_buffer) {
 	while (activeE) {
 
 		SelfList<Voice> *activeN = activeE->next();
-		if (activeE->self()->channel == AudioMixer::INVALID_CHANNEL || !mixer->channel_is_valid(activeE->self()->channel)) {
+		if (activeE->self()->channel == AudioMixer::INVALID_CHANNEL || !voice_mixer->channel_is_valid(activeE->self()->channel)) {
 
 			active_list.remove(activeE);
 			activeE->self()->active = false;
@@ -515,7 +517,7 @@ float AudioServerSW::voice_get_volume(RID p_voice) const {
 	Voice *v = voice_owner.get(p_voice);
 	ERR_FAIL_COND_V(!v, 0);
 
-	return mixer->channel_get_volume(v->channel);
+	return voice_mixer->channel_get_volume(v->channel);
 }
 float AudioServerSW::voice_get_pan(RID p_voice) const {
 
@@ -523,7 +525,7 @@ float AudioServerSW::voice_get_pan(RID p_voice) const {
 	Voice *v = voice_owner.get(p_voice);
 	ERR_FAIL_COND_V(!v, 0);
 
-	return mixer->channel_get_pan(v->channel);
+	return voice_mixer->channel_get_pan(v->channel);
 }
 float AudioServerSW::voice_get_pan_depth(RID p_voice) const {
 
@@ -531,7 +533,7 @@ float AudioServerSW::voice_get_pan_depth(RID p_voice) const {
 	Voice *v = voice_owner.get(p_voice);
 	ERR_FAIL_COND_V(!v, 0);
 
-	return mixer->channel_get_pan_depth(v->channel);
+	return voice_mixer->channel_get_pan_depth(v->channel);
 }
 float AudioServerSW::voice_get_pan_height(RID p_voice) const {
 
@@ -539,7 +541,7 @@ float AudioServerSW::voice_get_pan_height(RID p_voice) const {
 	Voice *v = voice_owner.get(p_voice);
 	ERR_FAIL_COND_V(!v, 0);
 
-	return mixer->channel_get_pan_height(v->channel);
+	return voice_mixer->channel_get_pan_height(v->channel);
 }
 AS::FilterType AudioServerSW::voice_get_filter_type(RID p_voice) const {
 
@@ -547,7 +549,7 @@ AS::FilterType AudioServerSW::voice_get_filter_type(RID p_voice) const {
 	Voice *v = voice_owner.get(p_voice);
 	ERR_FAIL_COND_V(!v, AS::FILTER_NONE);
 
-	return (AS::FilterType)mixer->channel_get_filter_type(v->channel);
+	return (AS::FilterType)voice_mixer->channel_get_filter_type(v->channel);
 }
 float AudioServerSW::voice_get_filter_cutoff(RID p_voice) const {
 
@@ -555,7 +557,7 @@ float AudioServerSW::voice_get_filter_cutoff(RID p_voice) const {
 	Voice *v = voice_owner.get(p_voice);
 	ERR_FAIL_COND_V(!v, 0);
 
-	return mixer->channel_get_filter_cutoff(v->channel);
+	return voice_mixer->channel_get_filter_cutoff(v->channel);
 }
 float AudioServerSW::voice_get_filter_resonance(RID p_voice) const {
 
@@ -563,7 +565,7 @@ float AudioServerSW::voice_get_filter_resonance(RID p_voice) const {
 	Voice *v = voice_owner.get(p_voice);
 	ERR_FAIL_COND_V(!v, 0);
 
-	return mixer->channel_get_filter_resonance(v->channel);
+	return voice_mixer->channel_get_filter_resonance(v->channel);
 }
 float AudioServerSW::voice_get_chorus(RID p_voice) const {
 
@@ -571,7 +573,7 @@ float AudioServerSW::voice_get_chorus(RID p_voice) const {
 	Voice *v = voice_owner.get(p_voice);
 	ERR_FAIL_COND_V(!v, 0);
 
-	return mixer->channel_get_chorus(v->channel);
+	return voice_mixer->channel_get_chorus(v->channel);
 }
 AS::ReverbRoomType AudioServerSW::voice_get_reverb_type(RID p_voice) const {
 
@@ -579,7 +581,7 @@ AS::ReverbRoomType AudioServerSW::voice_get_reverb_type(RID p_voice) const {
 	Voice *v = voice_owner.get(p_voice);
 	ERR_FAIL_COND_V(!v, REVERB_SMALL);
 
-	return (AS::ReverbRoomType)mixer->channel_get_reverb_type(v->channel);
+	return (AS::ReverbRoomType)voice_mixer->channel_get_reverb_type(v->channel);
 }
 float AudioServerSW::voice_get_reverb(RID p_voice) const {
 
@@ -587,7 +589,7 @@ float AudioServerSW::voice_get_reverb(RID p_voice) const {
 	Voice *v = voice_owner.get(p_voice);
 	ERR_FAIL_COND_V(!v, 0);
 
-	return mixer->channel_get_reverb(v->channel);
+	return voice_mixer->channel_get_reverb(v->channel);
 }
 
 int AudioServerSW::voice_get_mix_rate(RID p_voice) const {
@@ -596,7 +598,7 @@ int AudioServerSW::voice_get_mix_rate(RID p_voice) const {
 	Voice *v = voice_owner.get(p_voice);
 	ERR_FAIL_COND_V(!v, 0);
 
-	return mixer->channel_get_mix_rate(v->channel);
+	return voice_mixer->channel_get_mix_rate(v->channel);
 }
 bool AudioServerSW::voice_is_positional(RID p_voice) const {
 
@@ -604,7 +606,7 @@ bool AudioServerSW::voice_is_positional(RID p_voice) const {
 	Voice *v = voice_owner.get(p_voice);
 	ERR_FAIL_COND_V(!v, 0);
 
-	return mixer->channel_is_positional(v->channel);
+	return voice_mixer->channel_is_positional(v->channel);
 }
 
 void AudioServerSW::voice_stop(RID p_voice) {
@@ -614,7 +616,7 @@ void AudioServerSW::voice_stop(RID p_voice) {
 	cmd.voice = p_voice;
 	voice_rb.push_command(cmd);
 
-	//return mixer->channel_free( v->channel );
+	//return voice_mixer->channel_free( v->channel );
 }
 
 bool AudioServerSW::voice_is_active(RID p_voice) const {
@@ -699,7 +701,7 @@ void AudioServerSW::free(RID p_id) {
 
 		Voice *v = voice_owner.get(p_id);
 		AUDIO_LOCK
-		mixer->channel_free(v->channel);
+		voice_mixer->channel_free(v->channel);
 		voice_owner.free(p_id);
 		memdelete(v);
 
@@ -757,6 +759,11 @@ void AudioServerSW::init() {
 	mixer = memnew(AudioMixerSW(sample_manager, latency, AudioDriverSW::get_singleton()->get_mix_rate(), mix_chans, mixer_use_fx, mixer_interp, _mixer_callback, this));
 	mixer_step_usecs = mixer->get_step_usecs();
 
+	// event streams keep mixing in software, they expect their channels in step with the mix
+	AudioMixerHW::Backend *voice_backend = AudioDriverSW::get_singleton()->get_voice_backend();
+	hw_mixer = voice_backend ? memnew(AudioMixerHW(sample_manager, mixer, voice_backend)) : NULL;
+	voice_mixer = hw_mixer ? (AudioMixer *)hw_mixer : mixer;
+
 	_output_delay = 0;
 
 	stream_volume = 0.3;
@@ -783,6 +790,8 @@ void AudioServerSW::finish() {
 
 	memdelete_arr(internal_buffer);
 	memdelete_arr(stream_buffer);
+	if (hw_mixer)
+		memdelete(hw_mixer);
 	memdelete(mixer);
 }
 
@@ -890,6 +899,8 @@ uint32_t AudioServerSW::read_output_peak() const {
 AudioServerSW::AudioServerSW(SampleManagerSW *p_sample_manager) {
 
 	sample_manager = p_sample_manager;
+	hw_mixer = NULL;
+	voice_mixer = NULL;
 	String interp = GLOBAL_DEF("audio/mixer_interp", "linear");
 	Globals::get_singleton()->set_custom_property_info("audio/mixer_interp", PropertyInfo(Variant::STRING, "audio/mixer_interp", PROPERTY_HINT_ENUM, "raw,linear,cubic"));
 	if (interp == "raw")
@@ -34,6 +34,7 @@
 #include "os/thread.h"
 #include "os/thread_safe.h"
 #include "self_list.h"
+#include "servers/audio/audio_mixer_hw.h"
 #include "servers/audio/audio_mixer_sw.h"
 #include "servers/audio/voice_rb_sw.h"
 #include "servers/audio_server.h"
@@ -54,6 +55,8 @@ class AudioServerSW : public AudioServer {
 
 	SampleManagerSW *sample_manager;
 	AudioMixerSW *mixer;
+	AudioMixerHW *hw_mixer;
+	AudioMixer *voice_mixer; // hw_mixer when the driver has hardware voices, else mixer
 
 	virtual AudioMixer *get_mixer();
 	virtual void audio_mixer_chunk_callback(int p_frames);
@@ -256,6 +259,9 @@ public:
 
 	virtual float get_latency() { return 0; }
 
+	// Drivers that can play samples on their own voices return them here, see AudioMixerHW
+	virtual AudioMixerHW::Backend *get_voice_backend() { return NULL; }
+
 	AudioDriverSW();
 	virtual ~AudioDriverSW(){};
 };
@@ -75,6 +75,7 @@ RID SampleManagerMallocSW::sample_create(AS::SampleFormat p_format, bool p_stere
 	s->loop_end = 0;
 	s->loop_format = AS::SAMPLE_LOOP_NONE;
 	s->mix_rate = 44100;
+	s->version = ++last_version;
 
 	AudioServer::get_singleton()->lock();
 	RID rid = sample_owner.make_rid(s);
@@ -142,6 +143,7 @@ void SampleManagerMallocSW::sample_set_data(RID p_sample, const DVector<uint8_t>
 
 		dst[i] = src[i];
 	}
+	s->version = ++last_version;
 
 	switch (s->format) {
 
@@ -202,6 +204,14 @@ void *SampleManagerMallocSW::sample_get_data_ptr(RID p_sample) const {
 	return s->data;
 }
 
+uint32_t SampleManagerMallocSW::sample_get_version(RID p_sample) const {
+
+	const Sample *s = sample_owner.get(p_sample);
+	ERR_FAIL_COND_V(!s, 0);
+
+	return s->version;
+}
+
 void SampleManagerMallocSW::sample_set_mix_rate(RID p_sample, int p_rate) {
 
 	ERR_FAIL_COND(p_rate < 1);
@@ -282,6 +292,8 @@ void SampleManagerMallocSW::free(RID p_sample) {
 }
 
 SampleManagerMallocSW::SampleManagerMallocSW() {
+
+	last_version = 0;
 }
 
 SampleManagerMallocSW::~SampleManagerMallocSW() {
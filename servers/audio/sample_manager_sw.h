@@ -50,6 +50,8 @@ public:
 	virtual const DVector<uint8_t> sample_get_data(RID p_sample) const = 0;
 
 	virtual void *sample_get_data_ptr(RID p_sample) const = 0;
+	// Changes every time the data is set, and is never reused by another sample
+	virtual uint32_t sample_get_version(RID p_sample) const = 0;
 
 	virtual void sample_set_mix_rate(RID p_sample, int p_rate) = 0;
 	virtual int sample_get_mix_rate(RID p_sample) const = 0;
@@ -82,10 +84,12 @@ class SampleManagerMallocSW : public SampleManagerSW {
 		int loop_begin;
 		int loop_end;
 		int mix_rate;
+		uint32_t version;
 		String description;
 	};
 
 	mutable RID_Owner<Sample> sample_owner;
+	uint32_t last_version;
 
 public:
 	/* SAMPLE API */
@@ -103,6 +107,7 @@ public:
 	virtual const DVector<uint8_t> sample_get_data(RID p_sample) const;
 
 	virtual void *sample_get_data_ptr(RID p_sample) const;
+	virtual uint32_t sample_get_version(RID p_sample) const;
 
 	virtual void sample_set_mix_rate(RID p_sample, int p_rate);
 	virtual int sample_get_mix_rate(RID p_sample) const;
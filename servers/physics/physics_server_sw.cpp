@@ -37,6 +37,7 @@
 #include "joints/pin_joint_sw.h"
 #include "joints/slider_joint_sw.h"
 #include "os/os.h"
+#include "os/zone_profiler.h"
 #include "script_language.h"
 
 RID PhysicsServerSW::shape_create(ShapeType p_shape) {
@@ -1388,6 +1389,8 @@ void PhysicsServerSW::step(float p_step) {
 	if (!active)
 		return;
 
+	ZONE_SCOPE("PhysicsServerSW::step");
+
 	doing_sync = false;
 
 	last_step = p_step;
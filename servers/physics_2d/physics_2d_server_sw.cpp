@@ -34,6 +34,7 @@
 #include "collision_solver_2d_sw.h"
 #include "globals.h"
 #include "os/os.h"
+#include "os/zone_profiler.h"
 #include "script_language.h"
 
 RID Physics2DServerSW::shape_create(ShapeType p_shape) {
@@ -1185,6 +1186,8 @@ void Physics2DServerSW::step(float p_step) {
 	if (!active)
 		return;
 
+	ZONE_SCOPE("Physics2DServerSW::step");
+
 	doing_sync = false;
 
 	last_step = p_step;
@@ -599,9 +599,49 @@ Rasterizer::Rasterizer() {
 
 	draw_viewport_func = NULL;
 
+	frame_fence.submitted = 0;
+	frame_fence.completed = 0;
+	frame_fence.stalls = 0;
+	frame_fence.max_in_flight = 1;
+
 	ERR_FAIL_COND(sizeof(FixedMaterialShaderKey) != 4);
 }
 
+void Rasterizer::set_max_frames_in_flight(int p_frames) {
+
+	ERR_FAIL_COND(p_frames < 1 || p_frames > MAX_FRAMES_IN_FLIGHT);
+	frame_fence.max_in_flight = p_frames;
+}
+
+void Rasterizer::frame_fence_signal(uint64_t p_serial) {
+
+	ERR_FAIL_COND(p_serial > frame_fence.submitted);
+	if (p_serial > frame_fence.completed)
+		frame_fence.completed = p_serial;
+}
+
+void Rasterizer::frame_fence_begin() {
+
+	while (frame_fence.submitted - frame_fence.completed >= (uint64_t)frame_fence.max_in_flight) {
+
+		uint64_t serial = frame_fence.completed + 1;
+		frame_fence.stalls++;
+		_frame_fence_wait(serial);
+		// A backend that doesn't signal would spin here forever
+		ERR_FAIL_COND(frame_fence.completed < serial);
+	}
+}
+
+uint64_t Rasterizer::frame_fence_submit() {
+
+	return ++frame_fence.submitted;
+}
+
+void Rasterizer::_frame_fence_wait(uint64_t p_serial) {
+
+	frame_fence_signal(p_serial);
+}
+
 RID Rasterizer::create_overdraw_debug_material() {
 	RID mat = fixed_material_create();
 	fixed_material_set_parameter(mat, VisualServer::FIXED_MATERIAL_PARAM_SPECULAR, Color(0, 0, 0));
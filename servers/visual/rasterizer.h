@@ -43,6 +43,21 @@ class Rasterizer {
 protected:
 	typedef void (*CanvasItemDrawViewportFunc)(VisualServer *owner, void *ud, const Rect2 &p_rect);
 
+	struct FrameFence {
+		uint64_t submitted;
+		uint64_t completed;
+		uint64_t stalls;
+		int max_in_flight;
+	} frame_fence;
+
+	// begin_frame calls this to wait for room, end_frame calls submit once
+	// the frame went to the GPU and gets its serial back
+	void frame_fence_begin();
+	uint64_t frame_fence_submit();
+	// Block until p_serial is done and signal it. Backends that complete
+	// every frame before returning from end_frame can keep the default.
+	virtual void _frame_fence_wait(uint64_t p_serial);
+
 	RID create_default_material();
 	RID create_overdraw_debug_material();
 
@@ -484,6 +499,7 @@ public:
 	virtual void begin_frame() = 0;
 
 	virtual void set_viewport(const VS::ViewportRect &p_viewport) = 0;
+	virtual void set_screen(int p_screen) {} ///< following viewports draw to this screen, skipped screens keep their image
 	virtual void set_render_target(RID p_render_target, bool p_transparent_bg = false, bool p_vflip = false) = 0;
 	virtual void clear_viewport(const Color &p_color) = 0;
 	virtual void capture_viewport(Image *r_capture) = 0;
@@ -493,6 +509,16 @@ public:
 
 	virtual void set_camera(const Transform &p_world, const CameraMatrix &p_projection, bool p_ortho_hint) = 0;
 
+	/* STEREO */
+
+	// Distance between the eyes for the scene about to be drawn, zero when
+	// the current target shows a single image. When non zero, the scene is
+	// culled once and set_stereo_camera() gives the per eye projections,
+	// the rasterizer then draws the same list for both eyes.
+	virtual float get_stereo_eye_separation() const { return 0; }
+	virtual float get_stereo_convergence() const { return 1; }
+	virtual void set_stereo_camera(const CameraMatrix &p_left_projection, const CameraMatrix &p_right_projection) {}
+
 	virtual void add_light(RID p_light_instance) = 0; ///< all "add_light" calls happen before add_geometry calls
 
 	typedef Map<StringName, Variant> ParamOverrideMap;
@@ -1058,6 +1084,30 @@ public:
 	virtual bool needs_to_draw_next_frame() const = 0;
 
 	virtual void reload_vram() {}
+	// The app is going to the background: let the GPU finish and, if
+	// allowed, release what can be restored later on first use.
+	virtual void suspend(bool p_release_vram) {}
+
+	/* FRAME FENCE API */
+
+	// Every frame handed to the GPU gets a serial. A backend whose GPU runs
+	// behind the CPU signals serials as they complete, and begin_frame waits
+	// while max_frames_in_flight of them are outstanding: one keeps CPU and
+	// GPU in lockstep, two lets the next frame be prepared meanwhile.
+	enum {
+		MAX_FRAMES_IN_FLIGHT = 2
+	};
+
+	void set_max_frames_in_flight(int p_frames);
+	int get_max_frames_in_flight() const { return frame_fence.max_in_flight; }
+	int get_frames_in_flight() const { return frame_fence.submitted - frame_fence.completed; }
+
+	uint64_t get_frame_fence_submitted() const { return frame_fence.submitted; }
+	uint64_t get_frame_fence_completed() const { return frame_fence.completed; }
+	bool frame_fence_is_complete(uint64_t p_serial) const { return p_serial <= frame_fence.completed; }
+	uint64_t get_frame_fence_stall_count() const { return frame_fence.stalls; }
+
+	void frame_fence_signal(uint64_t p_serial);
 
 	virtual bool has_feature(VS::Features p_feature) const = 0;
 
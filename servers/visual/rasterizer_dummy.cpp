@@ -1322,6 +1322,8 @@ bool RasterizerDummy::render_target_renedered_in_frame(RID p_render_target) {
 }
 
 void RasterizerDummy::begin_frame() {
+
+	frame_fence_begin();
 }
 
 void RasterizerDummy::capture_viewport(Image *r_capture) {
@@ -1365,6 +1367,8 @@ void RasterizerDummy::end_shadow_map() {
 }
 
 void RasterizerDummy::end_frame() {
+
+	frame_fence_submit();
 }
 
 RID RasterizerDummy::canvas_light_occluder_create() {
@@ -32,12 +32,19 @@
 #include "globals.h"
 #include "io/marshalls.h"
 #include "os/os.h"
+#include "os/zone_profiler.h"
 #include "sort.h"
 // careful, these may run in different threads than the visual server
 
 BalloonAllocator<> *VisualServerRaster::OctreeAllocator::allocator = NULL;
 
+// Any screen may show the change, unless it is attributed with one of the
+// _*_mark_screens() helpers and VS_CHANGED_LOCAL
 #define VS_CHANGED \
+	changes++;     \
+	_screens_mark_dirty();
+
+#define VS_CHANGED_LOCAL \
 	changes++;
 
 //	print_line(__FUNCTION__);
@@ -1363,9 +1370,10 @@ void VisualServerRaster::camera_set_perspective(RID p_camera, float p_fovy_degre
 }
 
 void VisualServerRaster::camera_set_orthogonal(RID p_camera, float p_size, float p_z_near, float p_z_far) {
-	VS_CHANGED;
+	VS_CHANGED_LOCAL;
 	Camera *camera = camera_owner.get(p_camera);
 	ERR_FAIL_COND(!camera);
+	_camera_mark_screens(p_camera);
 	camera->type = Camera::ORTHOGONAL;
 	camera->size = p_size;
 	camera->znear = p_z_near;
@@ -1373,17 +1381,19 @@ void VisualServerRaster::camera_set_orthogonal(RID p_camera, float p_size, float
 }
 
 void VisualServerRaster::camera_set_transform(RID p_camera, const Transform &p_transform) {
-	VS_CHANGED;
+	VS_CHANGED_LOCAL;
 	Camera *camera = camera_owner.get(p_camera);
 	ERR_FAIL_COND(!camera);
+	_camera_mark_screens(p_camera);
 	camera->transform = p_transform.orthonormalized();
 }
 
 void VisualServerRaster::camera_set_visible_layers(RID p_camera, uint32_t p_layers) {
 
-	VS_CHANGED;
+	VS_CHANGED_LOCAL;
 	Camera *camera = camera_owner.get(p_camera);
 	ERR_FAIL_COND(!camera);
+	_camera_mark_screens(p_camera);
 
 	camera->visible_layers = p_layers;
 }
@@ -1441,28 +1451,158 @@ RID VisualServerRaster::viewport_create() {
 
 void VisualServerRaster::viewport_attach_to_screen(RID p_viewport, int p_screen) {
 
-	VS_CHANGED;
+	VS_CHANGED_LOCAL;
 	Viewport *viewport = viewport_owner.get(p_viewport);
 	ERR_FAIL_COND(!viewport);
 
 	screen_viewports[p_viewport] = p_screen;
+	_viewport_mark_screens(p_viewport);
 }
 
 void VisualServerRaster::viewport_detach(RID p_viewport) {
 
-	VS_CHANGED;
+	VS_CHANGED_LOCAL;
 	Viewport *viewport = viewport_owner.get(p_viewport);
 	ERR_FAIL_COND(!viewport);
+	_viewport_mark_screens(p_viewport);
 
 	ERR_FAIL_COND(!screen_viewports.has(p_viewport));
 	screen_viewports.erase(p_viewport);
 }
 
+void VisualServerRaster::screen_set_update_mode(int p_screen, ScreenUpdateMode p_mode) {
+
+	ERR_FAIL_COND(p_screen < 0);
+
+	if (p_mode == SCREEN_UPDATE_ALWAYS) {
+		screens.erase(p_screen);
+		return;
+	}
+
+	Screen &screen = screens[p_screen];
+	screen.update_mode = p_mode;
+	screen.dirty = true;
+}
+
+VisualServer::ScreenUpdateMode VisualServerRaster::screen_get_update_mode(int p_screen) const {
+
+	const Map<int, Screen>::Element *E = screens.find(p_screen);
+	return E ? E->get().update_mode : SCREEN_UPDATE_ALWAYS;
+}
+
+bool VisualServerRaster::_screen_needs_draw(int p_screen) const {
+
+	const Map<int, Screen>::Element *E = screens.find(p_screen);
+	return !E || E->get().dirty;
+}
+
+void VisualServerRaster::_screen_mark_dirty(int p_screen) {
+
+	Map<int, Screen>::Element *E = screens.find(p_screen);
+	if (E)
+		E->get().dirty = true;
+}
+
+void VisualServerRaster::_screens_mark_dirty() {
+
+	for (Map<int, Screen>::Element *E = screens.front(); E; E = E->next())
+		E->get().dirty = true;
+}
+
+void VisualServerRaster::_viewport_mark_screens(RID p_viewport) {
+
+	if (screens.empty())
+		return;
+
+	Map<RID, int>::Element *E = screen_viewports.find(p_viewport);
+	if (E)
+		_screen_mark_dirty(E->get());
+	else
+		_screens_mark_dirty(); // render targets may be shown on any screen
+}
+
+void VisualServerRaster::_canvas_mark_screens(Canvas *p_canvas) {
+
+	if (screens.empty())
+		return;
+
+	for (Set<RID>::Element *E = p_canvas->viewports.front(); E; E = E->next())
+		_viewport_mark_screens(E->get());
+}
+
+void VisualServerRaster::_canvas_item_mark_screens(CanvasItem *p_canvas_item) {
+
+	if (screens.empty())
+		return;
+
+	// walk up to the canvas, items outside of one are not visible anywhere
+	CanvasItem *item = p_canvas_item;
+	while (item->parent.is_valid()) {
+
+		if (canvas_owner.owns(item->parent)) {
+			_canvas_mark_screens(canvas_owner.get(item->parent));
+			return;
+		}
+		if (!canvas_item_owner.owns(item->parent))
+			return;
+		item = canvas_item_owner.get(item->parent);
+	}
+}
+
+void VisualServerRaster::_scenario_mark_screens(Scenario *p_scenario) {
+
+	if (screens.empty() || !p_scenario)
+		return;
+
+	for (SelfList<Viewport> *E = viewport_update_list.first(); E; E = E->next()) {
+
+		if (E->self()->scenario == p_scenario->self) {
+			_screens_mark_dirty();
+			return;
+		}
+	}
+
+	for (Map<RID, int>::Element *E = screen_viewports.front(); E; E = E->next()) {
+
+		Viewport *vp = viewport_owner.get(E->key());
+		if (vp && vp->scenario == p_scenario->self)
+			_screen_mark_dirty(E->get());
+	}
+}
+
+void VisualServerRaster::_camera_mark_screens(RID p_camera) {
+
+	if (screens.empty())
+		return;
+
+	for (SelfList<Viewport> *E = viewport_update_list.first(); E; E = E->next()) {
+
+		if (E->self()->camera == p_camera) {
+			_screens_mark_dirty();
+			return;
+		}
+	}
+
+	for (Map<RID, int>::Element *E = screen_viewports.front(); E; E = E->next()) {
+
+		Viewport *vp = viewport_owner.get(E->key());
+		if (vp && vp->camera == p_camera)
+			_screen_mark_dirty(E->get());
+	}
+}
+
+void VisualServerRaster::_set_screen(int p_screen) {
+
+	rasterizer->set_screen(p_screen);
+	viewport_rect = ViewportRect(); // force the viewport to be set again
+}
+
 void VisualServerRaster::viewport_set_as_render_target(RID p_viewport, bool p_enable) {
 
-	VS_CHANGED;
+	VS_CHANGED_LOCAL;
 	Viewport *viewport = viewport_owner.get(p_viewport);
 	ERR_FAIL_COND(!viewport);
+	_viewport_mark_screens(p_viewport);
 
 	if (viewport->render_target.is_valid() == p_enable)
 		return;
@@ -1486,9 +1626,10 @@ void VisualServerRaster::viewport_set_as_render_target(RID p_viewport, bool p_en
 
 void VisualServerRaster::viewport_set_render_target_update_mode(RID p_viewport, RenderTargetUpdateMode p_mode) {
 
-	VS_CHANGED;
+	VS_CHANGED_LOCAL;
 	Viewport *viewport = viewport_owner.get(p_viewport);
 	ERR_FAIL_COND(!viewport);
+	_viewport_mark_screens(p_viewport);
 
 	if (viewport->render_target.is_valid() && viewport->update_list.in_list())
 		viewport_update_list.remove(&viewport->update_list);
@@ -1563,9 +1704,10 @@ void VisualServerRaster::viewport_render_target_clear(RID p_viewport) {
 
 void VisualServerRaster::viewport_queue_screen_capture(RID p_viewport) {
 
-	VS_CHANGED;
+	VS_CHANGED_LOCAL;
 	Viewport *viewport = viewport_owner.get(p_viewport);
 	ERR_FAIL_COND(!viewport);
+	_viewport_mark_screens(p_viewport);
 	viewport->queue_capture = true;
 }
 
@@ -1580,12 +1722,13 @@ Image VisualServerRaster::viewport_get_screen_capture(RID p_viewport) const {
 }
 
 void VisualServerRaster::viewport_set_rect(RID p_viewport, const ViewportRect &p_rect) {
-	VS_CHANGED;
+	VS_CHANGED_LOCAL;
 	Viewport *viewport = NULL;
 
 	viewport = viewport_owner.get(p_viewport);
 
 	ERR_FAIL_COND(!viewport);
+	_viewport_mark_screens(p_viewport);
 
 	viewport->rect = p_rect;
 	if (viewport->render_target.is_valid()) {
@@ -1605,44 +1748,48 @@ VisualServer::ViewportRect VisualServerRaster::viewport_get_rect(RID p_viewport)
 
 void VisualServerRaster::viewport_set_hide_scenario(RID p_viewport, bool p_hide) {
 
-	VS_CHANGED;
+	VS_CHANGED_LOCAL;
 
 	Viewport *viewport = NULL;
 
 	viewport = viewport_owner.get(p_viewport);
 	ERR_FAIL_COND(!viewport);
+	_viewport_mark_screens(p_viewport);
 
 	viewport->hide_scenario = p_hide;
 }
 
 void VisualServerRaster::viewport_set_hide_canvas(RID p_viewport, bool p_hide) {
 
-	VS_CHANGED;
+	VS_CHANGED_LOCAL;
 
 	Viewport *viewport = NULL;
 
 	viewport = viewport_owner.get(p_viewport);
 	ERR_FAIL_COND(!viewport);
+	_viewport_mark_screens(p_viewport);
 
 	viewport->hide_canvas = p_hide;
 }
 
 void VisualServerRaster::viewport_set_disable_environment(RID p_viewport, bool p_disable) {
 
-	VS_CHANGED;
+	VS_CHANGED_LOCAL;
 
 	Viewport *viewport = NULL;
 	viewport = viewport_owner.get(p_viewport);
 	ERR_FAIL_COND(!viewport);
+	_viewport_mark_screens(p_viewport);
 	viewport->disable_environment = p_disable;
 }
 
 void VisualServerRaster::viewport_attach_camera(RID p_viewport, RID p_camera) {
-	VS_CHANGED;
+	VS_CHANGED_LOCAL;
 
 	Viewport *viewport = NULL;
 	viewport = viewport_owner.get(p_viewport);
 	ERR_FAIL_COND(!viewport);
+	_viewport_mark_screens(p_viewport);
 
 	if (p_camera.is_valid()) {
 
@@ -1656,11 +1803,12 @@ void VisualServerRaster::viewport_attach_camera(RID p_viewport, RID p_camera) {
 
 void VisualServerRaster::viewport_set_scenario(RID p_viewport, RID p_scenario) {
 
-	VS_CHANGED;
+	VS_CHANGED_LOCAL;
 
 	Viewport *viewport = NULL;
 	viewport = viewport_owner.get(p_viewport);
 	ERR_FAIL_COND(!viewport);
+	_viewport_mark_screens(p_viewport);
 
 	if (p_scenario.is_valid()) {
 
@@ -1683,11 +1831,12 @@ RID VisualServerRaster::viewport_get_attached_camera(RID p_viewport) const {
 }
 
 void VisualServerRaster::viewport_attach_canvas(RID p_viewport, RID p_canvas) {
-	VS_CHANGED;
+	VS_CHANGED_LOCAL;
 	Viewport *viewport = NULL;
 
 	viewport = viewport_owner.get(p_viewport);
 	ERR_FAIL_COND(!viewport);
+	_viewport_mark_screens(p_viewport);
 
 	Canvas *canvas = canvas_owner.get(p_canvas);
 	ERR_FAIL_COND(!canvas);
@@ -1705,10 +1854,11 @@ void VisualServerRaster::viewport_attach_canvas(RID p_viewport, RID p_canvas) {
 
 void VisualServerRaster::viewport_set_canvas_transform(RID p_viewport, RID p_canvas, const Matrix32 &p_transform) {
 
-	VS_CHANGED;
+	VS_CHANGED_LOCAL;
 	Viewport *viewport = NULL;
 	viewport = viewport_owner.get(p_viewport);
 	ERR_FAIL_COND(!viewport);
+	_viewport_mark_screens(p_viewport);
 
 	Map<RID, Viewport::CanvasData>::Element *E = viewport->canvas_map.find(p_canvas);
 	if (!E) {
@@ -1754,11 +1904,12 @@ Matrix32 VisualServerRaster::viewport_get_global_canvas_transform(RID p_viewport
 
 void VisualServerRaster::viewport_remove_canvas(RID p_viewport, RID p_canvas) {
 
-	VS_CHANGED;
+	VS_CHANGED_LOCAL;
 	Viewport *viewport = NULL;
 
 	viewport = viewport_owner.get(p_viewport);
 	ERR_FAIL_COND(!viewport);
+	_viewport_mark_screens(p_viewport);
 
 	Canvas *canvas = canvas_owner.get(p_canvas);
 	ERR_FAIL_COND(!canvas);
@@ -1775,11 +1926,12 @@ void VisualServerRaster::viewport_remove_canvas(RID p_viewport, RID p_canvas) {
 
 void VisualServerRaster::viewport_set_canvas_layer(RID p_viewport, RID p_canvas, int p_layer) {
 
-	VS_CHANGED;
+	VS_CHANGED_LOCAL;
 	Viewport *viewport = NULL;
 
 	viewport = viewport_owner.get(p_viewport);
 	ERR_FAIL_COND(!viewport);
+	_viewport_mark_screens(p_viewport);
 
 	Map<RID, Viewport::CanvasData>::Element *E = viewport->canvas_map.find(p_canvas);
 	if (!E) {
@@ -1792,9 +1944,10 @@ void VisualServerRaster::viewport_set_canvas_layer(RID p_viewport, RID p_canvas,
 
 void VisualServerRaster::viewport_set_transparent_background(RID p_viewport, bool p_enabled) {
 
-	VS_CHANGED;
+	VS_CHANGED_LOCAL;
 	Viewport *viewport = viewport_owner.get(p_viewport);
 	ERR_FAIL_COND(!viewport);
+	_viewport_mark_screens(p_viewport);
 
 	viewport->transparent_bg = p_enabled;
 }
@@ -1905,28 +2058,31 @@ RID VisualServerRaster::scenario_create() {
 }
 
 void VisualServerRaster::scenario_set_debug(RID p_scenario, ScenarioDebugMode p_debug_mode) {
-	VS_CHANGED;
+	VS_CHANGED_LOCAL;
 
 	Scenario *scenario = scenario_owner.get(p_scenario);
 	ERR_FAIL_COND(!scenario);
+	_scenario_mark_screens(scenario);
 	scenario->debug = p_debug_mode;
 }
 
 void VisualServerRaster::scenario_set_environment(RID p_scenario, RID p_environment) {
 
-	VS_CHANGED;
+	VS_CHANGED_LOCAL;
 
 	Scenario *scenario = scenario_owner.get(p_scenario);
 	ERR_FAIL_COND(!scenario);
+	_scenario_mark_screens(scenario);
 	scenario->environment = p_environment;
 }
 
 void VisualServerRaster::scenario_set_fallback_environment(RID p_scenario, RID p_environment) {
 
-	VS_CHANGED;
+	VS_CHANGED_LOCAL;
 
 	Scenario *scenario = scenario_owner.get(p_scenario);
 	ERR_FAIL_COND(!scenario);
+	_scenario_mark_screens(scenario);
 	scenario->fallback_environment = p_environment;
 }
 
@@ -1954,9 +2110,10 @@ RID VisualServerRaster::instance_create() {
 
 void VisualServerRaster::instance_set_base(RID p_instance, RID p_base) {
 
-	VS_CHANGED;
+	VS_CHANGED_LOCAL;
 	Instance *instance = instance_owner.get(p_instance);
 	ERR_FAIL_COND(!instance);
+	_scenario_mark_screens(instance->scenario);
 
 	if (instance->base_type != INSTANCE_NONE) {
 		//free anything related to that base
@@ -2157,10 +2314,11 @@ RID VisualServerRaster::instance_get_base(RID p_instance) const {
 
 void VisualServerRaster::instance_set_scenario(RID p_instance, RID p_scenario) {
 
-	VS_CHANGED;
+	VS_CHANGED_LOCAL;
 
 	Instance *instance = instance_owner.get(p_instance);
 	ERR_FAIL_COND(!instance);
+	_scenario_mark_screens(instance->scenario);
 
 	if (instance->scenario) {
 
@@ -2202,6 +2360,7 @@ void VisualServerRaster::instance_set_scenario(RID p_instance, RID p_scenario) {
 
 		instance_dependency_map[p_scenario].insert(instance->self);
 		instance->scenario = scenario;
+		_scenario_mark_screens(scenario);
 
 		if (instance->base_type == INSTANCE_LIGHT && rasterizer->light_get_type(instance->base_rid) == LIGHT_DIRECTIONAL) {
 
@@ -2223,10 +2382,11 @@ RID VisualServerRaster::instance_get_scenario(RID p_instance) const {
 
 void VisualServerRaster::instance_set_layer_mask(RID p_instance, uint32_t p_mask) {
 
-	VS_CHANGED;
+	VS_CHANGED_LOCAL;
 
 	Instance *instance = instance_owner.get(p_instance);
 	ERR_FAIL_COND(!instance);
+	_scenario_mark_screens(instance->scenario);
 
 	instance->layer_mask = p_mask;
 }
@@ -2261,9 +2421,10 @@ uint32_t VisualServerRaster::instance_get_object_instance_ID(RID p_instance) con
 }
 
 void VisualServerRaster::instance_attach_skeleton(RID p_instance, RID p_skeleton) {
-	VS_CHANGED;
+	VS_CHANGED_LOCAL;
 	Instance *instance = instance_owner.get(p_instance);
 	ERR_FAIL_COND(!instance);
+	_scenario_mark_screens(instance->scenario);
 
 	if (instance->data.skeleton.is_valid()) {
 		skeleton_dependency_map[instance->data.skeleton].erase(instance);
@@ -2285,9 +2446,10 @@ RID VisualServerRaster::instance_get_skeleton(RID p_instance) const {
 
 void VisualServerRaster::instance_set_morph_target_weight(RID p_instance, int p_shape, float p_weight) {
 
-	VS_CHANGED;
+	VS_CHANGED_LOCAL;
 	Instance *instance = instance_owner.get(p_instance);
 	ERR_FAIL_COND(!instance);
+	_scenario_mark_screens(instance->scenario);
 	ERR_FAIL_INDEX(p_shape, instance->data.morph_values.size());
 	instance->data.morph_values[p_shape] = p_weight;
 }
@@ -2302,17 +2464,19 @@ float VisualServerRaster::instance_get_morph_target_weight(RID p_instance, int p
 
 void VisualServerRaster::instance_set_surface_material(RID p_instance, int p_surface, RID p_material) {
 
-	VS_CHANGED;
+	VS_CHANGED_LOCAL;
 	Instance *instance = instance_owner.get(p_instance);
 	ERR_FAIL_COND(!instance);
+	_scenario_mark_screens(instance->scenario);
 	ERR_FAIL_INDEX(p_surface, instance->data.materials.size());
 	instance->data.materials[p_surface] = p_material;
 }
 
 void VisualServerRaster::instance_set_transform(RID p_instance, const Transform &p_transform) {
-	VS_CHANGED;
+	VS_CHANGED_LOCAL;
 	Instance *instance = instance_owner.get(p_instance);
 	ERR_FAIL_COND(!instance);
+	_scenario_mark_screens(instance->scenario);
 
 	if (p_transform == instance->data.transform) // must improve somehow
 		return;
@@ -2332,9 +2496,10 @@ Transform VisualServerRaster::instance_get_transform(RID p_instance) const {
 }
 
 void VisualServerRaster::instance_set_exterior(RID p_instance, bool p_enabled) {
-	VS_CHANGED;
+	VS_CHANGED_LOCAL;
 	Instance *instance = instance_owner.get(p_instance);
 	ERR_FAIL_COND(!instance);
+	_scenario_mark_screens(instance->scenario);
 
 	ERR_EXPLAIN("Portals can't be assigned to be exterior");
 
@@ -2354,10 +2519,11 @@ bool VisualServerRaster::instance_is_exterior(RID p_instance) const {
 }
 
 void VisualServerRaster::instance_set_room(RID p_instance, RID p_room) {
-	VS_CHANGED;
+	VS_CHANGED_LOCAL;
 
 	Instance *instance = instance_owner.get(p_instance);
 	ERR_FAIL_COND(!instance);
+	_scenario_mark_screens(instance->scenario);
 
 	if (instance->room && instance->RE) {
 
@@ -2467,10 +2633,11 @@ RID VisualServerRaster::instance_get_room(RID p_instance) const {
 
 void VisualServerRaster::instance_set_extra_visibility_margin(RID p_instance, real_t p_margin) {
 
-	VS_CHANGED;
+	VS_CHANGED_LOCAL;
 
 	Instance *instance = instance_owner.get(p_instance);
 	ERR_FAIL_COND(!instance);
+	_scenario_mark_screens(instance->scenario);
 
 	instance->extra_margin = p_margin;
 }
@@ -2663,9 +2830,10 @@ VS::ShadowCastingSetting VisualServerRaster::instance_geometry_get_cast_shadows_
 
 void VisualServerRaster::instance_geometry_set_material_override(RID p_instance, RID p_material) {
 
-	VS_CHANGED;
+	VS_CHANGED_LOCAL;
 	Instance *instance = instance_owner.get(p_instance);
 	ERR_FAIL_COND(!instance);
+	_scenario_mark_screens(instance->scenario);
 	instance->data.material_override = p_material;
 }
 
@@ -2678,9 +2846,10 @@ RID VisualServerRaster::instance_geometry_get_material_override(RID p_instance)
 
 void VisualServerRaster::instance_geometry_set_draw_range(RID p_instance, float p_min, float p_max) {
 
-	VS_CHANGED;
+	VS_CHANGED_LOCAL;
 	Instance *instance = instance_owner.get(p_instance);
 	ERR_FAIL_COND(!instance);
+	_scenario_mark_screens(instance->scenario);
 
 	instance->draw_range_begin = p_min;
 	instance->draw_range_end = p_max;
@@ -2704,9 +2873,10 @@ float VisualServerRaster::instance_geometry_get_draw_range_max(RID p_instance) c
 
 void VisualServerRaster::instance_geometry_set_baked_light(RID p_instance, RID p_baked_light) {
 
-	VS_CHANGED;
+	VS_CHANGED_LOCAL;
 	Instance *instance = instance_owner.get(p_instance);
 	ERR_FAIL_COND(!instance);
+	_scenario_mark_screens(instance->scenario);
 
 	if (instance->baked_light) {
 
@@ -2740,9 +2910,10 @@ RID VisualServerRaster::instance_geometry_get_baked_light(RID p_instance) const
 
 void VisualServerRaster::instance_geometry_set_baked_light_sampler(RID p_instance, RID p_baked_light_sampler) {
 
-	VS_CHANGED;
+	VS_CHANGED_LOCAL;
 	Instance *instance = instance_owner.get(p_instance);
 	ERR_FAIL_COND(!instance);
+	_scenario_mark_screens(instance->scenario);
 
 	if (instance->sampled_light) {
 		instance->sampled_light->baked_light_sampler_info->owned_instances.erase(instance);
@@ -2775,9 +2946,10 @@ RID VisualServerRaster::instance_geometry_get_baked_light_sampler(RID p_instance
 
 void VisualServerRaster::instance_geometry_set_baked_light_texture_index(RID p_instance, int p_tex_id) {
 
-	VS_CHANGED;
+	VS_CHANGED_LOCAL;
 	Instance *instance = instance_owner.get(p_instance);
 	ERR_FAIL_COND(!instance);
+	_scenario_mark_screens(instance->scenario);
 
 	instance->data.baked_lightmap_id = p_tex_id;
 }
@@ -3055,9 +3227,10 @@ void VisualServerRaster::_update_instances() {
 
 void VisualServerRaster::instance_light_set_enabled(RID p_instance, bool p_enabled) {
 
-	VS_CHANGED;
+	VS_CHANGED_LOCAL;
 	Instance *instance = instance_owner.get(p_instance);
 	ERR_FAIL_COND(!instance);
+	_scenario_mark_screens(instance->scenario);
 	ERR_FAIL_COND(instance->base_type != INSTANCE_LIGHT);
 
 	if (p_enabled == instance->light_info->enabled)
@@ -3099,6 +3272,7 @@ void VisualServerRaster::canvas_set_item_mirroring(RID p_canvas, RID p_item, con
 	int idx = canvas->find_item(canvas_item);
 	ERR_FAIL_COND(idx == -1);
 	canvas->child_items[idx].mirror = p_mirroring;
+	_canvas_mark_screens(canvas);
 }
 
 Point2 VisualServerRaster::canvas_get_item_mirroring(RID p_canvas, RID p_item) const {
@@ -3118,6 +3292,7 @@ void VisualServerRaster::canvas_set_modulate(RID p_canvas, const Color &p_color)
 	Canvas *canvas = canvas_owner.get(p_canvas);
 	ERR_FAIL_COND(!canvas);
 	canvas->modulate = p_color;
+	_canvas_mark_screens(canvas);
 }
 
 RID VisualServerRaster::canvas_item_create() {
@@ -3130,9 +3305,10 @@ RID VisualServerRaster::canvas_item_create() {
 
 void VisualServerRaster::canvas_item_set_parent(RID p_item, RID p_parent) {
 
-	VS_CHANGED;
+	VS_CHANGED_LOCAL;
 	CanvasItem *canvas_item = canvas_item_owner.get(p_item);
 	ERR_FAIL_COND(!canvas_item);
+	_canvas_item_mark_screens(canvas_item);
 
 	if (canvas_item->parent.is_valid()) {
 
@@ -3169,6 +3345,7 @@ void VisualServerRaster::canvas_item_set_parent(RID p_item, RID p_parent) {
 	}
 
 	canvas_item->parent = p_parent;
+	_canvas_item_mark_screens(canvas_item);
 }
 
 RID VisualServerRaster::canvas_item_get_parent(RID p_canvas_item) const {
@@ -3181,10 +3358,11 @@ RID VisualServerRaster::canvas_item_get_parent(RID p_canvas_item) const {
 
 void VisualServerRaster::canvas_item_set_visible(RID p_item, bool p_visible) {
 
-	VS_CHANGED;
+	VS_CHANGED_LOCAL;
 
 	CanvasItem *canvas_item = canvas_item_owner.get(p_item);
 	ERR_FAIL_COND(!canvas_item);
+	_canvas_item_mark_screens(canvas_item);
 
 	canvas_item->visible = p_visible;
 }
@@ -3199,28 +3377,30 @@ bool VisualServerRaster::canvas_item_is_visible(RID p_item) const {
 
 void VisualServerRaster::canvas_item_set_light_mask(RID p_canvas_item, int p_mask) {
 
-	VS_CHANGED;
+	VS_CHANGED_LOCAL;
 
 	CanvasItem *canvas_item = canvas_item_owner.get(p_canvas_item);
 	ERR_FAIL_COND(!canvas_item);
+	_canvas_item_mark_screens(canvas_item);
 
 	if (canvas_item->light_mask == p_mask)
 		return;
-	VS_CHANGED;
+	VS_CHANGED_LOCAL;
 
 	canvas_item->light_mask = p_mask;
 }
 
 void VisualServerRaster::canvas_item_set_blend_mode(RID p_canvas_item, MaterialBlendMode p_blend) {
 
-	VS_CHANGED;
+	VS_CHANGED_LOCAL;
 
 	CanvasItem *canvas_item = canvas_item_owner.get(p_canvas_item);
 	ERR_FAIL_COND(!canvas_item);
+	_canvas_item_mark_screens(canvas_item);
 
 	if (canvas_item->blend_mode == p_blend)
 		return;
-	VS_CHANGED;
+	VS_CHANGED_LOCAL;
 
 	canvas_item->blend_mode = p_blend;
 }
@@ -3229,50 +3409,56 @@ void VisualServerRaster::canvas_item_attach_viewport(RID p_canvas_item, RID p_vi
 
 	CanvasItem *canvas_item = canvas_item_owner.get(p_canvas_item);
 	ERR_FAIL_COND(!canvas_item);
+	_canvas_item_mark_screens(canvas_item);
 
-	VS_CHANGED;
+	VS_CHANGED_LOCAL;
 
 	canvas_item->viewport = p_viewport;
 }
 
 /*
 void VisualServerRaster::canvas_item_set_rect(RID p_item, const Rect2& p_rect) {
-	VS_CHANGED;
+	VS_CHANGED_LOCAL;
 	CanvasItem *canvas_item = canvas_item_owner.get( p_item );
 	ERR_FAIL_COND(!canvas_item);
+	_canvas_item_mark_screens(canvas_item);
 
 	canvas_item->rect=p_rect;
 }*/
 
 void VisualServerRaster::canvas_item_set_clip(RID p_item, bool p_clip) {
-	VS_CHANGED;
+	VS_CHANGED_LOCAL;
 	CanvasItem *canvas_item = canvas_item_owner.get(p_item);
 	ERR_FAIL_COND(!canvas_item);
+	_canvas_item_mark_screens(canvas_item);
 
 	canvas_item->clip = p_clip;
 }
 
 void VisualServerRaster::canvas_item_set_distance_field_mode(RID p_item, bool p_distance_field) {
-	VS_CHANGED;
+	VS_CHANGED_LOCAL;
 	CanvasItem *canvas_item = canvas_item_owner.get(p_item);
 	ERR_FAIL_COND(!canvas_item);
+	_canvas_item_mark_screens(canvas_item);
 
 	canvas_item->distance_field = p_distance_field;
 }
 
 void VisualServerRaster::canvas_item_set_transform(RID p_item, const Matrix32 &p_transform) {
 
-	VS_CHANGED;
+	VS_CHANGED_LOCAL;
 	CanvasItem *canvas_item = canvas_item_owner.get(p_item);
 	ERR_FAIL_COND(!canvas_item);
+	_canvas_item_mark_screens(canvas_item);
 
 	canvas_item->xform = p_transform;
 }
 
 void VisualServerRaster::canvas_item_set_custom_rect(RID p_item, bool p_custom_rect, const Rect2 &p_rect) {
-	VS_CHANGED;
+	VS_CHANGED_LOCAL;
 	CanvasItem *canvas_item = canvas_item_owner.get(p_item);
 	ERR_FAIL_COND(!canvas_item);
+	_canvas_item_mark_screens(canvas_item);
 
 	canvas_item->custom_rect = p_custom_rect;
 	if (p_custom_rect)
@@ -3280,9 +3466,10 @@ void VisualServerRaster::canvas_item_set_custom_rect(RID p_item, bool p_custom_r
 }
 
 void VisualServerRaster::canvas_item_set_opacity(RID p_item, float p_opacity) {
-	VS_CHANGED;
+	VS_CHANGED_LOCAL;
 	CanvasItem *canvas_item = canvas_item_owner.get(p_item);
 	ERR_FAIL_COND(!canvas_item);
+	_canvas_item_mark_screens(canvas_item);
 	canvas_item->opacity = p_opacity;
 }
 float VisualServerRaster::canvas_item_get_opacity(RID p_item, float p_opacity) const {
@@ -3294,9 +3481,10 @@ float VisualServerRaster::canvas_item_get_opacity(RID p_item, float p_opacity) c
 
 void VisualServerRaster::canvas_item_set_on_top(RID p_item, bool p_on_top) {
 
-	VS_CHANGED;
+	VS_CHANGED_LOCAL;
 	CanvasItem *canvas_item = canvas_item_owner.get(p_item);
 	ERR_FAIL_COND(!canvas_item);
+	_canvas_item_mark_screens(canvas_item);
 	canvas_item->ontop = p_on_top;
 }
 
@@ -3307,9 +3495,10 @@ bool VisualServerRaster::canvas_item_is_on_top(RID p_item) const {
 }
 
 void VisualServerRaster::canvas_item_set_self_opacity(RID p_item, float p_self_opacity) {
-	VS_CHANGED;
+	VS_CHANGED_LOCAL;
 	CanvasItem *canvas_item = canvas_item_owner.get(p_item);
 	ERR_FAIL_COND(!canvas_item);
+	_canvas_item_mark_screens(canvas_item);
 	canvas_item->self_opacity = p_self_opacity;
 }
 float VisualServerRaster::canvas_item_get_self_opacity(RID p_item, float p_self_opacity) const {
@@ -3320,9 +3509,10 @@ float VisualServerRaster::canvas_item_get_self_opacity(RID p_item, float p_self_
 }
 
 void VisualServerRaster::canvas_item_add_line(RID p_item, const Point2 &p_from, const Point2 &p_to, const Color &p_color, float p_width) {
-	VS_CHANGED;
+	VS_CHANGED_LOCAL;
 	CanvasItem *canvas_item = canvas_item_owner.get(p_item);
 	ERR_FAIL_COND(!canvas_item);
+	_canvas_item_mark_screens(canvas_item);
 
 	CanvasItem::CommandLine *line = memnew(CanvasItem::CommandLine);
 	ERR_FAIL_COND(!line);
@@ -3336,9 +3526,10 @@ void VisualServerRaster::canvas_item_add_line(RID p_item, const Point2 &p_from,
 }
 
 void VisualServerRaster::canvas_item_add_rect(RID p_item, const Rect2 &p_rect, const Color &p_color) {
-	VS_CHANGED;
+	VS_CHANGED_LOCAL;
 	CanvasItem *canvas_item = canvas_item_owner.get(p_item);
 	ERR_FAIL_COND(!canvas_item);
+	_canvas_item_mark_screens(canvas_item);
 
 	CanvasItem::CommandRect *rect = memnew(CanvasItem::CommandRect);
 	ERR_FAIL_COND(!rect);
@@ -3351,9 +3542,10 @@ void VisualServerRaster::canvas_item_add_rect(RID p_item, const Rect2 &p_rect, c
 
 void VisualServerRaster::canvas_item_add_circle(RID p_item, const Point2 &p_pos, float p_radius, const Color &p_color) {
 
-	VS_CHANGED;
+	VS_CHANGED_LOCAL;
 	CanvasItem *canvas_item = canvas_item_owner.get(p_item);
 	ERR_FAIL_COND(!canvas_item);
+	_canvas_item_mark_screens(canvas_item);
 
 	CanvasItem::CommandCircle *circle = memnew(CanvasItem::CommandCircle);
 	ERR_FAIL_COND(!circle);
@@ -3365,9 +3557,10 @@ void VisualServerRaster::canvas_item_add_circle(RID p_item, const Point2 &p_pos,
 }
 
 void VisualServerRaster::canvas_item_add_texture_rect(RID p_item, const Rect2 &p_rect, RID p_texture, bool p_tile, const Color &p_modulate, bool p_transpose) {
-	VS_CHANGED;
+	VS_CHANGED_LOCAL;
 	CanvasItem *canvas_item = canvas_item_owner.get(p_item);
 	ERR_FAIL_COND(!canvas_item);
+	_canvas_item_mark_screens(canvas_item);
 
 	CanvasItem::CommandRect *rect = memnew(CanvasItem::CommandRect);
 	ERR_FAIL_COND(!rect);
@@ -3400,9 +3593,10 @@ void VisualServerRaster::canvas_item_add_texture_rect(RID p_item, const Rect2 &p
 }
 
 void VisualServerRaster::canvas_item_add_texture_rect_region(RID p_item, const Rect2 &p_rect, RID p_texture, const Rect2 &p_src_rect, const Color &p_modulate, bool p_transpose) {
-	VS_CHANGED;
+	VS_CHANGED_LOCAL;
 	CanvasItem *canvas_item = canvas_item_owner.get(p_item);
 	ERR_FAIL_COND(!canvas_item);
+	_canvas_item_mark_screens(canvas_item);
 
 	CanvasItem::CommandRect *rect = memnew(CanvasItem::CommandRect);
 	ERR_FAIL_COND(!rect);
@@ -3434,9 +3628,10 @@ void VisualServerRaster::canvas_item_add_texture_rect_region(RID p_item, const R
 
 void VisualServerRaster::canvas_item_add_style_box(RID p_item, const Rect2 &p_rect, const Rect2 &p_source, RID p_texture, const Vector2 &p_topleft, const Vector2 &p_bottomright, bool p_draw_center, const Color &p_modulate) {
 
-	VS_CHANGED;
+	VS_CHANGED_LOCAL;
 	CanvasItem *canvas_item = canvas_item_owner.get(p_item);
 	ERR_FAIL_COND(!canvas_item);
+	_canvas_item_mark_screens(canvas_item);
 
 	CanvasItem::CommandStyle *style = memnew(CanvasItem::CommandStyle);
 	ERR_FAIL_COND(!style);
@@ -3454,9 +3649,10 @@ void VisualServerRaster::canvas_item_add_style_box(RID p_item, const Rect2 &p_re
 	canvas_item->commands.push_back(style);
 }
 void VisualServerRaster::canvas_item_add_primitive(RID p_item, const Vector<Point2> &p_points, const Vector<Color> &p_colors, const Vector<Point2> &p_uvs, RID p_texture, float p_width) {
-	VS_CHANGED;
+	VS_CHANGED_LOCAL;
 	CanvasItem *canvas_item = canvas_item_owner.get(p_item);
 	ERR_FAIL_COND(!canvas_item);
+	_canvas_item_mark_screens(canvas_item);
 
 	CanvasItem::CommandPrimitive *prim = memnew(CanvasItem::CommandPrimitive);
 	ERR_FAIL_COND(!prim);
@@ -3472,9 +3668,10 @@ void VisualServerRaster::canvas_item_add_primitive(RID p_item, const Vector<Poin
 
 void VisualServerRaster::canvas_item_add_polygon(RID p_item, const Vector<Point2> &p_points, const Vector<Color> &p_colors, const Vector<Point2> &p_uvs, RID p_texture) {
 
-	VS_CHANGED;
+	VS_CHANGED_LOCAL;
 	CanvasItem *canvas_item = canvas_item_owner.get(p_item);
 	ERR_FAIL_COND(!canvas_item);
+	_canvas_item_mark_screens(canvas_item);
 #ifdef DEBUG_ENABLED
 	int pointcount = p_points.size();
 	ERR_FAIL_COND(pointcount < 3);
@@ -3506,9 +3703,10 @@ void VisualServerRaster::canvas_item_add_polygon(RID p_item, const Vector<Point2
 
 void VisualServerRaster::canvas_item_add_triangle_array_ptr(RID p_item, int p_count, const int *p_indices, const Point2 *p_points, const Color *p_colors, const Point2 *p_uvs, RID p_texture) {
 
-	VS_CHANGED;
+	VS_CHANGED_LOCAL;
 	CanvasItem *canvas_item = canvas_item_owner.get(p_item);
 	ERR_FAIL_COND(!canvas_item);
+	_canvas_item_mark_screens(canvas_item);
 
 	ERR_FAIL_COND(p_count <= 0);
 
@@ -3529,9 +3727,10 @@ void VisualServerRaster::canvas_item_add_triangle_array_ptr(RID p_item, int p_co
 
 void VisualServerRaster::canvas_item_add_triangle_array(RID p_item, const Vector<int> &p_indices, const Vector<Point2> &p_points, const Vector<Color> &p_colors, const Vector<Point2> &p_uvs, RID p_texture, int p_count) {
 
-	VS_CHANGED;
+	VS_CHANGED_LOCAL;
 	CanvasItem *canvas_item = canvas_item_owner.get(p_item);
 	ERR_FAIL_COND(!canvas_item);
+	_canvas_item_mark_screens(canvas_item);
 
 	int ps = p_points.size();
 	ERR_FAIL_COND(!p_colors.empty() && p_colors.size() != ps && p_colors.size() != 1);
@@ -3568,9 +3767,10 @@ void VisualServerRaster::canvas_item_add_triangle_array(RID p_item, const Vector
 
 void VisualServerRaster::canvas_item_add_set_transform(RID p_item, const Matrix32 &p_transform) {
 
-	VS_CHANGED;
+	VS_CHANGED_LOCAL;
 	CanvasItem *canvas_item = canvas_item_owner.get(p_item);
 	ERR_FAIL_COND(!canvas_item);
+	_canvas_item_mark_screens(canvas_item);
 
 	CanvasItem::CommandTransform *tr = memnew(CanvasItem::CommandTransform);
 	ERR_FAIL_COND(!tr);
@@ -3581,9 +3781,10 @@ void VisualServerRaster::canvas_item_add_set_transform(RID p_item, const Matrix3
 
 void VisualServerRaster::canvas_item_add_set_blend_mode(RID p_item, MaterialBlendMode p_blend) {
 
-	VS_CHANGED;
+	VS_CHANGED_LOCAL;
 	CanvasItem *canvas_item = canvas_item_owner.get(p_item);
 	ERR_FAIL_COND(!canvas_item);
+	_canvas_item_mark_screens(canvas_item);
 
 	CanvasItem::CommandBlendMode *bm = memnew(CanvasItem::CommandBlendMode);
 	ERR_FAIL_COND(!bm);
@@ -3595,25 +3796,28 @@ void VisualServerRaster::canvas_item_add_set_blend_mode(RID p_item, MaterialBlen
 void VisualServerRaster::canvas_item_set_z(RID p_item, int p_z) {
 
 	ERR_FAIL_COND(p_z < CANVAS_ITEM_Z_MIN || p_z > CANVAS_ITEM_Z_MAX);
-	VS_CHANGED;
+	VS_CHANGED_LOCAL;
 	CanvasItem *canvas_item = canvas_item_owner.get(p_item);
 	ERR_FAIL_COND(!canvas_item);
+	_canvas_item_mark_screens(canvas_item);
 	canvas_item->z = p_z;
 }
 
 void VisualServerRaster::canvas_item_set_z_as_relative_to_parent(RID p_item, bool p_enable) {
 
-	VS_CHANGED;
+	VS_CHANGED_LOCAL;
 	CanvasItem *canvas_item = canvas_item_owner.get(p_item);
 	ERR_FAIL_COND(!canvas_item);
+	_canvas_item_mark_screens(canvas_item);
 	canvas_item->z_relative = p_enable;
 }
 
 void VisualServerRaster::canvas_item_set_copy_to_backbuffer(RID p_item, bool p_enable, const Rect2 &p_rect) {
 
-	VS_CHANGED;
+	VS_CHANGED_LOCAL;
 	CanvasItem *canvas_item = canvas_item_owner.get(p_item);
 	ERR_FAIL_COND(!canvas_item);
+	_canvas_item_mark_screens(canvas_item);
 	if (bool(canvas_item->copy_back_buffer != NULL) != p_enable) {
 		if (p_enable) {
 			canvas_item->copy_back_buffer = memnew(Rasterizer::CanvasItem::CopyBackBuffer);
@@ -3631,17 +3835,19 @@ void VisualServerRaster::canvas_item_set_copy_to_backbuffer(RID p_item, bool p_e
 
 void VisualServerRaster::canvas_item_set_use_parent_material(RID p_item, bool p_enable) {
 
-	VS_CHANGED;
+	VS_CHANGED_LOCAL;
 	CanvasItem *canvas_item = canvas_item_owner.get(p_item);
 	ERR_FAIL_COND(!canvas_item);
+	_canvas_item_mark_screens(canvas_item);
 	canvas_item->use_parent_material = p_enable;
 }
 
 void VisualServerRaster::canvas_item_set_material(RID p_item, RID p_material) {
 
-	VS_CHANGED;
+	VS_CHANGED_LOCAL;
 	CanvasItem *canvas_item = canvas_item_owner.get(p_item);
 	ERR_FAIL_COND(!canvas_item);
+	_canvas_item_mark_screens(canvas_item);
 
 	if (canvas_item->material)
 		canvas_item->material->owners.erase(canvas_item);
@@ -3656,17 +3862,19 @@ void VisualServerRaster::canvas_item_set_material(RID p_item, RID p_material) {
 
 void VisualServerRaster::canvas_item_set_sort_children_by_y(RID p_item, bool p_enable) {
 
-	VS_CHANGED;
+	VS_CHANGED_LOCAL;
 	CanvasItem *canvas_item = canvas_item_owner.get(p_item);
 	ERR_FAIL_COND(!canvas_item);
+	_canvas_item_mark_screens(canvas_item);
 	canvas_item->sort_y = p_enable;
 }
 
 void VisualServerRaster::canvas_item_add_clip_ignore(RID p_item, bool p_ignore) {
 
-	VS_CHANGED;
+	VS_CHANGED_LOCAL;
 	CanvasItem *canvas_item = canvas_item_owner.get(p_item);
 	ERR_FAIL_COND(!canvas_item);
+	_canvas_item_mark_screens(canvas_item);
 
 	CanvasItem::CommandClipIgnore *ci = memnew(CanvasItem::CommandClipIgnore);
 	ERR_FAIL_COND(!ci);
@@ -3676,17 +3884,19 @@ void VisualServerRaster::canvas_item_add_clip_ignore(RID p_item, bool p_ignore)
 }
 
 void VisualServerRaster::canvas_item_clear(RID p_item) {
-	VS_CHANGED;
+	VS_CHANGED_LOCAL;
 	CanvasItem *canvas_item = canvas_item_owner.get(p_item);
 	ERR_FAIL_COND(!canvas_item);
+	_canvas_item_mark_screens(canvas_item);
 
 	canvas_item->clear();
 }
 
 void VisualServerRaster::canvas_item_raise(RID p_item) {
-	VS_CHANGED;
+	VS_CHANGED_LOCAL;
 	CanvasItem *canvas_item = canvas_item_owner.get(p_item);
 	ERR_FAIL_COND(!canvas_item);
+	_canvas_item_mark_screens(canvas_item);
 
 	if (canvas_item->parent.is_valid()) {
 
@@ -4075,6 +4285,7 @@ void VisualServerRaster::black_bars_set_margins(int p_left, int p_top, int p_rig
 	black_margin[MARGIN_TOP] = p_top;
 	black_margin[MARGIN_RIGHT] = p_right;
 	black_margin[MARGIN_BOTTOM] = p_bottom;
+	_screen_mark_dirty(0);
 }
 
 void VisualServerRaster::black_bars_set_images(RID p_left, RID p_top, RID p_right, RID p_bottom) {
@@ -4083,6 +4294,7 @@ void VisualServerRaster::black_bars_set_images(RID p_left, RID p_top, RID p_righ
 	black_image[MARGIN_TOP] = p_top;
 	black_image[MARGIN_RIGHT] = p_right;
 	black_image[MARGIN_BOTTOM] = p_bottom;
+	_screen_mark_dirty(0);
 }
 
 void VisualServerRaster::_free_attached_instances(RID p_rid, bool p_free_scenario) {
@@ -5914,6 +6126,8 @@ void VisualServerRaster::_render_no_camera(Viewport *p_viewport, Camera *p_camer
 
 void VisualServerRaster::_render_camera(Viewport *p_viewport, Camera *p_camera, Scenario *p_scenario) {
 
+	ZONE_SCOPE("VisualServerRaster::render_camera");
+
 	render_pass++;
 	uint32_t camera_layer_mask = p_camera->visible_layers;
 
@@ -5953,6 +6167,20 @@ void VisualServerRaster::_render_camera(Viewport *p_viewport, Camera *p_camera,
 
 	Vector<Plane> planes = camera_matrix.get_projection_planes(p_camera->transform);
 
+	float eye_separation = ortho ? 0 : rasterizer->get_stereo_eye_separation();
+	if (eye_separation > 0) {
+
+		float aspect = viewport_rect.width / (float)viewport_rect.height;
+		float convergence = rasterizer->get_stereo_convergence();
+		CameraMatrix left_matrix, right_matrix;
+		left_matrix.set_perspective(p_camera->fov, aspect, p_camera->znear, p_camera->zfar, p_camera->vaspect, 1, eye_separation, convergence);
+		right_matrix.set_perspective(p_camera->fov, aspect, p_camera->znear, p_camera->zfar, p_camera->vaspect, 2, eye_separation, convergence);
+		rasterizer->set_stereo_camera(left_matrix, right_matrix);
+
+		// Both eyes draw the same culled list
+		planes = camera_matrix.get_stereo_projection_planes(p_camera->transform, eye_separation, convergence);
+	}
+
 	CullRange cull_range; // cull range is used for PSSM, and having an idea of the rendering depth
 	cull_range.nearp = Plane(p_camera->transform.origin, -p_camera->transform.basis.get_axis(2).normalized());
 	cull_range.z_near = camera_matrix.get_z_near();
@@ -5961,6 +6189,7 @@ void VisualServerRaster::_render_camera(Viewport *p_viewport, Camera *p_camera,
 	cull_range.max = cull_range.z_near;
 
 	/* STEP 2 - CULL */
+	uint64_t cull_begin = OS::get_singleton()->get_ticks_usec();
 	int cull_count = p_scenario->octree.cull_convex(planes, instance_cull_result, MAX_INSTANCE_CULL);
 	light_cull_count = 0;
 	light_samplers_culled = 0;
@@ -6151,6 +6380,8 @@ void VisualServerRaster::_render_camera(Viewport *p_viewport, Camera *p_camera,
 	if (cull_range.min < cull_range.z_near)
 		cull_range.min = cull_range.z_near;
 
+	culling_usec += OS::get_singleton()->get_ticks_usec() - cull_begin;
+
 	/* STEP 5 - PROCESS LIGHTS */
 
 	rasterizer->shadow_clear_near(); //clear near shadows, will be recreated
@@ -6429,6 +6660,7 @@ void VisualServerRaster::_render_canvas_item(CanvasItem *p_canvas_item, const Ma
 		}
 
 		ci->next = NULL;
+		canvas_items_in_frame++;
 	}
 
 	for (int i = 0; i < child_item_count; i++) {
@@ -6464,6 +6696,8 @@ void VisualServerRaster::_light_mask_canvas_items(int p_z, Rasterizer::CanvasIte
 
 void VisualServerRaster::_render_canvas(Canvas *p_canvas, const Matrix32 &p_transform, Rasterizer::CanvasLight *p_lights, Rasterizer::CanvasLight *p_masked_lights) {
 
+	ZONE_SCOPE("VisualServerRaster::render_canvas");
+
 	rasterizer->canvas_begin();
 
 	int l = p_canvas->child_items.size();
@@ -6842,13 +7076,22 @@ void VisualServerRaster::_draw_viewports() {
 		rasterizer->canvas_draw_rect(E->get()->rt_to_screen_rect, 0, Rect2(Point2(), E->get()->rt_to_screen_rect.size), E->get()->render_target_texture, Color(1, 1, 1));
 	}
 
-	//draw viewports attached to screen
+	//draw viewports attached to screen, screens not needing an update keep their last image
 
+	int current_screen = -1;
 	for (Map<RID, int>::Element *E = screen_viewports.front(); E; E = E->next()) {
 
 		Viewport *vp = viewport_owner.get(E->key());
 		ERR_CONTINUE(!vp);
 
+		if (!_screen_needs_draw(E->get()))
+			continue;
+
+		if (E->get() != current_screen) {
+			current_screen = E->get();
+			_set_screen(current_screen);
+		}
+
 		int window_w = OS::get_singleton()->get_video_mode(E->get()).width;
 		int window_h = OS::get_singleton()->get_video_mode(E->get()).height;
 
@@ -6875,6 +7118,11 @@ void VisualServerRaster::_draw_viewports() {
 
 void VisualServerRaster::_draw_cursors_and_margins() {
 
+	if (!_screen_needs_draw(0))
+		return;
+
+	_set_screen(0);
+
 	int window_w = OS::get_singleton()->get_video_mode().width;
 	int window_h = OS::get_singleton()->get_video_mode().height;
 
@@ -6932,9 +7180,13 @@ void VisualServerRaster::sync() {
 }
 
 void VisualServerRaster::draw() {
+
+	ZONE_SCOPE("VisualServerRaster::draw");
 	//if (changes)
 	//	print_line("changes: "+itos(changes));
 	changes = 0;
+	culling_usec = 0;
+	canvas_items_in_frame = 0;
 	shadows_enabled = GLOBAL_DEF("render/shadows_enabled", true);
 	room_cull_enabled = GLOBAL_DEF("render/room_cull_enabled", true);
 	light_discard_enabled = GLOBAL_DEF("render/light_discard_enabled", true);
@@ -6943,6 +7195,9 @@ void VisualServerRaster::draw() {
 	_draw_cursors_and_margins();
 	rasterizer->end_frame();
 	draw_extra_frame = rasterizer->needs_to_draw_next_frame();
+
+	for (Map<int, Screen>::Element *E = screens.front(); E; E = E->next())
+		E->get().dirty = draw_extra_frame;
 }
 
 bool VisualServerRaster::has_changed() const {
@@ -6952,6 +7207,13 @@ bool VisualServerRaster::has_changed() const {
 
 int VisualServerRaster::get_render_info(RenderInfo p_info) {
 
+	// culling and canvas item gathering happen here, not in the rasterizer
+	switch (p_info) {
+		case INFO_CULLING_TIME_USEC: return culling_usec;
+		case INFO_CANVAS_ITEMS_IN_FRAME: return canvas_items_in_frame;
+		default: {}
+	}
+
 	return rasterizer->get_render_info(p_info);
 }
 
@@ -7108,6 +7370,8 @@ VisualServerRaster::VisualServerRaster(Rasterizer *p_rasterizer) {
 	clear_color = Color(0.3, 0.3, 0.3, 1.0);
 	OctreeAllocator::allocator = &octree_allocator;
 	draw_extra_frame = false;
+	culling_usec = 0;
+	canvas_items_in_frame = 0;
 }
 
 VisualServerRaster::~VisualServerRaster() {
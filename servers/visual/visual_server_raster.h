@@ -529,6 +529,30 @@ class VisualServerRaster : public VisualServer {
 
 	Map<RID, int> screen_viewports;
 
+	struct Screen {
+
+		ScreenUpdateMode update_mode;
+		bool dirty;
+
+		Screen() {
+			update_mode = SCREEN_UPDATE_ALWAYS;
+			dirty = true;
+		}
+	};
+
+	// only screens not using SCREEN_UPDATE_ALWAYS
+	Map<int, Screen> screens;
+
+	bool _screen_needs_draw(int p_screen) const;
+	void _screen_mark_dirty(int p_screen);
+	void _screens_mark_dirty();
+	void _viewport_mark_screens(RID p_viewport);
+	void _canvas_mark_screens(Canvas *p_canvas);
+	void _canvas_item_mark_screens(CanvasItem *p_canvas_item);
+	void _scenario_mark_screens(Scenario *p_scenario);
+	void _camera_mark_screens(RID p_camera);
+	void _set_screen(int p_screen);
+
 	struct CullRange {
 
 		Plane nearp;
@@ -581,6 +605,9 @@ class VisualServerRaster : public VisualServer {
 	int black_margin[4];
 	RID black_image[4];
 
+	uint64_t culling_usec;
+	int canvas_items_in_frame;
+
 	Vector<Vector3> aabb_random_points;
 	Vector<Vector3> transformed_aabb_random_points;
 
@@ -987,6 +1014,9 @@ public:
 	virtual void viewport_attach_to_screen(RID p_viewport, int p_screen = 0);
 	virtual void viewport_detach(RID p_viewport);
 
+	virtual void screen_set_update_mode(int p_screen, ScreenUpdateMode p_mode);
+	virtual ScreenUpdateMode screen_get_update_mode(int p_screen) const;
+
 	virtual void viewport_set_as_render_target(RID p_viewport, bool p_enable);
 	virtual void viewport_set_render_target_update_mode(RID p_viewport, RenderTargetUpdateMode p_mode);
 	virtual RenderTargetUpdateMode viewport_get_render_target_update_mode(RID p_viewport) const;
@@ -415,6 +415,8 @@ public:
 
 	FUNC2(viewport_attach_to_screen, RID, int);
 	FUNC1(viewport_detach, RID);
+	FUNC2(screen_set_update_mode, int, ScreenUpdateMode);
+	FUNC1RC(ScreenUpdateMode, screen_get_update_mode, int);
 
 	FUNC2(viewport_set_as_render_target, RID, bool);
 	FUNC2(viewport_set_render_target_update_mode, RID, RenderTargetUpdateMode);
@@ -670,6 +670,14 @@ void VisualServer::_bind_methods() {
 	BIND_CONSTANT(INFO_VIDEO_MEM_USED);
 	BIND_CONSTANT(INFO_TEXTURE_MEM_USED);
 	BIND_CONSTANT(INFO_VERTEX_MEM_USED);
+	BIND_CONSTANT(INFO_TEXTURE_ATLAS_PAGES);
+	BIND_CONSTANT(INFO_TEXTURE_ATLAS_EFFICIENCY);
+	BIND_CONSTANT(INFO_INDEX_MEM_USED);
+	BIND_CONSTANT(INFO_TEXTURE_EVICTIONS);
+	BIND_CONSTANT(INFO_CULLING_TIME_USEC);
+	BIND_CONSTANT(INFO_CANVAS_ITEMS_IN_FRAME);
+	BIND_CONSTANT(INFO_CANVAS_BATCHES_IN_FRAME);
+	BIND_CONSTANT(INFO_TEXTURE_UPLOADS_IN_FRAME);
 }
 
 void VisualServer::_canvas_item_add_style_box(RID p_item, const Rect2 &p_rect, const Rect2 &p_source, RID p_texture, const Vector<float> &p_margins, const Color &p_modulate) {
@@ -683,6 +683,14 @@ public:
 	virtual void viewport_detach(RID p_viewport) = 0;
 	virtual void viewport_set_render_target_to_screen_rect(RID p_viewport, const Rect2 &p_rect) = 0;
 
+	enum ScreenUpdateMode {
+		SCREEN_UPDATE_ALWAYS, // default
+		SCREEN_UPDATE_WHEN_DIRTY, // keep the last image until something shown on the screen changes
+	};
+
+	virtual void screen_set_update_mode(int p_screen, ScreenUpdateMode p_mode) = 0;
+	virtual ScreenUpdateMode screen_get_update_mode(int p_screen) const = 0;
+
 	enum RenderTargetUpdateMode {
 		RENDER_TARGET_UPDATE_DISABLED,
 		RENDER_TARGET_UPDATE_ONCE, //then goes to disabled
@@ -1109,6 +1117,14 @@ public:
 		INFO_VIDEO_MEM_USED,
 		INFO_TEXTURE_MEM_USED,
 		INFO_VERTEX_MEM_USED,
+		INFO_TEXTURE_ATLAS_PAGES,
+		INFO_TEXTURE_ATLAS_EFFICIENCY,
+		INFO_INDEX_MEM_USED,
+		INFO_TEXTURE_EVICTIONS,
+		INFO_CULLING_TIME_USEC,
+		INFO_CANVAS_ITEMS_IN_FRAME,
+		INFO_CANVAS_BATCHES_IN_FRAME,
+		INFO_TEXTURE_UPLOADS_IN_FRAME,
 	};
 
 	virtual int get_render_info(RenderInfo p_info) = 0;